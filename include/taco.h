@@ -4,5 +4,6 @@
 #include "taco/tensor.h"
 #include "taco/format.h"
 #include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/semiring.h"
 
 #endif
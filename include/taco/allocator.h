@@ -0,0 +1,207 @@
+#ifndef TACO_ALLOCATOR_H
+#define TACO_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "taco/taco_allocator_t.h"
+
+namespace taco {
+
+/// An allocator for the arrays that generated kernels allocate.  Arrays of
+/// results are owned by the result tensors, which release them with `free`, so
+/// they must come from the system heap, but temporaries such as workspaces and
+/// coordinate lists can be served from memory that the allocator manages.  The
+/// default implementation allocates every array from the system heap.
+class KernelAllocator {
+public:
+  KernelAllocator();
+  virtual ~KernelAllocator();
+
+  /// Allocate `size` bytes by the default allocation policy, which aligns
+  /// them to at least 64 bytes.
+  virtual void* allocate(size_t size, bool temporary);
+
+  /// Resize an array allocated by this allocator, preserving its contents.
+  virtual void* reallocate(void* ptr, size_t size, bool temporary);
+
+  /// Release an array allocated by this allocator.
+  virtual void deallocate(void* ptr, bool temporary);
+
+  /// Called before and after each kernel call while the allocator is
+  /// installed.  Calls may be nested or run concurrently on several threads.
+  /// @{
+  virtual void beginKernel();
+  virtual void endKernel();
+  /// @}
+
+  /// Returns the hooks that generated code calls into.
+  taco_allocator_t* getHooks();
+
+private:
+  // The hooks are the first member, so that the hooks that generated code
+  // passes back can be cast to the struct that points to the allocator
+  struct Hooks {
+    taco_allocator_t hooks;
+    KernelAllocator* allocator;
+  };
+  Hooks hooks;
+
+  static void* allocateHook(taco_allocator_t* hooks, size_t size,
+                            int32_t temporary);
+  static void* reallocateHook(taco_allocator_t* hooks, void* ptr, size_t size,
+                              int32_t temporary);
+  static void deallocateHook(taco_allocator_t* hooks, void* ptr,
+                             int32_t temporary);
+  static KernelAllocator* getAllocator(taco_allocator_t* hooks);
+};
+
+/// A bump allocator that serves temporaries from large chunks of memory and
+/// releases them all at once when no kernel is running.  Chunks are kept for
+/// the next call, so a kernel that is called repeatedly on similar inputs
+/// allocates its temporaries without calling into the system allocator.
+/// Temporaries that are the last block of their chunk grow in place, while
+/// other temporaries that are reallocated are copied to a new block and keep
+/// their old block until the arena is released, so a kernel that repeatedly
+/// grows interleaved temporaries reserves the sum of their old sizes.
+class ArenaAllocator : public KernelAllocator {
+public:
+  /// Create an arena whose chunks are at least `chunkSize` bytes.
+  explicit ArenaAllocator(size_t chunkSize = 1 << 20);
+  ~ArenaAllocator();
+
+  void* allocate(size_t size, bool temporary);
+  void* reallocate(void* ptr, size_t size, bool temporary);
+  void deallocate(void* ptr, bool temporary);
+  void beginKernel();
+  void endKernel();
+
+  /// Release all temporaries.  Must not be called while a kernel runs.
+  void reset();
+
+  /// Returns the number of bytes the arena has reserved.
+  size_t getReservedBytes() const;
+
+private:
+  struct Chunk {
+    char*  data;
+    size_t size;
+  };
+  std::vector<Chunk> chunks;
+  size_t chunkSize;
+  size_t current;
+  size_t offset;
+  int activeKernels;
+  mutable std::mutex mutex;
+
+  void resetLocked();
+};
+
+/// A pool that keeps released temporaries in free lists of power-of-two size
+/// classes and hands them out again, so that workspaces are reused across
+/// kernel calls.
+class WorkspacePool : public KernelAllocator {
+public:
+  WorkspacePool();
+  ~WorkspacePool();
+
+  void* allocate(size_t size, bool temporary);
+  void* reallocate(void* ptr, size_t size, bool temporary);
+  void deallocate(void* ptr, bool temporary);
+
+  /// Return all pooled temporaries to the system allocator.
+  void clear();
+
+  /// Returns the number of bytes held by released temporaries.
+  size_t getPooledBytes() const;
+
+private:
+  std::vector<std::vector<void*>> freeLists;
+  size_t pooledBytes;
+  mutable std::mutex mutex;
+};
+
+/// The workspaces that a compiled kernel keeps across calls when it is lowered
+/// with `WorkspaceLifetime::Persistent`.  Every thread that calls the kernel
+/// gets its own workspaces, which are freed when the thread exits.
+class WorkspaceCache {
+public:
+  WorkspaceCache();
+  ~WorkspaceCache();
+
+  WorkspaceCache(const WorkspaceCache&) = delete;
+  WorkspaceCache& operator=(const WorkspaceCache&) = delete;
+
+  /// Returns the calling thread's workspace `id`, reallocated if it holds less
+  /// than `size` bytes.  Reallocated workspaces are zeroed if `clear` is true.
+  void* acquire(int id, size_t size, bool clear);
+
+  /// Free the workspaces of all threads.  Must not be called while a kernel
+  /// that uses them runs.
+  void release();
+
+  /// Returns the number of bytes held by the workspaces of all threads.
+  size_t getSize() const;
+
+  /// Returns the hooks that generated code calls into.
+  taco_workspace_cache_t* getHooks();
+
+private:
+  struct Workspace {
+    void*  data;
+    size_t size;
+  };
+  struct ThreadWorkspaces;
+  struct Hooks {
+    taco_workspace_cache_t hooks;
+    WorkspaceCache* cache;
+  };
+  Hooks hooks;
+
+  static void* acquireHook(taco_workspace_cache_t* hooks, int32_t id,
+                           size_t size, int32_t clear);
+  static ThreadWorkspaces& getThreadWorkspaces();
+  void freeLocked(std::map<int,Workspace>& workspaces);
+
+  // Identifies the cache's workspaces in the workspaces of threads, which
+  // outlive caches that are destroyed before the threads exit
+  uint64_t id;
+  std::set<ThreadWorkspaces*> threads;
+  size_t size;
+};
+
+/// Set the allocator that generated kernels allocate arrays with from now on,
+/// or restore the system allocator if `allocator` is null.
+void setKernelAllocator(std::shared_ptr<KernelAllocator> allocator);
+
+/// Get the allocator that generated kernels called by this thread allocate
+/// arrays with, or null if they use the system allocator.
+std::shared_ptr<KernelAllocator> getKernelAllocator();
+
+/// Get the allocator installed by a `ScopedKernelAllocator` of the calling
+/// thread, or null if there is none.
+KernelAllocator* getScopedKernelAllocator();
+
+/// Makes the kernels that the calling thread calls while the object is alive
+/// allocate arrays with `allocator`, in place of the one set by
+/// `setKernelAllocator`.
+class ScopedKernelAllocator {
+public:
+  explicit ScopedKernelAllocator(std::shared_ptr<KernelAllocator> allocator);
+  ~ScopedKernelAllocator();
+
+  ScopedKernelAllocator(const ScopedKernelAllocator&) = delete;
+  ScopedKernelAllocator& operator=(const ScopedKernelAllocator&) = delete;
+
+private:
+  std::shared_ptr<KernelAllocator> previous;
+};
+
+}
+#endif
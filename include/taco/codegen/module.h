@@ -2,11 +2,13 @@
 #define TACO_MODULE_H
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <utility>
 
 #include "taco/target.h"
+#include "taco/allocator.h"
 #include "taco/ir/ir.h"
 
 namespace taco {
@@ -16,7 +18,9 @@ class Module {
 public:
   /// Create a module for some target
   Module(Target target=getTargetFromEnvironment())
-    : lib_handle(nullptr), moduleFromUserSource(false), target(target) {
+    : lib_handle(nullptr), setAllocator(nullptr), setWorkspaceCache(nullptr),
+      parallel(false), workspaces(std::make_shared<WorkspaceCache>()),
+      moduleFromUserSource(false), target(target) {
     setJITLibname();
     setJITTmpdir();
   }
@@ -37,6 +41,12 @@ public:
 
   /// Get the source of the module as a string */
   std::string getSource();
+
+  /// Get a report of the loops in the source that the C compiler vectorized
+  /// and of the loops that were marked for vectorization but not vectorized,
+  /// by source line.  The report is empty if the module has not been compiled
+  /// or if the compiler's optimization remarks are not understood.
+  std::string getVectorizationReport();
   
   /// Get a function pointer to a compiled function. This returns a void*
   /// pointer, which the caller is required to cast to the correct function type
@@ -46,6 +56,19 @@ public:
 
   /// Call a raw function in this module and return the result
   int callFuncPackedRaw(std::string name, void** args);
+
+  /// Call a raw function of this module, obtained from `getFuncPtr`, and
+  /// return the result.  This skips looking the function up by name, and may
+  /// be called concurrently from several threads.  The function allocates
+  /// arrays with the allocator of the calling thread (`getKernelAllocator`).
+  int callFuncPtrRaw(void* funcPtr, void** args);
+
+  /// Call a raw function of this module, which allocates arrays with
+  /// `allocator`, or with the system allocator if it is null, and keeps
+  /// persistent workspaces in `workspaces`, or in the module's own cache if it
+  /// is null.
+  int callFuncPtrRaw(void* funcPtr, void** args, KernelAllocator* allocator,
+                     WorkspaceCache* workspaces=nullptr);
   
   /// Call a raw function in this module and return the result
   int callFuncPackedRaw(std::string name, std::vector<void*> args) {
@@ -61,16 +84,42 @@ public:
   int callFuncPacked(std::string name, std::vector<void*> args) {
     return callFuncPacked(name, args.data());
   }
+
+  /// Call a function using the taco_tensor_t interface, which allocates arrays
+  /// with `allocator` and keeps persistent workspaces in `workspaces`, and
+  /// return the result
+  int callFuncPacked(std::string name, void** args,
+                     KernelAllocator* allocator,
+                     WorkspaceCache* workspaces=nullptr) {
+    return callFuncPtrRaw(getFuncPtr("_shim_"+name), args, allocator,
+                          workspaces);
+  }
   
   /// Set the source of the module
   void setSource(std::string source);
+
+  /// Free the workspaces that the module's functions keep across calls in the
+  /// module's own cache.  Must not be called while one of the functions runs.
+  void releaseWorkspaces();
+
+  /// Get the number of bytes held by workspaces that the module's functions
+  /// keep across calls in the module's own cache.
+  size_t getWorkspaceSize() const;
   
 private:
   std::stringstream source;
   std::stringstream header;
+  std::string vectorizationReport;
   std::string libname;
   std::string tmpdir;
   void* lib_handle;
+  // the generated function that sets the calling thread's allocator hooks
+  void (*setAllocator)(taco_allocator_t*);
+  // the generated function that sets the calling thread's workspace cache
+  void (*setWorkspaceCache)(taco_workspace_cache_t*);
+  // true iff the generated code has parallel loops
+  bool parallel;
+  std::shared_ptr<WorkspaceCache> workspaces;
   std::vector<Stmt> funcs;
   
   // true iff the module was created from user-provided source
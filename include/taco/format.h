@@ -65,10 +65,23 @@ public:
   /// Sets the types of the coordinate arrays for each level
   void setLevelArrayTypes(std::vector<std::vector<Datatype>> levelArrayTypes);
 
+  /// Returns true if the format stores a symmetric matrix as its lower
+  /// triangle.  Only the components whose mode 0 coordinate is no smaller than
+  /// their mode 1 coordinate are stored, and kernels that read the matrix
+  /// account for the mirrored components of the upper triangle.  Components
+  /// inserted into the upper triangle are stored as their mirror, unless the
+  /// mirror is inserted too.
+  bool isSymmetric() const;
+
+  /// Sets whether the format stores a symmetric matrix as its lower triangle.
+  /// Only order 2 formats can be symmetric.
+  void setSymmetric(bool symmetric);
+
 private:
   std::vector<ModeFormatPack> modeFormatPacks;
   std::vector<int> modeOrdering;
   std::vector<std::vector<Datatype>> levelArrayTypes;
+  bool symmetric = false;
 };
 
 bool operator==(const Format&, const Format&);
@@ -469,6 +469,24 @@ IndexExpr heaviside(IndexExpr, IndexExpr = IndexExpr());
 
 IndexExpr Not(IndexExpr);
 
+/// Restrict an expression to the coordinates stored in a mask, in the manner
+/// of a GraphBLAS structural mask.  Only the sparsity structure of the mask
+/// access is used, and iteration is driven by it so that masked-out
+/// components are never computed.
+/// ```
+/// C(i,j) = mask(M(i,j), A(i,k) * B(j,k));
+/// ```
+IndexExpr mask(IndexExpr m, IndexExpr expr);
+
+/// Restrict an expression to the coordinates that are not stored in a mask.
+IndexExpr maskComplement(IndexExpr m, IndexExpr expr);
+
+/// Read the components of a matrix that are not on its diagonal.  Assignments
+/// whose right-hand side reads the matrix through `offDiagonal` are skipped
+/// where the two coordinates of the access are equal, which `exploitSymmetry`
+/// uses to scatter the stored triangle of a symmetric matrix to its mirror.
+IndexExpr offDiagonal(IndexExpr a);
+
 
 /// A reduction over the components indexed by the reduction variable.
 class Reduction : public IndexExpr {
@@ -529,7 +547,9 @@ public:
   /// starting point of a tile can require an $O(n)$ or $O(\log (n))$
   /// search.  Therefore, if we want to parallelize a blocked
   /// loop, then we want a fixed number of blocks and not a number
-  /// proportional to the tensor size.
+  /// proportional to the tensor size.  Dividing the position variable of a
+  /// fused loop (see fuse and pos) gives each outer iteration an equal share
+  /// of the nonzeros, which load balances matrices with skewed row lengths.
   /// Preconditions: divideFactor is a positive nonzero integer
   IndexStmt divide(IndexVar i, IndexVar i1, IndexVar i2, size_t divideFactor) const; // TODO: TailStrategy
 
@@ -594,6 +614,10 @@ public:
   /// assume that no data races will occur. For all other strategies other than Atomics,
   /// there is the precondition
   /// that the racing reduction must be over the index variable being parallelized.
+  /// When Atomics is used on a loop whose body is a fused position loop that
+  /// reduces into a result indexed by the fused coordinates (e.g. SpMV), the
+  /// reduction is carried in a scalar temporary that is written once per row,
+  /// and only rows that may be shared with other iterations are written atomically.
   IndexStmt parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy) const;
 
   /// pos and coord create
@@ -654,6 +678,16 @@ public:
   /// integer number of iterations
   /// Preconditions: unrollFactor is a positive nonzero integer
   IndexStmt unroll(IndexVar i, size_t unrollFactor) const;
+
+  /// The coiterate primitive selects how the loop over i advances the
+  /// iterators it intersects: one coordinate at a time (Merge), by galloping
+  /// over coordinates that cannot match (Gallop), or by comparing blocks of
+  /// coordinates at a time (SIMDMerge).  By default (Auto) the strategy is
+  /// chosen at runtime from the sizes of the intersected segments.
+  ///
+  /// Preconditions:
+  /// Loops that do not intersect ordered compressed levels always merge.
+  IndexStmt coiterate(IndexVar i, CoIterationStrategy strategy) const;
 };
 
 /// Check if two index statements are isomorphic.
@@ -732,7 +766,8 @@ public:
   Forall() = default;
   Forall(const ForallNode*);
   Forall(IndexVar indexVar, IndexStmt stmt);
-  Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0);
+  Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0,
+         CoIterationStrategy coiterationStrategy = CoIterationStrategy::Auto);
 
   IndexVar getIndexVar() const;
   IndexStmt getStmt() const;
@@ -742,12 +777,15 @@ public:
 
   size_t getUnrollFactor() const;
 
+  CoIterationStrategy getCoIterationStrategy() const;
+
   typedef ForallNode Node;
 };
 
 /// Create a forall index statement.
 Forall forall(IndexVar i, IndexStmt stmt);
-Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0);
+Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0,
+              CoIterationStrategy coiterationStrategy = CoIterationStrategy::Auto);
 
 
 /// A where statment has a producer statement that binds a tensor variable in
@@ -948,6 +986,13 @@ public:
   /// Returns the format of the tensor variable.
   const Format& getFormat() const;
 
+  /// Returns the fill value of the tensor variable, which is the value of the
+  /// components that are not stored.  Defaults to zero.
+  Literal getFill() const;
+
+  /// Set the fill value of the tensor variable.
+  void setFill(Literal fill);
+
   /// Returns the schedule of the tensor var, which describes how to compile
   /// and execute it's expression.
   const Schedule& getSchedule() const;
@@ -1070,6 +1115,15 @@ IndexExpr zero(IndexExpr, const std::set<Access>& zeroed);
 /// zero and then propagating and removing zeroes.
 IndexStmt zero(IndexStmt, const std::set<Access>& zeroed);
 
+/// Returns the value an index expression takes at coordinates where none of
+/// its operands are stored, which is computed from the fill values of the
+/// accessed tensors.  Returns an undefined literal if the value cannot be
+/// computed at compile time.
+Literal getFillValue(IndexExpr);
+
+/// Returns true if the literal is zero.
+bool isZero(Literal);
+
 /// Create an `other` tensor with the given name and format, 
 /// and return tensor(indexVars) = other(indexVars) if otherIsOnRight,
 /// and otherwise returns other(indexVars) = tensor(indexVars).
@@ -230,8 +230,10 @@ struct YieldNode : public IndexStmtNode {
 };
 
 struct ForallNode : public IndexStmtNode {
-  ForallNode(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy  output_race_strategy, size_t unrollFactor = 0)
-      : indexVar(indexVar), stmt(stmt), parallel_unit(parallel_unit), output_race_strategy(output_race_strategy), unrollFactor(unrollFactor) {}
+  ForallNode(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy  output_race_strategy, size_t unrollFactor = 0,
+             CoIterationStrategy coiteration_strategy = CoIterationStrategy::Auto)
+      : indexVar(indexVar), stmt(stmt), parallel_unit(parallel_unit), output_race_strategy(output_race_strategy), unrollFactor(unrollFactor),
+        coiteration_strategy(coiteration_strategy) {}
 
   void accept(IndexStmtVisitorStrict* v) const {
     v->visit(this);
@@ -242,6 +244,7 @@ struct ForallNode : public IndexStmtNode {
   ParallelUnit parallel_unit;
   OutputRaceStrategy  output_race_strategy;
   size_t unrollFactor = 0;
+  CoIterationStrategy coiteration_strategy = CoIterationStrategy::Auto;
 };
 
 struct WhereNode : public IndexStmtNode {
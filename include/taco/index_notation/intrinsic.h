@@ -74,6 +74,9 @@ DECLARE_INTRINSIC(Max)
 DECLARE_INTRINSIC(Min)
 DECLARE_INTRINSIC(Heaviside)
 DECLARE_INTRINSIC(Not)
+DECLARE_INTRINSIC(Mask)
+DECLARE_INTRINSIC(MaskComplement)
+DECLARE_INTRINSIC(OffDiagonal)
 
 }
 
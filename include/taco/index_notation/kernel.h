@@ -4,6 +4,8 @@
 #include <vector>
 #include <memory>
 
+#include "taco/taco_tensor_t.h"
+
 namespace taco {
 
 class Function;
@@ -18,13 +20,18 @@ class Module;
 /// component values of the result tensors in the concrete index statement.
 /// They can be called to do all these things at once (`evaluate`), to only
 /// allocate memory and assemble indices (`assemble`), or to only compute
-/// component values (`compute`).
+/// component values (`compute`).  A kernel keeps no state between calls, so
+/// it may be called concurrently from several threads on arguments that do
+/// not share result tensors.  Kernels allocate arrays with the allocator that
+/// is installed by `setKernelAllocator` when they are made, or with the one of
+/// a `ScopedKernelAllocator` of the calling thread.
 class Kernel {
 public:
   /// Construct an undefined kernel.
   Kernel();
 
-  /// Construct a kernel from relevant function pointers and a module.
+  /// Construct a kernel from a module and pointers to its packed functions,
+  /// which take an array of arguments.
   Kernel(IndexStmt stmt, std::shared_ptr<ir::Module> module,
          void* evaluate, void* assemble, void* compute);
 
@@ -54,6 +61,15 @@ public:
   }
   /// @}
 
+  /// Execute the kernel on raw tensors, the results followed by the operands,
+  /// without converting arguments or unpacking results.  The caller owns the
+  /// arrays that `evaluate` and `assemble` allocate for the results.
+  /// @{
+  bool evaluate(taco_tensor_t** args) const;
+  bool assemble(taco_tensor_t** args) const;
+  bool compute(taco_tensor_t** args) const;
+  /// @}
+
   /// Check whether the kernel is defined.
   bool defined();
 
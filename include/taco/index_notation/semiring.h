@@ -0,0 +1,134 @@
+#ifndef TACO_SEMIRING_H
+#define TACO_SEMIRING_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taco/type.h"
+#include "taco/ir/ir.h"
+#include "taco/index_notation/intrinsic.h"
+#include "taco/index_notation/index_notation.h"
+
+namespace taco {
+
+/// A semiring replaces the + and * of index notation with a user-defined
+/// addition and multiplication.  Components that are not stored in a sparse
+/// operand are implicitly equal to the additive identity of the semiring, so
+/// a semiring kernel only visits coordinates where that identity may be
+/// overwritten.
+class Semiring {
+public:
+  virtual ~Semiring() {}
+
+  /// Returns the name of the semiring.
+  virtual std::string getName() const = 0;
+
+  /// Emits IR that combines two values with the semiring addition.
+  virtual ir::Expr add(ir::Expr a, ir::Expr b) const = 0;
+
+  /// Emits IR that combines two values with the semiring multiplication.
+  virtual ir::Expr multiply(ir::Expr a, ir::Expr b) const = 0;
+
+  /// Returns the identity of the semiring addition, which results and
+  /// workspaces that are reduced into are initialized to.
+  virtual IndexExpr addIdentity(Datatype type) const = 0;
+
+  /// Returns the annihilator of the semiring multiplication, or an undefined
+  /// expression if it has none.  Defaults to the additive identity.
+  virtual IndexExpr annihilator(Datatype type) const;
+
+  /// Returns true if the additive identity annihilates multiplication, in which
+  /// case a product only needs to be computed where all operands are stored.
+  bool identityAnnihilates(Datatype type) const;
+};
+
+/// The conventional (+, *) semiring.
+class PlusTimesSemiring : public Semiring {
+public:
+  std::string getName() const;
+  ir::Expr add(ir::Expr a, ir::Expr b) const;
+  ir::Expr multiply(ir::Expr a, ir::Expr b) const;
+  IndexExpr addIdentity(Datatype type) const;
+};
+
+/// The tropical (min, +) semiring used for shortest paths.  The additive
+/// identity is +infinity, so it requires a floating-point type.
+class MinPlusSemiring : public Semiring {
+public:
+  std::string getName() const;
+  ir::Expr add(ir::Expr a, ir::Expr b) const;
+  ir::Expr multiply(ir::Expr a, ir::Expr b) const;
+  IndexExpr addIdentity(Datatype type) const;
+};
+
+/// The (max, *) semiring over non-negative values used for Viterbi-style
+/// most-likely-path computations.
+class MaxTimesSemiring : public Semiring {
+public:
+  std::string getName() const;
+  ir::Expr add(ir::Expr a, ir::Expr b) const;
+  ir::Expr multiply(ir::Expr a, ir::Expr b) const;
+  IndexExpr addIdentity(Datatype type) const;
+};
+
+/// The boolean (or, and) semiring used for reachability.
+class OrAndSemiring : public Semiring {
+public:
+  std::string getName() const;
+  ir::Expr add(ir::Expr a, ir::Expr b) const;
+  ir::Expr multiply(ir::Expr a, ir::Expr b) const;
+  IndexExpr addIdentity(Datatype type) const;
+};
+
+/// Intrinsic that applies one of the two operations of a semiring.  A call
+/// without arguments is used as the operator of reductions and compound
+/// assignments.
+class SemiringIntrinsic : public Intrinsic {
+public:
+  enum Operation {Addition, Multiplication};
+
+  SemiringIntrinsic(std::shared_ptr<Semiring> semiring, Operation operation);
+
+  std::string getName() const;
+  Datatype inferReturnType(const std::vector<Datatype>&) const;
+  ir::Expr lower(const std::vector<ir::Expr>&) const;
+  std::vector<std::vector<size_t>>
+  zeroPreservingArgs(const std::vector<IndexExpr>&) const;
+
+  const std::shared_ptr<Semiring>& getSemiring() const;
+  Operation getOperation() const;
+
+private:
+  std::shared_ptr<Semiring> semiring;
+  Operation operation;
+};
+
+/// Returns the semiring intrinsic that `expr` calls, or nullptr if `expr` is
+/// not a call to a semiring operation.
+const SemiringIntrinsic* getSemiringIntrinsic(IndexExpr expr);
+
+/// Combine two expressions with the addition of a semiring.
+IndexExpr semiringAdd(std::shared_ptr<Semiring> semiring,
+                      IndexExpr a, IndexExpr b);
+
+/// Combine two expressions with the multiplication of a semiring.
+IndexExpr semiringMul(std::shared_ptr<Semiring> semiring,
+                      IndexExpr a, IndexExpr b);
+
+/// Reduce an expression over an index variable with the addition of a
+/// semiring.
+Reduction reduce(IndexVar i, std::shared_ptr<Semiring> semiring,
+                 IndexExpr expr);
+
+/// Reinterpret the additions, multiplications and sum reductions of an
+/// expression in a semiring.
+/// ```
+/// y(i) = overSemiring(std::make_shared<MinPlusSemiring>(),
+///                     sum(j, A(i,j) * x(j)));
+/// ```
+IndexExpr overSemiring(std::shared_ptr<Semiring> semiring, IndexExpr expr);
+
+}
+
+#endif
@@ -207,5 +207,17 @@ IndexStmt scalarPromote(IndexStmt stmt);
  * 1. The result is a is scattered into but does not support random insert.
  */
 IndexStmt insertTemporaries(IndexStmt stmt);
+
+/**
+ * Rewrite assignments that read a matrix with a symmetric format, which stores
+ * only its lower triangle, so that each stored component is read once and
+ * contributes to the result both at its coordinates and at its mirror across
+ * the diagonal.  Parallel loops around such assignments update their results
+ * atomically.  Statements that already exploit symmetry are not changed.
+ * Other operands of the symmetric matrix must be dense or must not be indexed
+ * by both of its index variables, since the mirrored components read them
+ * transposed.
+ */
+IndexStmt exploitSymmetry(IndexStmt stmt);
 }
 #endif
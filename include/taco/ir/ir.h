@@ -33,6 +33,8 @@ enum class IRNodeType {
   Max,
   BitAnd,
   BitOr,
+  Shl,
+  Shr,
   Not,
   Eq,
   Neq,
@@ -382,6 +384,26 @@ struct BitOr : public ExprNode<BitOr> {
   static const IRNodeType _type_info = IRNodeType::BitOr;
 };
 
+/** Left shift: a << b */
+struct Shl : public ExprNode<Shl> {
+  Expr a;
+  Expr b;
+
+  static Expr make(Expr a, Expr b);
+
+  static const IRNodeType _type_info = IRNodeType::Shl;
+};
+
+/** Right shift: a >> b */
+struct Shr : public ExprNode<Shr> {
+  Expr a;
+  Expr b;
+
+  static Expr make(Expr a, Expr b);
+
+  static const IRNodeType _type_info = IRNodeType::Shr;
+};
+
 /** Equality: a==b. */
 struct Eq : public ExprNode<Eq> {
   Expr a;
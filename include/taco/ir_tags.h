@@ -23,6 +23,15 @@ enum class OutputRaceStrategy {
 };
 extern const char *OutputRaceStrategy_NAMES[];
 
+/// CoIterationStrategy::Auto picks one of the strategies below at runtime from the sizes of the intersected segments
+/// CoIterationStrategy::Merge advances intersected iterators one coordinate at a time
+/// CoIterationStrategy::Gallop advances lagging iterators with an exponential search followed by a binary search
+/// CoIterationStrategy::SIMDMerge advances lagging iterators by comparing blocks of coordinates at a time
+enum class CoIterationStrategy {
+  Auto, Merge, Gallop, SIMDMerge
+};
+extern const char *CoIterationStrategy_NAMES[];
+
 enum class BoundType {
   MinExact, MinConstraint, MaxExact, MaxConstraint
 };
@@ -48,6 +48,129 @@ ir::Stmt lower(IndexStmt stmt, std::string functionName,
                bool assemble=true, bool compute=true, bool pack=false, bool unpack=false,
                Lowerer lowerer=Lowerer());
 
+/// Representations of the guard array that records which coordinates of a
+/// dense workspace have been written, when the workspace is consumed by
+/// iterating over only the written coordinates.
+enum class WorkspaceGuard {
+  /// One bool per coordinate.
+  Bool,
+
+  /// One bit per coordinate, packed into 64-bit words.  Only the words of
+  /// written coordinates are reset when the workspace is consumed.
+  BitPacked
+};
+
+/// Set the workspace guard representation used by code lowered from now on.
+/// Defaults to `WorkspaceGuard::BitPacked`.
+void setWorkspaceGuard(WorkspaceGuard guard);
+
+/// Get the workspace guard representation used when lowering.
+WorkspaceGuard getWorkspaceGuard();
+
+/// Representations of dense workspaces that are consumed by iterating over
+/// only the written coordinates.
+enum class WorkspaceKind {
+  /// Arrays with one entry per coordinate of the workspace.
+  Dense,
+
+  /// An open addressing hash map from coordinates to values, sized from an
+  /// upper bound on the number of coordinates the producer can write.
+  /// Workspaces with more than 2^29 coordinates always use dense arrays.
+  Hash,
+
+  /// Hash maps for workspaces with at least 2^21 coordinates when an upper
+  /// bound on the number of written coordinates is known, dense otherwise.
+  Auto
+};
+
+/// Set the workspace representation used by code lowered from now on.
+/// Defaults to `WorkspaceKind::Auto`.
+void setWorkspaceKind(WorkspaceKind kind);
+
+/// Get the workspace representation used when lowering.
+WorkspaceKind getWorkspaceKind();
+
+/// Strategies for ordering the written coordinates of a dense workspace
+/// before they are appended to an ordered result level.  Workspaces that are
+/// drained into unordered result levels are never sorted.
+enum class WorkspaceOrdering {
+  /// Sort the written coordinates with qsort.
+  Sort,
+
+  /// Insertion sort short coordinate lists, scan the bit-packed guard when
+  /// the list is dense relative to the workspace size, and radix sort
+  /// otherwise.
+  Adaptive
+};
+
+/// Set the workspace ordering strategy used by code lowered from now on.
+/// Defaults to `WorkspaceOrdering::Adaptive`.
+void setWorkspaceOrdering(WorkspaceOrdering ordering);
+
+/// Get the workspace ordering strategy used when lowering.
+WorkspaceOrdering getWorkspaceOrdering();
+
+/// Lifetimes of the workspaces that kernels allocate for temporaries.
+enum class WorkspaceLifetime {
+  /// Workspaces are allocated and cleared at the start of each kernel call
+  /// and freed at the end of it.
+  Call,
+
+  /// Workspaces are kept across calls by the tensor that computes the kernel,
+  /// one set per calling thread, and are freed when the thread exits.  This
+  /// saves their allocation, and workspaces that are consumed by iterating
+  /// over their written coordinates reset only those coordinates, so they are
+  /// clean when the kernel returns and are not cleared again.  Other dense
+  /// workspaces are still zeroed on every call.  Call
+  /// `TensorBase::releaseWorkspaces` to free them.
+  Persistent
+};
+
+/// Set the workspace lifetime used by code lowered from now on.  Defaults to
+/// `WorkspaceLifetime::Call`.
+void setWorkspaceLifetime(WorkspaceLifetime lifetime);
+
+/// Get the workspace lifetime used when lowering.
+WorkspaceLifetime getWorkspaceLifetime();
+
+/// Strategies for choosing the initial capacity of the coordinate and value
+/// arrays of result levels that are assembled by appending, whose final size
+/// is only known once the kernel has run.  The arrays are doubled whenever
+/// they fill up.
+enum class OutputCapacity {
+  /// Start from a fixed capacity of `DEFAULT_ALLOC_SIZE` components.
+  Fixed,
+
+  /// Start from the capacity stored in the `vals_size` field of the result
+  /// before the kernel is called, or from `DEFAULT_ALLOC_SIZE` if it is not
+  /// positive.  Tensors store an upper bound on the number of components of
+  /// the result there, so that its arrays are allocated once.
+  Hinted
+};
+
+/// Set the output capacity strategy used by code lowered from now on.
+/// Defaults to `OutputCapacity::Hinted`.
+void setOutputCapacity(OutputCapacity capacity);
+
+/// Get the output capacity strategy used when lowering.
+OutputCapacity getOutputCapacity();
+
+/// The settings of the switches above, which select the code that is lowered
+/// for a statement.  Caches of compiled kernels are keyed on them.
+struct LoweringOptions {
+  WorkspaceGuard guard;
+  WorkspaceKind kind;
+  WorkspaceOrdering ordering;
+  WorkspaceLifetime lifetime;
+  OutputCapacity capacity;
+};
+
+bool operator==(const LoweringOptions&, const LoweringOptions&);
+bool operator!=(const LoweringOptions&, const LoweringOptions&);
+
+/// Get the settings of the switches used when lowering.
+LoweringOptions getLoweringOptions();
+
 /// Check whether the an index statement can be lowered to C code.  If the
 /// statement cannot be lowered and a `reason` string is provided then it is
 /// filled with the a reason.
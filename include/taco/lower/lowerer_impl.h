@@ -256,6 +256,10 @@ protected:
   /// Retrieve the access expressions that have been exhausted.
   std::set<Access> getExhaustedAccesses(MergePoint, MergeLattice) const;
 
+  /// Returns true if a complemented mask in the statement is stored at the
+  /// coordinates of the merge point, so that nothing is computed there.
+  bool isMaskedOut(MergePoint, IndexStmt) const;
+
   /// Retrieve the reduced tensor component value corresponding to an access.
   ir::Expr getReducedValueVar(Access) const;
 
@@ -316,10 +320,17 @@ protected:
                                const std::set<Access>& reducedAccesses);
   /**
    * Generate code to zero-initialize values array in range
-   * [begin * size, (begin + 1) * size).
+   * [begin * size, (begin + 1) * size).  Tensors reduced into with a semiring
+   * are initialized to the semiring's additive identity instead.
    */
   ir::Stmt zeroInitValues(ir::Expr tensor, ir::Expr begin, ir::Expr size);
 
+  /// Returns the value that the components of a result or temporary start
+  /// out as: the additive identity of the semiring that reduces into it, or
+  /// its fill value.
+  ir::Expr getInitialValue(TensorVar var);
+  ir::Expr getInitialValue(ir::Expr tensor);
+
   /// Declare position variables and initialize them with a locate.
   ir::Stmt declLocatePosVars(std::vector<Iterator> iterators);
 
@@ -353,9 +364,46 @@ protected:
   /// Gets the size of a temporary tensorVar in the where statement
   ir::Expr getTemporarySize(Where where);
 
+  /// Returns true iff the sparsely accelerated dense temporary of the where
+  /// statement should be stored in a hash map instead of dense arrays.  Hash
+  /// maps are never used by producers that run in parallel or are written
+  /// atomically, since they are probed and written without synchronization,
+  /// or for temporaries too large to index with 32-bit hash keys.
+  bool useHashWorkspace(Where where);
+
+  /// Returns an upper bound on the number of coordinates the producer of the
+  /// where statement writes to its temporary, computed from the sizes of
+  /// sparse operands, or an undefined expression if none is known.  The bound
+  /// is deliberately conservative: it counts all the coordinates of an
+  /// operand level rather than those reached by one iteration of the loops
+  /// around the where statement, because the temporary is allocated once
+  /// outside those loops and must hold the coordinates of any iteration.
+  ir::Expr getTemporaryNnzBound(Where where);
+
+  /// Returns true iff the result level that a sparsely accelerated dense
+  /// temporary is drained into must be appended to in coordinate order.
+  bool resultLevelIsOrdered(Where where);
+
   /// Initializes helper arrays to give dense workspaces sparse acceleration
   std::vector<ir::Stmt> codeToInitializeDenseAcceleratorArrays(Where where);
 
+  /// Returns code that allocates the workspace array `array` with `size`
+  /// elements, clearing it if `clear` is true, and code that frees it.
+  /// Workspaces that persist across calls are only cleared when allocated.
+  std::vector<ir::Stmt> codeToAllocateWorkspace(ir::Expr array, ir::Expr size, bool clear);
+
+  /// Returns an expression that is true iff the dense workspace guard `guard`
+  /// has not been set for coordinate `loc`.
+  ir::Expr guardIsUnset(ir::Expr guard, ir::Expr loc);
+
+  /// Returns code that sets the dense workspace guard `guard` for coordinate `loc`.
+  ir::Stmt setGuard(ir::Expr guard, ir::Expr loc, bool atomic, ParallelUnit parallelUnit);
+
+  /// Returns code that clears the dense workspace guard `guard` for coordinate
+  /// `loc`.  For bit-packed guards the whole word containing `loc` is cleared,
+  /// so this must only be used once every coordinate in the word is consumed.
+  ir::Stmt clearGuard(ir::Expr guard, ir::Expr loc, bool atomic, ParallelUnit parallelUnit);
+
   /// Recovers a derived indexvar from an underived variable.
   ir::Stmt codeToRecoverDerivedIndexVar(IndexVar underived, IndexVar indexVar, bool emitVarDecl);
 
@@ -363,6 +411,24 @@ protected:
   ir::Stmt codeToIncIteratorVars(ir::Expr coordinate, IndexVar coordinateVar,
           std::vector<Iterator> iterators, std::vector<Iterator> mergers);
 
+  /// Returns true if the merge point intersects compressed levels that can
+  /// skip ahead by searching their coordinate arrays instead of stepping one
+  /// position at a time.
+  bool canSearchToCoordinate(IndexVar coordinateVar,
+                             std::vector<Iterator> iterators,
+                             std::vector<Iterator> mergers);
+
+  /// Advance every merger past the current coordinate by searching the
+  /// coordinate arrays for the largest merger coordinate.
+  ir::Stmt codeToSearchIteratorVars(ir::Expr coordinate,
+                                    std::vector<Iterator> mergers,
+                                    CoIterationStrategy strategy);
+
+  /// Declare a variable that picks a co-iteration strategy at run time from
+  /// the ratio of the mergers' segment lengths.
+  ir::Stmt codeToSelectCoIterationStrategy(std::vector<Iterator> mergers,
+                                           ir::Expr strategyVar);
+
   ir::Stmt codeToLoadCoordinatesFromPosIterators(std::vector<Iterator> iterators, bool declVars);
 
   /// Create statements to append coordinate to result modes.
@@ -423,9 +489,17 @@ private:
   /// Map form temporary to indexListSize if accelerating dense workspace
   std::map<TensorVar, ir::Expr> tempToIndexListSize;
 
-  /// Map form temporary to bitGuard var if accelerating dense workspace
+  /// Map form temporary to bitGuard var if accelerating dense workspace.
+  /// For hash workspaces this is the array of keys (coordinates plus one).
   std::map<TensorVar, ir::Expr> tempToBitGuard;
 
+  /// Map from hash workspace temporaries to their hash map capacity var
+  std::map<TensorVar, ir::Expr> tempToHashCapacity;
+
+  /// Map from hash workspace temporaries to the var holding the hash map slot
+  /// of the coordinate being accessed
+  std::map<TensorVar, ir::Expr> tempToHashSlot;
+
   /// Map from result tensors to variables tracking values array capacity.
   std::map<ir::Expr, ir::Expr> capacityVars;
 
@@ -447,6 +521,7 @@ private:
   bool ignoreVectorize = false; // already being taken into account
 
   std::vector<ir::Stmt> whereConsumers;
+  std::vector<ir::Stmt> whereNonAtomicConsumers; // for results that no other parallel partition writes
   std::vector<TensorVar> whereTemps;
   std::map<TensorVar, const AccessNode *> whereTempsToResult;
 
@@ -457,6 +532,15 @@ private:
 
   int inParallelLoopDepth = 0;
 
+  /// Additive identities of the semirings that results and temporaries are
+  /// reduced with.
+  std::map<TensorVar, ir::Expr> reductionIdentities;
+
+  /// Co-iteration strategy of the forall whose merge lattice is being lowered,
+  /// and the run-time selector variable used when that strategy is Auto.
+  CoIterationStrategy coiterationStrategy = CoIterationStrategy::Merge;
+  ir::Expr coiterationStrategyVar;
+
   std::map<ParallelUnit, ir::Expr> parallelUnitSizes;
   std::map<ParallelUnit, IndexVar> parallelUnitIndexVars;
 
@@ -16,7 +16,9 @@ public:
   /// The memory reclamation policy of Array objects. UserOwns means the Array
   /// object will not free its data, free means it will reclaim data  with the
   /// C free function and delete means it will reclaim data with delete[].
-  enum Policy {UserOwns, Free, Delete};
+  /// Shared means the data lies in a block of memory, such as a memory mapped
+  /// file, that is released once the last array in it is destroyed.
+  enum Policy {UserOwns, Free, Delete, Shared};
 
   /// Construct an empty array of undefined elements.
   Array();
@@ -24,12 +26,19 @@ public:
   /// Construct an array of elements of the given type.
   Array(Datatype type, void* data, size_t size, Policy policy=Free);
 
+  /// Construct an array of elements of the given type that lie in a block of
+  /// memory owned by `owner`.  The array keeps the owner alive.
+  Array(Datatype type, void* data, size_t size, std::shared_ptr<void> owner);
+
   /// Returns the type of the array elements
   const Datatype& getType() const;
 
   /// Returns the number of array elements
   size_t getSize() const;
 
+  /// Returns the memory reclamation policy of the array
+  Policy getPolicy() const;
+
   /// Returns the array data.
   /// @{
   const void* getData() const;
@@ -63,9 +72,58 @@ Array makeArray(T* data, size_t size, Array::Policy policy=Array::UserOwns) {
   return Array(type<T>(), data, size, policy);
 }
 
-/// Construct an array of elements of the given type.
+/// How the memory of arrays is allocated.
+struct AllocationPolicy {
+  /// How large arrays are backed by huge pages.
+  enum HugePages {
+    /// Arrays use pages of the default size.
+    None,
+
+    /// Large arrays are aligned to huge pages and marked for transparent huge
+    /// pages with madvise(MADV_HUGEPAGE).
+    Transparent,
+
+    /// Large arrays constructed by `makeArray` are mapped from the reserved
+    /// huge page pool (MAP_HUGETLB), and use transparent huge pages when the
+    /// pool is exhausted.  Arrays that kernels allocate can be resized and
+    /// freed by generated code, so they use transparent huge pages.
+    Explicit
+  };
+
+  /// The alignment of arrays in bytes, which must be a power of two of at
+  /// least 64, since generated code assumes arrays are aligned to 64 bytes.
+  size_t alignment = 64;
+
+  HugePages hugePages = None;
+
+  /// Arrays smaller than this many bytes use pages of the default size.
+  size_t hugePageThreshold = 2 << 20;
+};
+
+bool operator==(const AllocationPolicy&, const AllocationPolicy&);
+bool operator!=(const AllocationPolicy&, const AllocationPolicy&);
+
+/// Set the allocation policy of arrays, and of the arrays that kernels
+/// allocate for results, of tensors that do not override it.
+void setAllocationPolicy(AllocationPolicy policy);
+
+/// Get the default allocation policy of arrays.
+AllocationPolicy getAllocationPolicy();
+
+/// Allocate `bytes` bytes by an allocation policy.  The memory is released
+/// with `free`, so explicit huge pages are replaced by transparent ones.
+void* allocateAligned(size_t bytes, const AllocationPolicy& policy);
+
+/// Resize memory allocated by `allocateAligned`, preserving its contents.
+void* reallocateAligned(void* ptr, size_t bytes, const AllocationPolicy& policy);
+
+/// Construct an array of elements of the given type, allocated by the default
+/// allocation policy.
 Array makeArray(Datatype type, size_t size);
 
+/// Construct an array of elements of the given type, allocated by `policy`.
+Array makeArray(Datatype type, size_t size, const AllocationPolicy& policy);
+
 /// Construct an Array from the values.
 template <typename T>
 Array makeArray(const std::vector<T>& values) {
@@ -6,12 +6,17 @@
 #include <string>
 
 #include "taco/format.h"
+#include "taco/type.h"
 
 namespace taco {
 class TensorBase;
 class Format;
 
-/// Read an mtx matrix from a file.
+/// Read an mtx matrix from a file.  The component type follows the field of
+/// the file: real files are read as Float64, integer files as Int64, complex
+/// files as Complex128 and pattern files as Bool tensors whose values are true.
+/// The lower triangle of symmetric files is stored as it is if the format is
+/// symmetric and expanded to both triangles otherwise.
 TensorBase readMTX(std::string filename, const ModeFormat& modetype, 
                    bool pack=true);
 
@@ -25,6 +30,26 @@ TensorBase readMTX(std::istream& stream, const ModeFormat& modetype,
 /// Read an mtx matrix from a stream.
 TensorBase readMTX(std::istream& stream, const Format& format, bool pack=true);
 
+/// Read an mtx matrix from a file into a tensor with the given component type.
+/// The values of pattern files are read as ones.
+TensorBase readMTX(std::string filename, const ModeFormat& modetype,
+                   Datatype ctype, bool pack=true);
+
+/// Read an mtx matrix from a file into a tensor with the given component type.
+/// The values of pattern files are read as ones.
+TensorBase readMTX(std::string filename, const Format& format, Datatype ctype,
+                   bool pack=true);
+
+/// Read an mtx matrix from a stream into a tensor with the given component
+/// type.  The values of pattern files are read as ones.
+TensorBase readMTX(std::istream& stream, const ModeFormat& modetype,
+                   Datatype ctype, bool pack=true);
+
+/// Read an mtx matrix from a stream into a tensor with the given component
+/// type.  The values of pattern files are read as ones.
+TensorBase readMTX(std::istream& stream, const Format& format, Datatype ctype,
+                   bool pack=true);
+
 TensorBase readSparse(std::istream& stream, const ModeFormat& modetype, 
                       bool symm = false);
 TensorBase readDense(std::istream& stream, const ModeFormat& modetype, 
@@ -38,7 +63,8 @@ TensorBase readDense(std::istream& stream, const Format& format,
 /// Write an mtx matrix to a file.
 void writeMTX(std::string filename, const TensorBase& tensor);
 
-/// Write an mtx matrix to a stream.
+/// Write an mtx matrix to a stream.  Matrices with a symmetric format are
+/// written as symmetric files holding their lower triangle.
 void writeMTX(std::ostream& stream, const TensorBase& tensor);
 void writeSparse(std::ostream& stream, const TensorBase& tensor);
 void writeDense(std::ostream& stream, const TensorBase& tensor);
@@ -0,0 +1,66 @@
+/// Read and write the ttb binary tensor format.  A ttb file stores the packed
+/// index arrays and values of a tensor together with its format, dimensions,
+/// component type and fill value, with every array aligned to 64 bytes.  Files
+/// are read by memory mapping them, so reading takes constant time and the
+/// pages of a file are shared by all processes that read it.  Tensors can also
+/// be placed in named POSIX shared memory objects in the same layout.
+
+#ifndef TACO_FILE_IO_TTB_H
+#define TACO_FILE_IO_TTB_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "taco/format.h"
+
+namespace taco {
+class TensorBase;
+class Format;
+
+/// Read a ttb tensor from a file in the format it was written in.  The arrays
+/// of the tensor are views of the memory mapped file, which is unmapped once
+/// they are all destroyed.  Writing to them does not modify the file.
+TensorBase readTTB(std::string filename);
+
+/// Read a ttb tensor from a file.  The file is memory mapped if the tensor was
+/// written in the given format and converted to it otherwise.
+TensorBase readTTB(std::string filename, const ModeFormat& modetype,
+                   bool pack=true);
+
+/// Read a ttb tensor from a file.  The file is memory mapped if the tensor was
+/// written in the given format and converted to it otherwise.
+TensorBase readTTB(std::string filename, const Format& format, bool pack=true);
+
+/// Read a ttb tensor from a stream.
+TensorBase readTTB(std::istream& stream, const ModeFormat& modetype,
+                   bool pack=true);
+
+/// Read a ttb tensor from a stream.
+TensorBase readTTB(std::istream& stream, const Format& format, bool pack=true);
+
+/// Write a packed tensor to a ttb file.
+void writeTTB(std::string filename, const TensorBase& tensor);
+
+/// Write a packed tensor to a ttb stream.
+void writeTTB(std::ostream& stream, const TensorBase& tensor);
+
+/// Copy a packed tensor into a new POSIX shared memory object, laid out as a
+/// ttb file, so that processes on the same host can attach it without copying
+/// it.  Shared tensor names consist of an optional leading slash followed by
+/// characters other than slashes.  The object persists until it is removed,
+/// even after the process that created it exits.
+void createSharedTensor(std::string name, const TensorBase& tensor);
+
+/// Attach a tensor created by `createSharedTensor`.  The arrays of the tensor
+/// are views of the shared memory, mapped privately like ttb files, so all
+/// processes that attach it share one physical copy until they write to it.
+TensorBase attachSharedTensor(std::string name);
+
+/// Remove the name of a shared tensor.  Processes that have attached it keep
+/// their views, and its memory is freed once they are all destroyed.
+void removeSharedTensor(std::string name);
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+/// Placement of tensor storage on the NUMA nodes of a machine.  On machines
+/// with several sockets, the pages of an array are placed on the node of the
+/// thread that first touches them, so arrays that are allocated and filled by
+/// the main thread live on one node, and parallel kernels that read them from
+/// the other nodes run at the bandwidth of the interconnect.  Placement is a
+/// hint: on systems without NUMA support, or where the kernel refuses it,
+/// memory is placed as the operating system chooses.
+
+#ifndef TACO_STORAGE_NUMA_H
+#define TACO_STORAGE_NUMA_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+
+#include "taco/type.h"
+#include "taco/allocator.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+class TensorStorage;
+
+/// How the pages of the arrays of a tensor are placed on NUMA nodes.
+enum class MemoryPlacement {
+  /// Pages are placed by the operating system, which usually places them on
+  /// the node of the thread that first touches them.
+  Default,
+
+  /// Pages are first touched by the threads that run parallel kernels
+  /// (`taco_get_num_threads`), each touching the contiguous range of pages
+  /// that a static schedule gives it, which is the range it accesses in
+  /// kernels that are parallelized over the outermost mode.  Threads should be
+  /// bound to cores (e.g. OMP_PROC_BIND=close) for pages to stay local.
+  FirstTouch,
+
+  /// Pages are interleaved across all nodes, which balances bandwidth for
+  /// arrays whose access pattern does not follow the static schedule.
+  Interleave,
+
+  /// The tensor is copied to every node when it is packed or computed, and
+  /// kernels that read it are passed the copy on the node of the calling
+  /// thread.  Meant for read-only operands of kernels that are called from
+  /// threads on several sockets.
+  Replicate
+};
+
+std::ostream& operator<<(std::ostream&, MemoryPlacement);
+
+/// Returns the number of NUMA nodes of the machine, which is one on machines
+/// without NUMA support.
+int getNumNumaNodes();
+
+/// Returns the NUMA node of the CPU that the calling thread runs on.
+int getCurrentNumaNode();
+
+/// Allocate `bytes` bytes of zeroed memory by `policy`, aligned to pages and
+/// placed by `placement`.  If `node` is not negative the pages are placed on
+/// that node instead.  The memory is released with `free`.
+void* allocatePlaced(size_t bytes, MemoryPlacement placement, int node=-1,
+                     const AllocationPolicy& policy=getAllocationPolicy());
+
+/// Construct a zeroed array placed by `placement`, or on `node` if it is not
+/// negative.
+Array makeArray(Datatype type, size_t size, MemoryPlacement placement,
+                int node=-1,
+                const AllocationPolicy& policy=getAllocationPolicy());
+
+/// Copy an array into memory placed by `placement`, or on `node` if it is not
+/// negative.  With `FirstTouch` placement the copy is made by the threads that
+/// run parallel kernels.
+Array placeArray(const Array& array, MemoryPlacement placement, int node=-1,
+                 const AllocationPolicy& policy=getAllocationPolicy());
+
+/// Copy the index arrays and values of a tensor storage into memory placed by
+/// `placement`, or on `node` if it is not negative.
+TensorStorage placeStorage(const TensorStorage& storage,
+                           MemoryPlacement placement, int node=-1,
+                           const AllocationPolicy& policy=
+                               getAllocationPolicy());
+
+/// A kernel allocator that places the result arrays that kernels allocate and
+/// allocates them by an allocation policy, and passes temporaries to another
+/// allocator, or to the system allocator if it is null.
+class PlacementAllocator : public KernelAllocator {
+public:
+  PlacementAllocator(MemoryPlacement placement,
+                     std::shared_ptr<KernelAllocator> base=nullptr,
+                     const AllocationPolicy& policy=getAllocationPolicy());
+
+  void* allocate(size_t size, bool temporary);
+  void* reallocate(void* ptr, size_t size, bool temporary);
+  void deallocate(void* ptr, bool temporary);
+  void beginKernel();
+  void endKernel();
+
+  MemoryPlacement getPlacement() const;
+  std::shared_ptr<KernelAllocator> getBase() const;
+  const AllocationPolicy& getPolicy() const;
+
+private:
+  MemoryPlacement placement;
+  std::shared_ptr<KernelAllocator> base;
+  AllocationPolicy policy;
+};
+
+}
+#endif
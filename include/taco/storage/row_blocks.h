@@ -0,0 +1,70 @@
+/// Out-of-core evaluation of expressions whose operand does not fit in
+/// memory.  The operand is split into blocks of consecutive coordinates of its
+/// outermost stored mode (e.g. blocks of rows of a CSR matrix), and each block
+/// is copied into memory and computed on in turn while the next block is read.
+
+#ifndef TACO_STORAGE_ROW_BLOCKS_H
+#define TACO_STORAGE_ROW_BLOCKS_H
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "taco/tensor.h"
+
+namespace taco {
+
+/// A packed tensor read in blocks of `rowsPerBlock` coordinates of its
+/// outermost stored mode, which must be dense or compressed.  The remaining
+/// levels may be dense, compressed or singleton with 32-bit index arrays.
+///
+/// Expressions are written in terms of the block tensor, which has the
+/// dimensions of the tensor except that its outermost mode has `rowsPerBlock`
+/// coordinates, and evaluated once per block by `evaluate`:
+///
+///   RowBlockStream blocks("A.ttb", 4096);
+///   TensorBase A = blocks.getBlockTensor();
+///   y(i) = A(i,j) * x(j);
+///   blocks.evaluate(y, [&](int firstRow, int numRows, const TensorBase& y) {
+///     // Rows [firstRow, firstRow + numRows) of the product are in y
+///   });
+class RowBlockStream {
+public:
+  /// Stream the blocks of a ttb file.  The file is memory mapped and the pages
+  /// of each block are released once the block has been copied.
+  RowBlockStream(std::string filename, int rowsPerBlock);
+
+  /// Stream the blocks of a packed tensor, such as one read by `readTTB`.
+  RowBlockStream(TensorBase tensor, int rowsPerBlock);
+
+  ~RowBlockStream();
+
+  /// Returns the tensor whose storage holds the current block.  Coordinates of
+  /// the last block past the end of the tensor are empty, so results computed
+  /// for them hold the fill value.
+  TensorBase getBlockTensor() const;
+
+  /// Returns the number of coordinates of the outermost stored mode.
+  int getNumRows() const;
+
+  int getRowsPerBlock() const;
+
+  int getNumBlocks() const;
+
+  /// Compile the expression assigned to `result`, which reads the block
+  /// tensor, and assemble and compute it once per block.  After each block
+  /// `consume(firstRow, numRows, result)` is called with the rows of the
+  /// tensor the block holds.  The next block is copied into memory on a
+  /// separate thread while the current block is computed and consumed.
+  /// Results are reassembled for every block, including results of compound
+  /// assignments, so they never accumulate over blocks.
+  void evaluate(TensorBase result,
+                std::function<void(int,int,const TensorBase&)> consume);
+
+private:
+  struct Content;
+  std::shared_ptr<Content> content;
+};
+
+}
+#endif
@@ -66,6 +66,12 @@ public:
   /// Set the tensor component value array.
   void setValues(const Array& values);
 
+  /// Returns the value of the components that are not stored.
+  TypedComponentVal getFillValue() const;
+
+  /// Set the value of the components that are not stored.
+  void setFillValue(TypedComponentVal fill);
+
 private:
   struct Content;
   std::shared_ptr<Content> content;
@@ -0,0 +1,38 @@
+/// This file defines the runtime structs through which generated code allocates
+/// and releases arrays and workspaces.  Note: this file must be valid C99, not
+/// C++.
+/// This *must* be kept in sync with the version used in codegen_c.cpp
+
+#ifndef TACO_ALLOCATOR_T_DEFINED
+#define TACO_ALLOCATOR_T_DEFINED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Allocation hooks of generated code.  `temporary` is nonzero for arrays
+/// that the kernel releases before it returns, and zero for arrays of results,
+/// which the caller takes ownership of and releases with `free`.
+typedef struct taco_allocator_t {
+  void* (*allocate)(struct taco_allocator_t* allocator, size_t size,
+                    int32_t temporary);
+  void* (*reallocate)(struct taco_allocator_t* allocator, void* ptr,
+                      size_t size, int32_t temporary);
+  void  (*deallocate)(struct taco_allocator_t* allocator, void* ptr,
+                      int32_t temporary);
+} taco_allocator_t;
+
+#endif
+
+#ifndef TACO_WORKSPACE_CACHE_T_DEFINED
+#define TACO_WORKSPACE_CACHE_T_DEFINED
+
+/// Hooks through which generated code acquires workspaces that persist across
+/// kernel calls.  `id` identifies the workspace and the returned array holds
+/// at least `size` bytes.  If `clear` is nonzero, a newly allocated array is
+/// zeroed, while a reused array is returned as the previous call left it.
+typedef struct taco_workspace_cache_t {
+  void* (*acquire)(struct taco_workspace_cache_t* cache, int32_t id,
+                   size_t size, int32_t clear);
+} taco_workspace_cache_t;
+
+#endif
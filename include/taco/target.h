@@ -18,6 +18,12 @@ struct Target {
   std::string compiler_env = "TACO_CC";
 
   std::string compiler = "cc";
+
+  /// Families of C compilers, which differ in the loop vectorization hints
+  /// they understand.  Unknown compilers get hints for all families, guarded
+  /// by the preprocessor.
+  enum CompilerFamily {CompilerUnknown=0, GCC, Clang, IntelLLVM} compilerFamily
+      = CompilerUnknown;
   
   // As we support them, we'll stick in optional features into the target as
   // well, including things like parallelism model (e.g. openmp, cilk) for
@@ -1,6 +1,7 @@
 #ifndef TACO_TENSOR_H
 #define TACO_TENSOR_H
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,6 +9,7 @@
 #include <utility>
 #include <array>
 #include <mutex>
+#include <tuple>
 
 #include "taco/type.h"
 #include "taco/format.h"
@@ -15,12 +17,14 @@
 #include "taco/codegen/module.h"
 
 #include "taco/index_notation/index_notation.h"
+#include "taco/lower/lower.h"
 
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/storage/typed_vector.h"
 #include "taco/storage/typed_index.h"
+#include "taco/storage/numa.h"
 
 #include "taco/error.h"
 #include "taco/error/error_messages.h"
@@ -99,6 +103,15 @@ public:
   /// Get the format the tensor is packed into
   const Format& getFormat() const;
 
+  /// Returns the fill value of the tensor, which is the value of the
+  /// components that are not stored.  Defaults to zero.
+  Literal getFillValue() const;
+
+  /// Set the fill value of the tensor.  Results computed from tensors with
+  /// non-zero fill values take the fill value the expression computes where
+  /// none of its operands are stored.
+  void setFillValue(Literal fill);
+
   /// Set the tensor's storage
   void setStorage(TensorStorage storage);
 
@@ -134,6 +147,13 @@ public:
   template <typename CType>
   void insert(const std::vector<int>& coordinate, CType value);
 
+  /// Insert a block of values into the tensor, where `coordinates[m][i]` is the
+  /// mode m coordinate of the value `values[i]`.  There must be one coordinate
+  /// array per mode.
+  template <typename CType>
+  void insertBulk(const std::vector<std::vector<int>>& coordinates,
+                  const std::vector<CType>& values);
+
   /// Fill the tensor with the list of components defined by the iterator range (begin, end).
   ///
   /// The input list of triplets does not have to be sorted, and can contains duplicated elements.
@@ -440,9 +460,58 @@ public:
   /// Set to true to perform the assemble and compute stages simultaneously.
   void setAssembleWhileCompute(bool assembleWhileCompute);
 
+  /// Set to true to keep the index assembled by a previous evaluation and only
+  /// run the compute kernel, which overwrites the values in place, while the
+  /// sparsity structure of the operands stays the same.  If `verify` is true
+  /// the index arrays of the operands are copied when the result is assembled
+  /// and compared to the copy before every evaluation, and the result is
+  /// reassembled when they change; if it is false the caller guarantees that
+  /// they do not change.  Has no effect when the
+  /// assemble and compute stages are performed simultaneously.
+  void setReuseSparsityPattern(bool reuse, bool verify=true);
+
+  /// Place the arrays of the tensor on NUMA nodes.  The placement applies to
+  /// the storage the tensor has now, to the storage it gets from `pack` and
+  /// `setStorage`, and to the arrays that kernels allocate when they compute
+  /// it.  Replicated tensors are copied to every node after they are packed or
+  /// computed, so changes made directly to their storage are not seen by the
+  /// copies until the placement is set again.
+  void setMemoryPlacement(MemoryPlacement placement);
+
+  /// Returns how the arrays of the tensor are placed on NUMA nodes.
+  MemoryPlacement getMemoryPlacement() const;
+
+  /// Returns the storage of the tensor, or its copy on the NUMA node of the
+  /// calling thread if the tensor is replicated.  Kernels that read the tensor
+  /// are passed this storage.
+  const TensorStorage& getLocalStorage() const;
+
+  /// Allocate the arrays of the tensor, and the arrays that kernels allocate
+  /// when they compute it, by `policy` instead of the default set by
+  /// `taco::setAllocationPolicy`.  Arrays the tensor already has are moved.
+  void setAllocationPolicy(AllocationPolicy policy);
+
+  /// Returns the allocation policy of the tensor's arrays.
+  AllocationPolicy getAllocationPolicy() const;
+
+  /// Free the workspaces that the kernel functions keep across calls when
+  /// they are lowered with `WorkspaceLifetime::Persistent`.  Every tensor keeps
+  /// its own workspaces, also when its kernel is shared with other tensors
+  /// that compute the same statement, so this must not be called while the
+  /// tensor is being computed.
+  void releaseWorkspaces();
+
+  /// Get the number of bytes held by workspaces that the kernel functions keep
+  /// across calls for this tensor.
+  size_t getWorkspaceSize() const;
+
   /// Get the source code of the kernel functions.
   std::string getSource() const;
 
+  /// Get a report of which loops of the kernel functions' source code the C
+  /// compiler vectorized.
+  std::string getVectorizationReport() const;
+
   /// Compile the source code of the kernel functions. This function is optional
   /// and mainly intended for experimentation. If the source code is not set
   /// then it will will be created it from the given expression.
@@ -462,6 +531,14 @@ public:
   /// Get the size of the initial index allocations.
   size_t getAllocSize() const;
 
+  /// Set to true to size the initial coordinate and value allocations of the
+  /// result from an upper bound on its number of components, which a symbolic
+  /// pass over the operands computes before each assembly.  The bound is
+  /// deterministic but not tight; for sparse matrix products it is the number
+  /// of multiplications (Gustavson's flop count).  The allocation size is used
+  /// for position arrays and when no bound can be derived.  Defaults to true.
+  void setEstimateAllocSize(bool estimate);
+
   /// Get the taco_tensor_t representation of this tensor.
   taco_tensor_t* getTacoTensorT();
 
@@ -488,12 +565,14 @@ public:
   friend std::ostream& operator<<(std::ostream&, TensorBase&);
 
   friend struct AccessTensorNode;
+  friend class RowBlockStream;
   std::vector<TensorBase> getDependentTensors();
 private:
   static std::shared_ptr<ir::Module> getHelperFunctions(
       const Format& format, Datatype ctype, const std::vector<int>& dimensions);
-  static std::shared_ptr<ir::Module> getComputeKernel(const IndexStmt stmt);
-  static void cacheComputeKernel(const IndexStmt stmt, 
+  static std::shared_ptr<ir::Module> getComputeKernel(const IndexStmt stmt,
+                                                      bool assembleWhileCompute);
+  static void cacheComputeKernel(const IndexStmt stmt, bool assembleWhileCompute,
                                  const std::shared_ptr<ir::Module> kernel);
 
   /* --- Compiler Methods --- */
@@ -511,6 +590,16 @@ private:
 
   void syncValues();
 
+  /// Place the storage of the tensor, or replicate it, by its memory placement.
+  void applyMemoryPlacement();
+
+  /// Returns the allocator for the arrays that kernels allocate for the
+  /// tensor, which places them if `placement` is first touch or interleave and
+  /// allocates them by the tensor's allocation policy.  Without either, it is
+  /// the allocator of the calling thread.
+  std::shared_ptr<KernelAllocator> getResultAllocator(
+      MemoryPlacement placement);
+
   template<typename CType>
   iterator_wrapper<int,CType> iteratorPacked();
   
@@ -537,8 +626,10 @@ private:
   static HelperFuncsCache helperFunctions;
   static std::mutex helperFunctionsMutex;
 
-  typedef std::vector<std::pair<IndexStmt, 
-                                std::shared_ptr<ir::Module>>> KernelsCache;
+  // Kernels are keyed on their statement, on whether they assemble while they
+  // compute and on the lowering options they were compiled under
+  typedef std::vector<std::tuple<IndexStmt, bool, LoweringOptions,
+                                 std::shared_ptr<ir::Module>>> KernelsCache;
   static KernelsCache computeKernels;
   static std::mutex computeKernelsMutex;
 };
@@ -702,11 +793,18 @@ enum class FileType {
   ttx,
 
   /// .rb  - The rutherford-boeing sparse matrix format.
-  rb
+  rb,
+
+  /// .ttb - The taco binary tensor format.  It stores the packed index arrays
+  ///        and values of a tensor together with its format, and is read by
+  ///        memory mapping the file.
+  ttb
 };
 
 /// Read a tensor from a file. The file format is inferred from the filename
-/// and the tensor is returned packed by default.
+/// and the tensor is returned packed by default.  Files whose names end in .gz
+/// or .zst (e.g. matrix.mtx.gz) are decompressed while they are parsed, if taco
+/// was built with zlib or zstd.
 TensorBase read(std::string filename, ModeFormat modeType, bool pack = true);
 
 /// Read a tensor from a file. The file format is inferred from the filename
@@ -733,6 +831,28 @@ TensorBase read(std::istream& stream, FileType filetype, ModeFormat modetype,
 TensorBase read(std::istream& stream, FileType filetype, Format format,
                 bool pack = true);
 
+/// Read a tensor from a file into a tensor with the given component type.  The
+/// file format is inferred from the filename and the tensor is returned packed
+/// by default.
+TensorBase read(std::string filename, ModeFormat modetype, Datatype ctype,
+                bool pack = true);
+
+/// Read a tensor from a file into a tensor with the given component type.  The
+/// file format is inferred from the filename and the tensor is returned packed
+/// by default.
+TensorBase read(std::string filename, Format format, Datatype ctype,
+                bool pack = true);
+
+/// Read a tensor from a stream of the given file format into a tensor with the
+/// given component type.  The tensor is returned packed by default.
+TensorBase read(std::istream& stream, FileType filetype, ModeFormat modetype,
+                Datatype ctype, bool pack = true);
+
+/// Read a tensor from a stream of the given file format into a tensor with the
+/// given component type.  The tensor is returned packed by default.
+TensorBase read(std::istream& stream, FileType filetype, Format format,
+                Datatype ctype, bool pack = true);
+
 /// Write a tensor to a file. The file format is inferred from the filename.
 void write(std::string filename, const TensorBase& tensor);
 
@@ -873,12 +993,27 @@ struct TensorBase::Content {
   Assignment         assignment;
 
   size_t             allocSize;
+  bool               estimateAllocSize;
+  std::function<size_t()> capacityBound;
   size_t             valuesSize;
 
   ir::Stmt           assembleFunc;
   ir::Stmt           computeFunc;
   bool               assembleWhileCompute;
   std::shared_ptr<ir::Module> module;
+  std::shared_ptr<WorkspaceCache> workspaces;
+
+  bool               reuseSparsityPattern;
+  bool               verifySparsityPattern;
+  bool               hasSparsityPattern;
+  std::vector<char>  sparsityPattern;
+
+  MemoryPlacement    placement;
+  std::vector<TensorStorage> replicas;
+  std::shared_ptr<PlacementAllocator> resultAllocator;
+
+  bool               hasAllocationPolicy;
+  AllocationPolicy   allocationPolicy;
 
   size_t             coordinateBufferUsed;
   size_t             coordinateSize;
@@ -939,6 +1074,39 @@ void TensorBase::insert(const std::vector<int>& coordinate, CType value) {
   setNeedsPack(true);
 }
 
+template <typename CType>
+void TensorBase::insertBulk(const std::vector<std::vector<int>>& coordinates,
+                            const std::vector<CType>& values) {
+  taco_uassert(coordinates.size() == (size_t)getOrder()) <<
+    "Wrong number of coordinate arrays";
+  taco_uassert(getComponentType() == type<CType>()) <<
+    "Cannot insert a value of type '" << type<CType>() << "' " <<
+    "into a tensor with component type " << getComponentType();
+  for (auto& modeCoordinates : coordinates) {
+    taco_uassert(modeCoordinates.size() == values.size()) <<
+      "Every mode must have one coordinate per value";
+  }
+  syncDependentTensors();
+
+  const size_t coordSize = content->coordinateSize;
+  const size_t used = content->coordinateBufferUsed;
+  if (content->coordinateBuffer->size() - used < values.size() * coordSize) {
+    content->coordinateBuffer->resize(used + values.size() * coordSize);
+  }
+  char* coordLoc = &content->coordinateBuffer->data()[used];
+  for (size_t i = 0; i < values.size(); i++) {
+    int* idxLoc = (int*)coordLoc;
+    for (auto& modeCoordinates : coordinates) {
+      *(idxLoc++) = modeCoordinates[i];
+    }
+    const CType value = values[i];
+    memcpy(idxLoc, &value, sizeof(CType));
+    coordLoc += coordSize;
+  }
+  content->coordinateBufferUsed += values.size() * coordSize;
+  setNeedsPack(true);
+}
+
 template <typename CType>
 void TensorBase::insertUnsynced(const std::vector<int>& coordinate, CType value) {
   taco_uassert(coordinate.size() == (size_t)getOrder()) <<
@@ -1018,7 +1186,7 @@ CType TensorBase::at(const std::vector<int>& coordinate) {
       return value.second;
     }
   }
-  return 0;
+  return getFillValue().getVal<CType>();
 }
 
 template<typename CType>
@@ -0,0 +1,468 @@
+#include "taco/allocator.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "taco/error.h"
+#include "taco/storage/array.h"
+
+using namespace std;
+
+namespace taco {
+
+// Generated code assumes that arrays are aligned to this many bytes, and
+// blocks served by the arena and the pool are prefixed by a header of the same
+// size that records their size.
+static const size_t alignment = 64;
+
+static void* alignedMalloc(size_t size) {
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, alignment, std::max(size, (size_t)1)) != 0) {
+    return nullptr;
+  }
+  return ptr;
+}
+
+static inline size_t roundUp(size_t size) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+
+// class KernelAllocator
+KernelAllocator::KernelAllocator() {
+  hooks.hooks.allocate = allocateHook;
+  hooks.hooks.reallocate = reallocateHook;
+  hooks.hooks.deallocate = deallocateHook;
+  hooks.allocator = this;
+}
+
+KernelAllocator::~KernelAllocator() {
+}
+
+void* KernelAllocator::allocate(size_t size, bool temporary) {
+  return allocateAligned(size, getAllocationPolicy());
+}
+
+void* KernelAllocator::reallocate(void* ptr, size_t size, bool temporary) {
+  return reallocateAligned(ptr, size, getAllocationPolicy());
+}
+
+void KernelAllocator::deallocate(void* ptr, bool temporary) {
+  free(ptr);
+}
+
+void KernelAllocator::beginKernel() {
+}
+
+void KernelAllocator::endKernel() {
+}
+
+taco_allocator_t* KernelAllocator::getHooks() {
+  return &hooks.hooks;
+}
+
+KernelAllocator* KernelAllocator::getAllocator(taco_allocator_t* hooks) {
+  static_assert(offsetof(Hooks, hooks) == 0,
+                "The hooks must be the first member of KernelAllocator::Hooks");
+  return reinterpret_cast<Hooks*>(hooks)->allocator;
+}
+
+void* KernelAllocator::allocateHook(taco_allocator_t* hooks, size_t size,
+                                    int32_t temporary) {
+  return getAllocator(hooks)->allocate(size, temporary != 0);
+}
+
+void* KernelAllocator::reallocateHook(taco_allocator_t* hooks, void* ptr,
+                                      size_t size, int32_t temporary) {
+  return getAllocator(hooks)->reallocate(ptr, size, temporary != 0);
+}
+
+void KernelAllocator::deallocateHook(taco_allocator_t* hooks, void* ptr,
+                                     int32_t temporary) {
+  getAllocator(hooks)->deallocate(ptr, temporary != 0);
+}
+
+
+// class ArenaAllocator
+ArenaAllocator::ArenaAllocator(size_t chunkSize)
+    : chunkSize(std::max(roundUp(chunkSize), alignment)), current(0),
+      offset(0), activeKernels(0) {
+}
+
+ArenaAllocator::~ArenaAllocator() {
+  for (auto& chunk : chunks) {
+    free(chunk.data);
+  }
+}
+
+void* ArenaAllocator::allocate(size_t size, bool temporary) {
+  if (!temporary) {
+    return KernelAllocator::allocate(size, temporary);
+  }
+  const size_t blockSize = alignment + roundUp(size);
+
+  lock_guard<std::mutex> lock(mutex);
+  while (current < chunks.size() && offset + blockSize > chunks[current].size) {
+    current++;
+    offset = 0;
+  }
+  if (current == chunks.size()) {
+    Chunk chunk;
+    chunk.size = std::max(chunkSize, blockSize);
+    chunk.data = static_cast<char*>(alignedMalloc(chunk.size));
+    if (chunk.data == nullptr) {
+      return nullptr;
+    }
+    chunks.push_back(chunk);
+    offset = 0;
+  }
+  char* block = chunks[current].data + offset;
+  offset += blockSize;
+  *reinterpret_cast<size_t*>(block) = size;
+  return block + alignment;
+}
+
+void* ArenaAllocator::reallocate(void* ptr, size_t size, bool temporary) {
+  if (!temporary) {
+    return KernelAllocator::reallocate(ptr, size, temporary);
+  }
+  if (ptr == nullptr) {
+    return allocate(size, temporary);
+  }
+  char* block = static_cast<char*>(ptr) - alignment;
+  size_t& oldSize = *reinterpret_cast<size_t*>(block);
+  {
+    // The last block of the current chunk grows in place if the chunk has room
+    lock_guard<std::mutex> lock(mutex);
+    if (current < chunks.size() &&
+        block + alignment + roundUp(oldSize) ==
+            chunks[current].data + offset &&
+        block + alignment + roundUp(size) <=
+            chunks[current].data + chunks[current].size) {
+      offset = (block - chunks[current].data) + alignment + roundUp(size);
+      oldSize = size;
+      return ptr;
+    }
+  }
+  void* resized = allocate(size, temporary);
+  if (resized != nullptr) {
+    memcpy(resized, ptr, std::min(oldSize, size));
+  }
+  return resized;
+}
+
+void ArenaAllocator::deallocate(void* ptr, bool temporary) {
+  // Temporaries are released all at once when no kernel is running
+  if (!temporary) {
+    KernelAllocator::deallocate(ptr, temporary);
+  }
+}
+
+void ArenaAllocator::beginKernel() {
+  lock_guard<std::mutex> lock(mutex);
+  activeKernels++;
+}
+
+void ArenaAllocator::endKernel() {
+  lock_guard<std::mutex> lock(mutex);
+  taco_iassert(activeKernels > 0);
+  if (--activeKernels == 0) {
+    resetLocked();
+  }
+}
+
+void ArenaAllocator::reset() {
+  lock_guard<std::mutex> lock(mutex);
+  taco_uassert(activeKernels == 0)
+      << "An arena cannot be reset while kernels allocate from it";
+  resetLocked();
+}
+
+void ArenaAllocator::resetLocked() {
+  // Coalesce the chunks, so that the next call fits in a single chunk
+  if (chunks.size() > 1) {
+    Chunk chunk;
+    chunk.size = 0;
+    for (auto& oldChunk : chunks) {
+      chunk.size += oldChunk.size;
+      free(oldChunk.data);
+    }
+    chunks.clear();
+    chunk.data = static_cast<char*>(alignedMalloc(chunk.size));
+    if (chunk.data != nullptr) {
+      chunks.push_back(chunk);
+    }
+  }
+  current = 0;
+  offset = 0;
+}
+
+size_t ArenaAllocator::getReservedBytes() const {
+  lock_guard<std::mutex> lock(mutex);
+  size_t reserved = 0;
+  for (auto& chunk : chunks) {
+    reserved += chunk.size;
+  }
+  return reserved;
+}
+
+
+// class WorkspacePool
+static size_t getSizeClass(size_t size) {
+  size_t sizeClass = 6;
+  while (((size_t)1 << sizeClass) < alignment + size) {
+    sizeClass++;
+  }
+  return sizeClass;
+}
+
+static inline size_t& getBlockHeader(void* ptr) {
+  return *reinterpret_cast<size_t*>(static_cast<char*>(ptr) - alignment);
+}
+
+WorkspacePool::WorkspacePool() : freeLists(64), pooledBytes(0) {
+}
+
+WorkspacePool::~WorkspacePool() {
+  clear();
+}
+
+void* WorkspacePool::allocate(size_t size, bool temporary) {
+  if (!temporary) {
+    return KernelAllocator::allocate(size, temporary);
+  }
+  const size_t sizeClass = getSizeClass(size);
+  {
+    lock_guard<std::mutex> lock(mutex);
+    if (!freeLists[sizeClass].empty()) {
+      void* ptr = freeLists[sizeClass].back();
+      freeLists[sizeClass].pop_back();
+      pooledBytes -= (size_t)1 << sizeClass;
+      return ptr;
+    }
+  }
+  char* block = static_cast<char*>(alignedMalloc((size_t)1 << sizeClass));
+  if (block == nullptr) {
+    return nullptr;
+  }
+  *reinterpret_cast<size_t*>(block) = sizeClass;
+  return block + alignment;
+}
+
+void* WorkspacePool::reallocate(void* ptr, size_t size, bool temporary) {
+  if (!temporary) {
+    return KernelAllocator::reallocate(ptr, size, temporary);
+  }
+  if (ptr == nullptr) {
+    return allocate(size, temporary);
+  }
+  const size_t capacity = ((size_t)1 << getBlockHeader(ptr)) - alignment;
+  if (size <= capacity) {
+    return ptr;
+  }
+  void* resized = allocate(size, temporary);
+  if (resized != nullptr) {
+    memcpy(resized, ptr, capacity);
+    deallocate(ptr, temporary);
+  }
+  return resized;
+}
+
+void WorkspacePool::deallocate(void* ptr, bool temporary) {
+  if (!temporary) {
+    KernelAllocator::deallocate(ptr, temporary);
+    return;
+  }
+  if (ptr == nullptr) {
+    return;
+  }
+  const size_t sizeClass = getBlockHeader(ptr);
+  lock_guard<std::mutex> lock(mutex);
+  freeLists[sizeClass].push_back(ptr);
+  pooledBytes += (size_t)1 << sizeClass;
+}
+
+void WorkspacePool::clear() {
+  lock_guard<std::mutex> lock(mutex);
+  for (auto& freeList : freeLists) {
+    for (void* ptr : freeList) {
+      free(static_cast<char*>(ptr) - alignment);
+    }
+    freeList.clear();
+  }
+  pooledBytes = 0;
+}
+
+size_t WorkspacePool::getPooledBytes() const {
+  lock_guard<std::mutex> lock(mutex);
+  return pooledBytes;
+}
+
+
+// class WorkspaceCache
+void* WorkspaceCache::acquireHook(taco_workspace_cache_t* hooks, int32_t id,
+                                  size_t size, int32_t clear) {
+  static_assert(offsetof(Hooks, hooks) == 0,
+                "The hooks must be the first member of WorkspaceCache::Hooks");
+  return reinterpret_cast<Hooks*>(hooks)->cache->acquire(id, size, clear != 0);
+}
+
+namespace {
+/// The live workspace caches by id.  The mutex guards them and the workspaces
+/// of all threads, which threads read without it only to find their own
+/// workspaces.  The registry is never destroyed, since threads may exit after
+/// static objects are destroyed.
+struct WorkspaceRegistry {
+  std::mutex mutex;
+  std::map<uint64_t, WorkspaceCache*> caches;
+  uint64_t nextId = 0;
+};
+}
+
+static WorkspaceRegistry& getWorkspaceRegistry() {
+  static WorkspaceRegistry* registry = new WorkspaceRegistry;
+  return *registry;
+}
+
+/// The workspaces of a thread in every cache, by the id of the cache.  Only
+/// the thread adds caches to them, so that it can look its workspaces up
+/// without locking.
+struct WorkspaceCache::ThreadWorkspaces {
+  std::map<uint64_t, std::map<int,Workspace>> caches;
+
+  ~ThreadWorkspaces() {
+    WorkspaceRegistry& registry = getWorkspaceRegistry();
+    lock_guard<std::mutex> lock(registry.mutex);
+    for (auto& workspaces : caches) {
+      // Caches that were destroyed already freed their workspaces
+      auto cache = registry.caches.find(workspaces.first);
+      if (cache != registry.caches.end()) {
+        cache->second->threads.erase(this);
+        cache->second->freeLocked(workspaces.second);
+      }
+    }
+  }
+};
+
+WorkspaceCache::ThreadWorkspaces& WorkspaceCache::getThreadWorkspaces() {
+  static thread_local ThreadWorkspaces workspaces;
+  return workspaces;
+}
+
+WorkspaceCache::WorkspaceCache() : size(0) {
+  hooks.hooks.acquire = acquireHook;
+  hooks.cache = this;
+  WorkspaceRegistry& registry = getWorkspaceRegistry();
+  lock_guard<std::mutex> lock(registry.mutex);
+  id = registry.nextId++;
+  registry.caches.insert({id, this});
+}
+
+WorkspaceCache::~WorkspaceCache() {
+  release();
+  WorkspaceRegistry& registry = getWorkspaceRegistry();
+  lock_guard<std::mutex> lock(registry.mutex);
+  registry.caches.erase(id);
+}
+
+void* WorkspaceCache::acquire(int id, size_t size, bool clear) {
+  ThreadWorkspaces& thread = getThreadWorkspaces();
+  auto workspaces = thread.caches.find(this->id);
+  if (workspaces != thread.caches.end()) {
+    auto workspace = workspaces->second.find(id);
+    if (workspace != workspaces->second.end() &&
+        workspace->second.data != nullptr && workspace->second.size >= size) {
+      return workspace->second.data;
+    }
+  }
+
+  WorkspaceRegistry& registry = getWorkspaceRegistry();
+  lock_guard<std::mutex> lock(registry.mutex);
+  // Drop the emptied workspaces of caches that were destroyed
+  for (auto it = thread.caches.begin(); it != thread.caches.end();) {
+    it = registry.caches.count(it->first) ? std::next(it)
+                                           : thread.caches.erase(it);
+  }
+  threads.insert(&thread);
+  Workspace& workspace = thread.caches[this->id][id];
+  free(workspace.data);
+  this->size -= workspace.size;
+  workspace.size = 0;
+  workspace.data = alignedMalloc(size);
+  if (workspace.data == nullptr) {
+    return nullptr;
+  }
+  if (clear) {
+    memset(workspace.data, 0, size);
+  }
+  workspace.size = size;
+  this->size += size;
+  return workspace.data;
+}
+
+void WorkspaceCache::release() {
+  WorkspaceRegistry& registry = getWorkspaceRegistry();
+  lock_guard<std::mutex> lock(registry.mutex);
+  // The workspaces are emptied rather than erased, since their threads may
+  // be looking up the workspaces of other caches
+  for (ThreadWorkspaces* thread : threads) {
+    auto workspaces = thread->caches.find(id);
+    if (workspaces != thread->caches.end()) {
+      freeLocked(workspaces->second);
+    }
+  }
+}
+
+void WorkspaceCache::freeLocked(std::map<int,Workspace>& workspaces) {
+  for (auto& workspace : workspaces) {
+    free(workspace.second.data);
+    size -= workspace.second.size;
+    workspace.second.data = nullptr;
+    workspace.second.size = 0;
+  }
+}
+
+size_t WorkspaceCache::getSize() const {
+  WorkspaceRegistry& registry = getWorkspaceRegistry();
+  lock_guard<std::mutex> lock(registry.mutex);
+  return size;
+}
+
+taco_workspace_cache_t* WorkspaceCache::getHooks() {
+  return &hooks.hooks;
+}
+
+
+static shared_ptr<KernelAllocator> kernelAllocator;
+static thread_local shared_ptr<KernelAllocator> scopedKernelAllocator;
+
+void setKernelAllocator(shared_ptr<KernelAllocator> allocator) {
+  atomic_store(&kernelAllocator, allocator);
+}
+
+shared_ptr<KernelAllocator> getKernelAllocator() {
+  if (scopedKernelAllocator != nullptr) {
+    return scopedKernelAllocator;
+  }
+  return atomic_load(&kernelAllocator);
+}
+
+KernelAllocator* getScopedKernelAllocator() {
+  return scopedKernelAllocator.get();
+}
+
+
+// class ScopedKernelAllocator
+ScopedKernelAllocator::ScopedKernelAllocator(
+    shared_ptr<KernelAllocator> allocator) : previous(scopedKernelAllocator) {
+  scopedKernelAllocator = allocator;
+}
+
+ScopedKernelAllocator::~ScopedKernelAllocator() {
+  scopedKernelAllocator = previous;
+}
+
+}
@@ -194,6 +194,10 @@ string CodeGen::printContextDeclAndInit(map<Expr, string, ExprCompare> varMap,
   return ret.str();
 }
 
+string CodeGen::restrictKeyword(string varname) const {
+  return aliasedPointers.count(varname) ? "" : restrictKeyword();
+}
+
 string CodeGen::printTensorProperty(string varname, const GetProperty* op, bool is_ptr) {
   stringstream ret;
   string star = is_ptr ? "*" : "";
@@ -238,7 +242,7 @@ string CodeGen::unpackTensorProperty(string varname, const GetProperty* op,
   if (op->property == TensorProperty::Values) {
     // for the values, it's in the last slot
     ret << printType(tensor->type, true);
-    ret << " " << restrictKeyword() << " " << varname << " = (" << printType(tensor->type, true) << ")(";
+    ret << " " << restrictKeyword(varname) << " " << varname << " = (" << printType(tensor->type, true) << ")(";
     ret << tensor->name << "->vals);\n";
     return ret.str();
   } else if (op->property == TensorProperty::ValuesSize) {
@@ -259,7 +263,7 @@ string CodeGen::unpackTensorProperty(string varname, const GetProperty* op,
     taco_iassert(op->property == TensorProperty::Indices);
     tp = "int*";
     auto nm = op->index;
-    ret << tp << " " << restrictKeyword() << " " << varname << " = ";
+    ret << tp << " " << restrictKeyword(varname) << " " << varname << " = ";
     ret << "(int*)(" << tensor->name << "->indices[" << op->mode;
     ret << "][" << nm << "]);\n";
   }
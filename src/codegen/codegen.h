@@ -2,6 +2,7 @@
 #define TACO_CODEGEN_H
 
 #include <memory>
+#include <set>
 #include "taco/ir/ir.h"
 #include "taco/ir/ir_printer.h"
 
@@ -58,6 +59,11 @@ protected:
   void doIndentStream(std::stringstream &stream);
   CodeGenType codeGenType;
 
+  /// Names of the pointers of the function being generated that may alias
+  /// another pointer, which must not be declared restrict.
+  std::set<std::string> aliasedPointers;
+  std::string restrictKeyword(std::string varname) const;
+
 private:
   virtual std::string restrictKeyword() const { return ""; }
 
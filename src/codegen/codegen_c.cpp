@@ -37,6 +37,17 @@ const string cHeaders =
   "#define TACO_MIN(_a,_b) ((_a) < (_b) ? (_a) : (_b))\n"
   "#define TACO_MAX(_a,_b) ((_a) > (_b) ? (_a) : (_b))\n"
   "#define TACO_DEREF(_a) (((___context___*)(*__ctx__))->_a)\n"
+  "#define TACO_ALIGNMENT 64\n"
+  "#if defined(__GNUC__)\n"
+  "#define TACO_THREAD_LOCAL __thread\n"
+  "#else\n"
+  "#define TACO_THREAD_LOCAL _Thread_local\n"
+  "#endif\n"
+  "#if defined(__GNUC__)\n"
+  "#define TACO_ASSUME_ALIGNED(_p) __builtin_assume_aligned((_p), TACO_ALIGNMENT)\n"
+  "#else\n"
+  "#define TACO_ASSUME_ALIGNED(_p) (_p)\n"
+  "#endif\n"
   "#ifndef TACO_TENSOR_T_DEFINED\n"
   "#define TACO_TENSOR_T_DEFINED\n"
   "typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;\n"
@@ -51,6 +62,88 @@ const string cHeaders =
   "  int32_t      vals_size;     // values array size\n"
   "} taco_tensor_t;\n"
   "#endif\n"
+  "int posix_memalign(void **memptr, size_t alignment, size_t size);\n"
+  "void* taco_alignedMalloc(size_t size) {\n"
+  "  void* ptr = NULL;\n"
+  "  if (posix_memalign(&ptr, TACO_ALIGNMENT, size) != 0) {\n"
+  "    return NULL;\n"
+  "  }\n"
+  "  return ptr;\n"
+  "}\n"
+  "#ifndef TACO_ALLOCATOR_T_DEFINED\n"
+  "#define TACO_ALLOCATOR_T_DEFINED\n"
+  "typedef struct taco_allocator_t {\n"
+  "  void* (*allocate)(struct taco_allocator_t* allocator, size_t size, int32_t temporary);\n"
+  "  void* (*reallocate)(struct taco_allocator_t* allocator, void* ptr, size_t size, int32_t temporary);\n"
+  "  void  (*deallocate)(struct taco_allocator_t* allocator, void* ptr, int32_t temporary);\n"
+  "} taco_allocator_t;\n"
+  "#endif\n"
+  "// The allocator of the kernel that the calling thread runs, which callers\n"
+  "// set before every call.  Kernels copy it when they are entered, so that\n"
+  "// the threads of their parallel loops allocate with it too, while helpers\n"
+  "// that release their scratch before they return use the calling thread's.\n"
+  "TACO_THREAD_LOCAL taco_allocator_t* taco_allocator = NULL;\n"
+  "void taco_setAllocator(taco_allocator_t* allocator) {\n"
+  "  taco_allocator = allocator;\n"
+  "}\n"
+  "void* taco_allocate(taco_allocator_t* allocator, size_t size, int32_t temporary) {\n"
+  "  if (allocator != NULL) {\n"
+  "    return allocator->allocate(allocator, size, temporary);\n"
+  "  }\n"
+  "  return taco_alignedMalloc(size);\n"
+  "}\n"
+  "void* taco_callocate(taco_allocator_t* allocator, size_t size, int32_t temporary) {\n"
+  "  void* ptr = taco_allocate(allocator, size, temporary);\n"
+  "  if (ptr != NULL) {\n"
+  "    memset(ptr, 0, size);\n"
+  "  }\n"
+  "  return ptr;\n"
+  "}\n"
+  "void* taco_reallocate(taco_allocator_t* allocator, void* ptr, size_t size, int32_t temporary) {\n"
+  "  if (allocator != NULL) {\n"
+  "    return allocator->reallocate(allocator, ptr, size, temporary);\n"
+  "  }\n"
+  "  void* resized = realloc(ptr, size);\n"
+  "  if (resized == NULL || (uintptr_t)resized % TACO_ALIGNMENT == 0) {\n"
+  "    return resized;\n"
+  "  }\n"
+  "  // realloc only guarantees the alignment of malloc\n"
+  "  void* aligned = taco_alignedMalloc(size);\n"
+  "  if (aligned != NULL) {\n"
+  "    memcpy(aligned, resized, size);\n"
+  "  }\n"
+  "  free(resized);\n"
+  "  return aligned;\n"
+  "}\n"
+  "void taco_deallocate(taco_allocator_t* allocator, void* ptr, int32_t temporary) {\n"
+  "  if (allocator != NULL) {\n"
+  "    allocator->deallocate(allocator, ptr, temporary);\n"
+  "    return;\n"
+  "  }\n"
+  "  free(ptr);\n"
+  "}\n"
+  "#ifndef TACO_WORKSPACE_CACHE_T_DEFINED\n"
+  "#define TACO_WORKSPACE_CACHE_T_DEFINED\n"
+  "typedef struct taco_workspace_cache_t {\n"
+  "  void* (*acquire)(struct taco_workspace_cache_t* cache, int32_t id, size_t size, int32_t clear);\n"
+  "} taco_workspace_cache_t;\n"
+  "#endif\n"
+  "TACO_THREAD_LOCAL taco_workspace_cache_t* taco_workspace_cache = NULL;\n"
+  "void taco_setWorkspaceCache(taco_workspace_cache_t* cache) {\n"
+  "  taco_workspace_cache = cache;\n"
+  "}\n"
+  "void* taco_acquireWorkspace(taco_workspace_cache_t* cache, int32_t id, size_t size, int32_t clear) {\n"
+  "  if (cache != NULL) {\n"
+  "    return cache->acquire(cache, id, size, clear);\n"
+  "  }\n"
+  "  return clear ? taco_callocate(taco_allocator, size, 1) : taco_allocate(taco_allocator, size, 1);\n"
+  "}\n"
+  "void* taco_releaseWorkspace(taco_workspace_cache_t* cache, void* ptr) {\n"
+  "  if (cache == NULL) {\n"
+  "    taco_deallocate(taco_allocator, ptr, 1);\n"
+  "  }\n"
+  "  return NULL;\n"
+  "}\n"
   "int cmp(const void *a, const void *b) {\n"
   "  return *((const int*)a) - *((const int*)b);\n"
   "}\n"
@@ -96,6 +189,117 @@ const string cHeaders =
   "  }\n"
   "  return lowerBound;\n"
   "}\n"
+  "int taco_gallop(int *array, int arrayStart, int arrayEnd, int target) {\n"
+  "  if (arrayStart >= arrayEnd || array[arrayStart] >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int step = 1;\n"
+  "  int lowerBound = arrayStart; // always < target\n"
+  "  int upperBound = arrayStart + 1;\n"
+  "  while (upperBound < arrayEnd && array[upperBound] < target) {\n"
+  "    lowerBound = upperBound;\n"
+  "    step *= 2;\n"
+  "    upperBound = lowerBound + step;\n"
+  "  }\n"
+  "  if (upperBound >= arrayEnd) {\n"
+  "    if (array[arrayEnd - 1] < target) {\n"
+  "      return arrayEnd;\n"
+  "    }\n"
+  "    upperBound = arrayEnd - 1;\n"
+  "  }\n"
+  "  return taco_binarySearchAfter(array, lowerBound, upperBound, target);\n"
+  "}\n"
+  "int taco_simdAdvance(int *array, int arrayStart, int arrayEnd, int target) {\n"
+  "  int pos = arrayStart;\n"
+  "  while (pos + 8 <= arrayEnd && array[pos + 7] < target) {\n"
+  "    pos += 8;\n"
+  "  }\n"
+  "  int blockEnd = (pos + 8 < arrayEnd) ? pos + 8 : arrayEnd;\n"
+  "  int count = 0;\n"
+  "  for (int i = pos; i < blockEnd; i++) {\n"
+  "    count += array[i] < target;\n"
+  "  }\n"
+  "  return pos + count;\n"
+  "}\n"
+  "int taco_orderIndexList(int32_t* list, int32_t size, const uint64_t* guard, int32_t dimension) {\n"
+  "  if (size <= 32) {\n"
+  "    for (int32_t i = 1; i < size; i++) {\n"
+  "      int32_t value = list[i];\n"
+  "      int32_t j = i - 1;\n"
+  "      while (j >= 0 && list[j] > value) {\n"
+  "        list[j + 1] = list[j];\n"
+  "        j--;\n"
+  "      }\n"
+  "      list[j + 1] = value;\n"
+  "    }\n"
+  "    return size;\n"
+  "  }\n"
+  "  int32_t words = (dimension + 63) / 64;\n"
+  "  if (guard && words <= 4 * size) {\n"
+  "    int32_t n = 0;\n"
+  "    for (int32_t w = 0; w < words; w++) {\n"
+  "      uint64_t bits = guard[w];\n"
+  "      while (bits) {\n"
+  "#if defined(__GNUC__)\n"
+  "        int32_t bit = __builtin_ctzll(bits);\n"
+  "#else\n"
+  "        int32_t bit = 0;\n"
+  "        while (!((bits >> bit) & 1)) bit++;\n"
+  "#endif\n"
+  "        list[n++] = w * 64 + bit;\n"
+  "        bits &= bits - 1;\n"
+  "      }\n"
+  "    }\n"
+  "    return n;\n"
+  "  }\n"
+  "  int32_t* buffer = (int32_t*)taco_allocate(taco_allocator, sizeof(int32_t) * size, 1);\n"
+  "  if (buffer == NULL) {\n"
+  "    // Sort in place if there is no memory for the radix sort scratch\n"
+  "    qsort(list, size, sizeof(int32_t), cmp);\n"
+  "    return size;\n"
+  "  }\n"
+  "  int32_t* src = list;\n"
+  "  int32_t* dst = buffer;\n"
+  "  for (int shift = 0; shift < 32 && ((dimension - 1) >> shift) > 0; shift += 8) {\n"
+  "    int32_t count[257] = {0};\n"
+  "    for (int32_t i = 0; i < size; i++) count[((src[i] >> shift) & 255) + 1]++;\n"
+  "    for (int32_t b = 0; b < 256; b++) count[b + 1] += count[b];\n"
+  "    for (int32_t i = 0; i < size; i++) dst[count[(src[i] >> shift) & 255]++] = src[i];\n"
+  "    int32_t* tmp = src;\n"
+  "    src = dst;\n"
+  "    dst = tmp;\n"
+  "  }\n"
+  "  if (src != list) memcpy(list, src, sizeof(int32_t) * size);\n"
+  "  taco_deallocate(taco_allocator, buffer, 1);\n"
+  "  return size;\n"
+  "}\n"
+  "int taco_hashCapacity(int32_t bound) {\n"
+  "  int64_t capacity = 16;\n"
+  "  while (capacity < 2 * (int64_t)bound && capacity < ((int64_t)1 << 30)) {\n"
+  "    capacity *= 2;\n"
+  "  }\n"
+  "  return (int32_t)capacity;\n"
+  "}\n"
+  "int taco_hashSlot(const int32_t* keys, int32_t mask, int32_t key) {\n"
+  "  int32_t slot = (int32_t)(((uint32_t)key * 2654435761u) & (uint32_t)mask);\n"
+  "  for (int32_t probe = 0; probe <= mask; probe++) {\n"
+  "    if (keys[slot] == 0 || keys[slot] == key + 1) {\n"
+  "      return slot;\n"
+  "    }\n"
+  "    slot = (slot + 1) & mask;\n"
+  "  }\n"
+  "  return -1;\n"
+  "}\n"
+  "int taco_orderHashSlots(int32_t* list, int32_t size, const int32_t* keys, int32_t mask, int32_t dimension) {\n"
+  "  for (int32_t i = 0; i < size; i++) {\n"
+  "    list[i] = keys[list[i]] - 1;\n"
+  "  }\n"
+  "  taco_orderIndexList(list, size, 0, dimension);\n"
+  "  for (int32_t i = 0; i < size; i++) {\n"
+  "    list[i] = taco_hashSlot(keys, mask, list[i]);\n"
+  "  }\n"
+  "  return size;\n"
+  "}\n"
   "taco_tensor_t* init_taco_tensor_t(int32_t order, int32_t csize,\n"
   "                                  int32_t* dimensions, int32_t* mode_ordering,\n"
   "                                  taco_mode_t* mode_types) {\n"
@@ -232,11 +436,115 @@ protected:
   }
 };
 
+namespace {
+
+// Finds the pointers of a function that may alias another pointer because
+// one is copied from the other, the arrays that are reallocated, and whether
+// the function allocates arrays or acquires persistent workspaces.  Other
+// pointers refer either to the arrays of distinct tensors or to arrays the
+// function allocates itself, so they can be declared restrict.
+struct FindPointerAliases : public IRVisitor {
+  using IRVisitor::visit;
+
+  set<Expr, ExprCompare> aliased;
+  set<Expr, ExprCompare> reallocated;
+  bool allocates = false;
+  bool acquiresWorkspaces = false;
+
+  // The checks take nodes rather than handles so that visitors do not wrap
+  // the nodes they visit in temporary handles, which release them
+  static bool isPointer(const Var* var) {
+    return var->is_ptr;
+  }
+
+  static bool isPointer(const GetProperty* property) {
+    return property->property == TensorProperty::Values ||
+           property->property == TensorProperty::Indices;
+  }
+
+  static bool isPointer(const Expr& expr) {
+    if (isa<Var>(expr)) {
+      return isPointer(to<Var>(expr));
+    }
+    if (isa<GetProperty>(expr)) {
+      return isPointer(to<GetProperty>(expr));
+    }
+    return false;
+  }
+
+  void copies(const Expr& lhs, const Expr& rhs) {
+    if (!isPointer(lhs)) {
+      return;
+    }
+    // Pointers used as anything but the array of a load flow into lhs
+    struct FindSources : public IRVisitor {
+      using IRVisitor::visit;
+      vector<Expr> sources;
+      void visit(const Var* op) {
+        if (isPointer(op)) {
+          sources.emplace_back(op);
+        }
+      }
+      void visit(const GetProperty* op) {
+        if (isPointer(op)) {
+          sources.emplace_back(op);
+        }
+      }
+      void visit(const Load* op) {
+        op->loc.accept(this);
+      }
+    };
+    FindSources findSources;
+    rhs.accept(&findSources);
+    if (!findSources.sources.empty()) {
+      aliased.insert(lhs);
+      aliased.insert(findSources.sources.begin(), findSources.sources.end());
+    }
+  }
+
+  void visit(const VarDecl* op) {
+    copies(op->var, op->rhs);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Assign* op) {
+    copies(op->lhs, op->rhs);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Allocate* op) {
+    if (op->is_realloc) {
+      reallocated.insert(op->var);
+    }
+    allocates = true;
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Free* op) {
+    allocates = true;
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Call* op) {
+    if (op->func == "taco_acquireWorkspace") {
+      acquiresWorkspaces = true;
+    }
+    IRVisitor::visit(op);
+  }
+};
+
+} // anonymous namespace
+
 CodeGen_C::CodeGen_C(std::ostream &dest, OutputKind outputKind, bool simplify)
-    : CodeGen(dest, false, simplify, C), out(dest), outputKind(outputKind) {}
+    : CodeGen(dest, false, simplify, C), out(dest), outputKind(outputKind),
+      compilerFamily(Target::CompilerUnknown) {}
 
 CodeGen_C::~CodeGen_C() {}
 
+void CodeGen_C::setCompilerFamily(Target::CompilerFamily compilerFamily) {
+  this->compilerFamily = compilerFamily;
+}
+
 void CodeGen_C::compile(Stmt stmt, bool isFirst) {
   varMap = {};
   localVars = {};
@@ -290,8 +598,32 @@ void CodeGen_C::visit(const Function* func) {
   varMap = varFinder.varMap;
   localVars = varFinder.localVars;
 
+  FindPointerAliases pointerAliases;
+  func->body.accept(&pointerAliases);
+  aliasedPointers.clear();
+  for (auto& pointer : pointerAliases.aliased) {
+    if (varMap.count(pointer)) {
+      aliasedPointers.insert(varMap[pointer]);
+    }
+  }
+  reallocatedArrays.clear();
+  for (auto& array : pointerAliases.reallocated) {
+    if (varMap.count(array)) {
+      reallocatedArrays.insert(varMap[array]);
+    }
+  }
+
   // Print variable declarations
   out << printDecls(varFinder.varDecls, func->inputs, func->outputs) << endl;
+  if (pointerAliases.allocates) {
+    doIndent();
+    out << "taco_allocator_t* taco_kernelAllocator = taco_allocator;" << endl;
+  }
+  if (pointerAliases.acquiresWorkspaces) {
+    doIndent();
+    out << "taco_workspace_cache_t* taco_kernelWorkspaces = "
+        << "taco_workspace_cache;" << endl;
+  }
 
   if (emittingCoroutine) {
     out << printContextDeclAndInit(varMap, localVars, numYields, func->name)
@@ -326,6 +658,16 @@ void CodeGen_C::visit(const VarDecl* op) {
     op->rhs.accept(this);
     stream << ";";
     stream << endl;
+  } else if (to<Var>(op->var)->is_ptr &&
+             aliasedPointers.count(varMap[op->var])) {
+    doIndent();
+    stream << keywordString(util::toString(op->var.type())) << "* ";
+    op->var.accept(this);
+    parentPrecedence = Precedence::TOP;
+    stream << " = ";
+    op->rhs.accept(this);
+    stream << ";";
+    stream << endl;
   } else {
     IRPrinter::visit(op);
   }
@@ -349,7 +691,7 @@ void CodeGen_C::visit(const Var* op) {
   }
 }
 
-static string genVectorizePragma(int width) {
+static string genClangVectorizePragma(int width) {
   stringstream ret;
   ret << "#pragma clang loop interleave(enable) ";
   if (!width)
@@ -360,6 +702,350 @@ static string genVectorizePragma(int width) {
   return ret.str();
 }
 
+namespace {
+
+// Returns true if two index expressions are structurally the same, so that
+// they address the same location in every iteration.  Expressions the check
+// does not understand are not the same.
+static bool sameIndex(Expr a, Expr b) {
+  if (a.ptr == b.ptr) {
+    return true;
+  }
+  if (!a.defined() || !b.defined() || a.type() != b.type()) {
+    return false;
+  }
+  if (isa<Literal>(a) && isa<Literal>(b)) {
+    const Literal* la = to<Literal>(a);
+    const Literal* lb = to<Literal>(b);
+    return la->type.isInt() ? la->getIntValue() == lb->getIntValue()
+                            : la->type.isUInt() &&
+                              la->getUIntValue() == lb->getUIntValue();
+  }
+  if (isa<Add>(a) && isa<Add>(b)) {
+    return sameIndex(to<Add>(a)->a, to<Add>(b)->a) &&
+           sameIndex(to<Add>(a)->b, to<Add>(b)->b);
+  }
+  if (isa<Sub>(a) && isa<Sub>(b)) {
+    return sameIndex(to<Sub>(a)->a, to<Sub>(b)->a) &&
+           sameIndex(to<Sub>(a)->b, to<Sub>(b)->b);
+  }
+  if (isa<Mul>(a) && isa<Mul>(b)) {
+    return sameIndex(to<Mul>(a)->a, to<Mul>(b)->a) &&
+           sameIndex(to<Mul>(a)->b, to<Mul>(b)->b);
+  }
+  if (isa<Cast>(a) && isa<Cast>(b)) {
+    return sameIndex(to<Cast>(a)->a, to<Cast>(b)->a);
+  }
+  if (isa<Load>(a) && isa<Load>(b)) {
+    return sameIndex(to<Load>(a)->arr, to<Load>(b)->arr) &&
+           sameIndex(to<Load>(a)->loc, to<Load>(b)->loc);
+  }
+  return false;
+}
+
+// Determines whether the iterations of a loop may be asserted to be
+// independent to the C compiler.  Stores must be to locations that are affine
+// in the loop variable with a nonzero coefficient, every load and store of a
+// stored array must use the same index, and scalars declared outside the loop
+// may only be updated by sum or product reductions that are not otherwise
+// read.
+struct LoopDependences : public IRVisitor {
+  using IRVisitor::visit;
+
+  // Variables whose value differs between iterations of the loop
+  set<Expr, ExprCompare> varying;
+  // Varying variables that are affine functions of the loop variables
+  set<Expr, ExprCompare> affine;
+  set<Expr, ExprCompare> locals;
+  map<Expr, string, ExprCompare> reductions;
+  map<Expr, int, ExprCompare> reductionUpdates;
+  map<Expr, int, ExprCompare> uses;
+  // Coefficients of the loop variable in affine variables, which are zero for
+  // variables that only vary within an iteration
+  map<Expr, Expr, ExprCompare> coefficients;
+  // The indices that every array is loaded and stored at
+  map<Expr, vector<Expr>, ExprCompare> accesses;
+  set<Expr, ExprCompare> stored;
+  Expr loopVar;
+  bool memoryIndependent = true;
+  bool scalarsIndependent = true;
+
+  LoopDependences(Stmt loop, Expr loopVar) : loopVar(loopVar) {
+    if (loopVar.defined()) {
+      varying.insert(loopVar);
+      affine.insert(loopVar);
+      locals.insert(loopVar);
+      coefficients[loopVar] = ir::Literal::make(1);
+    }
+    loop.accept(this);
+    for (auto& reduction : reductions) {
+      if (uses[reduction.first] != 2 * reductionUpdates[reduction.first]) {
+        scalarsIndependent = false;
+      }
+    }
+    // Iterations that access a stored array at other indices may read or
+    // write what other iterations write
+    for (auto& array : stored) {
+      const vector<Expr>& indices = accesses[array];
+      for (auto& index : indices) {
+        if (!sameIndex(index, indices[0])) {
+          memoryIndependent = false;
+        }
+      }
+    }
+  }
+
+  bool dependsOnIteration(Expr expr) {
+    struct FindVarying : public IRVisitor {
+      using IRVisitor::visit;
+      const set<Expr, ExprCompare>& varying;
+      bool found = false;
+      FindVarying(const set<Expr, ExprCompare>& varying) : varying(varying) {}
+      void visit(const Var* op) {
+        found = found || varying.count(op);
+      }
+    };
+    FindVarying findVarying(varying);
+    expr.accept(&findVarying);
+    return findVarying.found;
+  }
+
+  // Locations computed through loads, such as the coordinates of a sparse
+  // level, may repeat across iterations, so they are not affine
+  bool isAffine(Expr expr) {
+    if (!dependsOnIteration(expr)) {
+      return true;
+    }
+    if (isa<Var>(expr)) {
+      return affine.count(expr) > 0;
+    }
+    if (isa<Add>(expr)) {
+      return isAffine(to<Add>(expr)->a) && isAffine(to<Add>(expr)->b);
+    }
+    if (isa<Sub>(expr)) {
+      return isAffine(to<Sub>(expr)->a) && isAffine(to<Sub>(expr)->b);
+    }
+    if (isa<Mul>(expr)) {
+      const Mul* mul = to<Mul>(expr);
+      return (isAffine(mul->a) && !dependsOnIteration(mul->b)) ||
+             (isAffine(mul->b) && !dependsOnIteration(mul->a));
+    }
+    if (isa<Cast>(expr)) {
+      return isAffine(to<Cast>(expr)->a);
+    }
+    return false;
+  }
+
+  // Returns the coefficient of the loop variable in an affine expression, or
+  // an undefined expression if it is not known
+  Expr getCoefficient(Expr expr) {
+    if (!dependsOnIteration(expr)) {
+      return ir::Literal::make(0);
+    }
+    if (isa<Var>(expr)) {
+      return coefficients.count(expr) ? coefficients.at(expr) : Expr();
+    }
+    if (isa<Add>(expr) || isa<Sub>(expr)) {
+      const bool add = isa<Add>(expr);
+      Expr a = getCoefficient(add ? to<Add>(expr)->a : to<Sub>(expr)->a);
+      Expr b = getCoefficient(add ? to<Add>(expr)->b : to<Sub>(expr)->b);
+      if (!a.defined() || !b.defined()) {
+        return Expr();
+      }
+      if (isZero(b)) {
+        return a;
+      }
+      if (isZero(a)) {
+        return add ? b : ir::Neg::make(b);
+      }
+      return add ? ir::Add::make(a, b) : ir::Sub::make(a, b);
+    }
+    if (isa<Mul>(expr)) {
+      const Mul* mul = to<Mul>(expr);
+      if (!dependsOnIteration(mul->b)) {
+        Expr a = getCoefficient(mul->a);
+        return (!a.defined() || isZero(a)) ? a : ir::Mul::make(a, mul->b);
+      }
+      if (!dependsOnIteration(mul->a)) {
+        Expr b = getCoefficient(mul->b);
+        return (!b.defined() || isZero(b)) ? b : ir::Mul::make(mul->a, b);
+      }
+      return Expr();
+    }
+    if (isa<Cast>(expr)) {
+      return getCoefficient(to<Cast>(expr)->a);
+    }
+    return Expr();
+  }
+
+  static bool isZero(Expr coefficient) {
+    return isa<Literal>(coefficient) &&
+           to<Literal>(coefficient)->equalsScalar(0);
+  }
+
+  // Loop invariant factors of coefficients are strides, such as dimensions,
+  // which are taken to be nonzero.  Sums of nonzero terms may cancel.
+  bool isNonzero(Expr coefficient) {
+    if (!coefficient.defined()) {
+      return false;
+    }
+    if (isa<Literal>(coefficient)) {
+      return !isZero(coefficient);
+    }
+    if (isa<Neg>(coefficient)) {
+      return isNonzero(to<Neg>(coefficient)->a);
+    }
+    if (isa<Mul>(coefficient)) {
+      return isNonzero(to<Mul>(coefficient)->a) &&
+             isNonzero(to<Mul>(coefficient)->b);
+    }
+    return isa<Var>(coefficient) && !dependsOnIteration(coefficient);
+  }
+
+  void visit(const Var* op) {
+    uses[op]++;
+  }
+
+  void visit(const VarDecl* op) {
+    locals.insert(op->var);
+    if (dependsOnIteration(op->rhs)) {
+      if (isAffine(op->rhs)) {
+        affine.insert(op->var);
+        Expr coefficient = getCoefficient(op->rhs);
+        if (coefficient.defined()) {
+          coefficients[op->var] = coefficient;
+        }
+      }
+      varying.insert(op->var);
+    }
+    op->rhs.accept(this);
+  }
+
+  void visit(const For* op) {
+    locals.insert(op->var);
+    if (isAffine(op->start) && !dependsOnIteration(op->increment)) {
+      affine.insert(op->var);
+      // Inner loop variables step within an iteration from a start that is
+      // offset by the loop variable
+      Expr coefficient = getCoefficient(op->start);
+      if (coefficient.defined() && op->var.ptr != loopVar.ptr) {
+        coefficients[op->var] = coefficient;
+      }
+    }
+    varying.insert(op->var);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Assign* op) {
+    if (locals.count(op->lhs)) {
+      // Variables that are updated in the loop carry values across iterations
+      affine.erase(op->lhs);
+      coefficients.erase(op->lhs);
+      if (dependsOnIteration(op->rhs)) {
+        varying.insert(op->lhs);
+      }
+      IRVisitor::visit(op);
+      return;
+    }
+    op->lhs.accept(this);
+    Expr a, b;
+    string reduction;
+    if (isa<Add>(op->rhs)) {
+      a = to<Add>(op->rhs)->a;
+      b = to<Add>(op->rhs)->b;
+      reduction = "+";
+    }
+    else if (isa<Mul>(op->rhs)) {
+      a = to<Mul>(op->rhs)->a;
+      b = to<Mul>(op->rhs)->b;
+      reduction = "*";
+    }
+    if (op->use_atomics || !a.defined() || a != op->lhs ||
+        (reductions.count(op->lhs) && reductions[op->lhs] != reduction)) {
+      scalarsIndependent = false;
+      op->rhs.accept(this);
+      return;
+    }
+    reductions[op->lhs] = reduction;
+    reductionUpdates[op->lhs]++;
+    op->rhs.accept(this);
+  }
+
+  void visit(const Load* op) {
+    accesses[op->arr].push_back(op->loc);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Store* op) {
+    // Locations that do not move with the loop variable, such as those of a
+    // nested loop over a workspace, are written by every iteration
+    if (op->use_atomics || !isAffine(op->loc) ||
+        !isNonzero(getCoefficient(op->loc))) {
+      memoryIndependent = false;
+    }
+    accesses[op->arr].push_back(op->loc);
+    stored.insert(op->arr);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Break* op) {
+    memoryIndependent = false;
+    scalarsIndependent = false;
+  }
+};
+
+} // anonymous namespace
+
+vector<string> CodeGen_C::genVectorizePragmas(Stmt loop, Expr loopVar,
+                                              int width) {
+  LoopDependences dependences(loop, loopVar);
+  const bool independent = dependences.memoryIndependent &&
+                           dependences.scalarsIndependent;
+
+  // OpenMP simd asserts that iterations are independent, so it is only
+  // emitted for for loops whose dependences are known to be reductions
+  string simdPragma;
+  if (isa<For>(loop) && independent) {
+    stringstream ret;
+    ret << "#pragma omp simd";
+    if (width) {
+      ret << " simdlen(" << width << ")";
+    }
+    for (auto& reduction : dependences.reductions) {
+      taco_iassert(varMap.count(reduction.first) > 0);
+      ret << " reduction(" << reduction.second << ":"
+          << varMap[reduction.first] << ")";
+    }
+    simdPragma = ret.str();
+  }
+
+  string gccPragma = !simdPragma.empty() ? simdPragma :
+                     dependences.memoryIndependent ? "#pragma GCC ivdep" : "";
+  string intelPragma = !simdPragma.empty() ? simdPragma
+                                           : genClangVectorizePragma(width);
+  switch (compilerFamily) {
+    case Target::GCC:
+      return gccPragma.empty() ? vector<string>() : vector<string>{gccPragma};
+    case Target::Clang:
+      return {genClangVectorizePragma(width)};
+    case Target::IntelLLVM:
+      return {intelPragma};
+    case Target::CompilerUnknown:
+      break;
+  }
+
+  // Intel's LLVM based compilers also define __clang__
+  vector<string> pragmas = {"#if defined(__INTEL_LLVM_COMPILER)", intelPragma,
+                            "#elif defined(__clang__)",
+                            genClangVectorizePragma(width)};
+  if (!gccPragma.empty()) {
+    pragmas.push_back("#elif defined(__GNUC__)");
+    pragmas.push_back(gccPragma);
+  }
+  pragmas.push_back("#endif");
+  return pragmas;
+}
+
 static string getParallelizePragma(LoopKind kind) {
   stringstream ret;
   ret << "#pragma omp parallel for schedule";
@@ -395,12 +1081,16 @@ static string getAtomicPragma() {
 //
 // Docs for vectorization pragmas:
 // http://clang.llvm.org/docs/LanguageExtensions.html#extensions-for-loop-hint-optimizations
+// https://gcc.gnu.org/onlinedocs/gcc/Loop-Specific-Pragmas.html
+// https://www.openmp.org/spec-html/5.0/openmpsu42.html
 void CodeGen_C::visit(const For* op) {
   switch (op->kind) {
     case LoopKind::Vectorized:
-      doIndent();
-      out << genVectorizePragma(op->vec_width);
-      out << "\n";
+      for (auto& pragma : genVectorizePragmas(op, op->var, op->vec_width)) {
+        doIndent();
+        out << pragma;
+        out << "\n";
+      }
       break;
     case LoopKind::Static:
     case LoopKind::Dynamic:
@@ -456,9 +1146,11 @@ void CodeGen_C::visit(const While* op) {
   // while loops
   // however, we'll output the pragmas anyway
   if (op->kind == LoopKind::Vectorized) {
-    doIndent();
-    out << genVectorizePragma(op->vec_width);
-    out << "\n";
+    for (auto& pragma : genVectorizePragmas(op, Expr(), op->vec_width)) {
+      doIndent();
+      out << pragma;
+      out << "\n";
+    }
   }
 
   IRPrinter::visit(op);
@@ -466,7 +1158,7 @@ void CodeGen_C::visit(const While* op) {
 
 void CodeGen_C::visit(const GetProperty* op) {
   taco_iassert(varMap.count(op) > 0) <<
-      "Property " << Expr(op) << " of " << op->tensor << " not found in varMap";
+      "Property " << op->name << " of " << op->tensor << " not found in varMap";
   out << varMap[op];
 }
 
@@ -505,13 +1197,21 @@ void CodeGen_C::visit(const Max* op) {
 void CodeGen_C::visit(const Allocate* op) {
   string elementType = printCType(op->var.type(), false);
 
+  // Arrays are allocated aligned for vectorized loads and stores, which the
+  // compiler may assume as long as the array is never reallocated.
+  bool assumeAligned = !op->is_realloc &&
+                       !reallocatedArrays.count(varMap[op->var]);
+
   doIndent();
   op->var.accept(this);
   stream << " = (";
   stream << elementType << "*";
   stream << ")";
+  if (assumeAligned) {
+    stream << "TACO_ASSUME_ALIGNED(";
+  }
   if (op->is_realloc) {
-    stream << "realloc(";
+    stream << "taco_reallocate(taco_kernelAllocator, ";
     op->var.accept(this);
     stream << ", ";
   }
@@ -519,9 +1219,9 @@ void CodeGen_C::visit(const Allocate* op) {
     // If the allocation was requested to clear the allocated memory,
     // use calloc instead of malloc.
     if (op->clear) {
-      stream << "calloc(1, ";
+      stream << "taco_callocate(taco_kernelAllocator, ";
     } else {
-      stream << "malloc(";
+      stream << "taco_allocate(taco_kernelAllocator, ";
     }
   }
   stream << "sizeof(" << elementType << ")";
@@ -529,10 +1229,22 @@ void CodeGen_C::visit(const Allocate* op) {
   parentPrecedence = MUL;
   op->num_elements.accept(this);
   parentPrecedence = TOP;
-  stream << ");";
+  // Arrays of tensor properties are results that outlive the kernel, while
+  // all other arrays are temporaries.
+  stream << ", " << (isa<GetProperty>(op->var) ? 0 : 1);
+  stream << (assumeAligned ? "));" : ");");
     stream << endl;
 }
 
+void CodeGen_C::visit(const Free* op) {
+  doIndent();
+  stream << "taco_deallocate(taco_kernelAllocator, ";
+  parentPrecedence = Precedence::TOP;
+  op->var.accept(this);
+  stream << ", " << (isa<GetProperty>(op->var) ? 0 : 1) << ");";
+  stream << endl;
+}
+
 void CodeGen_C::visit(const Sqrt* op) {
   taco_tassert(op->type.isFloat() && op->type.getNumBits() == 64) <<
       "Codegen doesn't currently support non-double sqrt";
@@ -5,6 +5,7 @@
 
 #include "taco/ir/ir.h"
 #include "taco/ir/ir_printer.h"
+#include "taco/target.h"
 #include "codegen.h"
 
 namespace taco {
@@ -25,6 +26,10 @@ public:
   /// a mix of taco_tensor_t* and scalars into a function call
   static void generateShim(const Stmt& func, std::stringstream &stream);
 
+  /// Set the family of the compiler that will compile the generated code,
+  /// which determines the vectorization hints emitted for vectorized loops.
+  void setCompilerFamily(Target::CompilerFamily compilerFamily);
+
 protected:
   using IRPrinter::visit;
 
@@ -38,6 +43,7 @@ protected:
   void visit(const Min*);
   void visit(const Max*);
   void visit(const Allocate*);
+  void visit(const Free*);
   void visit(const Sqrt*);
   void visit(const Store*);
   void visit(const Assign*);
@@ -51,9 +57,14 @@ protected:
   std::string funcName;
   int labelCount;
   bool emittingCoroutine;
+  Target::CompilerFamily compilerFamily;
+  std::set<std::string> reallocatedArrays;
 
   class FindVars;
 
+  std::vector<std::string> genVectorizePragmas(Stmt loop, Expr loopVar,
+                                               int width);
+
 private:
   virtual std::string restrictKeyword() const { return "restrict"; }
 };
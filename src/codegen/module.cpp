@@ -2,6 +2,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <set>
+#include <mutex>
+#include <cstdio>
 #include <dlfcn.h>
 #include <unistd.h>
 #if USE_OPENMP
@@ -9,6 +12,7 @@
 #endif
 
 #include "taco/tensor.h"
+#include "taco/allocator.h"
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/env.h"
@@ -51,6 +55,10 @@ void Module::compileToSource(string path, string prefix) {
         "Only C99 codegen supported currently";
     std::shared_ptr<CodeGen> sourcegen =
         CodeGen::init_default(source, CodeGen::ImplementationGen);
+    if (!should_use_CUDA_codegen()) {
+      static_pointer_cast<CodeGen_C>(sourcegen)->setCompilerFamily(
+          target.compilerFamily);
+    }
     std::shared_ptr<CodeGen> headergen =
             CodeGen::init_default(header, CodeGen::HeaderGen);
 
@@ -102,6 +110,130 @@ void writeShims(vector<Stmt> funcs, string path, string prefix) {
   shims_file.close();
 }
 
+Target::CompilerFamily detectCompilerFamily(const string& cc) {
+  // Modules may be compiled from several threads
+  static mutex familiesMutex;
+  static map<string, Target::CompilerFamily> families;
+  lock_guard<mutex> lock(familiesMutex);
+  if (families.count(cc)) {
+    return families.at(cc);
+  }
+
+  string version;
+  FILE* pipe = popen((cc + " --version 2>/dev/null").c_str(), "r");
+  if (pipe) {
+    char buffer[256];
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+      version += buffer;
+    }
+    pclose(pipe);
+  }
+
+  Target::CompilerFamily family = Target::CompilerUnknown;
+  if (version.find("Intel") != string::npos) {
+    family = Target::IntelLLVM;
+  }
+  else if (version.find("clang") != string::npos) {
+    family = Target::Clang;
+  }
+  else if (version.find("Free Software Foundation") != string::npos ||
+           version.find("gcc") != string::npos ||
+           version.find("GCC") != string::npos) {
+    family = Target::GCC;
+  }
+  families[cc] = family;
+  return family;
+}
+
+/// Summarize which loops of the generated source were vectorized, given the
+/// optimization remarks emitted while compiling it.
+string summarizeVectorization(string source, string sourcePath,
+                              istream& remarks) {
+  // Loops of the source by the line of their header, mapped to the first
+  // line of the pragmas preceding them
+  map<int, int> loopStarts;
+  set<int> requested;
+  stringstream sourceStream(source);
+  string line;
+  int pragmaStart = 0;
+  bool sawPragma = false;
+  for (int lineNumber = 1; getline(sourceStream, line); lineNumber++) {
+    size_t start = line.find_first_not_of(" ");
+    if (start == string::npos) {
+      continue;
+    }
+    line = line.substr(start);
+    if (line[0] == '#') {
+      pragmaStart = pragmaStart ? pragmaStart : lineNumber;
+      sawPragma = sawPragma || line.find("simd") != string::npos ||
+                  line.find("ivdep") != string::npos ||
+                  line.find("vectorize") != string::npos;
+      continue;
+    }
+    if (line.compare(0, 4, "for ") == 0 || line.compare(0, 6, "while ") == 0) {
+      loopStarts[lineNumber] = pragmaStart ? pragmaStart : lineNumber;
+      if (sawPragma) {
+        requested.insert(lineNumber);
+      }
+    }
+    pragmaStart = 0;
+    sawPragma = false;
+  }
+
+  // Remarks have the form path:line:column: message, where compilers report
+  // a line from the loop's pragmas through the start of its body
+  map<int, string> vectorized;
+  while (getline(remarks, line)) {
+    if (line.compare(0, sourcePath.size() + 1, sourcePath + ":") != 0) {
+      continue;
+    }
+    string location = line.substr(sourcePath.size() + 1);
+    size_t messageStart = location.find(": ");
+    if (messageStart == string::npos) {
+      continue;
+    }
+    string message = location.substr(messageStart + 2);
+    if (message.find("vectorized") == string::npos ||
+        message.find("not vectorized") != string::npos ||
+        message.find("basic block") != string::npos) {
+      continue;
+    }
+    for (string prefix : {"optimized: ", "remark: "}) {
+      if (message.compare(0, prefix.size(), prefix) == 0) {
+        message = message.substr(prefix.size());
+      }
+    }
+    message = message.substr(0, message.find(" [-R"));
+
+    int remarkLine = atoi(location.c_str());
+    int loop = remarkLine;
+    for (auto& loopStart : loopStarts) {
+      if (loopStart.second <= remarkLine) {
+        loop = loopStart.first;
+      }
+    }
+    if (!vectorized.count(loop)) {
+      vectorized[loop] = message;
+    }
+  }
+
+  stringstream report;
+  for (auto& loop : vectorized) {
+    report << "line " << loop.first << ": " << loop.second;
+    if (requested.count(loop.first)) {
+      report << " (requested)";
+    }
+    report << endl;
+  }
+  for (int loop : requested) {
+    if (!vectorized.count(loop)) {
+      report << "line " << loop << ": requested vectorization not performed"
+             << endl;
+    }
+  }
+  return report.str();
+}
+
 } // anonymous namespace
 
 string Module::compile() {
@@ -112,6 +244,8 @@ string Module::compile() {
   string cflags;
   string file_ending;
   string shims_file;
+  string remarks_file = prefix + ".remarks";
+  string remarks_redirect;
   if (should_use_CUDA_codegen()) {
     cc = util::getFromEnv("TACO_NVCC", "nvcc");
     cflags = util::getFromEnv("TACO_NVCCFLAGS",
@@ -121,18 +255,38 @@ string Module::compile() {
   }
   else {
     cc = util::getFromEnv(target.compiler_env, target.compiler);
+    if (target.compilerFamily == Target::CompilerUnknown) {
+      target.compilerFamily = detectCompilerFamily(cc);
+    }
     cflags = util::getFromEnv("TACO_CFLAGS",
     "-O3 -ffast-math -std=c99") + " -shared -fPIC";
 #if USE_OPENMP
     cflags += " -fopenmp";
+#else
+    if (target.compilerFamily != Target::CompilerUnknown) {
+      cflags += " -fopenmp-simd";
+    }
 #endif
+    // Ask for optimization remarks on vectorized loops
+    switch (target.compilerFamily) {
+      case Target::GCC:
+        cflags += " -fopt-info-vec-optimized=" + remarks_file;
+        break;
+      case Target::Clang:
+      case Target::IntelLLVM:
+        cflags += " -Rpass=loop-vectorize";
+        remarks_redirect = " 2> " + remarks_file;
+        break;
+      case Target::CompilerUnknown:
+        break;
+    }
     file_ending = ".c";
     shims_file = "";
   }
   
   string cmd = cc + " " + cflags + " " +
     prefix + file_ending + " " + shims_file + " " + 
-    "-o " + fullpath + " -lm";
+    "-o " + fullpath + " -lm" + remarks_redirect;
 
   // open the output file & write out the source
   compileToSource(tmpdir, libname);
@@ -142,8 +296,17 @@ string Module::compile() {
   
   // now compile it
   int err = system(cmd.data());
+  stringstream remarks;
+  ifstream remarks_stream(remarks_file);
+  remarks << remarks_stream.rdbuf();
+  // Diagnostics of compilers whose remarks are printed to stderr are in the
+  // remarks file
   taco_uassert(err == 0) << "Compilation command failed:\n" << cmd
-    << "\nreturned " << err;
+    << "\nreturned " << err
+    << (remarks_redirect.empty() ? "" : "\n" + remarks.str());
+  vectorizationReport = remarks_stream.is_open()
+      ? summarizeVectorization(source.str(), prefix + file_ending, remarks)
+      : "";
 
   // use dlsym() to open the compiled library
   if (lib_handle) {
@@ -151,6 +314,11 @@ string Module::compile() {
   }
   lib_handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
   taco_uassert(lib_handle) << "Failed to load generated code";
+  *reinterpret_cast<void**>(&setAllocator) =
+      dlsym(lib_handle, "taco_setAllocator");
+  parallel = source.str().find("#pragma omp parallel") != string::npos;
+  *reinterpret_cast<void**>(&setWorkspaceCache) =
+      dlsym(lib_handle, "taco_setWorkspaceCache");
 
   return fullpath;
 }
@@ -164,43 +332,99 @@ string Module::getSource() {
   return source.str();
 }
 
+string Module::getVectorizationReport() {
+  return vectorizationReport;
+}
+
+void Module::releaseWorkspaces() {
+  workspaces->release();
+}
+
+size_t Module::getWorkspaceSize() const {
+  return workspaces->getSize();
+}
+
 void* Module::getFuncPtr(std::string name) {
   return dlsym(lib_handle, name.data());
 }
 
 int Module::callFuncPackedRaw(std::string name, void** args) {
+  return callFuncPtrRaw(getFuncPtr(name), args);
+}
+
+int Module::callFuncPtrRaw(void* funcPtr, void** args) {
+  KernelAllocator* allocator = getScopedKernelAllocator();
+  if (allocator != nullptr) {
+    return callFuncPtrRaw(funcPtr, args, allocator);
+  }
+  shared_ptr<KernelAllocator> installed = getKernelAllocator();
+  return callFuncPtrRaw(funcPtr, args, installed.get());
+}
+
+int Module::callFuncPtrRaw(void* v_func_ptr, void** args,
+                           KernelAllocator* allocator,
+                           WorkspaceCache* workspaces) {
   typedef int (*fnptr_t)(void**);
   static_assert(sizeof(void*) == sizeof(fnptr_t),
     "Unable to cast dlsym() returned void pointer to function pointer");
-  void* v_func_ptr = getFuncPtr(name);
   fnptr_t func_ptr;
   *reinterpret_cast<void**>(&func_ptr) = v_func_ptr;
 
 #if USE_OPENMP
-  omp_sched_t existingSched;
-  ParallelSchedule tacoSched;
-  int existingChunkSize, tacoChunkSize;
-  int existingNumThreads = omp_get_max_threads();
-  omp_get_schedule(&existingSched, &existingChunkSize);
-  taco_get_parallel_schedule(&tacoSched, &tacoChunkSize);
-  switch (tacoSched) {
-    case ParallelSchedule::Static:
-      omp_set_schedule(omp_sched_static, tacoChunkSize);
-      break;
-    case ParallelSchedule::Dynamic:
-      omp_set_schedule(omp_sched_dynamic, tacoChunkSize);
-      break;
-    default:
-      break;
-  }
-  omp_set_num_threads(taco_get_num_threads());
+  // Serial code does not read the OpenMP settings, so they are only changed
+  // for the duration of calls to code with parallel loops
+  omp_sched_t existingSched = omp_sched_static;
+  int existingChunkSize = 0, existingNumThreads = 0;
+  if (parallel) {
+    ParallelSchedule tacoSched;
+    int tacoChunkSize;
+    existingNumThreads = omp_get_max_threads();
+    omp_get_schedule(&existingSched, &existingChunkSize);
+    taco_get_parallel_schedule(&tacoSched, &tacoChunkSize);
+    switch (tacoSched) {
+      case ParallelSchedule::Static:
+        omp_set_schedule(omp_sched_static, tacoChunkSize);
+        break;
+      case ParallelSchedule::Dynamic:
+        omp_set_schedule(omp_sched_dynamic, tacoChunkSize);
+        break;
+      default:
+        break;
+    }
+    omp_set_num_threads(taco_get_num_threads());
+  }
 #endif
 
+  // The hooks are set for the calling thread only, so concurrent calls with
+  // different allocators or workspace caches do not interfere
+  if (setAllocator != nullptr) {
+    setAllocator((allocator != nullptr) ? allocator->getHooks() : nullptr);
+  }
+  if (setWorkspaceCache != nullptr) {
+    setWorkspaceCache((workspaces != nullptr) ? workspaces->getHooks()
+                                              : this->workspaces->getHooks());
+  }
+  if (allocator != nullptr) {
+    allocator->beginKernel();
+  }
+
   int ret = func_ptr(args);
 
+  if (allocator != nullptr) {
+    allocator->endKernel();
+  }
+  if (setAllocator != nullptr) {
+    setAllocator(nullptr);
+  }
+  if (setWorkspaceCache != nullptr) {
+    setWorkspaceCache(nullptr);
+  }
+
 #if USE_OPENMP
-  omp_set_schedule(existingSched, existingChunkSize);
-  omp_set_num_threads(existingNumThreads);
+  if (parallel) {
+    omp_set_schedule(existingSched, existingChunkSize);
+    omp_set_num_threads(existingNumThreads);
+  }
 #endif
 
   return ret;
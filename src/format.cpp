@@ -99,6 +99,16 @@ void Format::setLevelArrayTypes(std::vector<std::vector<Datatype>> levelArrayTyp
   this->levelArrayTypes = levelArrayTypes;
 }
 
+bool Format::isSymmetric() const {
+  return this->symmetric;
+}
+
+void Format::setSymmetric(bool symmetric) {
+  taco_uassert(!symmetric || getOrder() == 2)
+      << "Only matrix formats can be symmetric";
+  this->symmetric = symmetric;
+}
+
 
 bool operator==(const Format& a, const Format& b){
   const auto aModeTypePacks = a.getModeFormatPacks();
@@ -107,7 +117,8 @@ bool operator==(const Format& a, const Format& b){
   const auto bModeOrdering = b.getModeOrdering();
   
   if (aModeTypePacks.size() != bModeTypePacks.size() || 
-      aModeOrdering.size() != bModeOrdering.size()) {
+      aModeOrdering.size() != bModeOrdering.size() ||
+      a.isSymmetric() != b.isSymmetric()) {
     return false;
   }
   for (size_t i = 0; i < aModeOrdering.size(); ++i) {
@@ -129,7 +140,8 @@ bool operator!=(const Format& a, const Format& b) {
 
 std::ostream &operator<<(std::ostream& os, const Format& format) {
   return os << "(" << util::join(format.getModeFormatPacks(), ",") << "; "
-            << util::join(format.getModeOrdering(), ",") << ")";
+            << util::join(format.getModeOrdering(), ",")
+            << (format.isSymmetric() ? "; symmetric" : "") << ")";
 }
 
 
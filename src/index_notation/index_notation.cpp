@@ -1,8 +1,12 @@
 #include "taco/index_notation/index_notation.h"
 
 #include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <map>
 #include <vector>
 #include <utility>
 #include <set>
@@ -15,6 +19,7 @@
 #include "taco/format.h"
 
 #include "taco/index_notation/intrinsic.h"
+#include "taco/index_notation/semiring.h"
 #include "taco/index_notation/schedule.h"
 #include "taco/index_notation/transformations.h"
 #include "taco/index_notation/index_notation_nodes.h"
@@ -105,6 +110,19 @@ std::ostream& operator<<(std::ostream& os, const IndexExpr& expr) {
   return os;
 }
 
+// Intrinsics are identified by their names, except for semiring operations,
+// whose names do not determine the operations of user-defined semirings
+static bool sameIntrinsic(const Intrinsic& a, const Intrinsic& b) {
+  auto aSemiring = dynamic_cast<const SemiringIntrinsic*>(&a);
+  auto bSemiring = dynamic_cast<const SemiringIntrinsic*>(&b);
+  if (aSemiring != nullptr || bSemiring != nullptr) {
+    return aSemiring != nullptr && bSemiring != nullptr &&
+           aSemiring->getSemiring() == bSemiring->getSemiring() &&
+           aSemiring->getOperation() == bSemiring->getOperation();
+  }
+  return a.getName() == b.getName();
+}
+
 struct Isomorphic : public IndexNotationVisitorStrict {
   bool eq = false;
   IndexExpr bExpr;
@@ -138,7 +156,8 @@ struct Isomorphic : public IndexNotationVisitorStrict {
 
   bool check(TensorVar a, TensorVar b) {
     if (!util::contains(isoBTensor, a) && !util::contains(isoATensor, b)) {
-      if (a.getType() != b.getType() || a.getFormat() != b.getFormat()) {
+      if (a.getType() != b.getType() || a.getFormat() != b.getFormat() ||
+          !equals(a.getFill(), b.getFill())) {
         return false;
       }
       isoBTensor.insert({a, b});
@@ -273,7 +292,7 @@ struct Isomorphic : public IndexNotationVisitorStrict {
       return;
     }
     auto bnode = to<CallIntrinsicNode>(bExpr.ptr);
-    if (anode->func->getName() != bnode->func->getName() ||
+    if (!sameIntrinsic(*anode->func, *bnode->func) ||
         anode->args.size() != bnode->args.size()) {
       eq = false;
       return;
@@ -350,7 +369,8 @@ struct Isomorphic : public IndexNotationVisitorStrict {
         !check(anode->stmt, bnode->stmt) ||
         anode->parallel_unit != bnode->parallel_unit ||
         anode->output_race_strategy != bnode->output_race_strategy ||
-        anode->unrollFactor != bnode->unrollFactor) {
+        anode->unrollFactor != bnode->unrollFactor ||
+        anode->coiteration_strategy != bnode->coiteration_strategy) {
       eq = false;
       return;
     }
@@ -561,7 +581,7 @@ struct Equals : public IndexNotationVisitorStrict {
       return;
     }
     auto bnode = to<CallIntrinsicNode>(bExpr.ptr);
-    if (anode->func->getName() != bnode->func->getName() ||
+    if (!sameIntrinsic(*anode->func, *bnode->func) ||
         anode->args.size() != bnode->args.size()) {
       eq = false;
       return;
@@ -637,7 +657,8 @@ struct Equals : public IndexNotationVisitorStrict {
         !equals(anode->stmt, bnode->stmt) ||
         anode->parallel_unit != bnode->parallel_unit ||
         anode->output_race_strategy != bnode->output_race_strategy ||
-        anode->unrollFactor != bnode->unrollFactor) {
+        anode->unrollFactor != bnode->unrollFactor ||
+        anode->coiteration_strategy != bnode->coiteration_strategy) {
       eq = false;
       return;
     }
@@ -1274,6 +1295,25 @@ IndexExpr Not(IndexExpr a) {
   return CallIntrinsic(std::make_shared<NotIntrinsic>(), {a});
 }
 
+IndexExpr mask(IndexExpr m, IndexExpr expr) {
+  taco_uassert(isa<Access>(m)) << "A mask must be a tensor access";
+  return CallIntrinsic(std::make_shared<MaskIntrinsic>(), {m, expr});
+}
+
+IndexExpr maskComplement(IndexExpr m, IndexExpr expr) {
+  taco_uassert(isa<Access>(m)) << "A mask must be a tensor access";
+  return CallIntrinsic(std::make_shared<MaskComplementIntrinsic>(), {m, expr});
+}
+
+IndexExpr offDiagonal(IndexExpr a) {
+  taco_uassert(isa<Access>(a) && to<Access>(a).getIndexVars().size() == 2)
+      << "Only matrix accesses can be restricted to their off-diagonal";
+  const auto& indexVars = to<Access>(a).getIndexVars();
+  taco_uassert(indexVars[0] != indexVars[1])
+      << "A diagonal access has no off-diagonal components";
+  return CallIntrinsic(std::make_shared<OffDiagonalIntrinsic>(), {a});
+}
+
 
 // class Reduction
 Reduction::Reduction(const ReductionNode* n) : IndexExpr(n) {
@@ -1404,10 +1444,23 @@ IndexStmt IndexStmt::split(IndexVar i, IndexVar i1, IndexVar i2, size_t splitFac
   return transformed;
 }
 
-IndexStmt IndexStmt::divide(IndexVar i, IndexVar i1, IndexVar i2, size_t splitFactor) const {
-  taco_not_supported_yet;
-  // mostly the same as split, but instead of splitFactor being a constant use an expression
-  return *this;
+IndexStmt IndexStmt::divide(IndexVar i, IndexVar i1, IndexVar i2, size_t divideFactor) const {
+  IndexVarRel rel = IndexVarRel(new DivideRelNode(i, i1, i2, divideFactor));
+  string reason;
+
+  // Add predicate to concrete index notation
+  IndexStmt transformed = Transformation(AddSuchThatPredicates({rel})).apply(*this, &reason);
+  if (!transformed.defined()) {
+    taco_uerror << reason;
+  }
+
+  // Replace all occurrences of i with nested i1, i2
+  transformed = Transformation(ForAllReplace({i}, {i1, i2})).apply(transformed, &reason);
+  if (!transformed.defined()) {
+    taco_uerror << reason;
+  }
+
+  return transformed;
 }
 
 IndexStmt IndexStmt::precompute(IndexExpr expr, IndexVar i, IndexVar iw, TensorVar workspace) const {
@@ -1556,7 +1609,7 @@ IndexStmt IndexStmt::unroll(IndexVar i, size_t unrollFactor) const {
 
     void visit(const ForallNode* node) {
       if (node->indexVar == i) {
-        stmt = Forall(i, rewrite(node->stmt), node->parallel_unit, node->output_race_strategy, unrollFactor);
+        stmt = Forall(i, rewrite(node->stmt), node->parallel_unit, node->output_race_strategy, unrollFactor, node->coiteration_strategy);
       }
       else {
         IndexNotationRewriter::visit(node);
@@ -1566,6 +1619,25 @@ IndexStmt IndexStmt::unroll(IndexVar i, size_t unrollFactor) const {
   return UnrollLoop(i, unrollFactor).rewrite(*this);
 }
 
+IndexStmt IndexStmt::coiterate(IndexVar i, CoIterationStrategy strategy) const {
+  struct SetCoIterationStrategy : IndexNotationRewriter {
+    using IndexNotationRewriter::visit;
+    IndexVar i;
+    CoIterationStrategy strategy;
+    SetCoIterationStrategy(IndexVar i, CoIterationStrategy strategy) : i(i), strategy(strategy) {}
+
+    void visit(const ForallNode* node) {
+      if (node->indexVar == i) {
+        stmt = Forall(i, rewrite(node->stmt), node->parallel_unit, node->output_race_strategy, node->unrollFactor, strategy);
+      }
+      else {
+        IndexNotationRewriter::visit(node);
+      }
+    }
+  };
+  return SetCoIterationStrategy(i, strategy).rewrite(*this);
+}
+
 std::ostream& operator<<(std::ostream& os, const IndexStmt& expr) {
   if (!expr.defined()) return os << "IndexStmt()";
   IndexNotationPrinter printer(os);
@@ -1654,8 +1726,9 @@ Forall::Forall(IndexVar indexVar, IndexStmt stmt)
     : Forall(indexVar, stmt, ParallelUnit::NotParallel, OutputRaceStrategy::IgnoreRaces) {
 }
 
-Forall::Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor)
-        : Forall(new ForallNode(indexVar, stmt, parallel_unit, output_race_strategy, unrollFactor)) {
+Forall::Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor,
+               CoIterationStrategy coiterationStrategy)
+        : Forall(new ForallNode(indexVar, stmt, parallel_unit, output_race_strategy, unrollFactor, coiterationStrategy)) {
 }
 
 IndexVar Forall::getIndexVar() const {
@@ -1678,12 +1751,17 @@ size_t Forall::getUnrollFactor() const {
   return getNode(*this)->unrollFactor;
 }
 
+CoIterationStrategy Forall::getCoIterationStrategy() const {
+  return getNode(*this)->coiteration_strategy;
+}
+
 Forall forall(IndexVar i, IndexStmt stmt) {
   return Forall(i, stmt);
 }
 
-Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor) {
-  return Forall(i, stmt, parallel_unit, output_race_strategy, unrollFactor);
+Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor,
+              CoIterationStrategy coiterationStrategy) {
+  return Forall(i, stmt, parallel_unit, output_race_strategy, unrollFactor, coiterationStrategy);
 }
 
 template <> bool isa<Forall>(IndexStmt s) {
@@ -1888,6 +1966,7 @@ struct TensorVar::Content {
   string name;
   Type type;
   Format format;
+  Literal fill;
   Schedule schedule;
 };
 
@@ -1942,6 +2021,19 @@ const Format& TensorVar::getFormat() const {
   return content->format;
 }
 
+Literal TensorVar::getFill() const {
+  return content->fill.defined()
+         ? content->fill
+         : to<Literal>(Literal::zero(getType().getDataType()));
+}
+
+void TensorVar::setFill(Literal fill) {
+  taco_uassert(fill.getDataType() == getType().getDataType())
+      << "The fill value of " << getName() << " must have type "
+      << getType().getDataType() << " but has type " << fill.getDataType();
+  content->fill = fill;
+}
+
 const Schedule& TensorVar::getSchedule() const {
   struct GetSchedule : public IndexNotationVisitor {
     using IndexNotationVisitor::visit;
@@ -2342,14 +2434,19 @@ IndexStmt makeConcreteNotation(IndexStmt stmt) {
       // that's not a reduction
       vector<IndexVar> topLevelReductions;
       IndexExpr rhs = node->rhs;
-      while (isa<Reduction>(rhs)) {
+      IndexExpr op;
+      // Nested reductions can only be hoisted together if they use the same
+      // reduction operator
+      while (isa<Reduction>(rhs) &&
+             (!op.defined() || equals(to<Reduction>(rhs).getOp(), op))) {
         Reduction reduction = to<Reduction>(rhs);
         topLevelReductions.push_back(reduction.getVar());
+        op = reduction.getOp();
         rhs = reduction.getExpr();
       }
 
       if (rhs != node->rhs) {
-        stmt = Assignment(node->lhs, rhs, Add());
+        stmt = Assignment(node->lhs, rhs, op);
         for (auto& i : util::reverse(topLevelReductions)) {
           stmt = forall(i, stmt);
         }
@@ -2414,11 +2511,13 @@ vector<TensorVar> getResults(IndexStmt stmt) {
   vector<TensorVar> result;
   set<TensorVar> collected;
 
+  // A result may be written by several assignments of a multi statement
   for (auto& access : getResultAccesses(stmt).first) {
     TensorVar tensor = access.getTensorVar();
-    taco_iassert(!util::contains(collected, tensor));
-    collected.insert(tensor);
-    result.push_back(tensor);
+    if (!util::contains(collected, tensor)) {
+      collected.insert(tensor);
+      result.push_back(tensor);
+    }
   }
 
   return result;
@@ -2644,10 +2743,14 @@ private:
   set<TensorVar> zeroedVars;
 
   void visit(const AccessNode* op) {
-    if (util::contains(zeroed, op) ||
-        util::contains(zeroedVars, op->tensorVar)) {
+    if (util::contains(zeroedVars, op->tensorVar)) {
       expr = IndexExpr();
     }
+    else if (util::contains(zeroed, op)) {
+      // Exhausted operands hold their fill value
+      Literal fill = op->tensorVar.getFill();
+      expr = isZero(fill) ? IndexExpr() : fill;
+    }
     else {
       expr = op;
     }
@@ -2761,6 +2864,24 @@ private:
   }
 
   void visit(const CallIntrinsicNode* op) {
+    // Exhausted operands of semiring operations hold the additive identity,
+    // which a semiring addition can drop outright.
+    const SemiringIntrinsic* semiringOp = getSemiringIntrinsic(op);
+    if (semiringOp && semiringOp->getOperation() == SemiringIntrinsic::Addition) {
+      IndexExpr a = rewrite(op->args[0]);
+      IndexExpr b = rewrite(op->args[1]);
+      if (!a.defined() || !b.defined()) {
+        expr = a.defined() ? a : b;
+      }
+      else if (a == op->args[0] && b == op->args[1]) {
+        expr = op;
+      }
+      else {
+        expr = new CallIntrinsicNode(op->func, {a, b});
+      }
+      return;
+    }
+
     std::vector<IndexExpr> args;
     std::vector<size_t> zeroArgs;
     bool rewritten = false;
@@ -2768,7 +2889,9 @@ private:
       IndexExpr arg = op->args[i];
       IndexExpr rewrittenArg = rewrite(arg);
       if (!rewrittenArg.defined()) {
-        rewrittenArg = Literal::zero(arg.getDataType());
+        rewrittenArg = semiringOp
+            ? semiringOp->getSemiring()->addIdentity(arg.getDataType())
+            : Literal::zero(arg.getDataType());
         zeroArgs.push_back(i);
       }
       args.push_back(rewrittenArg);
@@ -2839,7 +2962,7 @@ private:
       stmt = op;
     }
     else {
-      stmt = new ForallNode(op->indexVar, body, op->parallel_unit, op->output_race_strategy, op->unrollFactor);
+      stmt = new ForallNode(op->indexVar, body, op->parallel_unit, op->output_race_strategy, op->unrollFactor, op->coiteration_strategy);
     }
   }
 
@@ -2865,7 +2988,20 @@ private:
   }
 
   void visit(const MultiNode* op) {
-    taco_not_supported_yet;
+    IndexStmt stmt1 = rewrite(op->stmt1);
+    IndexStmt stmt2 = rewrite(op->stmt2);
+    if (!stmt1.defined()) {
+      stmt = stmt2;
+    }
+    else if (!stmt2.defined()) {
+      stmt = stmt1;
+    }
+    else if (stmt1 == op->stmt1 && stmt2 == op->stmt2) {
+      stmt = op;
+    }
+    else {
+      stmt = new MultiNode(stmt1, stmt2);
+    }
   }
 
   void visit(const SuchThatNode* op) {
@@ -2890,6 +3026,227 @@ IndexStmt zero(IndexStmt stmt, const std::set<Access>& zeroed) {
   return Zero(zeroed).rewrite(stmt);
 }
 
+/// Lowers an index expression without tensor accesses to IR, which reuses the
+/// constant folding that intrinsics do when they are lowered.
+struct LowerConstant : public IndexExprVisitorStrict {
+  using IndexExprVisitorStrict::visit;
+
+  ir::Expr expr;
+
+  ir::Expr lower(IndexExpr e) {
+    expr = ir::Expr();
+    e.accept(this);
+    ir::Expr result = expr;
+    expr = ir::Expr();
+    return result;
+  }
+
+  void visit(const AccessNode* op) {
+    expr = ir::Expr();
+  }
+
+  void visit(const LiteralNode* op) {
+    ComponentTypeUnion value;
+    memcpy(&value, op->val, op->getDataType().getNumBytes());
+    expr = ir::Literal::make(TypedComponentVal(op->getDataType(), &value),
+                             op->getDataType());
+  }
+
+  template <class T>
+  void visitUnary(const UnaryExprNode* op) {
+    ir::Expr a = lower(op->a);
+    expr = a.defined() ? T::make(a) : ir::Expr();
+  }
+
+  template <class T>
+  void visitBinary(const BinaryExprNode* op) {
+    ir::Expr a = lower(op->a);
+    ir::Expr b = lower(op->b);
+    expr = (a.defined() && b.defined()) ? T::make(a, b) : ir::Expr();
+  }
+
+  void visit(const NegNode* op)  { visitUnary<ir::Neg>(op); }
+  void visit(const SqrtNode* op) { visitUnary<ir::Sqrt>(op); }
+  void visit(const AddNode* op)  { visitBinary<ir::Add>(op); }
+  void visit(const SubNode* op)  { visitBinary<ir::Sub>(op); }
+  void visit(const MulNode* op)  { visitBinary<ir::Mul>(op); }
+  void visit(const DivNode* op)  { visitBinary<ir::Div>(op); }
+
+  void visit(const CastNode* op) {
+    ir::Expr a = lower(op->a);
+    expr = a.defined() ? ir::Cast::make(a, op->getDataType()) : ir::Expr();
+  }
+
+  void visit(const CallIntrinsicNode* op) {
+    std::vector<ir::Expr> args;
+    for (auto& arg : op->args) {
+      args.push_back(lower(arg));
+      if (!args.back().defined()) {
+        expr = ir::Expr();
+        return;
+      }
+    }
+    expr = op->func->lower(args);
+  }
+
+  void visit(const ReductionNode* op) {
+    expr = ir::Expr();
+  }
+};
+
+/// Evaluates constant IR to a value, or returns false if the IR calls a
+/// function that is not known at compile time.
+static bool foldConstant(ir::Expr e, std::complex<double>* value) {
+  std::complex<double> a, b;
+  if (ir::isa<ir::Literal>(e)) {
+    auto literal = ir::to<ir::Literal>(e);
+    Datatype type = literal->type;
+    *value = type.isBool()    ? (double)literal->getBoolValue()
+           : type.isInt()     ? (double)literal->getIntValue()
+           : type.isUInt()    ? (double)literal->getUIntValue()
+           : type.isFloat()   ? literal->getFloatValue()
+           : literal->getComplexValue();
+    return true;
+  }
+  if (ir::isa<ir::Neg>(e)) {
+    if (!foldConstant(ir::to<ir::Neg>(e)->a, &a)) return false;
+    *value = -a;
+    return true;
+  }
+  if (ir::isa<ir::Sqrt>(e)) {
+    if (!foldConstant(ir::to<ir::Sqrt>(e)->a, &a)) return false;
+    *value = e.type().isComplex() ? std::sqrt(a) : std::sqrt(a.real());
+    return true;
+  }
+  if (ir::isa<ir::Cast>(e)) {
+    if (!foldConstant(ir::to<ir::Cast>(e)->a, &a)) return false;
+    *value = (e.type().isInt() || e.type().isUInt())
+             ? std::trunc(a.real()) : a;
+    return true;
+  }
+  if (ir::isa<ir::Add>(e) || ir::isa<ir::Sub>(e) ||
+      ir::isa<ir::Mul>(e) || ir::isa<ir::Div>(e)) {
+    ir::Expr ea, eb;
+    if (ir::isa<ir::Add>(e)) {
+      ea = ir::to<ir::Add>(e)->a; eb = ir::to<ir::Add>(e)->b;
+    } else if (ir::isa<ir::Sub>(e)) {
+      ea = ir::to<ir::Sub>(e)->a; eb = ir::to<ir::Sub>(e)->b;
+    } else if (ir::isa<ir::Mul>(e)) {
+      ea = ir::to<ir::Mul>(e)->a; eb = ir::to<ir::Mul>(e)->b;
+    } else {
+      ea = ir::to<ir::Div>(e)->a; eb = ir::to<ir::Div>(e)->b;
+    }
+    if (!foldConstant(ea, &a) || !foldConstant(eb, &b)) return false;
+    if (ir::isa<ir::Add>(e)) {
+      *value = a + b;
+    } else if (ir::isa<ir::Sub>(e)) {
+      *value = a - b;
+    } else if (ir::isa<ir::Mul>(e)) {
+      *value = a * b;
+    } else if (e.type().isInt() || e.type().isUInt()) {
+      if (b == 0.0) return false;
+      *value = std::trunc(a.real() / b.real());
+    } else {
+      *value = a / b;
+    }
+    return true;
+  }
+  if (ir::isa<ir::Max>(e) || ir::isa<ir::Min>(e)) {
+    const bool isMax = ir::isa<ir::Max>(e);
+    const auto& operands = isMax ? ir::to<ir::Max>(e)->operands
+                                 : ir::to<ir::Min>(e)->operands;
+    for (size_t i = 0; i < operands.size(); ++i) {
+      if (!foldConstant(operands[i], &a)) return false;
+      if (i == 0 || (isMax ? a.real() > value->real()
+                           : a.real() < value->real())) {
+        *value = a;
+      }
+    }
+    return !operands.empty();
+  }
+  if (ir::isa<ir::Call>(e) && !e.type().isComplex()) {
+    auto call = ir::to<ir::Call>(e);
+    std::string func = call->func;
+    if (e.type().getKind() == Datatype::Float32 && !func.empty() &&
+        func.back() == 'f' && func != "fabsf") {
+      func.pop_back();
+    }
+    else if (func == "fabsf") {
+      func = "fabs";
+    }
+    std::vector<double> args;
+    for (auto& arg : call->args) {
+      if (!foldConstant(arg, &a)) return false;
+      args.push_back(a.real());
+    }
+    static const std::map<std::string, double(*)(double)> unaryFuncs = {
+      {"exp", std::exp}, {"log", std::log}, {"log10", std::log10},
+      {"sqrt", std::sqrt}, {"cbrt", std::cbrt}, {"fabs", std::fabs},
+      {"sin", std::sin}, {"cos", std::cos}, {"tan", std::tan},
+      {"sinh", std::sinh}, {"cosh", std::cosh}, {"tanh", std::tanh}
+    };
+    if (args.size() == 1 && util::contains(unaryFuncs, func)) {
+      *value = unaryFuncs.at(func)(args[0]);
+      return true;
+    }
+    if (args.size() == 2 && func == "pow") {
+      *value = std::pow(args[0], args[1]);
+      return true;
+    }
+  }
+  return false;
+}
+
+static Literal makeLiteral(std::complex<double> value, Datatype type) {
+  switch (type.getKind()) {
+    case Datatype::Bool:       return Literal(value != 0.0);
+    case Datatype::UInt8:      return Literal((uint8_t)value.real());
+    case Datatype::UInt16:     return Literal((uint16_t)value.real());
+    case Datatype::UInt32:     return Literal((uint32_t)value.real());
+    case Datatype::UInt64:     return Literal((uint64_t)value.real());
+    case Datatype::Int8:       return Literal((int8_t)value.real());
+    case Datatype::Int16:      return Literal((int16_t)value.real());
+    case Datatype::Int32:      return Literal((int32_t)value.real());
+    case Datatype::Int64:      return Literal((int64_t)value.real());
+    case Datatype::Float32:    return Literal((float)value.real());
+    case Datatype::Float64:    return Literal(value.real());
+    case Datatype::Complex64:  return Literal(std::complex<float>(value));
+    case Datatype::Complex128: return Literal(value);
+    default:
+      break;
+  }
+  return Literal();
+}
+
+Literal getFillValue(IndexExpr expr) {
+  std::set<Access> accesses;
+  match(expr,
+    function<void(const AccessNode*)>([&](const AccessNode* op) {
+      accesses.insert(op);
+    })
+  );
+
+  IndexExpr filled = zero(expr, accesses);
+  if (!filled.defined()) {
+    return to<Literal>(Literal::zero(expr.getDataType()));
+  }
+  if (isa<Literal>(filled)) {
+    return to<Literal>(filled);
+  }
+
+  std::complex<double> value;
+  ir::Expr constant = LowerConstant().lower(filled);
+  if (!constant.defined() || !foldConstant(constant, &value)) {
+    return Literal();
+  }
+  return makeLiteral(value, expr.getDataType());
+}
+
+bool isZero(Literal literal) {
+  std::complex<double> value;
+  return foldConstant(LowerConstant().lower(literal), &value) && value == 0.0;
+}
+
 IndexStmt generatePackStmt(TensorVar tensor, 
                            std::string otherName, Format otherFormat, 
                            std::vector<IndexVar> indexVars, 
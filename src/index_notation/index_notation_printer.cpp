@@ -183,6 +183,9 @@ void IndexNotationPrinter::visit(const ReductionNode* op) {
     void visit(const BinaryExprNode* node) {
       reductionName = "reduction(" + node->getOperatorString() + ")";
     }
+    void visit(const CallIntrinsicNode* node) {
+      reductionName = "reduction(" + node->func->getName() + ")";
+    }
   };
   parentPrecedence = Precedence::REDUCTION;
   os << ReductionName().get(op->op) << "(" << op->var << ", ";
@@ -202,6 +205,9 @@ void IndexNotationPrinter::visit(const AssignmentNode* op) {
     void visit(const BinaryExprNode* node) {
       operatorName = node->getOperatorString();
     }
+    void visit(const CallIntrinsicNode* node) {
+      operatorName = node->func->getName();
+    }
   };
 
   op->lhs.accept(this);
@@ -224,6 +230,9 @@ void IndexNotationPrinter::visit(const ForallNode* op) {
   if (op->parallel_unit != ParallelUnit::NotParallel) {
     os << ", " << ParallelUnit_NAMES[(int) op->parallel_unit] << ", " << OutputRaceStrategy_NAMES[(int) op->output_race_strategy];
   }
+  if (op->coiteration_strategy != CoIterationStrategy::Auto) {
+    os << ", " << CoIterationStrategy_NAMES[(int) op->coiteration_strategy];
+  }
   os << ")";
 }
 
@@ -159,7 +159,7 @@ void IndexNotationRewriter::visit(const ForallNode* op) {
     stmt = op;
   }
   else {
-    stmt = new ForallNode(op->indexVar, s, op->parallel_unit, op->output_race_strategy, op->unrollFactor);
+    stmt = new ForallNode(op->indexVar, s, op->parallel_unit, op->output_race_strategy, op->unrollFactor, op->coiteration_strategy);
   }
 }
 
@@ -274,6 +274,10 @@ struct ReplaceRewriter : public IndexNotationRewriter {
     SUBSTITUTE_EXPR;
   }
 
+  void visit(const CallIntrinsicNode* op) {
+    SUBSTITUTE_EXPR;
+  }
+
   void visit(const ReductionNode* op) {
     SUBSTITUTE_EXPR;
   }
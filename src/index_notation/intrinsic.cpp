@@ -1580,4 +1580,76 @@ NotIntrinsic::zeroPreservingArgs(const std::vector<IndexExpr>& args) const {
   return {};
 }
 
+// class MaskIntrinsic
+
+std::string MaskIntrinsic::getName() const {
+  return "mask";
+}
+
+Datatype MaskIntrinsic::inferReturnType(const std::vector<Datatype>& argTypes) const {
+  taco_iassert(argTypes.size() == 2);
+  return argTypes[1];
+}
+
+ir::Expr MaskIntrinsic::lower(const std::vector<ir::Expr>& args) const {
+  taco_iassert(args.size() == 2);
+
+  // Only the sparsity structure of the mask matters, which the merge lattice
+  // has already taken into account.
+  return args[1];
+}
+
+std::vector<std::vector<size_t>>
+MaskIntrinsic::zeroPreservingArgs(const std::vector<IndexExpr>& args) const {
+  return {{0}, {1}};
+}
+
+// class MaskComplementIntrinsic
+
+std::string MaskComplementIntrinsic::getName() const {
+  return "mask_complement";
+}
+
+Datatype MaskComplementIntrinsic::inferReturnType(const std::vector<Datatype>& argTypes) const {
+  taco_iassert(argTypes.size() == 2);
+  return argTypes[1];
+}
+
+ir::Expr MaskComplementIntrinsic::lower(const std::vector<ir::Expr>& args) const {
+  taco_iassert(args.size() == 2);
+
+  // Coordinates stored in the mask are skipped by the lowerer, so wherever
+  // the mask is evaluated the expression passes through.
+  return args[1];
+}
+
+std::vector<std::vector<size_t>>
+MaskComplementIntrinsic::zeroPreservingArgs(const std::vector<IndexExpr>& args) const {
+  return {{1}};
+}
+
+// class OffDiagonalIntrinsic
+
+std::string OffDiagonalIntrinsic::getName() const {
+  return "off_diagonal";
+}
+
+Datatype OffDiagonalIntrinsic::inferReturnType(const std::vector<Datatype>& argTypes) const {
+  taco_iassert(argTypes.size() == 1);
+  return argTypes[0];
+}
+
+ir::Expr OffDiagonalIntrinsic::lower(const std::vector<ir::Expr>& args) const {
+  taco_iassert(args.size() == 1);
+
+  // The lowerer guards assignments that read the intrinsic so that they are
+  // skipped on the diagonal, where the value passes through.
+  return args[0];
+}
+
+std::vector<std::vector<size_t>>
+OffDiagonalIntrinsic::zeroPreservingArgs(const std::vector<IndexExpr>& args) const {
+  return {{0}};
+}
+
 }
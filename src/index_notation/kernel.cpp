@@ -5,6 +5,7 @@
 #include "taco/index_notation/index_notation.h"
 #include "taco/lower/lower.h"
 #include "taco/codegen/module.h"
+#include "taco/allocator.h"
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
@@ -19,6 +20,16 @@ namespace taco {
 
 struct Kernel::Content {
   shared_ptr<ir::Module> module;
+  shared_ptr<KernelAllocator> allocator;
+
+  /// Call a function of the module with the allocator of a
+  /// `ScopedKernelAllocator` of the calling thread, or with the allocator that
+  /// was installed when the kernel was made.
+  int call(void* function, void** args) const {
+    KernelAllocator* scoped = getScopedKernelAllocator();
+    return module->callFuncPtrRaw(function, args,
+                                  scoped ? scoped : allocator.get());
+  }
 };
 
 Kernel::Kernel() : content(nullptr) {
@@ -31,6 +42,7 @@ Kernel::Kernel() : content(nullptr) {
 Kernel::Kernel(IndexStmt stmt, shared_ptr<ir::Module> module, void* evaluate,
                void* assemble, void* compute) : content(new Content) {
   content->module = module;
+  content->allocator = getKernelAllocator();
   this->numResults = getResults(stmt).size();
   this->evaluateFunction = evaluate;
   this->assembleFunction = assemble;
@@ -82,24 +94,36 @@ void unpackResults(size_t numResults, const vector<void*> arguments,
 
 bool Kernel::operator()(const vector<TensorStorage>& args) const {
   vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("evaluate", arguments.data());
+  int result = content->call(evaluateFunction, arguments.data());
   unpackResults(this->numResults, arguments, args);
   return (result == 0);
 }
 
 bool Kernel::assemble(const vector<TensorStorage>& args) const {
   vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("assemble", arguments.data());
+  int result = content->call(assembleFunction, arguments.data());
   unpackResults(this->numResults, arguments, args);
   return (result == 0);
 }
 
 bool Kernel::compute(const vector<TensorStorage>& args) const {
   vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("compute", arguments.data());
+  int result = content->call(computeFunction, arguments.data());
   return (result == 0);
 }
 
+bool Kernel::evaluate(taco_tensor_t** args) const {
+  return content->call(evaluateFunction, (void**)args) == 0;
+}
+
+bool Kernel::assemble(taco_tensor_t** args) const {
+  return content->call(assembleFunction, (void**)args) == 0;
+}
+
+bool Kernel::compute(taco_tensor_t** args) const {
+  return content->call(computeFunction, (void**)args) == 0;
+}
+
 bool Kernel::defined() {
   return content != nullptr;
 }
@@ -115,15 +139,16 @@ Kernel compile(IndexStmt stmt) {
       << reason << endl << stmt;
 
   shared_ptr<ir::Module> module(new ir::Module);
-  IndexStmt parallelStmt = parallelizeOuterLoop(stmt);
+  IndexStmt parallelStmt = exploitSymmetry(parallelizeOuterLoop(stmt));
+  stmt = exploitSymmetry(stmt);
   module->addFunction(lower(parallelStmt, "compute",  false, true));
   module->addFunction(lower(stmt, "assemble", true, false));
   module->addFunction(lower(stmt, "evaluate", true, true));
   module->compile();
 
-  void* evaluate = module->getFuncPtr("evaluate");
-  void* assemble = module->getFuncPtr("assemble");
-  void* compute  = module->getFuncPtr("compute");
+  void* evaluate = module->getFuncPtr("_shim_evaluate");
+  void* assemble = module->getFuncPtr("_shim_assemble");
+  void* compute  = module->getFuncPtr("_shim_compute");
   return Kernel(stmt, module, evaluate, assemble, compute);
 }
 
@@ -30,6 +30,9 @@ void IndexVarRel::print(std::ostream& stream) const {
       case SPLIT:
         getNode<SplitRelNode>()->print(stream);
         break;
+      case DIVIDE:
+        getNode<DivideRelNode>()->print(stream);
+        break;
       case POS:
         getNode<PosRelNode>()->print(stream);
         break;
@@ -56,6 +59,8 @@ bool IndexVarRel::equals(const IndexVarRel &rel) const {
   switch(getRelType()) {
     case SPLIT:
       return getNode<SplitRelNode>()->equals(*rel.getNode<SplitRelNode>());
+    case DIVIDE:
+      return getNode<DivideRelNode>()->equals(*rel.getNode<DivideRelNode>());
     case POS:
       return getNode<PosRelNode>()->equals(*rel.getNode<PosRelNode>());
       break;
@@ -262,6 +267,138 @@ bool operator==(const SplitRelNode& a, const SplitRelNode& b) {
   return a.equals(b);
 }
 
+// DivideRelNode
+struct DivideRelNode::Content {
+  IndexVar parentVar;
+  IndexVar outerVar;
+  IndexVar innerVar;
+  size_t divideFactor;
+};
+
+DivideRelNode::DivideRelNode(IndexVar parentVar, IndexVar outerVar, IndexVar innerVar, size_t divideFactor)
+  : IndexVarRelNode(DIVIDE), content(new Content) {
+  content->parentVar = parentVar;
+  content->outerVar = outerVar;
+  content->innerVar = innerVar;
+  content->divideFactor = divideFactor;
+}
+
+const IndexVar& DivideRelNode::getParentVar() const {
+  return content->parentVar;
+}
+const IndexVar& DivideRelNode::getOuterVar() const {
+  return content->outerVar;
+}
+const IndexVar& DivideRelNode::getInnerVar() const {
+  return content->innerVar;
+}
+const size_t& DivideRelNode::getDivideFactor() const {
+  return content->divideFactor;
+}
+
+void DivideRelNode::print(std::ostream &stream) const {
+  stream << "divide(" << getParentVar() << ", " << getOuterVar() << ", " << getInnerVar() << ", " << getDivideFactor() << ")";
+}
+
+bool DivideRelNode::equals(const DivideRelNode &rel) const {
+  return getParentVar() == rel.getParentVar() && getOuterVar() == rel.getOuterVar()
+        && getInnerVar() == rel.getInnerVar() && getDivideFactor() == rel.getDivideFactor();
+}
+
+std::vector<IndexVar> DivideRelNode::getParents() const {
+  return {getParentVar()};
+}
+
+std::vector<IndexVar> DivideRelNode::getChildren() const {
+  return {getOuterVar(), getInnerVar()};
+}
+
+std::vector<IndexVar> DivideRelNode::getIrregulars() const {
+  // Classified like the outer variable of split so that the inner variable
+  // remains the one that directly iterates over positions
+  return {getOuterVar()};
+}
+
+ir::Expr DivideRelNode::getStripSize(std::vector<ir::Expr> parentBound) const {
+  Datatype divideFactorType = parentBound[0].type();
+  ir::Expr extent = ir::Sub::make(parentBound[1], parentBound[0]);
+  return ir::Div::make(ir::Add::make(extent, ir::Literal::make(getDivideFactor()-1, divideFactorType)),
+                       ir::Literal::make(getDivideFactor(), divideFactorType));
+}
+
+std::vector<ir::Expr> DivideRelNode::computeRelativeBound(std::set<IndexVar> definedVars, std::map<IndexVar, std::vector<ir::Expr>> computedBounds, std::map<IndexVar, ir::Expr> variableExprs, Iterators iterators, ProvenanceGraph provGraph) const {
+  taco_iassert(computedBounds.count(getParentVar()) == 1);
+  std::vector<ir::Expr> parentBound = computedBounds.at(getParentVar());
+  bool outerVarDefined = definedVars.count(getOuterVar());
+  bool innerVarDefined = definedVars.count(getInnerVar());
+
+  if (provGraph.isPosVariable(getParentVar()) || !outerVarDefined) {
+    return parentBound; // dividing pos space does not change coordinate bounds
+  }
+
+  ir::Expr stripSize = getStripSize(parentBound);
+  ir::Expr minBound = ir::Add::make(parentBound[0], ir::Mul::make(variableExprs[getOuterVar()], stripSize));
+  if (!innerVarDefined) {
+    // outerVar constrains space to a stripSize strip starting at outerVar * stripSize
+    ir::Expr maxBound = ir::Min::make(parentBound[1], ir::Add::make(minBound, stripSize));
+    return {minBound, maxBound};
+  }
+  // outerVar and innerVar constrain space to a length 1 strip starting at outerVar * stripSize + innerVar
+  minBound = ir::Add::make(minBound, variableExprs[getInnerVar()]);
+  ir::Expr maxBound = ir::Min::make(parentBound[1], ir::Add::make(minBound, ir::Literal::make(1, variableExprs[getParentVar()].type())));
+  return {minBound, maxBound};
+}
+
+std::vector<ir::Expr> DivideRelNode::deriveIterBounds(taco::IndexVar indexVar,
+                                                      std::map<IndexVar, std::vector<ir::Expr>> parentIterBounds,
+                                                      std::map<IndexVar, std::vector<ir::Expr>> parentCoordBounds,
+                                                      std::map<taco::IndexVar, taco::ir::Expr> variableNames,
+                                                      Iterators iterators, ProvenanceGraph provGraph) const {
+  taco_iassert(indexVar == getOuterVar() || indexVar == getInnerVar());
+  taco_iassert(parentIterBounds.size() == 1);
+  taco_iassert(parentIterBounds.count(getParentVar()) == 1);
+
+  std::vector<ir::Expr> parentBound = parentIterBounds.at(getParentVar());
+  Datatype divideFactorType = parentBound[0].type();
+  if (indexVar == getOuterVar()) {
+    return {ir::Literal::zero(divideFactorType), ir::Literal::make(getDivideFactor(), divideFactorType)};
+  }
+  else if (indexVar == getInnerVar()) {
+    return {ir::Literal::zero(divideFactorType), getStripSize(parentBound)};
+  }
+  taco_ierror;
+  return {};
+}
+
+ir::Expr DivideRelNode::recoverVariable(taco::IndexVar indexVar,
+                                        std::map<taco::IndexVar, taco::ir::Expr> variableNames,
+                                        Iterators iterators, std::map<IndexVar, std::vector<ir::Expr>> parentIterBounds, std::map<IndexVar, std::vector<ir::Expr>> parentCoordBounds, ProvenanceGraph provGraph) const {
+  taco_iassert(indexVar == getParentVar());
+  taco_iassert(variableNames.count(getParentVar()) && variableNames.count(getOuterVar()) && variableNames.count(getInnerVar()));
+  taco_iassert(parentIterBounds.count(getParentVar()));
+  std::vector<ir::Expr> parentBound = parentIterBounds.at(getParentVar());
+  ir::Expr stripStart = ir::Add::make(parentBound[0], ir::Mul::make(variableNames[getOuterVar()], getStripSize(parentBound)));
+  return ir::Add::make(stripStart, variableNames[getInnerVar()]);
+}
+
+ir::Stmt DivideRelNode::recoverChild(taco::IndexVar indexVar,
+                                     std::map<taco::IndexVar, taco::ir::Expr> variableNames, bool emitVarDecl, Iterators iterators, ProvenanceGraph provGraph) const {
+  // Unlike split, the size of the strips depends on the bounds of the parent,
+  // which are not known where children are recovered
+  taco_uerror << "Schedules that iterate over " << getParentVar()
+              << " and recover " << indexVar << " from it are not supported, "
+              << "since the strips of divide(" << getParentVar() << ", "
+              << getOuterVar() << ", " << getInnerVar() << ", "
+              << getDivideFactor() << ") depend on the bounds of "
+              << getParentVar() << ". Iterate over " << getOuterVar()
+              << " and " << getInnerVar() << " instead.";
+  return ir::Stmt();
+}
+
+bool operator==(const DivideRelNode& a, const DivideRelNode& b) {
+  return a.equals(b);
+}
+
 struct PosRelNode::Content {
   Content(IndexVar parentVar, IndexVar posVar, Access access) : parentVar(parentVar), posVar(posVar), access(access) {}
   IndexVar parentVar;
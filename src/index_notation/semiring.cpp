@@ -0,0 +1,229 @@
+#include "taco/index_notation/semiring.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "taco/index_notation/index_notation_nodes.h"
+#include "taco/index_notation/index_notation_rewriter.h"
+#include "taco/error.h"
+
+namespace taco {
+
+// class Semiring
+
+IndexExpr Semiring::annihilator(Datatype type) const {
+  return addIdentity(type);
+}
+
+bool Semiring::identityAnnihilates(Datatype type) const {
+  IndexExpr annihilatorValue = annihilator(type);
+  return annihilatorValue.defined() &&
+         equals(annihilatorValue, addIdentity(type));
+}
+
+// class PlusTimesSemiring
+
+std::string PlusTimesSemiring::getName() const {
+  return "plus_times";
+}
+
+ir::Expr PlusTimesSemiring::add(ir::Expr a, ir::Expr b) const {
+  return ir::Add::make(a, b);
+}
+
+ir::Expr PlusTimesSemiring::multiply(ir::Expr a, ir::Expr b) const {
+  return ir::Mul::make(a, b);
+}
+
+IndexExpr PlusTimesSemiring::addIdentity(Datatype type) const {
+  return Literal::zero(type);
+}
+
+// class MinPlusSemiring
+
+std::string MinPlusSemiring::getName() const {
+  return "min_plus";
+}
+
+ir::Expr MinPlusSemiring::add(ir::Expr a, ir::Expr b) const {
+  return ir::Min::make(a, b);
+}
+
+ir::Expr MinPlusSemiring::multiply(ir::Expr a, ir::Expr b) const {
+  return ir::Add::make(a, b);
+}
+
+IndexExpr MinPlusSemiring::addIdentity(Datatype type) const {
+  switch (type.getKind()) {
+    case Datatype::Float32:
+      return Literal(std::numeric_limits<float>::infinity());
+    case Datatype::Float64:
+      return Literal(std::numeric_limits<double>::infinity());
+    default:
+      taco_uerror << "The " << getName() << " semiring requires a "
+                  << "floating-point type, but got " << type;
+  }
+  return IndexExpr();
+}
+
+// class MaxTimesSemiring
+
+std::string MaxTimesSemiring::getName() const {
+  return "max_times";
+}
+
+ir::Expr MaxTimesSemiring::add(ir::Expr a, ir::Expr b) const {
+  return ir::Max::make(a, b);
+}
+
+ir::Expr MaxTimesSemiring::multiply(ir::Expr a, ir::Expr b) const {
+  return ir::Mul::make(a, b);
+}
+
+IndexExpr MaxTimesSemiring::addIdentity(Datatype type) const {
+  return Literal::zero(type);
+}
+
+// class OrAndSemiring
+
+std::string OrAndSemiring::getName() const {
+  return "or_and";
+}
+
+ir::Expr OrAndSemiring::add(ir::Expr a, ir::Expr b) const {
+  ir::Expr result = ir::Or::make(a, b);
+  return a.type().isBool() ? result : ir::Cast::make(result, a.type());
+}
+
+ir::Expr OrAndSemiring::multiply(ir::Expr a, ir::Expr b) const {
+  ir::Expr result = ir::And::make(a, b);
+  return a.type().isBool() ? result : ir::Cast::make(result, a.type());
+}
+
+IndexExpr OrAndSemiring::addIdentity(Datatype type) const {
+  return Literal::zero(type);
+}
+
+// class SemiringIntrinsic
+
+SemiringIntrinsic::SemiringIntrinsic(std::shared_ptr<Semiring> semiring,
+                                     Operation operation)
+    : semiring(semiring), operation(operation) {
+  taco_uassert(semiring != nullptr) << "Semiring operations need a semiring";
+}
+
+std::string SemiringIntrinsic::getName() const {
+  return semiring->getName() +
+         ((operation == Addition) ? "_add" : "_mul");
+}
+
+Datatype
+SemiringIntrinsic::inferReturnType(const std::vector<Datatype>& argTypes) const {
+  // Reduction operators are calls without arguments
+  if (argTypes.empty()) {
+    return Datatype();
+  }
+  taco_iassert(argTypes.size() == 2);
+  taco_uassert(argTypes[0] == argTypes[1])
+      << "Operands of " << getName() << " must have the same type";
+  return argTypes[0];
+}
+
+ir::Expr SemiringIntrinsic::lower(const std::vector<ir::Expr>& args) const {
+  taco_iassert(args.size() == 2);
+  return (operation == Addition) ? semiring->add(args[0], args[1])
+                                 : semiring->multiply(args[0], args[1]);
+}
+
+std::vector<std::vector<size_t>>
+SemiringIntrinsic::zeroPreservingArgs(const std::vector<IndexExpr>& args) const {
+  taco_iassert(args.size() == 2);
+
+  // Unstored components equal the additive identity.  A sum is the identity
+  // only where both operands are, while a product is the identity wherever
+  // either operand is, provided the identity annihilates multiplication.
+  if (operation == Addition) {
+    return {{0, 1}};
+  }
+  if (semiring->identityAnnihilates(args[0].getDataType())) {
+    return {{0}, {1}};
+  }
+  return {};
+}
+
+const std::shared_ptr<Semiring>& SemiringIntrinsic::getSemiring() const {
+  return semiring;
+}
+
+SemiringIntrinsic::Operation SemiringIntrinsic::getOperation() const {
+  return operation;
+}
+
+const SemiringIntrinsic* getSemiringIntrinsic(IndexExpr expr) {
+  if (!isa<CallIntrinsicNode>(expr.ptr)) {
+    return nullptr;
+  }
+  const CallIntrinsicNode* call = to<CallIntrinsicNode>(expr.ptr);
+  return dynamic_cast<const SemiringIntrinsic*>(call->func.get());
+}
+
+IndexExpr semiringAdd(std::shared_ptr<Semiring> semiring,
+                      IndexExpr a, IndexExpr b) {
+  return CallIntrinsic(std::make_shared<SemiringIntrinsic>(
+                           semiring, SemiringIntrinsic::Addition), {a, b});
+}
+
+IndexExpr semiringMul(std::shared_ptr<Semiring> semiring,
+                      IndexExpr a, IndexExpr b) {
+  return CallIntrinsic(std::make_shared<SemiringIntrinsic>(
+                           semiring, SemiringIntrinsic::Multiplication), {a, b});
+}
+
+Reduction reduce(IndexVar i, std::shared_ptr<Semiring> semiring,
+                 IndexExpr expr) {
+  IndexExpr op = CallIntrinsic(std::make_shared<SemiringIntrinsic>(
+                                   semiring, SemiringIntrinsic::Addition), {});
+  return Reduction(op, i, expr);
+}
+
+IndexExpr overSemiring(std::shared_ptr<Semiring> semiring, IndexExpr expr) {
+  struct OverSemiring : public IndexNotationRewriter {
+    using IndexNotationRewriter::visit;
+
+    std::shared_ptr<Semiring> semiring;
+    OverSemiring(std::shared_ptr<Semiring> semiring) : semiring(semiring) {}
+
+    void visit(const AddNode* op) {
+      expr = semiringAdd(semiring, rewrite(op->a), rewrite(op->b));
+    }
+
+    void visit(const MulNode* op) {
+      expr = semiringMul(semiring, rewrite(op->a), rewrite(op->b));
+    }
+
+    void visit(const SubNode* op) {
+      taco_uerror << "Subtraction has no meaning in the "
+                  << semiring->getName() << " semiring";
+    }
+
+    void visit(const DivNode* op) {
+      taco_uerror << "Division has no meaning in the "
+                  << semiring->getName() << " semiring";
+    }
+
+    void visit(const NegNode* op) {
+      taco_uerror << "Negation has no meaning in the "
+                  << semiring->getName() << " semiring";
+    }
+
+    void visit(const ReductionNode* op) {
+      taco_uassert(isa<AddNode>(op->op.ptr))
+          << "Only sum reductions can be reinterpreted in a semiring";
+      expr = reduce(op->var, semiring, rewrite(op->a));
+    }
+  };
+  return OverSemiring(semiring).rewrite(expr);
+}
+
+}
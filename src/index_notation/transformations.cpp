@@ -3,6 +3,7 @@
 #include "taco/index_notation/index_notation.h"
 #include "taco/index_notation/index_notation_rewriter.h"
 #include "taco/index_notation/index_notation_nodes.h"
+#include "taco/index_notation/intrinsic.h"
 #include "taco/error/error_messages.h"
 #include "taco/util/collections.h"
 #include "taco/lower/iterator.h"
@@ -441,6 +442,55 @@ struct ReplaceReductionExpr : public IndexNotationRewriter {
 IndexStmt scalarPromote(IndexStmt stmt, ProvenanceGraph provGraph, 
                         bool isWholeStmt, bool promoteScalar);
 
+/// Rewrites a reduction over a fused position space, whose result is indexed
+/// only by the fused row coordinates, to accumulate into a scalar that is
+/// written out whenever a row ends.  Each parallel partition then only has to
+/// write the row it starts in and the partial row it ends in (the carry-out)
+/// with atomics, regardless of how many rows or nonzeros the partition spans.
+static IndexStmt carryOutFusedPositionReduction(IndexStmt stmt,
+                                                ProvenanceGraph provGraph) {
+  if (!isa<Forall>(stmt)) {
+    return stmt;
+  }
+  Forall posForall = to<Forall>(stmt);
+  IndexVar posVar = posForall.getIndexVar();
+
+  vector<IndexVar> underivedAncestors = provGraph.getUnderivedAncestors(posVar);
+  IndexVar posDescendant;
+  if (underivedAncestors.size() < 2 || !provGraph.isPosVariable(posVar) ||
+      !provGraph.getPosIteratorFullyDerivedDescendant(underivedAncestors[0],
+                                                      &posDescendant) ||
+      posDescendant != posVar || !isa<Assignment>(posForall.getStmt())) {
+    return stmt;
+  }
+
+  Assignment assignment = to<Assignment>(posForall.getStmt());
+  Access result = assignment.getLhs();
+  if (!isa<taco::Add>(assignment.getOperator()) ||
+      result.getIndexVars().empty()) {
+    return stmt;
+  }
+  vector<IndexVar> rowVars(underivedAncestors.begin(),
+                           underivedAncestors.end() - 1);
+  for (const IndexVar& var : result.getIndexVars()) {
+    if (!util::contains(rowVars, var)) {
+      return stmt;
+    }
+  }
+
+  TensorVar resultVar = result.getTensorVar();
+  TensorVar carry("t" + posVar.getName() + resultVar.getName(),
+                  Type(resultVar.getType().getDataType(), {}));
+  IndexStmt producer = forall(posVar, Assignment(carry(), assignment.getRhs(),
+                                                 assignment.getOperator()),
+                              posForall.getParallelUnit(),
+                              posForall.getOutputRaceStrategy(),
+                              posForall.getUnrollFactor(),
+                              posForall.getCoIterationStrategy());
+  IndexStmt consumer = Assignment(result, carry(), assignment.getOperator());
+  return where(consumer, producer);
+}
+
 // class Parallelize
 struct Parallelize::Content {
   IndexVar i;
@@ -563,7 +613,7 @@ IndexStmt Parallelize::apply(IndexStmt stmt, std::string* reason) const {
           );
           taco_iassert(!precomputeAssignments.empty());
 
-          IndexStmt precomputed_stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor());
+          IndexStmt precomputed_stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor(), foralli.getCoIterationStrategy());
           for (auto assignment : precomputeAssignments) {
             // Construct temporary of correct type and size of outer loop
             TensorVar w(string("w_") + ParallelUnit_NAMES[(int) parallelize.getParallelUnit()], Type(assignment->lhs.getDataType(), {Dimension(i)}), taco::dense);
@@ -572,7 +622,7 @@ IndexStmt Parallelize::apply(IndexStmt stmt, std::string* reason) const {
             IndexStmt producer = ReplaceReductionExpr(map<Access, Access>({{assignment->lhs, w(i)}})).rewrite(precomputed_stmt);
             taco_iassert(isa<Forall>(producer));
             Forall producer_forall = to<Forall>(producer);
-            producer = forall(producer_forall.getIndexVar(), producer_forall.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor());
+            producer = forall(producer_forall.getIndexVar(), producer_forall.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor(), foralli.getCoIterationStrategy());
 
             // build consumer that writes from temporary to output, mark consumer as parallel reduction
             ParallelUnit reductionUnit = ParallelUnit::CPUThreadGroupReduction;
@@ -594,16 +644,20 @@ IndexStmt Parallelize::apply(IndexStmt stmt, std::string* reason) const {
         if (parallelize.getOutputRaceStrategy() == OutputRaceStrategy::Atomics) {
           // want to avoid extra atomics by accumulating variable and then 
           // reducing at end
-          IndexStmt body = scalarPromote(foralli.getStmt(), provGraph, 
-                                         false, true);
+          IndexStmt body = carryOutFusedPositionReduction(foralli.getStmt(),
+                                                          provGraph);
+          if (body == foralli.getStmt()) {
+            body = scalarPromote(body, provGraph, false, true);
+          }
           stmt = forall(i, body, parallelize.getParallelUnit(), 
                         parallelize.getOutputRaceStrategy(), 
-                        foralli.getUnrollFactor());
+                        foralli.getUnrollFactor(),
+                        foralli.getCoIterationStrategy());
           return;
         }
 
 
-        stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor());
+        stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor(), foralli.getCoIterationStrategy());
         return;
       }
 
@@ -783,6 +837,7 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
     IndexStmt innerBody;
     map <IndexVar, ParallelUnit> forallParallelUnit;
     map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy;
+    map <IndexVar, CoIterationStrategy> forallCoIterationStrategy;
     vector<IndexVar> indexVarOriginalOrder;
     Iterators iterators;
 
@@ -796,6 +851,7 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
       indexVarOriginalOrder.push_back(i);
       forallParallelUnit[i] = foralli.getParallelUnit();
       forallOutputRaceStrategy[i] = foralli.getOutputRaceStrategy();
+      forallCoIterationStrategy[i] = foralli.getCoIterationStrategy();
 
       // Iterator and if Iterator enforces constraints
       vector<pair<Iterator, bool>> depIterators;
@@ -878,12 +934,15 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
     IndexStmt innerBody;
     const map <IndexVar, ParallelUnit> forallParallelUnit;
     const map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy;
+    const map <IndexVar, CoIterationStrategy> forallCoIterationStrategy;
 
     TopoReorderRewriter(const vector<IndexVar>& sortedVars, IndexStmt innerBody,
                         const map <IndexVar, ParallelUnit> forallParallelUnit,
-                        const map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy)
+                        const map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy,
+                        const map <IndexVar, CoIterationStrategy> forallCoIterationStrategy)
         : sortedVars(sortedVars), innerBody(innerBody),
-        forallParallelUnit(forallParallelUnit), forallOutputRaceStrategy(forallOutputRaceStrategy)  {
+        forallParallelUnit(forallParallelUnit), forallOutputRaceStrategy(forallOutputRaceStrategy),
+        forallCoIterationStrategy(forallCoIterationStrategy)  {
     }
 
     void visit(const ForallNode* node) {
@@ -894,14 +953,16 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
       taco_iassert(util::contains(sortedVars, i));
       stmt = innerBody;
       for (auto it = sortedVars.rbegin(); it != sortedVars.rend(); ++it) {
-        stmt = forall(*it, stmt, forallParallelUnit.at(*it), forallOutputRaceStrategy.at(*it), foralli.getUnrollFactor());
+        stmt = forall(*it, stmt, forallParallelUnit.at(*it), forallOutputRaceStrategy.at(*it), foralli.getUnrollFactor(),
+                      forallCoIterationStrategy.at(*it));
       }
       return;
     }
 
   };
   TopoReorderRewriter rewriter(sortedVars, dagBuilder.innerBody, 
-                               dagBuilder.forallParallelUnit, dagBuilder.forallOutputRaceStrategy);
+                               dagBuilder.forallParallelUnit, dagBuilder.forallOutputRaceStrategy,
+                               dagBuilder.forallCoIterationStrategy);
   return rewriter.rewrite(stmt);
 }
 
@@ -943,10 +1004,19 @@ IndexStmt scalarPromote(IndexStmt stmt, ProvenanceGraph provGraph,
 
       std::vector<Access> resultAccesses;
       std::tie(resultAccesses, std::ignore) = getResultAccesses(foralli);
+      std::map<TensorVar,int> numResultAccesses;
+      for (const auto& resultAccess : resultAccesses) {
+        numResultAccesses[resultAccess.getTensorVar()]++;
+      }
       for (const auto& resultAccess : resultAccesses) {
         if (!promoteScalar && resultAccess.getIndexVars().empty()) {
           continue;
         }
+        // Results that are written through several accesses, such as the
+        // mirrored assignments of symmetric matrices, cannot be hoisted
+        if (numResultAccesses.at(resultAccess.getTensorVar()) > 1) {
+          continue;
+        }
 
         std::set<IndexVar> resultIndices(resultAccess.getIndexVars().begin(),
                                          resultAccess.getIndexVars().end());
@@ -1034,7 +1104,8 @@ IndexStmt scalarPromote(IndexStmt stmt, ProvenanceGraph provGraph,
       }
 
       stmt = forall(i, body, foralli.getParallelUnit(),
-                    foralli.getOutputRaceStrategy(), foralli.getUnrollFactor());
+                    foralli.getOutputRaceStrategy(), foralli.getUnrollFactor(),
+                    foralli.getCoIterationStrategy());
       for (const auto& consumer : consumers) {
         stmt = where(consumer, stmt);
       }
@@ -1166,4 +1237,140 @@ IndexStmt insertTemporaries(IndexStmt stmt)
   return stmt;
 }
 
+static bool isProduct(IndexExpr expr) {
+  if (isa<Access>(expr) || isa<Literal>(expr)) {
+    return true;
+  }
+  if (isa<Neg>(expr)) {
+    return isProduct(to<Neg>(expr).getA());
+  }
+  if (isa<Mul>(expr)) {
+    return isProduct(to<Mul>(expr).getA()) && isProduct(to<Mul>(expr).getB());
+  }
+  return false;
+}
+
+IndexStmt exploitSymmetry(IndexStmt stmt) {
+  bool exploited = false;
+  match(stmt,
+    function<void(const CallIntrinsicNode*)>([&](const CallIntrinsicNode* op) {
+      exploited |= (dynamic_cast<const OffDiagonalIntrinsic*>(op->func.get())
+                    != nullptr);
+    })
+  );
+  if (exploited) {
+    return stmt;
+  }
+
+  struct ExploitSymmetry : public IndexNotationRewriter {
+    using IndexNotationRewriter::visit;
+
+    int whereDepth = 0;
+
+    void visit(const ForallNode* node) {
+      IndexStmt body = rewrite(node->stmt);
+      if (body == node->stmt) {
+        stmt = node;
+        return;
+      }
+      // The mirrored components are scattered across the iterations of the
+      // loop, so parallel loops must update their results atomically.
+      OutputRaceStrategy outputRaceStrategy =
+          (node->parallel_unit == ParallelUnit::NotParallel)
+          ? node->output_race_strategy : OutputRaceStrategy::Atomics;
+      stmt = Forall(node->indexVar, body, node->parallel_unit,
+                    outputRaceStrategy, node->unrollFactor,
+                    node->coiteration_strategy);
+    }
+
+    void visit(const WhereNode* node) {
+      whereDepth++;
+      IndexNotationRewriter::visit(node);
+      whereDepth--;
+    }
+
+    void visit(const AssignmentNode* node) {
+      Assignment assignment(node);
+      vector<Access> symmetricAccesses;
+      match(assignment.getRhs(),
+        function<void(const AccessNode*)>([&](const AccessNode* op) {
+          if (op->tensorVar.getFormat().isSymmetric()) {
+            symmetricAccesses.push_back(Access(op));
+          }
+        })
+      );
+      if (symmetricAccesses.empty()) {
+        stmt = node;
+        return;
+      }
+
+      Access access = symmetricAccesses[0];
+      IndexVar i = access.getIndexVars()[0];
+      IndexVar j = access.getIndexVars()[1];
+      if (symmetricAccesses.size() == 1 && i == j) {
+        // The diagonal of a symmetric matrix is stored in full
+        stmt = node;
+        return;
+      }
+
+      TensorVar result = assignment.getLhs().getTensorVar();
+      taco_uassert(!result.getFormat().isSymmetric())
+          << "Symmetric results are not supported: " << assignment;
+      taco_uassert(symmetricAccesses.size() == 1)
+          << "Expressions may read at most one symmetric matrix: "
+          << assignment;
+      taco_uassert(whereDepth == 0)
+          << "Symmetric matrices cannot be read by temporaries: "
+          << assignment;
+      taco_uassert(isProduct(assignment.getRhs()))
+          << "Symmetric matrices can only be read by products: " << assignment;
+      taco_uassert(result.getOrder() == 0 || isDense(result.getFormat()))
+          << "Results of expressions that read symmetric matrices must be "
+          << "dense: " << assignment;
+      // The mirrored components read the other operands with the two index
+      // variables swapped, which sparse operands indexed by both cannot be
+      // iterated in.
+      match(assignment.getRhs(),
+        function<void(const AccessNode*)>([&](const AccessNode* op) {
+          const vector<IndexVar>& indexVars = op->indexVars;
+          taco_uassert(op->tensorVar == access.getTensorVar() ||
+                       isDense(op->tensorVar.getFormat()) ||
+                       !util::contains(indexVars, i) ||
+                       !util::contains(indexVars, j))
+              << "Symmetric matrices cannot be multiplied by sparse operands "
+              << "that are indexed by both of their index variables: "
+              << assignment;
+        })
+      );
+
+      // Add the component mirrored across the diagonal for each stored
+      // component that is not on it, which is what the stored component
+      // contributes with its coordinates swapped.
+      map<IndexVar,IndexVar> swap = {{i, j}, {j, i}};
+      Access lhs = assignment.getLhs();
+      vector<IndexVar> mirrorVars;
+      for (auto& indexVar : lhs.getIndexVars()) {
+        mirrorVars.push_back(util::contains(swap, indexVar) ? swap.at(indexVar)
+                                                            : indexVar);
+      }
+      Access mirrorLhs(result, mirrorVars);
+      IndexExpr mirrorRhs = replace(assignment.getRhs(), swap);
+      const AccessNode* mirrorAccess = nullptr;
+      match(mirrorRhs,
+        function<void(const AccessNode*)>([&](const AccessNode* op) {
+          if (op->tensorVar == access.getTensorVar()) {
+            mirrorAccess = op;
+          }
+        })
+      );
+      taco_iassert(mirrorAccess != nullptr);
+      mirrorRhs = replace(mirrorRhs, {{Access(mirrorAccess),
+                                       offDiagonal(access)}});
+      stmt = multi(assignment, Assignment(mirrorLhs, mirrorRhs,
+                                          assignment.getOperator()));
+    }
+  };
+  return ExploitSymmetry().rewrite(stmt);
+}
+
 }
@@ -410,6 +410,22 @@ Expr BitOr::make(Expr a, Expr b) {
   return bitOr;
 }
 
+Expr Shl::make(Expr a, Expr b) {
+  Shl *shl = new Shl;
+  shl->type = a.type();
+  shl->a = a;
+  shl->b = b;
+  return shl;
+}
+
+Expr Shr::make(Expr a, Expr b) {
+  Shr *shr = new Shr;
+  shr->type = a.type();
+  shr->a = a;
+  shr->b = b;
+  return shr;
+}
+
 // Boolean binary ops
 Expr Eq::make(Expr a, Expr b) {
   Eq *eq = new Eq;
@@ -902,6 +918,10 @@ template<> void ExprNode<BitAnd>::accept(IRVisitorStrict *v)
     const { v->visit((const BitAnd*)this); }
 template<> void ExprNode<BitOr>::accept(IRVisitorStrict *v)
     const { v->visit((const BitOr*)this); }
+template<> void ExprNode<Shl>::accept(IRVisitorStrict *v)
+    const { v->visit((const Shl*)this); }
+template<> void ExprNode<Shr>::accept(IRVisitorStrict *v)
+    const { v->visit((const Shr*)this); }
 template<> void ExprNode<Eq>::accept(IRVisitorStrict *v)
     const { v->visit((const Eq*)this); }
 template<> void ExprNode<Neq>::accept(IRVisitorStrict *v)
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <sstream>
 #include <iostream>
 
@@ -94,10 +95,18 @@ void IRPrinter::visit(const Literal* op) {
       taco_not_supported_yet;
     break;
     case Datatype::Float32:
+      if (std::isinf(op->getValue<float>())) {
+        stream << ((op->getValue<float>() > 0) ? "INFINITY" : "-INFINITY");
+        break;
+      }
       stream << ((op->getValue<float>() != 0.0)
                  ? util::toString(op->getValue<float>()) : "0.0");
     break;
     case Datatype::Float64:
+      if (std::isinf(op->getValue<double>())) {
+        stream << ((op->getValue<double>() > 0) ? "INFINITY" : "-INFINITY");
+        break;
+      }
       stream << ((op->getValue<double>()!=0.0)
                  ? util::toString(op->getValue<double>()) : "0.0");
     break;
@@ -122,8 +131,9 @@ void IRPrinter::visit(const Literal* op) {
 }
 
 void IRPrinter::visit(const Var* op) {
-  if (varNames.contains(op)) {
-    stream << varNames.get(op);
+  const Expr var = op;
+  if (varNames.contains(var)) {
+    stream << varNames.get(var);
   }
   else {
     stream << op->name;
@@ -195,6 +205,14 @@ void IRPrinter::visit(const BitOr* op){
   printBinOp(op->a, op->b, "|", Precedence::BOR);
 }
 
+void IRPrinter::visit(const Shl* op){
+  printBinOp(op->a, op->b, "<<", Precedence::SHL);
+}
+
+void IRPrinter::visit(const Shr* op){
+  printBinOp(op->a, op->b, ">>", Precedence::SHR);
+}
+
 void IRPrinter::visit(const Eq* op){
   printBinOp(op->a, op->b, "==", Precedence::EQ);
 }
@@ -250,7 +268,7 @@ void IRPrinter::visit(const IfThenElse* op) {
   op->cond.accept(this);
   stream << ")";
 
-  Stmt scopedStmt = Stmt(to<Scope>(op->then)->scopedStmt);
+  const Stmt& scopedStmt = to<Scope>(op->then)->scopedStmt;
   if (isa<Block>(scopedStmt)) {
     stream << " {" << endl;
     op->then.accept(this);
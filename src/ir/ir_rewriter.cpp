@@ -142,6 +142,14 @@ void IRRewriter::visit(const BitOr* op) {
   expr = visitBinaryOp(op, this);
 }
 
+void IRRewriter::visit(const Shl* op) {
+  expr = visitBinaryOp(op, this);
+}
+
+void IRRewriter::visit(const Shr* op) {
+  expr = visitBinaryOp(op, this);
+}
+
 void IRRewriter::visit(const Eq* op) {
   expr = visitBinaryOp(op, this);
 }
@@ -43,6 +43,70 @@ std::shared_ptr<LowererImpl> Lowerer::getLowererImpl() {
   return impl;
 }
 
+static WorkspaceGuard workspaceGuard = WorkspaceGuard::BitPacked;
+
+void setWorkspaceGuard(WorkspaceGuard guard) {
+  workspaceGuard = guard;
+}
+
+WorkspaceGuard getWorkspaceGuard() {
+  return workspaceGuard;
+}
+
+static WorkspaceKind workspaceKind = WorkspaceKind::Auto;
+
+void setWorkspaceKind(WorkspaceKind kind) {
+  workspaceKind = kind;
+}
+
+WorkspaceKind getWorkspaceKind() {
+  return workspaceKind;
+}
+
+static WorkspaceOrdering workspaceOrdering = WorkspaceOrdering::Adaptive;
+
+void setWorkspaceOrdering(WorkspaceOrdering ordering) {
+  workspaceOrdering = ordering;
+}
+
+WorkspaceOrdering getWorkspaceOrdering() {
+  return workspaceOrdering;
+}
+
+static WorkspaceLifetime workspaceLifetime = WorkspaceLifetime::Call;
+
+void setWorkspaceLifetime(WorkspaceLifetime lifetime) {
+  workspaceLifetime = lifetime;
+}
+
+WorkspaceLifetime getWorkspaceLifetime() {
+  return workspaceLifetime;
+}
+
+static OutputCapacity outputCapacity = OutputCapacity::Hinted;
+
+void setOutputCapacity(OutputCapacity capacity) {
+  outputCapacity = capacity;
+}
+
+OutputCapacity getOutputCapacity() {
+  return outputCapacity;
+}
+
+bool operator==(const LoweringOptions& a, const LoweringOptions& b) {
+  return a.guard == b.guard && a.kind == b.kind && a.ordering == b.ordering &&
+         a.lifetime == b.lifetime && a.capacity == b.capacity;
+}
+
+bool operator!=(const LoweringOptions& a, const LoweringOptions& b) {
+  return !(a == b);
+}
+
+LoweringOptions getLoweringOptions() {
+  return {workspaceGuard, workspaceKind, workspaceOrdering, workspaceLifetime,
+          outputCapacity};
+}
+
 ir::Stmt lower(IndexStmt stmt, std::string name, 
                bool assemble, bool compute, bool pack, bool unpack,
                Lowerer lowerer) {
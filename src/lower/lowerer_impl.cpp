@@ -1,18 +1,24 @@
 #include <taco/lower/mode_format_compressed.h>
 #include "taco/lower/lowerer_impl.h"
+#include "taco/lower/lower.h"
 
 #include "taco/index_notation/index_notation.h"
 #include "taco/index_notation/index_notation_nodes.h"
 #include "taco/index_notation/index_notation_visitor.h"
+#include "taco/index_notation/index_notation_rewriter.h"
+#include "taco/index_notation/semiring.h"
 #include "taco/ir/ir.h"
 #include "ir/ir_generators.h"
 #include "taco/ir/ir_visitor.h"
+#include "taco/ir/ir_rewriter.h"
 #include "taco/ir/simplify.h"
 #include "taco/lower/iterator.h"
 #include "taco/lower/merge_lattice.h"
 #include "mode_access.h"
 #include "taco/util/collections.h"
 
+#include <atomic>
+
 using namespace std;
 using namespace taco::ir;
 using taco::util::combine;
@@ -135,6 +141,19 @@ LowererImpl::lower(IndexStmt stmt, string name,
     tensorVars.insert({temp, irVar});
   }
 
+  // Record the identities that semiring reductions start from
+  match(stmt,
+    function<void(const AssignmentNode*)>([&](const AssignmentNode* op) {
+      const SemiringIntrinsic* semiringOp = getSemiringIntrinsic(op->op);
+      if (semiringOp) {
+        TensorVar result = op->lhs.getTensorVar();
+        Datatype type = result.getType().getDataType();
+        reductionIdentities.insert(
+            {result, lower(semiringOp->getSemiring()->addIdentity(type))});
+      }
+    })
+  );
+
   // Create variables for keeping track of result values array capacity
   createCapacityVars(resultVars, &capacityVars);
 
@@ -280,6 +299,29 @@ LowererImpl::lower(IndexStmt stmt, string name,
 
 Stmt LowererImpl::lowerAssignment(Assignment assignment)
 {
+  // Assignments that read a matrix through offDiagonal are skipped where the
+  // coordinates of the access are equal.
+  CallIntrinsic offDiagonal;
+  match(assignment.getRhs(),
+    function<void(const CallIntrinsicNode*)>([&](const CallIntrinsicNode* op) {
+      if (dynamic_cast<const OffDiagonalIntrinsic*>(op->func.get())) {
+        offDiagonal = op;
+      }
+    })
+  );
+  if (offDiagonal.defined()) {
+    Access access = to<Access>(offDiagonal.getArgs()[0]);
+    const auto& indexVars = access.getIndexVars();
+    taco_iassert(util::contains(indexVarToExprMap, indexVars[0]) &&
+                 util::contains(indexVarToExprMap, indexVars[1]));
+    Expr isOffDiagonal = ir::Neq::make(indexVarToExprMap.at(indexVars[0]),
+                                       indexVarToExprMap.at(indexVars[1]));
+    IndexExpr rhs = replace(assignment.getRhs(), {{offDiagonal, access}});
+    Stmt stmt = lowerAssignment(Assignment(assignment.getLhs(), rhs,
+                                           assignment.getOperator()));
+    return stmt.defined() ? IfThenElse::make(isOffDiagonal, stmt) : stmt;
+  }
+
   TensorVar result = assignment.getLhs().getTensorVar();
   Stmt computeStmt;
   Expr rhs = lower(assignment.getRhs());
@@ -292,6 +334,12 @@ Stmt LowererImpl::lowerAssignment(Assignment assignment)
       if (!assignment.getOperator().defined()) {
         return Assign::make(var, rhs);
       }
+      else if (const SemiringIntrinsic* semiringOp =
+                   getSemiringIntrinsic(assignment.getOperator())) {
+        taco_uassert(markAssignsAtomicDepth == 0 || util::contains(whereTemps, result))
+            << "Semiring reductions cannot be performed atomically";
+        return Assign::make(var, semiringOp->lower({var, rhs}));
+      }
       else {
         taco_iassert(isa<taco::Add>(assignment.getOperator()));
         return compoundAssign(var, rhs, markAssignsAtomicDepth > 0 && !util::contains(whereTemps, result), atomicParallelUnit);
@@ -305,6 +353,13 @@ Stmt LowererImpl::lowerAssignment(Assignment assignment)
       if (!assignment.getOperator().defined()) {
         computeStmt = Store::make(values, loc, rhs);
       }
+      else if (const SemiringIntrinsic* semiringOp =
+                   getSemiringIntrinsic(assignment.getOperator())) {
+        taco_uassert(markAssignsAtomicDepth == 0)
+            << "Semiring reductions cannot be performed atomically";
+        computeStmt = Store::make(values, loc,
+                                  semiringOp->lower({Load::make(values, loc), rhs}));
+      }
       else {
         computeStmt = compoundStore(values, loc, rhs, markAssignsAtomicDepth > 0, atomicParallelUnit);
       }
@@ -320,6 +375,33 @@ Stmt LowererImpl::lowerAssignment(Assignment assignment)
       return computeStmt;
     }
 
+    if(temporaryWithSparseAcceleration && util::contains(tempToHashCapacity, result)) {
+      taco_iassert(markAssignsAtomicDepth == 0) << "Hash workspaces cannot be written atomically";
+      Expr values = getValuesArray(result);
+      Expr slot = tempToHashSlot.at(result);
+      Expr keys = tempToBitGuard.at(result);
+      Expr mask = ir::Sub::make(tempToHashCapacity.at(result), 1);
+      Expr coordinate = indexVarToExprMap.at(assignment.getLhs().getIndexVars()[0]);
+      Expr indexList = tempToIndexList.at(result);
+      Expr indexListSize = tempToIndexListSize.at(result);
+
+      Stmt locateSlot = VarDecl::make(slot, ir::Call::make("taco_hashSlot", {keys, mask, coordinate}, Int32));
+      Stmt initialStorage = computeStmt;
+      if(assignment.getOperator().defined()) {
+        initialStorage = Store::make(values, slot, rhs);
+      }
+      Stmt markKey = Store::make(keys, slot, ir::Add::make(coordinate, 1));
+      Stmt trackSlot = Store::make(indexList, indexListSize, slot);
+      Stmt incrementStmt = Assign::make(indexListSize, ir::Add::make(indexListSize, 1));
+
+      Stmt firstWriteAtIndex = Block::make(initialStorage, trackSlot, markKey, incrementStmt);
+      if(!generateComputeCode()) {
+        firstWriteAtIndex = Block::make(trackSlot, markKey, incrementStmt);
+      }
+      Expr slotIsEmpty = ir::Eq::make(Load::make(keys, slot), 0);
+      return Block::make(locateSlot, IfThenElse::make(slotIsEmpty, firstWriteAtIndex, computeStmt));
+    }
+
     if(temporaryWithSparseAcceleration) {
       Expr values = getValuesArray(result);
       Expr loc = generateValueLocExpr(assignment.getLhs());
@@ -333,7 +415,7 @@ Stmt LowererImpl::lowerAssignment(Assignment assignment)
       Expr indexList = tempToIndexList.at(result);
       Expr indexListSize = tempToIndexListSize.at(result);
 
-      Stmt markBitGuardAsTrue = Store::make(bitGuardArr, loc, ir::Literal::make(true), markAssignsAtomicDepth > 0, atomicParallelUnit);
+      Stmt markBitGuardAsTrue = setGuard(bitGuardArr, loc, markAssignsAtomicDepth > 0, atomicParallelUnit);
       Stmt trackIndex = Store::make(indexList, indexListSize, loc, markAssignsAtomicDepth > 0, atomicParallelUnit);
       Expr incrementSize = ir::Add::make(indexListSize, ir::Literal::make(1));
       Stmt incrementStmt = Assign::make(indexListSize, incrementSize, markAssignsAtomicDepth > 0, atomicParallelUnit);
@@ -343,8 +425,7 @@ Stmt LowererImpl::lowerAssignment(Assignment assignment)
         firstWriteAtIndex = Block::make(trackIndex, markBitGuardAsTrue, incrementStmt);
       }
 
-      Expr readBitGuard = Load::make(bitGuardArr, loc);
-      Stmt finalStmt = IfThenElse::make(ir::Neg::make(readBitGuard), firstWriteAtIndex, computeStmt);
+      Stmt finalStmt = IfThenElse::make(guardIsUnset(bitGuardArr, loc), firstWriteAtIndex, computeStmt);
       return finalStmt;
     }
 
@@ -581,8 +662,11 @@ Stmt LowererImpl::lowerForall(Forall forall)
   else {
     std::vector<IndexVar> underivedAncestors = provGraph.getUnderivedAncestors(forall.getIndexVar());
     taco_iassert(underivedAncestors.size() == 1); // TODO: add support for fused coordinate of pos loop
+    CoIterationStrategy outerStrategy = coiterationStrategy;
+    coiterationStrategy = forall.getCoIterationStrategy();
     loops = lowerMergeLattice(lattice, underivedAncestors[0],
                               forall.getStmt(), reducedAccesses);
+    coiterationStrategy = outerStrategy;
   }
 //  taco_iassert(loops.defined());
 
@@ -968,8 +1052,15 @@ Stmt LowererImpl::lowerForallDimension(Forall forall,
     }
 
     Stmt declareVar = VarDecl::make(coordinate, Load::make(indexList, loopVar));
+    Stmt resetGuard = clearGuard(bitGuard, coordinate, markAssignsAtomicDepth > 0, atomicParallelUnit);
+    if (util::contains(tempToHashCapacity, var)) {
+      // Hash workspaces track slots, and their keys hold coordinates plus one
+      Expr slot = tempToHashSlot.at(var);
+      declareVar = Block::make(VarDecl::make(slot, Load::make(indexList, loopVar)),
+                               VarDecl::make(coordinate, ir::Sub::make(Load::make(bitGuard, slot), 1)));
+      resetGuard = ir::Store::make(bitGuard, slot, 0);
+    }
     Stmt body = lowerForallBody(coordinate, forall.getStmt(), locators, inserters, appenders, reducedAccesses);
-    Stmt resetGuard = ir::Store::make(bitGuard, coordinate, ir::Literal::make(false), markAssignsAtomicDepth > 0, atomicParallelUnit);
     body = Block::make(declareVar, body, resetGuard);
 
     if (forall.getParallelUnit() != ParallelUnit::NotParallel && forall.getOutputRaceStrategy() == OutputRaceStrategy::Atomics) {
@@ -1202,9 +1293,22 @@ Stmt LowererImpl::lowerForallFusedPosition(Forall forall, Iterator iterator,
   body = Block::make(recoveryStmt, Block::make(loopsToTrackUnderived), body);
 
   // Code to write results if using temporary and reset temporary
+  Stmt declareFirstRow;
   if (!whereConsumers.empty() && whereConsumers.back().defined()) {
     Expr temp = tensorVars.find(whereTemps.back())->second;
-    Stmt writeResults = Block::make(whereConsumers.back(), ir::Assign::make(temp, ir::Literal::zero(temp.type())));
+    Stmt writeResult = whereConsumers.back();
+    if (forall.getParallelUnit() == ParallelUnit::NotParallel &&
+        whereNonAtomicConsumers.back() != whereConsumers.back()) {
+      // Only the first row of a parallel partition can have been started by
+      // another partition, so rows that end after it are written without
+      // atomics.  The last (carry-out) row is written atomically after the loop.
+      Expr firstRow = Var::make(temp.as<Var>()->name + "_first_row", Bool);
+      declareFirstRow = VarDecl::make(firstRow, true);
+      writeResult = IfThenElse::make(firstRow,
+                                     Block::make(writeResult, ir::Assign::make(firstRow, false)),
+                                     whereNonAtomicConsumers.back());
+    }
+    Stmt writeResults = Block::make(writeResult, ir::Assign::make(temp, getInitialValue(whereTemps.back())));
     body = Block::make(body, IfThenElse::make(writeResultCond, writeResults));
   }
 
@@ -1251,6 +1355,7 @@ Stmt LowererImpl::lowerForallFusedPosition(Forall forall, Iterator iterator,
   // Loop with preamble and postamble
   return Block::blanks(boundsCompute,
                        Block::make(Block::make(searchForUnderivedStart),
+                       declareFirstRow,
                        For::make(indexVarToExprMap[iterator.getIndexVar()], startBound, endBound, 1,
                                  Block::make(declareCoordinate, body),
                                  kind,
@@ -1278,21 +1383,41 @@ Stmt LowererImpl::lowerMergeLattice(MergeLattice lattice, IndexVar coordinateVar
           });
   bool resolvedCoordDeclared = !modeIteratorsNonMergers.empty();
 
+  // Intersections of compressed levels may skip over runs of coordinates that
+  // cannot match.  With the Auto strategy the choice between stepping,
+  // galloping and block comparisons is made at run time from segment lengths.
+  Expr outerStrategyVar = coiterationStrategyVar;
+  coiterationStrategyVar = Expr();
+  Stmt strategySelection;
+  if (coiterationStrategy == CoIterationStrategy::Auto &&
+      lattice.points().size() == 1 &&
+      canSearchToCoordinate(coordinateVar, lattice.points()[0].iterators(),
+                            mergers)) {
+    coiterationStrategyVar = Var::make(coordinateVar.getName() + "Strategy",
+                                       Int());
+    strategySelection = codeToSelectCoIterationStrategy(mergers,
+                                                        coiterationStrategyVar);
+  }
+  Expr strategyVar = coiterationStrategyVar;
+
   vector<Stmt> mergeLoopsVec;
   for (MergePoint point : lattice.points()) {
     // Each iteration of this loop generates a while loop for one of the merge
     // points in the merge lattice.
     IndexStmt zeroedStmt = zero(statement, getExhaustedAccesses(point,lattice));
     MergeLattice sublattice = lattice.subLattice(point);
+    coiterationStrategyVar = strategyVar;
     Stmt mergeLoop = lowerMergePoint(sublattice, coordinate, coordinateVar, zeroedStmt, reducedAccesses, resolvedCoordDeclared);
     mergeLoopsVec.push_back(mergeLoop);
   }
   Stmt mergeLoops = Block::make(mergeLoopsVec);
+  coiterationStrategyVar = outerStrategyVar;
 
   // Append position to the pos array
   Stmt appendPositions = generateAppendPositions(appenders);
 
   return Block::blanks(iteratorVarInits,
+                       strategySelection,
                        mergeLoops,
                        appendPositions);
 }
@@ -1334,6 +1459,25 @@ Stmt LowererImpl::lowerMergePoint(MergeLattice pointLattice,
 
   // Increment iterator position variables
   Stmt incIteratorVarStmts = codeToIncIteratorVars(coordinate, coordinateVar, iterators, mergers);
+  if (pointLattice.points().size() == 1 &&
+      coiterationStrategy != CoIterationStrategy::Merge &&
+      canSearchToCoordinate(coordinateVar, iterators, mergers)) {
+    if (coiterationStrategy != CoIterationStrategy::Auto) {
+      incIteratorVarStmts = codeToSearchIteratorVars(coordinate, mergers,
+                                                     coiterationStrategy);
+    }
+    else if (coiterationStrategyVar.defined()) {
+      Expr strategy = coiterationStrategyVar;
+      Expr isGallop = Eq::make(strategy, (int)CoIterationStrategy::Gallop);
+      Expr isSIMD = Eq::make(strategy, (int)CoIterationStrategy::SIMDMerge);
+      incIteratorVarStmts = Case::make({
+          {isGallop, codeToSearchIteratorVars(coordinate, mergers,
+                                              CoIterationStrategy::Gallop)},
+          {isSIMD, codeToSearchIteratorVars(coordinate, mergers,
+                                            CoIterationStrategy::SIMDMerge)},
+          {true, incIteratorVarStmts}}, true);
+    }
+  }
 
   /// While loop over rangers
   return While::make(checkThatNoneAreExhausted(rangers),
@@ -1402,6 +1546,9 @@ Stmt LowererImpl::lowerMergeCases(ir::Expr coordinate, IndexVar coordinateVar, I
 
   // Just one iterator so no conditionals
   if (lattice.iterators().size() == 1) {
+    if (isMaskedOut(lattice.points()[0], stmt)) {
+      return Stmt();
+    }
     Stmt body = lowerForallBody(coordinate, stmt, {}, inserters, 
                                 appenders, reducedAccesses);
     result.push_back(body);
@@ -1418,8 +1565,16 @@ Stmt LowererImpl::lowerMergeCases(ir::Expr coordinate, IndexVar coordinateVar, I
         }
       }
 
-      // Construct case body
+      // Construct case body.  Coordinates removed by a complemented mask
+      // still need a case so they are not handled by a later one.
       IndexStmt zeroedStmt = zero(stmt, getExhaustedAccesses(point, lattice));
+      if (isMaskedOut(point, zeroedStmt)) {
+        if (coordComparisons.empty()) {
+          break;
+        }
+        cases.push_back({taco::ir::conjunction(coordComparisons), Block::make()});
+        continue;
+      }
       Stmt body = lowerForallBody(coordinate, zeroedStmt, {},
                                   inserters, appenders, reducedAccesses);
       if (coordComparisons.empty()) {
@@ -1505,10 +1660,41 @@ Expr LowererImpl::getTemporarySize(Where where) {
 vector<Stmt> LowererImpl::codeToInitializeDenseAcceleratorArrays(Where where) {
   TensorVar temporary = where.getTemporary();
 
-  // TODO: emit as uint64 and manually emit bit pack code
-  const Datatype bitGuardType = taco::Bool;
+  if (useHashWorkspace(where)) {
+    // An open addressing hash map with a keys array (zero marks an empty
+    // slot), a values array and a list of the occupied slots
+    Expr bound = getTemporaryNnzBound(where);
+    if (!bound.defined()) {
+      bound = getTemporarySize(where);
+    }
+    const Expr capacity = ir::Var::make(temporary.getName() + "_capacity", taco::Int32);
+    const Expr keysArr = ir::Var::make(temporary.getName() + "_keys", taco::Int32, true, false);
+    const std::string indexListName = temporary.getName() + "_index_list";
+    const Expr indexListArr = ir::Var::make(indexListName, taco::Int32, true, false);
+
+    tempToIndexList[temporary] = indexListArr;
+    tempToIndexListSize[temporary] = ir::Var::make(indexListName + "_size", taco::Int32, false, false);
+    tempToBitGuard[temporary] = keysArr;
+    tempToHashCapacity[temporary] = capacity;
+    tempToHashSlot[temporary] = ir::Var::make(temporary.getName() + "_slot", taco::Int32);
+
+    Stmt declareCapacity = VarDecl::make(capacity, ir::Call::make("taco_hashCapacity", {bound}, Int32));
+    Stmt indexListDecl = VarDecl::make(indexListArr, ir::Literal::make(0));
+    vector<Stmt> allocateIndexList = codeToAllocateWorkspace(indexListArr, capacity, false);
+    Stmt keysDecl = VarDecl::make(keysArr, ir::Literal::make(0));
+    vector<Stmt> allocateKeys = codeToAllocateWorkspace(keysArr, capacity, true);
+    Stmt inits = Block::make(declareCapacity, indexListDecl, allocateIndexList[0],
+                             keysDecl, allocateKeys[0]);
+    Stmt freeTemps = Block::make(allocateIndexList[1], allocateKeys[1]);
+    return {inits, freeTemps};
+  }
+
+  const bool bitPacked = getWorkspaceGuard() == WorkspaceGuard::BitPacked;
+  const Datatype bitGuardType = bitPacked ? taco::UInt64 : taco::Bool;
   const std::string bitGuardName = temporary.getName() + "_already_set";
-  const Expr bitGuardSize = getTemporarySize(where);
+  const Expr indexListSize = getTemporarySize(where);
+  const Expr bitGuardSize = bitPacked ? ir::Div::make(ir::Add::make(indexListSize, 63), 64)
+                                      : indexListSize;
   const Expr alreadySetArr = ir::Var::make(bitGuardName,
                                            bitGuardType,
                                            true, false);
@@ -1525,7 +1711,6 @@ vector<Stmt> LowererImpl::codeToInitializeDenseAcceleratorArrays(Where where) {
   Stmt alreadySetDecl = Stmt();
   Stmt indexListDecl = Stmt();
   const Expr indexListSizeExpr = ir::Var::make(indexListName + "_size", taco::Int32, false, false);
-  Stmt freeTemps = Block::make(Free::make(indexListArr), Free::make(alreadySetArr));
   if ((isa<Forall>(where.getProducer()) && inParallelLoopDepth == 0) || !should_use_CUDA_codegen()) {
     alreadySetDecl = VarDecl::make(alreadySetArr, ir::Literal::make(0));
     indexListDecl = VarDecl::make(indexListArr, ir::Literal::make(0));
@@ -1535,8 +1720,9 @@ vector<Stmt> LowererImpl::codeToInitializeDenseAcceleratorArrays(Where where) {
   tempToIndexListSize[temporary] = indexListSizeExpr;
   tempToBitGuard[temporary] = alreadySetArr;
 
-  Stmt allocateIndexList = Allocate::make(indexListArr, bitGuardSize);
   if(should_use_CUDA_codegen()) {
+    Stmt freeTemps = Block::make(Free::make(indexListArr), Free::make(alreadySetArr));
+    Stmt allocateIndexList = Allocate::make(indexListArr, indexListSize);
     Stmt allocateAlreadySet = Allocate::make(alreadySetArr, bitGuardSize);
     Expr p = Var::make("p" + temporary.getName(), Int());
     Stmt guardZeroInit = Store::make(alreadySetArr, p, ir::Literal::zero(bitGuardType));
@@ -1545,15 +1731,188 @@ vector<Stmt> LowererImpl::codeToInitializeDenseAcceleratorArrays(Where where) {
     Stmt inits = Block::make(alreadySetDecl, indexListDecl, allocateAlreadySet, allocateIndexList, zeroInitLoop);
     return {inits, freeTemps};
   } else {
-    Expr sizeOfElt = Sizeof::make(bitGuardType);
-    Expr callocAlreadySet = ir::Call::make("calloc", {bitGuardSize, sizeOfElt}, Int());
-    Stmt allocateAlreadySet = VarDecl::make(alreadySetArr, callocAlreadySet);
-    Stmt inits = Block::make(indexListDecl, allocateIndexList, allocateAlreadySet);
+    // The guard is cleared as the workspace is consumed, so it only needs to
+    // be cleared when it is allocated
+    vector<Stmt> allocateIndexList = codeToAllocateWorkspace(indexListArr, indexListSize, false);
+    vector<Stmt> allocateAlreadySet = codeToAllocateWorkspace(alreadySetArr, bitGuardSize, true);
+    Stmt inits = Block::make(indexListDecl, allocateIndexList[0], alreadySetDecl,
+                             allocateAlreadySet[0]);
+    Stmt freeTemps = Block::make(allocateIndexList[1], allocateAlreadySet[1]);
     return {inits, freeTemps};
   }
 
 }
 
+// Identifies persistent workspaces across all lowered functions, so that the
+// functions compiled into a module never share a workspace.
+static std::atomic<int> persistentWorkspaceCount(0);
+
+vector<Stmt> LowererImpl::codeToAllocateWorkspace(Expr array, Expr size, bool clear) {
+  if (getWorkspaceLifetime() == WorkspaceLifetime::Call || should_use_CUDA_codegen()) {
+    return {Allocate::make(array, size, false, Expr(), clear), Free::make(array)};
+  }
+  // The workspace cache of the call, which the generated function reads from
+  // the calling thread on entry, so that the threads of parallel loops use it
+  Expr cache = ir::Var::make("taco_kernelWorkspaces", UInt8, true);
+  Expr id = ir::Literal::make(persistentWorkspaceCount++);
+  Expr bytes = ir::Mul::make(size, Sizeof::make(array.type()));
+  Expr acquire = ir::Call::make("taco_acquireWorkspace",
+                                {cache, id, bytes, ir::Literal::make((int)clear)},
+                                array.type());
+  Expr release = ir::Call::make("taco_releaseWorkspace", {cache, array},
+                                array.type());
+  return {Assign::make(array, acquire), Assign::make(array, release)};
+}
+
+bool LowererImpl::useHashWorkspace(Where where) {
+  if (!canAccelerateDenseTemp(where)) {
+    return false;
+  }
+  // The producer is lowered with one level of atomics removed, so its writes
+  // are atomic if the where statement is nested in more than one atomic loop
+  // or the producer contains parallel loops
+  bool parallelProducer = false;
+  match(where.getProducer(),
+        std::function<void(const ForallNode*)>([&](const ForallNode* op) {
+          if (op->parallel_unit != ParallelUnit::NotParallel) {
+            parallelProducer = true;
+          }
+        })
+  );
+  if (parallelProducer || markAssignsAtomicDepth > 1) {
+    return false;
+  }
+  // Hash maps are sized to twice the number of coordinates they may hold and
+  // store coordinates plus one, so both must fit in 32 bits
+  Dimension dimension = where.getTemporary().getType().getShape().getDimension(0);
+  if (!dimension.isFixed() || dimension.getSize() > (1 << 29)) {
+    return false;
+  }
+  switch (getWorkspaceKind()) {
+    case WorkspaceKind::Dense:
+      return false;
+    case WorkspaceKind::Hash:
+      return true;
+    case WorkspaceKind::Auto: {
+      // Dense workspaces are cheaper to access, so only use hash maps when a
+      // dense workspace would not fit in cache and the hash map can be small
+      return dimension.getSize() >= (1 << 21) &&
+             getTemporaryNnzBound(where).defined();
+    }
+  }
+  taco_unreachable;
+  return false;
+}
+
+Expr LowererImpl::getTemporaryNnzBound(Where where) {
+  vector<Assignment> assignments;
+  match(where.getProducer(),
+        std::function<void(const AssignmentNode*)>([&](const AssignmentNode* op) {
+          assignments.push_back(op);
+        })
+  );
+  if (assignments.size() != 1 || assignments[0].getLhs().getIndexVars().size() != 1) {
+    return Expr();
+  }
+  IndexVar var = assignments[0].getLhs().getIndexVars()[0];
+
+  // A product can only be nonzero where all of its operands are nonzero, so
+  // any operand that is sparse in the workspace variable bounds the number of
+  // coordinates written to the workspace.
+  vector<Access> operands;
+  std::function<bool(IndexExpr)> collectOperands = [&](IndexExpr expr) {
+    if (isa<Access>(expr)) {
+      operands.push_back(to<Access>(expr));
+      return true;
+    }
+    if (isa<Mul>(expr)) {
+      return collectOperands(to<Mul>(expr).getA()) && collectOperands(to<Mul>(expr).getB());
+    }
+    return false;
+  };
+  if (!collectOperands(assignments[0].getRhs())) {
+    return Expr();
+  }
+
+  Expr bound;
+  for (const Access& operand : operands) {
+    const vector<IndexVar>& vars = operand.getIndexVars();
+    auto it = std::find(vars.begin(), vars.end(), var);
+    if (it == vars.end()) {
+      continue;
+    }
+    const Format format = operand.getTensorVar().getFormat();
+    const vector<int>& modeOrdering = format.getModeOrdering();
+    int level = (int)(std::find(modeOrdering.begin(), modeOrdering.end(),
+                                (int)(it - vars.begin())) - modeOrdering.begin()) + 1;
+    if (iterators.levelIterator(ModeAccess(operand, level)).isFull()) {
+      continue;
+    }
+
+    // The number of positions in the level bounds its number of coordinates
+    Expr size = ir::Literal::make(1);
+    for (int l = 1; l <= level; l++) {
+      Iterator levelIterator = iterators.levelIterator(ModeAccess(operand, l));
+      size = levelIterator.isFull() ? ir::Mul::make(size, levelIterator.getWidth())
+                                    : levelIterator.getSize(size);
+      if (!size.defined()) {
+        break;
+      }
+    }
+    if (!size.defined()) {
+      continue;
+    }
+    bound = bound.defined() ? ir::Min::make(bound, size) : size;
+  }
+  if (!bound.defined()) {
+    return Expr();
+  }
+  return ir::Min::make(bound, getTemporarySize(where));
+}
+
+Expr LowererImpl::guardIsUnset(Expr guard, Expr loc) {
+  if (guard.type() != taco::UInt64) {
+    return ir::Neg::make(Load::make(guard, loc));
+  }
+  Expr word = Load::make(guard, ir::Shr::make(loc, 6));
+  Expr mask = ir::Shl::make(ir::Cast::make(1, taco::UInt64), ir::BitAnd::make(loc, 63));
+  return ir::Eq::make(ir::BitAnd::make(word, mask), ir::Literal::zero(taco::UInt64));
+}
+
+Stmt LowererImpl::setGuard(Expr guard, Expr loc, bool atomic, ParallelUnit parallelUnit) {
+  if (guard.type() != taco::UInt64) {
+    return Store::make(guard, loc, ir::Literal::make(true), atomic, parallelUnit);
+  }
+  Expr wordLoc = ir::Shr::make(loc, 6);
+  Expr mask = ir::Shl::make(ir::Cast::make(1, taco::UInt64), ir::BitAnd::make(loc, 63));
+  return Store::make(guard, wordLoc, ir::BitOr::make(Load::make(guard, wordLoc), mask),
+                     atomic, parallelUnit);
+}
+
+Stmt LowererImpl::clearGuard(Expr guard, Expr loc, bool atomic, ParallelUnit parallelUnit) {
+  if (guard.type() != taco::UInt64) {
+    return Store::make(guard, loc, ir::Literal::make(false), atomic, parallelUnit);
+  }
+  return Store::make(guard, ir::Shr::make(loc, 6), ir::Literal::zero(taco::UInt64),
+                     atomic, parallelUnit);
+}
+
+bool LowererImpl::resultLevelIsOrdered(Where where) {
+  vector<Access> inputAccesses = getArgumentAccesses(where.getConsumer());
+  vector<Access> resultAccesses;
+  std::tie(resultAccesses, std::ignore) = getResultAccesses(where.getConsumer());
+  taco_iassert(inputAccesses.size() == 1 && resultAccesses.size() == 1);
+
+  vector<IndexVar> resultVars = resultAccesses[0].getIndexVars();
+  auto it = std::find(resultVars.begin(), resultVars.end(),
+                      inputAccesses[0].getIndexVars()[0]);
+  taco_iassert(it != resultVars.end());
+
+  Format format = resultAccesses[0].getTensorVar().getFormat();
+  int modeIndex = format.getModeOrdering()[it - resultVars.begin()];
+  return format.getModeFormats()[modeIndex].isOrdered();
+}
+
 // Returns true if the following conditions are met:
 // 1) The temporary is a dense vector
 // 2) There is only one value on the right hand side of the consumer
@@ -1632,14 +1991,15 @@ vector<Stmt> LowererImpl::codeToInitializeTemporary(Where where) {
                                   true, false);
       taco_iassert(temporary.getType().getOrder() == 1) << " Temporary order was "
                                                         << temporary.getType().getOrder();  // TODO
-      Expr size = getTemporarySize(where);
+      Expr size = util::contains(tempToHashCapacity, temporary)
+                  ? tempToHashCapacity.at(temporary) : getTemporarySize(where);
 
       // no decl needed for shared memory
       Stmt decl = Stmt();
       if ((isa<Forall>(where.getProducer()) && inParallelLoopDepth == 0) || !should_use_CUDA_codegen()) {
         decl = VarDecl::make(values, ir::Literal::make(0));
       }
-      Stmt allocate = Allocate::make(values, size);
+      vector<Stmt> allocate = codeToAllocateWorkspace(values, size, false);
 
       /// Make a struct object that lowerAssignment and lowerAccess can read
       /// temporary value arrays from.
@@ -1647,13 +2007,37 @@ vector<Stmt> LowererImpl::codeToInitializeTemporary(Where where) {
       arrays.values = values;
       this->temporaryArrays.insert({temporary, arrays});
 
-      freeTemporary = Block::make(freeTemporary, Free::make(values));
-      initializeTemporary = Block::make(decl, initializeTemporary, allocate);
+      freeTemporary = Block::make(freeTemporary, allocate[1]);
+      initializeTemporary = Block::make(decl, initializeTemporary, allocate[0]);
     }
   }
   return {initializeTemporary, freeTemporary};
 }
 
+/// Returns `stmt` with its stores and assignments written without atomics.
+static Stmt removeAtomics(Stmt stmt) {
+  struct RemoveAtomics : public IRRewriter {
+    using IRRewriter::visit;
+
+    void visit(const Store* op) {
+      IRRewriter::visit(op);
+      if (op->use_atomics) {
+        const Store* store = stmt.as<Store>();
+        stmt = Store::make(store->arr, store->loc, store->data);
+      }
+    }
+
+    void visit(const Assign* op) {
+      IRRewriter::visit(op);
+      if (op->use_atomics) {
+        const Assign* assign = stmt.as<Assign>();
+        stmt = Assign::make(assign->lhs, assign->rhs);
+      }
+    }
+  };
+  return RemoveAtomics().rewrite(stmt);
+}
+
 Stmt LowererImpl::lowerWhere(Where where) {
   TensorVar temporary = where.getTemporary();
   bool accelarateDenseWorkSpace = canAccelerateDenseTemp(where);
@@ -1682,13 +2066,34 @@ Stmt LowererImpl::lowerWhere(Where where) {
   );
 
   Stmt consumer = lower(where.getConsumer());
-  if(accelarateDenseWorkSpace) {
+  Stmt nonAtomicConsumer = consumer;
+  if (markAssignsAtomicDepth > 0 && isScalar(temporary.getType())) {
+    nonAtomicConsumer = removeAtomics(consumer);
+  }
+  if(accelarateDenseWorkSpace && resultLevelIsOrdered(where)) {
     // We need to sort the indices array
     Expr listOfIndices = tempToIndexList.at(temporary);
     Expr listOfIndicesSize = tempToIndexListSize.at(temporary);
-    Expr sizeOfElt = ir::Sizeof::make(listOfIndices.type());
-    Expr cmpName = ir::Var::make("cmp", Int());
-    Stmt sortCall = ir::Sort::make( {listOfIndices, listOfIndicesSize, sizeOfElt, cmpName});
+    Stmt sortCall;
+    if (util::contains(tempToHashCapacity, temporary)) {
+      Expr keys = tempToBitGuard.at(temporary);
+      Expr mask = ir::Sub::make(tempToHashCapacity.at(temporary), 1);
+      Expr orderCall = ir::Call::make("taco_orderHashSlots",
+                                      {listOfIndices, listOfIndicesSize, keys, mask,
+                                       getTemporarySize(where)}, Int32);
+      sortCall = Assign::make(listOfIndicesSize, orderCall);
+    } else if (getWorkspaceOrdering() == WorkspaceOrdering::Sort) {
+      Expr sizeOfElt = ir::Sizeof::make(listOfIndices.type());
+      Expr cmpName = ir::Var::make("cmp", Int());
+      sortCall = ir::Sort::make( {listOfIndices, listOfIndicesSize, sizeOfElt, cmpName});
+    } else {
+      Expr bitGuard = tempToBitGuard.at(temporary);
+      Expr guardWords = (bitGuard.type() == taco::UInt64) ? bitGuard : ir::Literal::make(0);
+      Expr orderCall = ir::Call::make("taco_orderIndexList",
+                                      {listOfIndices, listOfIndicesSize, guardWords,
+                                       getTemporarySize(where)}, Int32);
+      sortCall = Assign::make(listOfIndicesSize, orderCall);
+    }
     consumer = Block::make(sortCall, consumer);
   }
 
@@ -1704,12 +2109,13 @@ Stmt LowererImpl::lowerWhere(Where where) {
                                 temporary.getType().getDataType(),
                                 true, false);
     Expr size = getTemporarySize(where);
-    Stmt zeroInit = Store::make(values, p, ir::Literal::zero(temporary.getType().getDataType()));
+    Stmt zeroInit = Store::make(values, p, getInitialValue(temporary));
     Stmt loopInit = For::make(p, 0, size, 1, zeroInit, LoopKind::Serial);
     initializeTemporary = Block::make(initializeTemporary, loopInit);
   }
 
   whereConsumers.push_back(consumer);
+  whereNonAtomicConsumers.push_back(nonAtomicConsumer);
   whereTemps.push_back(where.getTemporary());
   captureNextLocatePos = true;
 
@@ -1732,6 +2138,7 @@ Stmt LowererImpl::lowerWhere(Where where) {
   }
 
   whereConsumers.pop_back();
+  whereNonAtomicConsumers.pop_back();
   whereTemps.pop_back();
   whereTempsToResult.erase(where.getTemporary());
   return Block::make(initializeTemporary, producer, markAssignsAtomicDepth > 0 ? capturedLocatePos : ir::Stmt(), consumer,  freeTemporary);
@@ -1925,6 +2332,22 @@ std::vector<Iterator> LowererImpl::getIterators(Access access) const {
 }
 
 
+bool LowererImpl::isMaskedOut(MergePoint point, IndexStmt stmt) const {
+  bool maskedOut = false;
+  match(stmt,
+    function<void(const CallIntrinsicNode*)>([&](const CallIntrinsicNode* op) {
+      if (!dynamic_cast<const MaskComplementIntrinsic*>(op->func.get()) ||
+          !isa<Access>(op->args[0])) {
+        return;
+      }
+      Iterator leaf = getIterators(to<Access>(op->args[0])).back();
+      maskedOut |= util::contains(point.iterators(), leaf) ||
+                   util::contains(point.locators(), leaf);
+    })
+  );
+  return maskedOut;
+}
+
 set<Access> LowererImpl::getExhaustedAccesses(MergePoint point,
                                               MergeLattice lattice) const
 {
@@ -2011,9 +2434,14 @@ Stmt LowererImpl::initResultArrays(vector<Access> writes,
   }
 
   std::vector<Stmt> result;
+  set<TensorVar> initialized;
   for (auto& write : writes) {
     if (write.getTensorVar().getOrder() == 0) continue;
 
+    // Results written by several assignments of a multi statement are
+    // initialized once
+    if (!initialized.insert(write.getTensorVar()).second) continue;
+
     std::vector<Stmt> initArrays;
 
     const auto iterators = getIterators(write);
@@ -2023,6 +2451,26 @@ Stmt LowererImpl::initResultArrays(vector<Access> writes,
     Expr valuesArr = GetProperty::make(tensor, TensorProperty::Values);
     bool clearValuesAllocation = false;
 
+    // Appended levels start from the capacity the caller stores in the result
+    // (an estimate of its number of components) instead of a fixed size.
+    Expr capacityHint;
+    if (generateAssembleCode() &&
+        getOutputCapacity() == OutputCapacity::Hinted &&
+        std::any_of(iterators.begin(), iterators.end(),
+                    [](const Iterator& it) { return it.hasAppend(); })) {
+      capacityHint = Var::make(util::toString(tensor) + "_capacity_hint", Int());
+      Expr valuesSize = GetProperty::make(tensor, TensorProperty::ValuesSize);
+      initArrays.push_back(VarDecl::make(capacityHint, DEFAULT_ALLOC_SIZE));
+      initArrays.push_back(IfThenElse::make(Gt::make(valuesSize, 0),
+                                            Assign::make(capacityHint, valuesSize)));
+      for (const auto& iterator : iterators) {
+        if (iterator.hasAppend()) {
+          Mode mode = iterator.getMode();
+          mode.addVar("capacity_hint", capacityHint);
+        }
+      }
+    }
+
     Expr parentSize = 1;
     if (generateAssembleCode()) {
       for (const auto& iterator : iterators) {
@@ -2058,8 +2506,9 @@ Stmt LowererImpl::initResultArrays(vector<Access> writes,
         taco_iassert(!iterators.empty());
         
         Expr capacityVar = getCapacityVar(tensor);
-        Expr allocSize = isValue(parentSize, 0) 
-                         ? DEFAULT_ALLOC_SIZE : parentSize;
+        Expr allocSize = !isValue(parentSize, 0) ? parentSize
+                         : capacityHint.defined() ? capacityHint
+                         : Expr(DEFAULT_ALLOC_SIZE);
         initArrays.push_back(VarDecl::make(capacityVar, allocSize));
         initArrays.push_back(Allocate::make(valuesArr, capacityVar, false /* is_realloc */, Expr() /* old_elements */,
                                             clearValuesAllocation));
@@ -2114,8 +2563,10 @@ ir::Stmt LowererImpl::finalizeResultArrays(std::vector<Access> writes) {
 
   bool clearValuesAllocation = false;
   std::vector<Stmt> result;
+  set<TensorVar> finalized;
   for (auto& write : writes) {
     if (write.getTensorVar().getOrder() == 0) continue;
+    if (!finalized.insert(write.getTensorVar()).second) continue;
 
     const auto iterators = getIterators(write);
     taco_iassert(!iterators.empty());
@@ -2155,7 +2606,7 @@ ir::Stmt LowererImpl::finalizeResultArrays(std::vector<Access> writes) {
 Stmt LowererImpl::defineScalarVariable(TensorVar var, bool zero) {
   Datatype type = var.getType().getDataType();
   Expr varValueIR = Var::make(var.getName() + "_val", type, false, false);
-  Expr init = (zero) ? ir::Literal::zero(type)
+  Expr init = (zero) ? getInitialValue(var)
                      : Load::make(GetProperty::make(tensorVars.at(var),
                                                     TensorProperty::Values));
   tensorVars.find(var)->second = varValueIR;
@@ -2292,7 +2743,7 @@ Stmt LowererImpl::resizeAndInitValues(const std::vector<Iterator>& appenders,
     }
 
     if (util::contains(reducedTensors, tensor)) {
-      Expr zero = ir::Literal::zero(tensor.type());
+      Expr zero = getInitialValue(tensor);
       result.push_back(Store::make(values, pos, zero));
     }
   }
@@ -2306,17 +2757,34 @@ Stmt LowererImpl::zeroInitValues(Expr tensor, Expr begin, Expr size) {
   Expr upper = simplify(ir::Mul::make(ir::Add::make(begin, 1), size));
   Expr p = Var::make("p" + util::toString(tensor), Int());
   Expr values = GetProperty::make(tensor, TensorProperty::Values);
-  Stmt zeroInit = Store::make(values, p, ir::Literal::zero(tensor.type()));
+  Expr zero = getInitialValue(tensor);
+  Stmt zeroInit = Store::make(values, p, zero);
   LoopKind parallel = (isa<ir::Literal>(size) && 
                        to<ir::Literal>(size)->getIntValue() < (1 << 10))
                       ? LoopKind::Serial : LoopKind::Static_Chunked;
-  if (should_use_CUDA_codegen() && util::contains(parallelUnitSizes, ParallelUnit::GPUBlock)) {
+  if (should_use_CUDA_codegen() && util::contains(parallelUnitSizes, ParallelUnit::GPUBlock) &&
+      isValue(zero, 0)) {
     return ir::VarDecl::make(ir::Var::make("status", Int()),
                                     ir::Call::make("cudaMemset", {values, ir::Literal::make(0, Int()), ir::Mul::make(ir::Sub::make(upper, lower), ir::Literal::make(values.type().getNumBytes()))}, Int()));
   }
   return For::make(p, lower, upper, 1, zeroInit, parallel);
 }
 
+Expr LowererImpl::getInitialValue(TensorVar var) {
+  return util::contains(reductionIdentities, var)
+         ? reductionIdentities.at(var)
+         : lowerLiteral(var.getFill());
+}
+
+Expr LowererImpl::getInitialValue(Expr tensor) {
+  for (auto& tensorVar : tensorVars) {
+    if (tensorVar.second == tensor) {
+      return getInitialValue(tensorVar.first);
+    }
+  }
+  return ir::Literal::zero(tensor.type());
+}
+
 Stmt LowererImpl::declLocatePosVars(vector<Iterator> locators) {
   vector<Stmt> result;
   for (Iterator& locator : locators) {
@@ -2617,6 +3085,77 @@ Stmt LowererImpl::codeToIncIteratorVars(Expr coordinate, IndexVar coordinateVar,
   return Block::make(result);
 }
 
+bool LowererImpl::canSearchToCoordinate(IndexVar coordinateVar,
+                                        vector<Iterator> iterators,
+                                        vector<Iterator> mergers) {
+  if (mergers.size() < 2 || iterators.size() != mergers.size()) {
+    return false;
+  }
+  for (auto& merger : mergers) {
+    if (!merger.hasPosIter() || !merger.isUnique() || !merger.isOrdered() ||
+        merger.isWindowed() || merger.getIndexVar() != coordinateVar ||
+        merger.getMode().getModeFormat().getName() != "compressed" ||
+        merger.getMode().getModePack().getNumModes() != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Stmt LowererImpl::codeToSearchIteratorVars(Expr coordinate,
+                                           vector<Iterator> mergers,
+                                           CoIterationStrategy strategy) {
+  taco_iassert(strategy == CoIterationStrategy::Gallop ||
+               strategy == CoIterationStrategy::SIMDMerge);
+  string search = (strategy == CoIterationStrategy::Gallop)
+                  ? "taco_gallop" : "taco_simdAdvance";
+
+  // Every merger is at or past the current coordinate, so no coordinate
+  // below the largest merger coordinate can be in the intersection.  If all
+  // mergers agree the intersection point was just consumed.
+  vector<Expr> coords = coordinates(mergers);
+  Expr allEqual;
+  for (auto& coord : coords) {
+    Expr eq = Eq::make(coord, coordinate);
+    allEqual = allEqual.defined() ? And::make(allEqual, eq) : eq;
+  }
+  Expr target = Var::make(util::toString(coordinate) + "Target", Int());
+  vector<Stmt> result;
+  result.push_back(VarDecl::make(target,
+                                 ir::Add::make(Max::make(coords),
+                                               ir::Cast::make(allEqual, Int()))));
+  for (auto& merger : mergers) {
+    Expr ivar = merger.getIteratorVar();
+    Expr crd = merger.getMode().getModePack().getArray(1);
+    result.push_back(Assign::make(ivar,
+        Call::make(search, {crd, ivar, merger.getEndVar(), target},
+                   ivar.type())));
+  }
+  return Block::make(result);
+}
+
+Stmt LowererImpl::codeToSelectCoIterationStrategy(vector<Iterator> mergers,
+                                                  Expr strategyVar) {
+  vector<Expr> lengths;
+  for (auto& merger : mergers) {
+    lengths.push_back(ir::Sub::make(merger.getEndVar(), merger.getIteratorVar()));
+  }
+  Expr shortest = Min::make(lengths);
+  Expr longest = Max::make(lengths);
+
+  // Galloping pays off once one segment is much longer than the other, block
+  // comparisons once the lengths are moderately skewed.
+  Stmt select = Case::make({
+      {Gte::make(longest, ir::Mul::make(shortest, 32)),
+       Assign::make(strategyVar, (int)CoIterationStrategy::Gallop)},
+      {Gte::make(longest, ir::Mul::make(shortest, 4)),
+       Assign::make(strategyVar, (int)CoIterationStrategy::SIMDMerge)}},
+      false);
+  return Block::make(VarDecl::make(strategyVar,
+                                   (int)CoIterationStrategy::Merge),
+                     select);
+}
+
 Stmt LowererImpl::codeToLoadCoordinatesFromPosIterators(vector<Iterator> iterators, bool declVars) {
   // Load coordinates from position iterators
   Stmt loadPosIterCoordinates;
@@ -2743,6 +3282,9 @@ Expr LowererImpl::generateValueLocExpr(Access access) const {
   if (isScalar(access.getTensorVar().getType())) {
     return ir::Literal::make(0);
   }
+  if (util::contains(tempToHashSlot, access.getTensorVar())) {
+    return tempToHashSlot.at(access.getTensorVar());
+  }
   Iterator it = getIterators(access).back();
 
   // to make indexing temporary arrays with index var work correctly
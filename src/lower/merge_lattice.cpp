@@ -3,11 +3,14 @@
 #include <set>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <complex>
 
 #include "taco/lower/iterator.h"
 #include "taco/index_notation/index_notation.h"
 #include "taco/index_notation/index_notation_nodes.h"
 #include "taco/index_notation/index_notation_visitor.h"
+#include "taco/index_notation/semiring.h"
 #include "tensor_path.h"
 #include "mode_access.h"
 #include "taco/util/collections.h"
@@ -185,33 +188,11 @@ private:
   }
 
   void visit(const MulNode* expr) {
-    MergeLattice a = build(expr->a);
-    MergeLattice b = build(expr->b);
-    if (a.points().size() > 0 && b.points().size() > 0) {
-      lattice = intersectLattices(a, b);
-    }
-    // Scalar operands
-    else if (a.points().size() > 0) {
-      lattice = a;
-    }
-    else if (b.points().size() > 0) {
-      lattice = b;
-    }
+    lattice = buildConjunctionLattice(expr->a, expr->b);
   }
 
   void visit(const DivNode* expr) {
-    MergeLattice a = build(expr->a);
-    MergeLattice b = build(expr->b);
-    if (a.points().size() > 0 && b.points().size() > 0) {
-      lattice = intersectLattices(a, b);
-    }
-    // Scalar operands
-    else if (a.points().size() > 0) {
-      lattice = a;
-    }
-    else if (b.points().size() > 0) {
-      lattice = b;
-    }
+    lattice = buildConjunctionLattice(expr->a, expr->b);
   }
 
   void visit(const SqrtNode* expr) {
@@ -223,9 +204,24 @@ private:
   }
 
   void visit(const CallIntrinsicNode* expr) {
+    if (getSemiringIntrinsic(expr)) {
+      lattice = buildSemiringLattice(expr);
+      return;
+    }
+    if (dynamic_cast<const MaskIntrinsic*>(expr->func.get()) ||
+        dynamic_cast<const MaskComplementIntrinsic*>(expr->func.get())) {
+      lattice = buildMaskLattice(expr);
+      return;
+    }
+
     const auto zeroPreservingArgsSets = 
         expr->func->zeroPreservingArgs(expr->args);
 
+    if (hasNonZeroFillOperand(expr) || !hasZeroFill(expr)) {
+      lattice = buildFillLattice(expr, zeroPreservingArgsSets);
+      return;
+    }
+
     std::set<size_t> zeroPreservingArgs;
     for (const auto& zeroPreservingArgsSet : zeroPreservingArgsSets) {
       taco_iassert(!zeroPreservingArgsSet.empty());
@@ -255,6 +251,215 @@ private:
     lattice = l;
   }
 
+  /**
+   * Returns true if an expression is zero wherever none of its operands are
+   * stored.
+   */
+  static bool hasZeroFill(IndexExpr expr) {
+    Literal fill = getFillValue(expr);
+    return fill.defined() && isZero(fill);
+  }
+
+  /**
+   * Returns true if a literal is a floating-point or complex NaN.
+   */
+  static bool isNaN(const Literal& literal) {
+    switch (literal.getDataType().getKind()) {
+      case Datatype::Float32:
+        return std::isnan(literal.getVal<float>());
+      case Datatype::Float64:
+        return std::isnan(literal.getVal<double>());
+      case Datatype::Complex64: {
+        std::complex<float> value = literal.getVal<std::complex<float>>();
+        return std::isnan(value.real()) || std::isnan(value.imag());
+      }
+      case Datatype::Complex128: {
+        std::complex<double> value = literal.getVal<std::complex<double>>();
+        return std::isnan(value.real()) || std::isnan(value.imag());
+      }
+      default:
+        return false;
+    }
+  }
+
+  /**
+   * Returns true if an expression accesses a tensor with a non-zero fill.
+   */
+  static bool hasNonZeroFillOperand(IndexExpr expr) {
+    bool nonZeroFill = false;
+    match(expr,
+      function<void(const AccessNode*)>([&](const AccessNode* op) {
+        nonZeroFill |= !isZero(op->tensorVar.getFill());
+      })
+    );
+    return nonZeroFill;
+  }
+
+  /**
+   * Returns true if a lattice iterates over every coordinate, because it keeps
+   * iterating over the dimension once all other iterators are exhausted.
+   */
+  static bool isFull(const MergeLattice& l) {
+    for (auto& point : l.points()) {
+      bool dimensionsOnly = !point.iterators().empty();
+      for (auto& iterator : point.iterators()) {
+        dimensionsOnly &= iterator.isDimensionIterator();
+      }
+      if (dimensionsOnly) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Returns the points of a lattice that iterate over or locate into at least
+   * one of the given iterators.
+   */
+  static MergeLattice restrictLattice(const MergeLattice& l,
+                                      const vector<Iterator>& iterators) {
+    vector<MergePoint> points;
+    for (auto& point : l.points()) {
+      bool hasIterator = false;
+      for (auto& iterator : point.iterators()) {
+        hasIterator |= util::contains(iterators, iterator);
+      }
+      for (auto& locator : point.locators()) {
+        hasIterator |= util::contains(iterators, locator);
+      }
+      if (hasIterator) {
+        points.push_back(point);
+      }
+    }
+    return MergeLattice(points);
+  }
+
+  /**
+   * A product (or quotient) is only non-zero where both operands are, so it
+   * iterates over the intersection of its operands.  An operand with a
+   * non-zero fill value does not annihilate the product where it is not
+   * stored, so in that case the product iterates over the other operand, or
+   * over the union of both if neither fill value is zero.
+   */
+  MergeLattice buildConjunctionLattice(IndexExpr ea, IndexExpr eb) {
+    MergeLattice a = build(ea);
+    MergeLattice b = build(eb);
+
+    // Scalar operands
+    if (a.points().size() == 0 || b.points().size() == 0) {
+      return (a.points().size() > 0) ? a : b;
+    }
+
+    const bool aAnnihilates = isFull(a) || hasZeroFill(ea);
+    const bool bAnnihilates = isFull(b) || hasZeroFill(eb);
+    if (aAnnihilates && bAnnihilates) {
+      return intersectLattices(a, b);
+    }
+    else if (aAnnihilates) {
+      return restrictLattice(unionLattices(a, b), a.iterators());
+    }
+    else if (bAnnihilates) {
+      return restrictLattice(unionLattices(a, b), b.iterators());
+    }
+    return unionLattices(a, b);
+  }
+
+  /**
+   * An intrinsic call whose operands have non-zero fill values, or whose value
+   * where no operand is stored is non-zero, iterates over the union of its
+   * operands; everywhere else it computes its fill value.  Zero-preserving
+   * arguments with zero fill values still restrict the iteration.
+   */
+  MergeLattice buildFillLattice(const CallIntrinsicNode* expr,
+      const vector<vector<size_t>>& zeroPreservingArgsSets) {
+    MergeLattice l({});
+    vector<MergeLattice> argLattices;
+    for (auto& arg : expr->args) {
+      argLattices.push_back(build(arg));
+      if (argLattices.back().points().size() > 0) {
+        l = (l.points().size() > 0) ? unionLattices(l, argLattices.back())
+                                    : argLattices.back();
+      }
+    }
+
+    for (const auto& zeroPreservingArgsSet : zeroPreservingArgsSets) {
+      vector<Iterator> zeroPreservingIterators;
+      bool restricts = true;
+      for (const auto zeroPreservingArg : zeroPreservingArgsSet) {
+        const MergeLattice& argLattice = argLattices[zeroPreservingArg];
+        restricts &= argLattice.points().size() > 0 && !isFull(argLattice) &&
+                     hasZeroFill(expr->args[zeroPreservingArg]);
+        if (restricts) {
+          util::append(zeroPreservingIterators, argLattice.iterators());
+        }
+      }
+      if (restricts) {
+        l = restrictLattice(l, zeroPreservingIterators);
+      }
+    }
+    return l;
+  }
+
+  /**
+   * Unstored components of the operands of a semiring operation equal the
+   * semiring's additive identity.  A semiring addition therefore iterates
+   * over the union of its operands, like +, and a semiring multiplication
+   * over their intersection, like *, but only if the additive identity
+   * annihilates multiplication.  Otherwise the product can differ from the
+   * identity anywhere, so the whole dimension is iterated.
+   */
+  MergeLattice buildSemiringLattice(const CallIntrinsicNode* expr) {
+    const SemiringIntrinsic* semiringOp = getSemiringIntrinsic(expr);
+    taco_iassert(expr->args.size() == 2);
+    MergeLattice a = build(expr->args[0]);
+    MergeLattice b = build(expr->args[1]);
+
+    // Scalar operands
+    if (a.points().size() == 0 || b.points().size() == 0) {
+      return (a.points().size() > 0) ? a : b;
+    }
+
+    if (semiringOp->getOperation() == SemiringIntrinsic::Addition) {
+      return unionLattices(a, b);
+    }
+    const auto& semiring = semiringOp->getSemiring();
+    if (semiring->identityAnnihilates(expr->getDataType())) {
+      return intersectLattices(a, b);
+    }
+    return unionLattices(modeIterationLattice(), unionLattices(a, b));
+  }
+
+  /**
+   * A structural mask iterates over the intersection of the mask and the
+   * masked expression.  A complemented mask co-iterates the mask alongside the
+   * expression, so that the lowerer can skip coordinates where the mask is
+   * stored, but never iterates over coordinates that are only in the mask.
+   */
+  MergeLattice buildMaskLattice(const CallIntrinsicNode* expr) {
+    taco_iassert(expr->args.size() == 2);
+    MergeLattice m = build(expr->args[0]);
+    MergeLattice x = build(expr->args[1]);
+
+    // Scalar expressions and masks that are not indexed by this loop do not
+    // restrict iteration.
+    bool maskIndexed = false;
+    for (auto& point : m.points()) {
+      for (auto& iterator : point.iterators()) {
+        maskIndexed |= !iterator.isDimensionIterator();
+      }
+      maskIndexed |= !point.locators().empty();
+    }
+    if (x.points().size() == 0 || !maskIndexed) {
+      return x;
+    }
+
+    if (dynamic_cast<const MaskIntrinsic*>(expr->func.get())) {
+      return intersectLattices(m, x);
+    }
+
+    return restrictLattice(unionLattices(m, x), x.iterators());
+  }
+
   void visit(const ReductionNode* node) {
     taco_ierror << "Merge lattices must be created from concrete index "
     << "notation, which does not have reduction nodes.";
@@ -262,6 +467,31 @@ private:
 
   void visit(const AssignmentNode* node) {
     lattice = build(node->rhs);
+
+    // Coordinates outside the lattice compute the fill value of the right-hand
+    // side, so unless that value is what the result holds there already, every
+    // coordinate must be iterated over.  Semiring results start out holding
+    // the additive identity, which is the fill value of semiring expressions.
+    // NaN fill values, such as the 0/0 of dividing two sparse tensors, are
+    // ignored unless a tensor declared a non-zero fill, as they are for
+    // tensors without fill values.  Fill values that cannot be folded, such as
+    // acos(0), may be any value, so they are never ignored.
+    if (lattice.points().size() > 0 && !isFull(lattice) &&
+        !getSemiringIntrinsic(node->op) && !getSemiringIntrinsic(node->rhs) &&
+        (!node->op.defined() || isa<Add>(node->op))) {
+      Literal resultFill = node->op.defined()
+          ? to<Literal>(Literal::zero(node->rhs.getDataType()))
+          : node->lhs.getTensorVar().getFill();
+      Literal rhsFill = getFillValue(node->rhs);
+      const bool fillsMatch = rhsFill.defined() &&
+          (isZero(resultFill) ? isZero(rhsFill) : equals(rhsFill, resultFill));
+      const bool declaredFill = !isZero(resultFill) ||
+                                hasNonZeroFillOperand(node->rhs);
+      const bool nanFill = rhsFill.defined() && isNaN(rhsFill);
+      if (!fillsMatch && (declaredFill || !nanFill)) {
+        lattice = unionLattices(lattice, modeIterationLattice());
+      }
+    }
     latticesOfTemporaries.insert({node->lhs.getTensorVar(), lattice});
 
     // This is to allow for scalar temporaries to be used (for example
@@ -443,8 +673,11 @@ private:
     vector<Iterator> locaters = combine(left.locators(), right.locators());
     vector<Iterator> results  = combine(left.results(),  right.results());
 
-    // Remove duplicate iterators.
+    // Remove duplicate iterators.  The statements of a multi statement may
+    // share iterators.
     iterators = deduplicateDimensionIterators(iterators);
+    locaters = deduplicate(locaters);
+    results = deduplicate(results);
 
     return MergePoint(iterators, locaters, results);
   }
@@ -581,7 +814,18 @@ private:
           dimensionIteratorFound = true;
         }
       }
-      else {
+      else if (!util::contains(deduplicates, iterator)) {
+        deduplicates.push_back(iterator);
+      }
+    }
+    return deduplicates;
+  }
+
+  static vector<Iterator> deduplicate(const vector<Iterator>& iterators)
+  {
+    vector<Iterator> deduplicates;
+    for (auto& iterator : iterators) {
+      if (!util::contains(deduplicates, iterator)) {
         deduplicates.push_back(iterator);
       }
     }
@@ -143,7 +143,9 @@ Stmt CompressedModeFormat::getAppendInitLevel(Expr szPrev, Expr sz,
   const bool szPrevIsZero = isa<Literal>(szPrev) && 
                             to<Literal>(szPrev)->equalsScalar(0);
 
-  Expr defaultCapacity = Literal::make(allocSize, Datatype::Int32); 
+  // The capacity hint bounds the number of components of the result, which
+  // sizes the coordinates but not the positions of the level
+  Expr defaultCapacity = Literal::make(allocSize, Datatype::Int32);
   Expr posArray = getPosArray(mode.getModePack());
   Expr initCapacity = szPrevIsZero ? defaultCapacity : Add::make(szPrev, 1);
   Expr posCapacity = initCapacity;
@@ -166,7 +168,9 @@ Stmt CompressedModeFormat::getAppendInitLevel(Expr szPrev, Expr sz,
   if (mode.getPackLocation() == (mode.getModePack().getNumModes() - 1)) {
     Expr crdCapacity = getCoordCapacity(mode);
     Expr crdArray = getCoordArray(mode.getModePack());
-    initStmts.push_back(VarDecl::make(crdCapacity, defaultCapacity));
+    Expr initCrdCapacity = mode.hasVar("capacity_hint")
+                           ? mode.getVar("capacity_hint") : defaultCapacity;
+    initStmts.push_back(VarDecl::make(crdCapacity, initCrdCapacity));
     initStmts.push_back(Allocate::make(crdArray, crdCapacity));
   }
 
@@ -1,7 +1,16 @@
 #include "taco/storage/array.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
+#if TACO_LINUX
+#include <sys/mman.h>
+#endif
 
 #include "taco/type.h"
 #include "taco/error.h"
@@ -18,10 +27,12 @@ struct Array::Content : util::Uncopyable {
   void*  data;
   size_t size;
   Policy policy = Array::UserOwns;
+  std::shared_ptr<void> owner;
 
   ~Content() {
     switch (policy) {
       case UserOwns:
+      case Shared:
         // do nothing
         break;
       case Free:
@@ -98,6 +109,15 @@ Array::Array(Datatype type, void* data, size_t size, Policy policy) : Array() {
   content->policy = policy;
 }
 
+Array::Array(Datatype type, void* data, size_t size,
+             std::shared_ptr<void> owner) : Array() {
+  content->type = type;
+  content->data = data;
+  content->size = size;
+  content->policy = Shared;
+  content->owner = owner;
+}
+
 const Datatype& Array::getType() const {
   return content->type;
 }
@@ -106,6 +126,10 @@ size_t Array::getSize() const {
   return content->size;
 }
 
+Array::Policy Array::getPolicy() const {
+  return content->policy;
+}
+
 const void* Array::getData() const {
   return content->data;
 }
@@ -205,17 +229,158 @@ std::ostream& operator<<(std::ostream& os, Array::Policy policy) {
     case Array::Delete:
       os << "delete";
       break;
+    case Array::Shared:
+      os << "shared";
+      break;
   }
   return os;
 }
 
+bool operator==(const AllocationPolicy& a, const AllocationPolicy& b) {
+  return a.alignment == b.alignment && a.hugePages == b.hugePages &&
+         a.hugePageThreshold == b.hugePageThreshold;
+}
+
+bool operator!=(const AllocationPolicy& a, const AllocationPolicy& b) {
+  return !(a == b);
+}
+
+static void checkAllocationPolicy(const AllocationPolicy& policy) {
+  taco_uassert(policy.alignment >= 64 &&
+               (policy.alignment & (policy.alignment - 1)) == 0)
+      << "Arrays must be aligned to a power of two of at least 64 bytes, not "
+      << policy.alignment;
+}
+
+// Kernels read the policy on every allocation, so it is replaced as a whole
+// instead of being guarded by a lock.  Null stands for the default policy.
+static shared_ptr<const AllocationPolicy> allocationPolicy;
+
+void setAllocationPolicy(AllocationPolicy policy) {
+  checkAllocationPolicy(policy);
+  atomic_store(&allocationPolicy,
+               shared_ptr<const AllocationPolicy>(
+                   make_shared<AllocationPolicy>(policy)));
+}
+
+AllocationPolicy getAllocationPolicy() {
+  shared_ptr<const AllocationPolicy> policy = atomic_load(&allocationPolicy);
+  return (policy != nullptr) ? *policy : AllocationPolicy();
+}
+
+/// Returns the size of huge pages, read from /proc/meminfo.
+static size_t getHugePageSize() {
+  static const size_t hugePageSize = []() {
+    ifstream meminfo("/proc/meminfo");
+    string line;
+    while (getline(meminfo, line)) {
+      if (line.compare(0, 13, "Hugepagesize:") == 0) {
+        const size_t kilobytes = strtoull(line.c_str() + 13, nullptr, 10);
+        if (kilobytes > 0) {
+          return kilobytes << 10;
+        }
+      }
+    }
+    return (size_t)2 << 20;
+  }();
+  return hugePageSize;
+}
+
+static bool usesHugePages(size_t bytes, const AllocationPolicy& policy) {
+  return policy.hugePages != AllocationPolicy::None &&
+         bytes >= policy.hugePageThreshold;
+}
+
+/// Mark the huge pages that lie within [ptr, ptr + bytes) for transparent huge
+/// pages.  Failures are ignored, since huge pages are a hint.
+static void adviseHugePages(void* ptr, size_t bytes) {
+#if TACO_LINUX && defined(MADV_HUGEPAGE)
+  const uintptr_t hugePageSize = getHugePageSize();
+  const uintptr_t first = ((uintptr_t)ptr + hugePageSize - 1) / hugePageSize *
+                          hugePageSize;
+  const uintptr_t last = ((uintptr_t)ptr + bytes) / hugePageSize *
+                         hugePageSize;
+  if (last > first) {
+    madvise((void*)first, last - first, MADV_HUGEPAGE);
+  }
+#endif
+}
+
+void* allocateAligned(size_t bytes, const AllocationPolicy& policy) {
+  size_t alignment = policy.alignment;
+  size_t paddedBytes = std::max(bytes, (size_t)1);
+  const bool huge = usesHugePages(bytes, policy);
+  if (huge) {
+    // Pad to whole huge pages, so that no huge page is shared with other
+    // allocations
+    const size_t hugePageSize = getHugePageSize();
+    alignment = std::max(alignment, hugePageSize);
+    paddedBytes = (paddedBytes + hugePageSize - 1) / hugePageSize *
+                  hugePageSize;
+  }
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, alignment, paddedBytes) != 0) {
+    return nullptr;
+  }
+  if (huge) {
+    adviseHugePages(ptr, paddedBytes);
+  }
+  return ptr;
+}
+
+void* reallocateAligned(void* ptr, size_t bytes,
+                        const AllocationPolicy& policy) {
+  void* resized = realloc(ptr, std::max(bytes, (size_t)1));
+  if (resized == nullptr) {
+    return nullptr;
+  }
+  // realloc only guarantees the alignment of malloc
+  if ((uintptr_t)resized % policy.alignment != 0) {
+    void* aligned = allocateAligned(bytes, policy);
+    if (aligned != nullptr) {
+      memcpy(aligned, resized, bytes);
+    }
+    free(resized);
+    return aligned;
+  }
+  if (usesHugePages(bytes, policy)) {
+    adviseHugePages(resized, bytes);
+  }
+  return resized;
+}
+
 Array makeArray(Datatype type, size_t size) {
   if (should_use_CUDA_unified_memory()) {
     return Array(type, cuda_unified_alloc(size * type.getNumBytes()), size, Array::Free);
   }
   else {
-    return Array(type, malloc(size * type.getNumBytes()), size, Array::Free);
+    return makeArray(type, size, getAllocationPolicy());
+  }
+}
+
+Array makeArray(Datatype type, size_t size, const AllocationPolicy& policy) {
+  checkAllocationPolicy(policy);
+  const size_t bytes = size * type.getNumBytes();
+#if TACO_LINUX && defined(MAP_HUGETLB)
+  if (policy.hugePages == AllocationPolicy::Explicit &&
+      usesHugePages(bytes, policy)) {
+    const size_t hugePageSize = getHugePageSize();
+    const size_t paddedBytes = (bytes + hugePageSize - 1) / hugePageSize *
+                               hugePageSize;
+    void* data = mmap(nullptr, paddedBytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      shared_ptr<void> owner(data, [paddedBytes](void* data) {
+        munmap(data, paddedBytes);
+      });
+      return Array(type, data, size, owner);
+    }
   }
+#endif
+  void* data = allocateAligned(bytes, policy);
+  taco_uassert(data != nullptr) << "Could not allocate an array of " << size
+                                << " " << type << " components";
+  return Array(type, data, size, Array::Free);
 }
 
 }
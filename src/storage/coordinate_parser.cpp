@@ -0,0 +1,441 @@
+#include "storage/coordinate_parser.h"
+
+#include <algorithm>
+#include <climits>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "taco/tensor.h"
+#include "taco/error.h"
+
+using namespace std;
+
+namespace taco {
+
+// Threads are only started for ranges of at least this many bytes when the
+// number of threads is chosen automatically
+static const size_t minBytesPerThread = 1 << 20;
+
+static inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDelimiter(char c) {
+  return isSpace(c) || c == '\n' || c == '\0';
+}
+
+bool parseInteger(const char*& ptr, long long* value) {
+  const char* p = ptr;
+  bool negative = false;
+  if (*p == '-' || *p == '+') {
+    negative = (*p == '-');
+    p++;
+  }
+  if (!isDigit(*p)) {
+    return false;
+  }
+  long long result = 0;
+  while (isDigit(*p)) {
+    if (result > (LLONG_MAX - 9) / 10) {
+      return false;
+    }
+    result = result * 10 + (*p - '0');
+    p++;
+  }
+  *value = negative ? -result : result;
+  ptr = p;
+  return true;
+}
+
+bool parseDouble(const char*& ptr, double* value) {
+  static const double powersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  if (isDelimiter(*ptr)) {
+    return false;
+  }
+
+  // Decimal numbers with an exactly representable significand and power of
+  // ten are converted with a single correctly rounded operation
+  const char* p = ptr;
+  bool negative = false;
+  if (*p == '-' || *p == '+') {
+    negative = (*p == '-');
+    p++;
+  }
+  uint64_t significand = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool hasDigits = false;
+  bool exact = true;
+  while (isDigit(*p)) {
+    if (significand != 0 || *p != '0') {
+      if (++digits > 19) {
+        exact = false;
+      }
+      significand = significand * 10 + (*p - '0');
+    }
+    hasDigits = true;
+    p++;
+  }
+  if (*p == '.') {
+    p++;
+    while (isDigit(*p)) {
+      if (significand != 0 || *p != '0') {
+        if (++digits > 19) {
+          exact = false;
+        }
+        significand = significand * 10 + (*p - '0');
+      }
+      exponent--;
+      hasDigits = true;
+      p++;
+    }
+  }
+  if (hasDigits && (*p == 'e' || *p == 'E')) {
+    p++;
+    long long power;
+    if (isDigit(*p) || ((*p == '-' || *p == '+') && isDigit(p[1]))) {
+      exact = parseInteger(p, &power) && power > -1000 && power < 1000 && exact;
+      exponent += exact ? (int)power : 0;
+    }
+    else {
+      exact = false;
+    }
+  }
+
+  if (hasDigits && exact && isDelimiter(*p) &&
+      significand <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22) {
+    double result = (double)significand;
+    result = (exponent < 0) ? result / powersOfTen[-exponent]
+                            : result * powersOfTen[exponent];
+    *value = negative ? -result : result;
+    ptr = p;
+    return true;
+  }
+
+  // Fall back to strtod for everything else, such as long significands, hex
+  // floats, infinities and NaNs
+  char* end;
+  double result = strtod(ptr, &end);
+  if (end == ptr) {
+    return false;
+  }
+  *value = result;
+  ptr = end;
+  return true;
+}
+
+static inline void skipSpace(const char*& ptr) {
+  while (isSpace(*ptr)) {
+    ptr++;
+  }
+}
+
+/// Returns the number of whitespace separated tokens of the first line in
+/// [begin, end) that is neither blank nor a comment, or -1 if there is none.
+static int countTokens(const char* begin, const char* end) {
+  const char* ptr = begin;
+  while (ptr < end) {
+    const char* lineEnd = (const char*)memchr(ptr, '\n', end - ptr);
+    lineEnd = (lineEnd != nullptr) ? lineEnd : end;
+    skipSpace(ptr);
+    if (ptr < lineEnd && *ptr != '%' && *ptr != '#') {
+      int tokens = 0;
+      while (ptr < lineEnd) {
+        tokens++;
+        while (ptr < lineEnd && !isSpace(*ptr)) {
+          ptr++;
+        }
+        skipSpace(ptr);
+      }
+      return tokens;
+    }
+    ptr = lineEnd + 1;
+  }
+  return -1;
+}
+
+/// Parse the lines in [begin, end), where end follows a newline.  Errors are
+/// returned as a message rather than raised, since this runs on worker threads.
+static void parseLines(const char* begin, const char* end, int order,
+                       int numValues, bool integerValues,
+                       CoordinateBlock* block, string* error) {
+  block->coordinates.resize(order);
+  block->dimensions.assign(order, 0);
+  const size_t expectedSize = (end - begin) / (4 * (order + numValues)) + 1;
+  for (auto& coordinates : block->coordinates) {
+    coordinates.reserve(expectedSize);
+  }
+  if (integerValues) {
+    block->integers.reserve(expectedSize * numValues);
+  }
+  else {
+    block->values.reserve(expectedSize * numValues);
+  }
+
+  const char* ptr = begin;
+  while (ptr < end) {
+    const char* lineBegin = ptr;
+    const char* lineEnd = (const char*)memchr(ptr, '\n', end - ptr);
+    skipSpace(ptr);
+    if (ptr == lineEnd || *ptr == '%' || *ptr == '#') {
+      ptr = lineEnd + 1;
+      continue;
+    }
+
+    for (int mode = 0; mode < order; mode++) {
+      skipSpace(ptr);
+      long long idx;
+      if (ptr == lineEnd || !parseInteger(ptr, &idx) || !isDelimiter(*ptr)) {
+        *error = "Malformed coordinate in line: " + string(lineBegin, lineEnd);
+        return;
+      }
+      if (idx > INT_MAX) {
+        *error = "Coordinate in file is larger than INT_MAX";
+        return;
+      }
+      if (idx < 1) {
+        *error = "Coordinates in file must be one-based";
+        return;
+      }
+      block->coordinates[mode].push_back((int)idx - 1);
+      block->dimensions[mode] = std::max(block->dimensions[mode], (int)idx);
+    }
+    for (int i = 0; i < numValues; i++) {
+      skipSpace(ptr);
+      bool parsed;
+      if (integerValues) {
+        long long value = 0;
+        parsed = ptr != lineEnd && parseInteger(ptr, &value) &&
+                 isDelimiter(*ptr);
+        block->integers.push_back(value);
+      }
+      else {
+        double value = 0.0;
+        parsed = ptr != lineEnd && parseDouble(ptr, &value) &&
+                 isDelimiter(*ptr);
+        block->values.push_back(value);
+      }
+      if (!parsed) {
+        *error = "Malformed value in line: " + string(lineBegin, lineEnd);
+        return;
+      }
+    }
+    block->numComponents++;
+    ptr = lineEnd + 1;
+  }
+}
+
+/// Split [begin, end) at line boundaries and parse the pieces in parallel.
+static void parseRange(const char* begin, const char* end, int order,
+                       int numValues, bool integerValues, int numThreads,
+                       vector<CoordinateBlock>* blocks) {
+  const size_t size = end - begin;
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+    numThreads = (int)std::min((size_t)numThreads,
+                               size / minBytesPerThread + 1);
+  }
+
+  vector<const char*> bounds = {begin};
+  for (int i = 1; i < numThreads; i++) {
+    const char* bound = std::max(begin + i * (size / numThreads), bounds.back());
+    bound = (const char*)memchr(bound, '\n', end - bound);
+    if (bound == nullptr || bound + 1 >= end) {
+      break;
+    }
+    bounds.push_back(bound + 1);
+  }
+  bounds.push_back(end);
+
+  const size_t numChunks = bounds.size() - 1;
+  vector<CoordinateBlock> chunks(numChunks);
+  vector<string> errors(numChunks);
+  vector<thread> threads;
+  for (size_t i = 1; i < numChunks; i++) {
+    threads.emplace_back(parseLines, bounds[i], bounds[i+1], order, numValues,
+                         integerValues, &chunks[i], &errors[i]);
+  }
+  parseLines(bounds[0], bounds[1], order, numValues, integerValues, &chunks[0],
+             &errors[0]);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < numChunks; i++) {
+    taco_uassert(errors[i].empty()) << errors[i];
+    if (chunks[i].size() > 0) {
+      blocks->push_back(std::move(chunks[i]));
+    }
+  }
+}
+
+vector<CoordinateBlock> parseCoordinates(std::istream& stream, int order,
+                                         int numValues, bool integerValues,
+                                         int numThreads, size_t blockSize) {
+  vector<CoordinateBlock> blocks;
+  string buffer;
+  size_t carried = 0;
+  while (stream) {
+    buffer.resize(carried + blockSize);
+    stream.read(&buffer[carried], blockSize);
+    buffer.resize(carried + stream.gcount());
+
+    size_t parsed;
+    if (stream) {
+      // Parse up to the last complete line and carry the rest over
+      size_t lastNewline = buffer.rfind('\n');
+      parsed = (lastNewline != string::npos) ? lastNewline + 1 : 0;
+    }
+    else {
+      if (!buffer.empty() && buffer.back() != '\n') {
+        buffer.push_back('\n');
+      }
+      parsed = buffer.size();
+    }
+
+    if (parsed > 0) {
+      const char* begin = buffer.data();
+      if (order < 0) {
+        const int numTokens = countTokens(begin, begin + parsed);
+        order = (numTokens >= 0) ? numTokens - numValues : -1;
+      }
+      if (order >= 0) {
+        parseRange(begin, begin + parsed, order, numValues, integerValues,
+                   numThreads, &blocks);
+      }
+    }
+    carried = buffer.size() - parsed;
+    buffer.erase(0, parsed);
+  }
+  return blocks;
+}
+
+
+template <typename T>
+static T makeValue(double real, double imag, T*) {
+  return static_cast<T>(real);
+}
+
+template <typename T>
+static std::complex<T> makeValue(double real, double imag, std::complex<T>*) {
+  return std::complex<T>(static_cast<T>(real), static_cast<T>(imag));
+}
+
+static bool makeValue(double real, double imag, bool*) {
+  return real != 0.0 || imag != 0.0;
+}
+
+template <typename T>
+static T makeValue(long long value, T*) {
+  return static_cast<T>(value);
+}
+
+template <typename T>
+static std::complex<T> makeValue(long long value, std::complex<T>*) {
+  return std::complex<T>(static_cast<T>(value), 0);
+}
+
+static bool makeValue(long long value, bool*) {
+  return value != 0;
+}
+
+template <typename T>
+static T negate(T value) {
+  return -value;
+}
+
+static bool negate(bool value) {
+  return value;
+}
+
+template <typename T>
+static T conjugate(T value) {
+  return value;
+}
+
+template <typename T>
+static std::complex<T> conjugate(std::complex<T> value) {
+  return std::conj(value);
+}
+
+template <typename T>
+static void insertTypedBlock(TensorBase& tensor, const CoordinateBlock& block,
+                             int numValues, MatrixSymmetry symmetry) {
+  vector<T> values(block.size());
+  for (size_t i = 0; i < block.size(); i++) {
+    if (!block.integers.empty()) {
+      values[i] = makeValue(block.integers[i*numValues], (T*)nullptr);
+      continue;
+    }
+    const double real = (numValues > 0) ? block.values[i*numValues] : 1.0;
+    const double imag = (numValues > 1) ? block.values[i*numValues + 1] : 0.0;
+    values[i] = makeValue(real, imag, (T*)nullptr);
+  }
+  tensor.insertBulk(block.coordinates, values);
+  if (symmetry == MatrixSymmetry::General) {
+    return;
+  }
+
+  // Mirror the components that are not on the diagonal
+  taco_iassert(block.coordinates.size() == 2);
+  vector<vector<int>> mirrored(2);
+  vector<T> mirroredValues;
+  for (size_t i = 0; i < block.size(); i++) {
+    if (block.coordinates[0][i] == block.coordinates[1][i]) {
+      continue;
+    }
+    mirrored[0].push_back(block.coordinates[1][i]);
+    mirrored[1].push_back(block.coordinates[0][i]);
+    const T value = values[i];
+    switch (symmetry) {
+      case MatrixSymmetry::SkewSymmetric:
+        mirroredValues.push_back(negate(value));
+        break;
+      case MatrixSymmetry::Hermitian:
+        mirroredValues.push_back(conjugate(value));
+        break;
+      default:
+        mirroredValues.push_back(value);
+        break;
+    }
+  }
+  tensor.insertBulk(mirrored, mirroredValues);
+}
+
+void insertBlock(TensorBase& tensor, const CoordinateBlock& block,
+                 int numValues, MatrixSymmetry symmetry) {
+  const Datatype ctype = tensor.getComponentType();
+  taco_uassert(symmetry != MatrixSymmetry::SkewSymmetric ||
+               !(ctype.isUInt() || ctype.isBool()))
+      << "Cannot read a skew-symmetric matrix into a " << ctype << " tensor";
+  switch (ctype.getKind()) {
+    case Datatype::Bool: insertTypedBlock<bool>(tensor, block, numValues, symmetry); break;
+    case Datatype::UInt8: insertTypedBlock<uint8_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::UInt16: insertTypedBlock<uint16_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::UInt32: insertTypedBlock<uint32_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::UInt64: insertTypedBlock<uint64_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::Int8: insertTypedBlock<int8_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::Int16: insertTypedBlock<int16_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::Int32: insertTypedBlock<int32_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::Int64: insertTypedBlock<int64_t>(tensor, block, numValues, symmetry); break;
+    case Datatype::Float32: insertTypedBlock<float>(tensor, block, numValues, symmetry); break;
+    case Datatype::Float64: insertTypedBlock<double>(tensor, block, numValues, symmetry); break;
+    case Datatype::Complex64: insertTypedBlock<std::complex<float>>(tensor, block, numValues, symmetry); break;
+    case Datatype::Complex128: insertTypedBlock<std::complex<double>>(tensor, block, numValues, symmetry); break;
+    default:
+      taco_uerror << "Cannot read " << ctype << " tensors from text files";
+  }
+}
+
+}
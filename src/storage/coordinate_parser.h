@@ -0,0 +1,69 @@
+#ifndef TACO_STORAGE_COORDINATE_PARSER_H
+#define TACO_STORAGE_COORDINATE_PARSER_H
+
+#include <istream>
+#include <vector>
+#include <cstddef>
+
+namespace taco {
+class TensorBase;
+
+/// Components parsed from a range of lines of a coordinate file, stored as one
+/// coordinate array per mode and an array with the values of each component
+/// one after the other.
+struct CoordinateBlock {
+  std::vector<std::vector<int>> coordinates;
+  std::vector<double> values;
+
+  /// The values of blocks that are parsed as integers, in place of `values`.
+  std::vector<long long> integers;
+
+  /// One more than the largest coordinate of each mode.
+  std::vector<int> dimensions;
+
+  size_t numComponents = 0;
+
+  size_t size() const {
+    return numComponents;
+  }
+};
+
+/// Parse the coordinate lines of the rest of a stream.  Each line holds
+/// `order` one-based coordinates followed by `numValues` values, and blank
+/// lines and lines that start with '%' or '#' are skipped.  If `order` is
+/// negative it is inferred from the first line.  If `integerValues` is true
+/// the values must be integers, which are parsed exactly into the `integers`
+/// of the blocks.  The stream is read in blocks
+/// of `blockSize` bytes, that are split at line boundaries and parsed by up to
+/// `numThreads` threads, or by as many threads as the hardware supports if
+/// `numThreads` is zero.  The blocks hold zero-based coordinates in file order.
+std::vector<CoordinateBlock> parseCoordinates(std::istream& stream, int order,
+                                              int numValues=1,
+                                              bool integerValues=false,
+                                              int numThreads=0,
+                                              size_t blockSize=(64 << 20));
+
+/// The symmetry of a matrix stored as one of its triangles.
+enum class MatrixSymmetry {General, Symmetric, SkewSymmetric, Hermitian};
+
+/// Insert the components of a block into a tensor, converting their values to
+/// the component type of the tensor.  Components with no values are inserted as
+/// ones and components with two values as complex numbers.  The components of
+/// a symmetric matrix that are not on the diagonal are also inserted
+/// transposed, negated if it is skew-symmetric and conjugated if Hermitian.
+void insertBlock(TensorBase& tensor, const CoordinateBlock& block,
+                 int numValues,
+                 MatrixSymmetry symmetry=MatrixSymmetry::General);
+
+/// Parse a decimal integer at `ptr` and advance `ptr` past it.  Returns false
+/// if there is no integer at `ptr` or if it does not fit in 63 bits.
+bool parseInteger(const char*& ptr, long long* value);
+
+/// Parse a floating point number at `ptr` and advance `ptr` past it.  Decimal
+/// numbers whose significand fits in 53 bits and whose exponent is at most 22
+/// are converted exactly without calling strtod.  Returns false if there is no
+/// number at `ptr`.
+bool parseDouble(const char*& ptr, double* value);
+
+}
+#endif
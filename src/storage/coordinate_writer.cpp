@@ -0,0 +1,159 @@
+#include "storage/coordinate_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include "taco/error.h"
+#include "taco/format.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+
+using namespace std;
+
+namespace taco {
+
+void formatUnsigned(std::string& buffer, unsigned long long value) {
+  char digits[20];
+  int numDigits = 0;
+  do {
+    digits[numDigits++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (numDigits > 0) {
+    buffer += digits[--numDigits];
+  }
+}
+
+void formatInteger(std::string& buffer, long long value) {
+  if (value < 0) {
+    buffer += '-';
+    formatUnsigned(buffer, 0ull - (unsigned long long)value);
+  }
+  else {
+    formatUnsigned(buffer, (unsigned long long)value);
+  }
+}
+
+void formatDouble(std::string& buffer, double value) {
+  // Integers with at most six digits are formatted the same way by %g, so
+  // they are formatted without calling snprintf
+  if (value > -1e6 && value < 1e6 && value == (double)(long long)value &&
+      !(value == 0 && std::signbit(value))) {
+    formatInteger(buffer, (long long)value);
+    return;
+  }
+  char digits[32];
+  const int size = snprintf(digits, sizeof(digits), "%g", value);
+  buffer.append(digits, size);
+}
+
+void writeFormatted(std::ostream& stream, size_t size,
+                    const function<void(size_t,size_t,std::string&)>& format,
+                    size_t itemsPerRange, int numThreads) {
+  taco_iassert(itemsPerRange > 0);
+  const size_t numRanges = (size + itemsPerRange - 1) / itemsPerRange;
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  numThreads = (int)std::max((size_t)1, std::min((size_t)numThreads, numRanges));
+
+  // Each round formats a range on every thread and writes them in order,
+  // reusing the buffers of the previous round
+  vector<string> buffers(numThreads);
+  for (size_t begin = 0; begin < size; begin += numThreads * itemsPerRange) {
+    auto formatRange = [&](int i) {
+      const size_t rangeBegin = std::min(size, begin + i * itemsPerRange);
+      const size_t rangeEnd = std::min(size, rangeBegin + itemsPerRange);
+      buffers[i].clear();
+      format(rangeBegin, rangeEnd, buffers[i]);
+    };
+    vector<thread> threads;
+    for (int i = 1; i < numThreads; i++) {
+      threads.emplace_back(formatRange, i);
+    }
+    formatRange(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (auto& buffer : buffers) {
+      stream.write(buffer.data(), buffer.size());
+    }
+  }
+}
+
+// class PackedComponents
+PackedComponents::PackedComponents(const TensorBase& tensor) {
+  taco_iassert(supports(tensor));
+  const Format& format = tensor.getFormat();
+  const Index& index = tensor.getStorage().getIndex();
+  const vector<ModeFormat> modeFormats = format.getModeFormats();
+  for (int l = 0; l < tensor.getOrder(); l++) {
+    Level level;
+    level.mode = format.getModeOrdering()[l];
+    level.dimension = tensor.getDimension(level.mode);
+    level.pos = nullptr;
+    level.crd = nullptr;
+    const ModeIndex& modeIndex = index.getModeIndex(l);
+    if (modeFormats[l].getName() == ModeFormat::Dense.getName()) {
+      level.kind = Dense;
+    }
+    else if (modeFormats[l].getName() == ModeFormat::Compressed.getName()) {
+      level.kind = Compressed;
+      level.pos = (const int32_t*)modeIndex.getIndexArray(0).getData();
+      level.crd = (const int32_t*)modeIndex.getIndexArray(1).getData();
+    }
+    else {
+      level.kind = Singleton;
+      level.crd = (const int32_t*)modeIndex.getIndexArray(1).getData();
+    }
+    levels.push_back(level);
+  }
+}
+
+bool PackedComponents::supports(const TensorBase& tensor) {
+  const TensorStorage& storage = tensor.getStorage();
+  if (storage.getValues().getData() == nullptr) {
+    return false;
+  }
+  const Index& index = storage.getIndex();
+  if (index.numModeIndices() != tensor.getOrder()) {
+    return false;
+  }
+  const vector<ModeFormat> modeFormats = tensor.getFormat().getModeFormats();
+  for (int l = 0; l < tensor.getOrder(); l++) {
+    const string name = modeFormats[l].getName();
+    if (name == ModeFormat::Dense.getName()) {
+      continue;
+    }
+    if ((name != ModeFormat::Compressed.getName() &&
+         name != ModeFormat::Singleton.getName()) ||
+        (l == 0 && name == ModeFormat::Singleton.getName())) {
+      return false;
+    }
+    const ModeIndex& modeIndex = index.getModeIndex(l);
+    if (modeIndex.numIndexArrays() < 2) {
+      return false;
+    }
+    for (int i = 0; i < 2; i++) {
+      if (modeIndex.getIndexArray(i).getType() != Int32) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+size_t PackedComponents::getNumTopPositions() const {
+  if (levels.empty()) {
+    return 1;
+  }
+  if (levels[0].kind == Dense) {
+    return levels[0].dimension;
+  }
+  return levels[0].pos[1] - levels[0].pos[0];
+}
+
+}
@@ -0,0 +1,199 @@
+#ifndef TACO_STORAGE_COORDINATE_WRITER_H
+#define TACO_STORAGE_COORDINATE_WRITER_H
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "taco/tensor.h"
+
+namespace taco {
+
+/// Append the decimal representation of an integer to a buffer.
+void formatInteger(std::string& buffer, long long value);
+
+/// Append the decimal representation of an unsigned integer to a buffer.
+void formatUnsigned(std::string& buffer, unsigned long long value);
+
+/// Append a floating point number to a buffer the way streams format it by
+/// default, with six significant digits.
+void formatDouble(std::string& buffer, double value);
+
+/// Append a component value to a buffer the way `operator<<` formats it,
+/// except that 8-bit integers are formatted as numbers rather than characters.
+template <typename T>
+inline void formatValue(std::string& buffer, T value) {
+  if (std::is_floating_point<T>::value) {
+    formatDouble(buffer, (double)value);
+  }
+  else if (std::is_signed<T>::value) {
+    formatInteger(buffer, (long long)value);
+  }
+  else {
+    formatUnsigned(buffer, (unsigned long long)value);
+  }
+}
+
+template <typename T>
+inline void formatValue(std::string& buffer, std::complex<T> value) {
+  buffer += '(';
+  formatDouble(buffer, value.real());
+  buffer += ',';
+  formatDouble(buffer, value.imag());
+  buffer += ')';
+}
+
+/// Write the text of the items [0, size) to a stream, where `format(begin,
+/// end, buffer)` appends the text of the items [begin, end) to `buffer`.
+/// Ranges of `itemsPerRange` items are formatted by up to `numThreads`
+/// threads, or by as many threads as the hardware supports if `numThreads` is
+/// zero, and written in order.
+void writeFormatted(std::ostream& stream, size_t size,
+                    const std::function<void(size_t,size_t,std::string&)>& format,
+                    size_t itemsPerRange=(1 << 16), int numThreads=0);
+
+/// The components stored in the packed index of a tensor, traversed directly
+/// rather than through compiled code.  Supports tensors whose levels are
+/// dense, compressed or singleton and whose index arrays hold 32-bit integers.
+class PackedComponents {
+public:
+  explicit PackedComponents(const TensorBase& tensor);
+
+  /// Returns true if the components of the tensor can be traversed directly.
+  static bool supports(const TensorBase& tensor);
+
+  /// Returns the number of positions of the first level.  Traversals are split
+  /// into ranges of these positions.
+  size_t getNumTopPositions() const;
+
+  /// Calls `visit(coordinates, position)` for each component stored under the
+  /// positions [begin, end) of the first level, in storage order.
+  /// `coordinates` holds the zero-based coordinates of the component in mode
+  /// order and `position` is its position in the values array.
+  template <typename Visit>
+  void traverse(size_t begin, size_t end, Visit visit) const {
+    const int order = (int)levels.size();
+    std::vector<int> coordinates(order);
+    if (order == 0) {
+      if (begin < end) {
+        visit(coordinates.data(), (size_t)0);
+      }
+      return;
+    }
+
+    // The current position, first position and end of each level
+    std::vector<size_t> positions(order), starts(order), ends(order);
+    const size_t offset = (levels[0].kind == Compressed) ? levels[0].pos[0] : 0;
+    starts[0] = 0;
+    positions[0] = offset + begin;
+    ends[0] = offset + end;
+
+    int l = 0;
+    while (true) {
+      if (positions[l] == ends[l]) {
+        if (l == 0) {
+          break;
+        }
+        l--;
+        positions[l]++;
+        continue;
+      }
+
+      const Level& level = levels[l];
+      const size_t position = positions[l];
+      coordinates[level.mode] = (level.kind == Dense)
+                                ? (int)(position - starts[l])
+                                : level.crd[position];
+      if (l == order - 1) {
+        visit(coordinates.data(), position);
+        positions[l]++;
+        continue;
+      }
+
+      const Level& child = levels[l+1];
+      switch (child.kind) {
+        case Dense:
+          starts[l+1] = position * child.dimension;
+          ends[l+1] = starts[l+1] + child.dimension;
+          break;
+        case Compressed:
+          starts[l+1] = child.pos[position];
+          ends[l+1] = child.pos[position + 1];
+          break;
+        case Singleton:
+          starts[l+1] = position;
+          ends[l+1] = position + 1;
+          break;
+      }
+      positions[l+1] = starts[l+1];
+      l++;
+    }
+  }
+
+private:
+  enum Kind {Dense, Compressed, Singleton};
+  struct Level {
+    Kind kind;
+    int mode;
+    size_t dimension;
+    const int32_t* pos;
+    const int32_t* crd;
+  };
+  std::vector<Level> levels;
+};
+
+/// Write a line for each component stored in a tensor, in storage order.  Each
+/// line holds the one-based coordinates of the component followed by a space
+/// if `writeCoordinates` is true, and its value appended by
+/// `appendValue(buffer, value)`.  Tensors supported by PackedComponents are
+/// traversed directly and formatted in parallel.
+template <typename T, typename AppendValue>
+void writeComponents(std::ostream& stream, const TensorBase& tensor,
+                     bool writeCoordinates, AppendValue appendValue) {
+  const int order = tensor.getOrder();
+  if (!PackedComponents::supports(tensor)) {
+    std::string buffer;
+    for (auto& value : iterate<T>(tensor)) {
+      for (int k = 0; writeCoordinates && k < order; k++) {
+        formatInteger(buffer, value.first[k] + 1);
+        buffer += ' ';
+      }
+      appendValue(buffer, value.second);
+      buffer += '\n';
+      if (buffer.size() >= (1 << 20)) {
+        stream.write(buffer.data(), buffer.size());
+        buffer.clear();
+      }
+    }
+    stream.write(buffer.data(), buffer.size());
+    return;
+  }
+
+  PackedComponents components(tensor);
+  const T* values = (const T*)tensor.getStorage().getValues().getData();
+  const size_t numTopPositions = components.getNumTopPositions();
+  const size_t numComponents = tensor.getStorage().getValues().getSize();
+  const size_t componentsPerPosition =
+      (numTopPositions > 0) ? numComponents / numTopPositions + 1 : 1;
+  writeFormatted(stream, numTopPositions,
+                 [&](size_t begin, size_t end, std::string& buffer) {
+    components.traverse(begin, end,
+                        [&](const int* coordinates, size_t position) {
+      for (int k = 0; writeCoordinates && k < order; k++) {
+        formatInteger(buffer, coordinates[k] + 1);
+        buffer += ' ';
+      }
+      appendValue(buffer, values[position]);
+      buffer += '\n';
+    });
+  }, std::max((size_t)1, (size_t)(1 << 16) / componentsPerPosition));
+}
+
+}
+#endif
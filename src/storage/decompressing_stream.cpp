@@ -0,0 +1,332 @@
+#include "storage/decompressing_stream.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef TACO_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TACO_ZSTD
+#include <zstd.h>
+#endif
+
+#include "taco/error.h"
+#include "taco/util/files.h"
+
+using namespace std;
+
+namespace taco {
+
+static bool endsWith(const string& str, const string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Compression stripCompressionExtension(string* filename) {
+  const vector<pair<string,Compression>> extensions = {
+    {".gz", Compression::Gzip},
+    {".zst", Compression::Zstd},
+    {".zstd", Compression::Zstd}
+  };
+  for (auto& extension : extensions) {
+    if (endsWith(*filename, extension.first)) {
+      filename->erase(filename->size() - extension.first.size());
+      return extension.second;
+    }
+  }
+  return Compression::None;
+}
+
+bool isCompressionSupported(Compression compression) {
+  switch (compression) {
+    case Compression::None:
+      return true;
+    case Compression::Gzip:
+#ifdef TACO_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    case Compression::Zstd:
+#ifdef TACO_ZSTD
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+/// A stream buffer whose contents are produced by a decompression thread.  The
+/// thread fills buffers of `bufferSize` bytes and blocks while `numBuffers`
+/// of them are waiting to be read.
+class DecompressingStream::Buffer : public std::streambuf {
+public:
+  Buffer(string filename, Compression compression, size_t bufferSize,
+         size_t numBuffers)
+      : filename(filename), bufferSize(bufferSize), numBuffers(numBuffers) {
+    util::openStream(file, filename, fstream::in | fstream::binary);
+    producer = thread(&Buffer::produce, this, compression);
+  }
+
+  ~Buffer() {
+    {
+      lock_guard<mutex> lock(queueMutex);
+      cancelled = true;
+    }
+    queueChanged.notify_all();
+    producer.join();
+  }
+
+protected:
+  int_type underflow() override {
+    unique_lock<mutex> lock(queueMutex);
+    if (!current.empty()) {
+      free.push_back(std::move(current));
+      current.clear();
+    }
+    queueChanged.notify_all();
+    queueChanged.wait(lock, [&]() { return !full.empty() || finished; });
+    if (full.empty()) {
+      setg(nullptr, nullptr, nullptr);
+      // Raised through the stream, whose exception mask includes badbit
+      taco_uassert(error.empty()) << error;
+      return traits_type::eof();
+    }
+
+    current = std::move(full.front());
+    full.pop_front();
+    queueChanged.notify_all();
+    char* data = &current[0];
+    setg(data, data, data + current.size());
+    return traits_type::to_int_type(*data);
+  }
+
+private:
+  string filename;
+  fstream file;
+  size_t bufferSize;
+  size_t numBuffers;
+  thread producer;
+
+  mutex queueMutex;
+  condition_variable queueChanged;
+  deque<string> full;
+  vector<string> free;
+  string current;
+  bool finished = false;
+  bool cancelled = false;
+  string error;
+
+  /// Returns an empty buffer with room for `bufferSize` bytes.
+  string takeBuffer() {
+    string buffer;
+    {
+      lock_guard<mutex> lock(queueMutex);
+      if (!free.empty()) {
+        buffer = std::move(free.back());
+        free.pop_back();
+      }
+    }
+    buffer.resize(bufferSize);
+    return buffer;
+  }
+
+  /// Queue the first `size` bytes of a buffer to be read, waiting while the
+  /// queue is full.  Returns false if the stream was destroyed.
+  bool emit(string& buffer, size_t size) {
+    if (size == 0) {
+      return true;
+    }
+    buffer.resize(size);
+    unique_lock<mutex> lock(queueMutex);
+    queueChanged.wait(lock, [&]() {
+      return full.size() < numBuffers || cancelled;
+    });
+    if (cancelled) {
+      return false;
+    }
+    full.push_back(std::move(buffer));
+    queueChanged.notify_all();
+    return true;
+  }
+
+  /// Decompress the file into the queue.  Errors are recorded and raised by
+  /// the reader, since this runs on a separate thread.
+  void produce(Compression compression) {
+    string message;
+    switch (compression) {
+      case Compression::None:
+        message = copy();
+        break;
+      case Compression::Gzip:
+        message = inflateGzip();
+        break;
+      case Compression::Zstd:
+        message = decompressZstd();
+        break;
+    }
+
+    lock_guard<mutex> lock(queueMutex);
+    error = message;
+    finished = true;
+    queueChanged.notify_all();
+  }
+
+  string copy() {
+    while (file) {
+      string out = takeBuffer();
+      file.read(&out[0], bufferSize);
+      if (!emit(out, file.gcount())) {
+        break;
+      }
+    }
+    return "";
+  }
+
+  string inflateGzip() {
+#ifdef TACO_ZLIB
+    z_stream stream = {};
+    // Accept gzip and zlib headers
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+      return "Could not initialize zlib";
+    }
+    vector<char> in(bufferSize);
+    string out = takeBuffer();
+    size_t used = 0;
+    bool streamEnded = false;
+    bool flushed = true;
+    bool stopped = false;
+    string message;
+    while (true) {
+      // Inflating may leave output that did not fit, which must be drained
+      // before more input is read
+      if (stream.avail_in == 0 && flushed) {
+        file.read(in.data(), in.size());
+        if (file.gcount() == 0) {
+          break;
+        }
+        stream.next_in = (Bytef*)in.data();
+        stream.avail_in = (uInt)file.gcount();
+      }
+
+      stream.next_out = (Bytef*)&out[used];
+      stream.avail_out = (uInt)(bufferSize - used);
+      const int status = inflate(&stream, Z_NO_FLUSH);
+      used = bufferSize - stream.avail_out;
+      // The end of a member is only reported once all its output is written
+      flushed = status == Z_STREAM_END || stream.avail_out != 0;
+      if (status == Z_STREAM_END) {
+        // Files may hold several concatenated gzip members
+        streamEnded = true;
+        inflateReset(&stream);
+      }
+      else if (status == Z_OK) {
+        streamEnded = false;
+      }
+      else if (status != Z_BUF_ERROR) {
+        // Buffer errors only mean that no progress was possible, but other
+        // errors mean that the file is corrupt
+        message = "Corrupt gzip file: " + filename;
+        break;
+      }
+
+      if (used == bufferSize) {
+        if (!emit(out, used)) {
+          stopped = true;
+          break;
+        }
+        out = takeBuffer();
+        used = 0;
+      }
+    }
+    inflateEnd(&stream);
+    if (message.empty() && !stopped) {
+      if (!streamEnded) {
+        message = "Truncated gzip file: " + filename;
+      }
+      emit(out, used);
+    }
+    return message;
+#else
+    return "taco was built without zlib";
+#endif
+  }
+
+  string decompressZstd() {
+#ifdef TACO_ZSTD
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    ZSTD_initDStream(stream);
+    vector<char> in(bufferSize);
+    ZSTD_inBuffer input = {in.data(), 0, 0};
+    string out = takeBuffer();
+    size_t used = 0;
+    size_t status = 1;
+    bool flushed = true;
+    bool stopped = false;
+    string message;
+    while (true) {
+      // The decoder may hold output that did not fit, which it produces
+      // without more input until it returns 0 or leaves room in the output
+      if (input.pos == input.size && flushed) {
+        file.read(in.data(), in.size());
+        if (file.gcount() == 0) {
+          break;
+        }
+        input = {in.data(), (size_t)file.gcount(), 0};
+      }
+
+      ZSTD_outBuffer output = {&out[0], bufferSize, used};
+      status = ZSTD_decompressStream(stream, &output, &input);
+      used = output.pos;
+      if (ZSTD_isError(status)) {
+        message = "Corrupt zstd file: " + filename + " (" +
+                  ZSTD_getErrorName(status) + ")";
+        break;
+      }
+      flushed = status == 0 || output.pos < output.size;
+
+      if (used == bufferSize) {
+        if (!emit(out, used)) {
+          stopped = true;
+          break;
+        }
+        out = takeBuffer();
+        used = 0;
+      }
+    }
+    ZSTD_freeDStream(stream);
+    if (message.empty() && !stopped) {
+      // A zero status marks the end of a frame
+      if (status != 0) {
+        message = "Truncated zstd file: " + filename;
+      }
+      emit(out, used);
+    }
+    return message;
+#else
+    return "taco was built without zstd";
+#endif
+  }
+};
+
+DecompressingStream::DecompressingStream(string filename,
+                                         Compression compression,
+                                         size_t bufferSize, size_t numBuffers)
+    : std::istream(nullptr) {
+  taco_uassert(isCompressionSupported(compression))
+      << "taco was built without support for reading " << filename;
+  buffer.reset(new Buffer(filename, compression, bufferSize, numBuffers));
+  rdbuf(buffer.get());
+  // Decompression errors raised by the buffer propagate out of reads
+  exceptions(badbit);
+}
+
+DecompressingStream::~DecompressingStream() {
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef TACO_STORAGE_DECOMPRESSING_STREAM_H
+#define TACO_STORAGE_DECOMPRESSING_STREAM_H
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+namespace taco {
+
+/// The compression of a tensor file.
+enum class Compression {None, Gzip, Zstd};
+
+/// Returns the compression of a file, inferred from its last extension (.gz or
+/// .zst), and removes that extension from `filename`.
+Compression stripCompressionExtension(std::string* filename);
+
+/// Returns true if taco was built with support for reading files with the
+/// given compression.
+bool isCompressionSupported(Compression compression);
+
+/// An input stream over the decompressed contents of a file.  The file is read
+/// and decompressed on a separate thread into a bounded queue of buffers, so
+/// that decompression overlaps with the parsing of the previous buffers.
+class DecompressingStream : public std::istream {
+public:
+  DecompressingStream(std::string filename, Compression compression,
+                      size_t bufferSize=(4 << 20), size_t numBuffers=4);
+  ~DecompressingStream();
+
+private:
+  class Buffer;
+  std::unique_ptr<Buffer> buffer;
+};
+
+}
+#endif
@@ -5,6 +5,8 @@
 #include <sstream>
 #include <cstdlib>
 #include <climits>
+#include <algorithm>
+#include <cctype>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
@@ -12,78 +14,59 @@
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
 #include "taco/util/files.h"
+#include "storage/coordinate_parser.h"
+#include "storage/coordinate_writer.h"
 
 using namespace std;
 
 namespace taco {
 
 template <typename T>
-TensorBase dispatchReadMTX(std::string filename, const T& format, bool pack) {
+TensorBase dispatchReadMTX(std::string filename, const T& format,
+                           Datatype ctype, bool pack) {
   std::fstream file;
   util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readMTX(file, format, pack);
+  TensorBase tensor = readMTX(file, format, ctype, pack);
   file.close();
   return tensor;
 }
 
 TensorBase readMTX(std::string filename, const ModeFormat& modetype, bool pack) {
-  return dispatchReadMTX(filename, modetype, pack);
+  return dispatchReadMTX(filename, modetype, Datatype(), pack);
 }
 
 TensorBase readMTX(std::string filename, const Format& format, bool pack) {
-  return dispatchReadMTX(filename, format, pack);
+  return dispatchReadMTX(filename, format, Datatype(), pack);
 }
 
-template <typename T>
-TensorBase dispatchReadMTX(std::istream& stream, const T& format, bool pack) {
-  string line;
-  if (!std::getline(stream, line)) {
-    return TensorBase();
-  }
-
-  // Read Header
-  std::stringstream lineStream(line);
-  string head, type, formats, field, symmetry;
-  lineStream >> head >> type >> formats >> field >> symmetry;
-  taco_uassert(head=="%%MatrixMarket") << "Unknown header of MatrixMarket";
-  // type = [matrix tensor]
-  taco_uassert((type=="matrix") || (type=="tensor"))
-                                       << "Unknown type of MatrixMarket";
-  // formats = [coordinate array]
-  // field = [real integer complex pattern]
-  taco_uassert(field=="real")          << "MatrixMarket field not available";
-  // symmetry = [general symmetric skew-symmetric Hermitian]
-  taco_uassert((symmetry=="general") || (symmetry=="symmetric"))
-                                       << "MatrixMarket symmetry not available";
-
-  bool symm = (symmetry=="symmetric");
-
-  TensorBase tensor;
-  if (formats=="coordinate")
-    tensor = readSparse(stream,format,symm);
-  else if (formats=="array")
-    tensor = readDense(stream,format,symm);
-  else
-    taco_uerror << "MatrixMarket format not available";
-
-  if (pack) {
-    tensor.pack();
-  }
+TensorBase readMTX(std::string filename, const ModeFormat& modetype,
+                   Datatype ctype, bool pack) {
+  return dispatchReadMTX(filename, modetype, ctype, pack);
+}
 
-  return tensor;
+TensorBase readMTX(std::string filename, const Format& format, Datatype ctype,
+                   bool pack) {
+  return dispatchReadMTX(filename, format, ctype, pack);
 }
 
-TensorBase readMTX(std::istream& stream, const ModeFormat& modetype, bool pack) {
-  return dispatchReadMTX(stream, modetype, pack);
+enum class MTXField {Real, Integer, Complex, Pattern};
+
+static string toLower(string str) {
+  std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+  return str;
 }
 
-TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
-  return dispatchReadMTX(stream, format, pack);
+static int getNumValues(MTXField field) {
+  switch (field) {
+    case MTXField::Pattern: return 0;
+    case MTXField::Complex: return 2;
+    default:                return 1;
+  }
 }
 
-template <typename T>
-TensorBase dispatchReadSparse(std::istream& stream, const T& format, 
-                              bool symm) {
+/// Skips the comments that follow the banner and returns the dimensions on the
+/// size line.
+static vector<int> readSizeLine(std::istream& stream) {
   string line;
   std::getline(stream,line);
 
@@ -104,130 +87,233 @@ TensorBase dispatchReadSparse(std::istream& stream, const T& format,
     taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
     dimensions.push_back(static_cast<int>(dimension));
   }
+  return dimensions;
+}
+
+template <typename T>
+static TensorBase readSparse(std::istream& stream, const T& format,
+                             Datatype ctype, MTXField field,
+                             MatrixSymmetry symmetry) {
+  vector<int> dimensions = readSizeLine(stream);
   size_t nnz = dimensions[dimensions.size()-1];
   dimensions.pop_back();
-  if (symm)
+  if (symmetry != MatrixSymmetry::General)
     taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
 
-  vector<int> coordinates;
-  vector<double> values;
-  coordinates.reserve(nnz*dimensions.size());
-  values.reserve(nnz);
-
-  while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
-    for (size_t i=0; i < dimensions.size(); i++) {
-      long index = strtol(linePtr, &linePtr, 10);
-      taco_uassert(index <= INT_MAX) << "Index exceeds INT_MAX";
-      coordinates.push_back(static_cast<int>(index));
-    }
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
+  vector<CoordinateBlock> blocks = parseCoordinates(stream,
+                                                    (int)dimensions.size(),
+                                                    getNumValues(field),
+                                                    field == MTXField::Integer);
+  size_t numValues = 0;
+  for (auto& block : blocks) {
+    numValues += block.size();
   }
-
-  // Create matrix
-  TensorBase tensor(type<double>(), dimensions, format);
-  if (symm)
+  taco_uassert(numValues == nnz) << "Expected " << nnz << " components but "
+                                 << "read " << numValues;
+
+  // Create matrix.  Matrices with a symmetric format store the lower triangle
+  // that symmetric files hold as it is.
+  TensorBase tensor(ctype, dimensions, format);
+  if (tensor.getFormat().isSymmetric()) {
+    taco_uassert(symmetry == MatrixSymmetry::General ||
+                 symmetry == MatrixSymmetry::Symmetric)
+        << "Only symmetric matrices can be read into a symmetric format";
+    symmetry = MatrixSymmetry::General;
+  }
+  if (symmetry != MatrixSymmetry::General)
     tensor.reserve(2*nnz);
   else
     tensor.reserve(nnz);
 
   // Insert coordinates
-  std::vector<int> coord;
-  for (size_t i = 0; i < nnz; i++) {
-    coord.clear();
-    for (size_t mode = 0; mode < dimensions.size(); mode++) {
-      coord.push_back(coordinates[i*dimensions.size() + mode] -1);
-    }
-    tensor.insert(coord, values[i]);
-    if (symm && coord.front() != coord.back()) {
-      std::reverse(coord.begin(), coord.end());
-      tensor.insert(coord, values[i]);
-    }
+  for (auto& block : blocks) {
+    insertBlock(tensor, block, getNumValues(field), symmetry);
+    block = CoordinateBlock();
   }
 
   return tensor;
 }
 
-TensorBase readSparse(std::istream& stream, const ModeFormat& modetype, 
-                      bool symm) {
-  return dispatchReadSparse(stream, modetype, symm);
-}
-
-TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
-  return dispatchReadSparse(stream, format, symm);
-}
-
 template <typename T>
-TensorBase dispatchReadDense(std::istream& stream, const T& format, bool symm) {
-  string line;
-  std::getline(stream,line);
-
-  // Skip comments at the top of the file
-  string token;
-  do {
-    std::stringstream lineStream(line);
-    lineStream >> token;
-    if (token[0] != '%') {
-      break;
-    }
-  } while (std::getline(stream, line));
-
-  // The first non-comment line is the header with dimension sizes
-  vector<int> dimensions;
-  char* linePtr = (char*)line.data();
-  while (size_t dimension = strtoul(linePtr, &linePtr, 10)) {
-    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
-    dimensions.push_back(static_cast<int>(dimension));
-  }
-  if (symm)
+static TensorBase readDense(std::istream& stream, const T& format,
+                            Datatype ctype, MTXField field,
+                            MatrixSymmetry symmetry) {
+  taco_uassert(field != MTXField::Pattern)
+      << "MatrixMarket array files cannot have the pattern field";
+  vector<int> dimensions = readSizeLine(stream);
+  if (symmetry != MatrixSymmetry::General)
     taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
 
-  vector<double> values;
+  const int numValues = getNumValues(field);
+  CoordinateBlock values;
+  const bool integers = (field == MTXField::Integer);
+  for (auto& block : parseCoordinates(stream, 0, numValues, integers)) {
+    values.values.insert(values.values.end(), block.values.begin(),
+                         block.values.end());
+    values.integers.insert(values.integers.end(), block.integers.begin(),
+                           block.integers.end());
+    values.numComponents += block.size();
+  }
   auto size = std::accumulate(begin(dimensions), end(dimensions),
                               1, std::multiplies<double>());
-  values.reserve(size);
+  taco_uassert(values.size() >= (size_t)size)
+      << "Expected " << size << " values but read " << values.size();
+  if (integers) {
+    values.integers.resize(size * numValues);
+  }
+  else {
+    values.values.resize(size * numValues);
+  }
+  values.numComponents = size;
 
-  while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
+  // Values are stored in column-major order
+  values.coordinates.resize(dimensions.size());
+  for (auto& coordinates : values.coordinates) {
+    coordinates.reserve(size);
+  }
+  for (auto n = 0; n<size; n++) {
+    auto index=n;
+    for (size_t mode = 0; mode < dimensions.size()-1; mode++) {
+      values.coordinates[mode].push_back(index%dimensions[mode]);
+      index=index/dimensions[mode];
+    }
+    values.coordinates.back().push_back(index);
   }
 
   // Create matrix
-  TensorBase tensor(type<double>(), dimensions, format);
-  if (symm)
+  TensorBase tensor(ctype, dimensions, format);
+  taco_uassert(!tensor.getFormat().isSymmetric())
+      << "MatrixMarket array files cannot be read into a symmetric format";
+  if (symmetry != MatrixSymmetry::General)
     tensor.reserve(2*size);
   else
     tensor.reserve(size);
+  insertBlock(tensor, values, numValues, symmetry);
 
-  // Insert coordinates
-  std::vector<int> coord;
-  for (auto n = 0; n<size; n++) {
-    coord.clear();
-    auto index=n;
-    for (size_t mode = 0; mode < dimensions.size()-1; mode++) {
-      coord.push_back(index%dimensions[mode]);
-      index=index/dimensions[mode];
-    }
-    coord.push_back(index);
-    tensor.insert(coord, values[n]);
-    if (symm && coord.front() != coord.back()) {
-      std::reverse(coord.begin(), coord.end());
-      tensor.insert(coord, values[n]);
-    }
+  return tensor;
+}
+
+template <typename T>
+TensorBase dispatchReadMTX(std::istream& stream, const T& format,
+                           Datatype ctype, bool pack) {
+  string line;
+  if (!std::getline(stream, line)) {
+    return TensorBase();
+  }
+
+  // Read Header
+  std::stringstream lineStream(line);
+  string head, type, formats, field, symmetry;
+  lineStream >> head >> type >> formats >> field >> symmetry;
+  taco_uassert(head=="%%MatrixMarket") << "Unknown header of MatrixMarket";
+  // type = [matrix tensor]
+  taco_uassert((type=="matrix") || (type=="tensor"))
+                                       << "Unknown type of MatrixMarket";
+  // formats = [coordinate array]
+  // field = [real integer complex pattern]
+  field = toLower(field);
+  MTXField mtxField = MTXField::Real;
+  Datatype defaultType;
+  if (field == "real") {
+    mtxField = MTXField::Real;
+    defaultType = Float64;
+  }
+  else if (field == "integer") {
+    mtxField = MTXField::Integer;
+    defaultType = Int64;
+  }
+  else if (field == "complex") {
+    mtxField = MTXField::Complex;
+    defaultType = Complex128;
+  }
+  else if (field == "pattern") {
+    // Pattern files have no values, so the one byte of a bool is enough
+    mtxField = MTXField::Pattern;
+    defaultType = Bool;
+  }
+  else {
+    taco_uerror << "MatrixMarket field not available";
+  }
+  // symmetry = [general symmetric skew-symmetric Hermitian]
+  symmetry = toLower(symmetry);
+  MatrixSymmetry mtxSymmetry = MatrixSymmetry::General;
+  if (symmetry == "general") {
+    mtxSymmetry = MatrixSymmetry::General;
+  }
+  else if (symmetry == "symmetric") {
+    mtxSymmetry = MatrixSymmetry::Symmetric;
+  }
+  else if (symmetry == "skew-symmetric") {
+    mtxSymmetry = MatrixSymmetry::SkewSymmetric;
+  }
+  else if (symmetry == "hermitian") {
+    mtxSymmetry = MatrixSymmetry::Hermitian;
+  }
+  else {
+    taco_uerror << "MatrixMarket symmetry not available";
+  }
+
+  if (ctype == Datatype()) {
+    ctype = defaultType;
+  }
+  taco_uassert(mtxField != MTXField::Complex || ctype.isComplex())
+      << "Cannot read complex values into a " << ctype << " tensor";
+
+  TensorBase tensor;
+  if (formats=="coordinate")
+    tensor = readSparse(stream, format, ctype, mtxField, mtxSymmetry);
+  else if (formats=="array")
+    tensor = readDense(stream, format, ctype, mtxField, mtxSymmetry);
+  else
+    taco_uerror << "MatrixMarket format not available";
+
+  if (pack) {
+    tensor.pack();
   }
 
   return tensor;
 }
 
+TensorBase readMTX(std::istream& stream, const ModeFormat& modetype, bool pack) {
+  return dispatchReadMTX(stream, modetype, Datatype(), pack);
+}
+
+TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
+  return dispatchReadMTX(stream, format, Datatype(), pack);
+}
+
+TensorBase readMTX(std::istream& stream, const ModeFormat& modetype,
+                   Datatype ctype, bool pack) {
+  return dispatchReadMTX(stream, modetype, ctype, pack);
+}
+
+TensorBase readMTX(std::istream& stream, const Format& format, Datatype ctype,
+                   bool pack) {
+  return dispatchReadMTX(stream, format, ctype, pack);
+}
+
+static MatrixSymmetry getSymmetry(bool symm) {
+  return symm ? MatrixSymmetry::Symmetric : MatrixSymmetry::General;
+}
+
+TensorBase readSparse(std::istream& stream, const ModeFormat& modetype, 
+                      bool symm) {
+  return readSparse(stream, modetype, Float64, MTXField::Real,
+                    getSymmetry(symm));
+}
+
+TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
+  return readSparse(stream, format, Float64, MTXField::Real, getSymmetry(symm));
+}
+
 TensorBase readDense(std::istream& stream, const ModeFormat& modetype, 
                      bool symm) {
-  return dispatchReadDense(stream, modetype, symm);
+  return readDense(stream, modetype, Float64, MTXField::Real,
+                   getSymmetry(symm));
 }
 
 TensorBase readDense(std::istream& stream, const Format& format, bool symm) {
-  return dispatchReadDense(stream, format, symm);
+  return readDense(stream, format, Float64, MTXField::Real, getSymmetry(symm));
 }
 
 void writeMTX(std::string filename, const TensorBase& tensor) {
@@ -238,56 +324,59 @@ void writeMTX(std::string filename, const TensorBase& tensor) {
 }
 
 void writeMTX(std::ostream& stream, const TensorBase& tensor) {
+  taco_uassert(!isDense(tensor.getFormat()) ||
+               !tensor.getFormat().isSymmetric())
+      << "Dense symmetric matrices cannot be written to MatrixMarket files";
   if (isDense(tensor.getFormat()))
     writeDense(stream, tensor);
   else
     writeSparse(stream, tensor);
 }
 
+static void writeBanner(std::ostream& stream, const TensorBase& tensor,
+                        std::string format) {
+  const Datatype& ctype = tensor.getComponentType();
+  string field = ctype.isComplex() ? "complex"
+               : ctype.isFloat()   ? "real"
+               :                     "integer";
+  stream << "%%MatrixMarket " << (tensor.getOrder() == 2 ? "matrix" : "tensor")
+         << " " << format << " " << field << " "
+         << (tensor.getFormat().isSymmetric() ? "symmetric" : "general")
+         << std::endl;
+}
+
 template<typename T>
-static void writeSparseTyped(std::ostream& stream, const TensorBase& tensor) {
-  if(tensor.getOrder() == 2)
-    stream << "%%MatrixMarket matrix coordinate real general" << std::endl;
-  else
-    stream << "%%MatrixMarket tensor coordinate real general" << std::endl;
-  stream << "%"                                             << std::endl;
-  stream << util::join(tensor.getDimensions(), " ") << " ";
-  stream << tensor.getStorage().getIndex().getSize() << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
-    }
-    stream << value.second << endl;
-  }
+static void appendValue(std::string& buffer, T value) {
+  formatValue(buffer, value);
 }
 
 template<typename T>
-static void writeSparseCharTyped(std::ostream& stream, const TensorBase& tensor) {
-  if(tensor.getOrder() == 2)
-    stream << "%%MatrixMarket matrix coordinate real general" << std::endl;
-  else
-    stream << "%%MatrixMarket tensor coordinate real general" << std::endl;
+static void appendValue(std::string& buffer, std::complex<T> value) {
+  formatDouble(buffer, value.real());
+  buffer += ' ';
+  formatDouble(buffer, value.imag());
+}
+
+template<typename T>
+static void writeSparseTyped(std::ostream& stream, const TensorBase& tensor) {
+  writeBanner(stream, tensor, "coordinate");
   stream << "%"                                             << std::endl;
   stream << util::join(tensor.getDimensions(), " ") << " ";
   stream << tensor.getStorage().getIndex().getSize() << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
-    }
-    stream << static_cast<int>(value.second) << endl;
-  }
+  writeComponents<T>(stream, tensor, true, [](std::string& buffer, T value) {
+    appendValue(buffer, value);
+  });
 }
 
-
 void writeSparse(std::ostream& stream, const TensorBase& tensor) {
   switch(tensor.getComponentType().getKind()) {
     case Datatype::Bool: writeSparseTyped<bool>(stream, tensor); break;
-    case Datatype::UInt8: writeSparseCharTyped<uint8_t>(stream, tensor); break;
+    case Datatype::UInt8: writeSparseTyped<uint8_t>(stream, tensor); break;
     case Datatype::UInt16: writeSparseTyped<uint16_t>(stream, tensor); break;
     case Datatype::UInt32: writeSparseTyped<uint32_t>(stream, tensor); break;
     case Datatype::UInt64: writeSparseTyped<uint64_t>(stream, tensor); break;
     case Datatype::UInt128: writeSparseTyped<unsigned long long>(stream, tensor); break;
-    case Datatype::Int8: writeSparseCharTyped<int8_t>(stream, tensor); break;
+    case Datatype::Int8: writeSparseTyped<int8_t>(stream, tensor); break;
     case Datatype::Int16: writeSparseTyped<int16_t>(stream, tensor); break;
     case Datatype::Int32: writeSparseTyped<int32_t>(stream, tensor); break;
     case Datatype::Int64: writeSparseTyped<int64_t>(stream, tensor); break;
@@ -304,40 +393,24 @@ void writeSparse(std::ostream& stream, const TensorBase& tensor) {
 
 template<typename T>
 void writeDenseTyped(std::ostream& stream, const TensorBase& tensor) {
-  if(tensor.getOrder() == 2)
-    stream << "%%MatrixMarket matrix array real general" << std::endl;
-  else
-    stream << "%%MatrixMarket tensor array real general" << std::endl;
-  stream << "%"                                        << std::endl;
-  stream << util::join(tensor.getDimensions(), " ") << " " << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    stream << value.second << endl;
-  }
-}
-
-template<typename T>
-void writeDenseCharTyped(std::ostream& stream, const TensorBase& tensor) {
-  if(tensor.getOrder() == 2)
-    stream << "%%MatrixMarket matrix array real general" << std::endl;
-  else
-    stream << "%%MatrixMarket tensor array real general" << std::endl;
+  writeBanner(stream, tensor, "array");
   stream << "%"                                        << std::endl;
   stream << util::join(tensor.getDimensions(), " ") << " " << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    stream << static_cast<int>(value.second) << endl;
-  }
+  writeComponents<T>(stream, tensor, false, [](std::string& buffer, T value) {
+    appendValue(buffer, value);
+  });
 }
 
 
 void writeDense(std::ostream& stream, const TensorBase& tensor) {
   switch(tensor.getComponentType().getKind()) {
     case Datatype::Bool: writeDenseTyped<bool>(stream, tensor); break;
-    case Datatype::UInt8: writeDenseCharTyped<uint8_t>(stream, tensor); break;
+    case Datatype::UInt8: writeDenseTyped<uint8_t>(stream, tensor); break;
     case Datatype::UInt16: writeDenseTyped<uint16_t>(stream, tensor); break;
     case Datatype::UInt32: writeDenseTyped<uint32_t>(stream, tensor); break;
     case Datatype::UInt64: writeDenseTyped<uint64_t>(stream, tensor); break;
     case Datatype::UInt128: writeDenseTyped<unsigned long long>(stream, tensor); break;
-    case Datatype::Int8: writeDenseCharTyped<int8_t>(stream, tensor); break;
+    case Datatype::Int8: writeDenseTyped<int8_t>(stream, tensor); break;
     case Datatype::Int16: writeDenseTyped<int16_t>(stream, tensor); break;
     case Datatype::Int32: writeDenseTyped<int32_t>(stream, tensor); break;
     case Datatype::Int64: writeDenseTyped<int64_t>(stream, tensor); break;
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <climits>
+#include <algorithm>
 
 #include "taco/tensor.h"
 #include "taco/error.h"
@@ -14,6 +15,7 @@
 #include "taco/util/files.h"
 #include "taco/util/collections.h"
 #include "taco/cuda.h"
+#include "storage/coordinate_writer.h"
 
 using namespace std;
 
@@ -259,13 +261,18 @@ void readIndices(std::istream &hbfile, int linesize, int indices[]){
 
 void writeIndices(std::ostream &hbfile, int indsize,
                   int indperline, int indices[]){
-  for (auto i = 1; i <= indsize; i++) {
-    hbfile << indices[i-1] + 1 << " ";
-    if (i%indperline==0)
-      hbfile << "\n";
-  }
-  if (indsize%indperline != 0)
-    hbfile << "\n";
+  const size_t numLines = indsize/indperline + (indsize%indperline != 0);
+  writeFormatted(hbfile, numLines,
+                 [&](size_t begin, size_t end, std::string& buffer) {
+    for (size_t line = begin; line < end; line++) {
+      const size_t lineEnd = std::min((size_t)indsize, (line+1) * indperline);
+      for (size_t i = line * indperline; i < lineEnd; i++) {
+        formatInteger(buffer, indices[i] + 1);
+        buffer += ' ';
+      }
+      buffer += '\n';
+    }
+  });
 }
 
 void readValues(std::istream &hbfile, int linesize, double values[]){
@@ -285,17 +292,19 @@ void readValues(std::istream &hbfile, int linesize, double values[]){
 template<typename T>
 void writeValues(std::ostream &hbfile, int valuesize,
                  int valperline, T values[]){
-  for (auto i = 1; i <= valuesize; i++) {
-    auto val = static_cast<double>(values[i-1]);
-    if (std::floor(val) == val)
-      hbfile << val << ".0 ";
-    else
-      hbfile << val << " ";
-    if (i%valperline==0)
-      hbfile << "\n";
-  }
-  if (valuesize%valperline != 0)
-    hbfile << "\n";
+  const size_t numLines = valuesize/valperline + (valuesize%valperline != 0);
+  writeFormatted(hbfile, numLines,
+                 [&](size_t begin, size_t end, std::string& buffer) {
+    for (size_t line = begin; line < end; line++) {
+      const size_t lineEnd = std::min((size_t)valuesize, (line+1) * valperline);
+      for (size_t i = line * valperline; i < lineEnd; i++) {
+        auto val = static_cast<double>(values[i]);
+        formatDouble(buffer, val);
+        buffer += (std::floor(val) == val) ? ".0 " : " ";
+      }
+      buffer += '\n';
+    }
+  });
 }
 
 // Useless for Taco
@@ -13,70 +13,66 @@
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/files.h"
+#include "storage/coordinate_parser.h"
+#include "storage/coordinate_writer.h"
 
 using namespace std;
 
 namespace taco {
 
 template <typename T>
-TensorBase dispatchReadTNS(std::string filename, const T& format, bool pack) {
+TensorBase dispatchReadTNS(std::string filename, const T& format,
+                           Datatype ctype, bool pack) {
   std::fstream file;
   util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readTNS(file, format, pack);
+  TensorBase tensor = readTNS(file, format, ctype, pack);
   file.close();
   return tensor;
 }
 
 TensorBase readTNS(std::string filename, const ModeFormat& modetype, bool pack) {
-  return dispatchReadTNS(filename, modetype, pack);
+  return dispatchReadTNS(filename, modetype, Float64, pack);
 }
 
 TensorBase readTNS(std::string filename, const Format& format, bool pack) {
-  return dispatchReadTNS(filename, format, pack);
+  return dispatchReadTNS(filename, format, Float64, pack);
 }
 
-template <typename T>
-TensorBase dispatchReadTNS(std::istream& stream, const T& format, bool pack) {
-  std::vector<int>    coordinates;
-  std::vector<double> values;
+TensorBase readTNS(std::string filename, const ModeFormat& modetype,
+                   Datatype ctype, bool pack) {
+  return dispatchReadTNS(filename, modetype, ctype, pack);
+}
+
+TensorBase readTNS(std::string filename, const Format& format, Datatype ctype,
+                   bool pack) {
+  return dispatchReadTNS(filename, format, ctype, pack);
+}
 
-  std::string line;
-  if (!std::getline(stream, line)) {
+template <typename T>
+TensorBase dispatchReadTNS(std::istream& stream, const T& format,
+                           Datatype ctype, bool pack) {
+  // Infer the tensor order from the first coordinate
+  vector<CoordinateBlock> blocks = parseCoordinates(stream, -1);
+  if (blocks.empty()) {
     return TensorBase();
   }
+  const size_t order = blocks[0].coordinates.size();
 
-  // Infer tensor order from the first coordinate
-  vector<string> toks = util::split(line, " ");
-  size_t order = toks.size()-1;
+  size_t nnz = 0;
   std::vector<int> dimensions(order);
-  std::vector<int> coordinate(order);
-
-  // Load data
-  do {
-    char* linePtr = (char*)line.data();
+  for (auto& block : blocks) {
+    nnz += block.size();
     for (size_t i = 0; i < order; i++) {
-      long idx = strtol(linePtr, &linePtr, 10);
-      taco_uassert(idx <= INT_MAX)<<"Coordinate in file is larger than INT_MAX";
-      coordinate[i] = (int)idx - 1;
-      dimensions[i] = std::max(dimensions[i], (int)idx);
+      dimensions[i] = std::max(dimensions[i], block.dimensions[i]);
     }
-    coordinates.insert(coordinates.end(), coordinate.begin(), coordinate.end());
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
-
-  } while (std::getline(stream, line));
+  }
 
   // Create tensor
-  const size_t nnz = values.size();
-  TensorBase tensor(type<double>(), dimensions, format);
+  TensorBase tensor(ctype, dimensions, format);
   tensor.reserve(nnz);
-
-  // Insert coordinates (TODO add and use bulk insertion)
-  for (size_t i = 0; i < nnz; i++) {
-    for (size_t j = 0; j < order; j++) {
-      coordinate[j] = coordinates[i*order + j];
-    }
-    tensor.insert(coordinate, values[i]);
+  for (auto& block : blocks) {
+    insertBlock(tensor, block, 1);
+    block = CoordinateBlock();
   }
 
   if (pack) {
@@ -87,11 +83,21 @@ TensorBase dispatchReadTNS(std::istream& stream, const T& format, bool pack) {
 }
 
 TensorBase readTNS(std::istream& stream, const ModeFormat& modetype, bool pack) {
-  return dispatchReadTNS(stream, modetype, pack);
+  return dispatchReadTNS(stream, modetype, Float64, pack);
 }
 
 TensorBase readTNS(std::istream& stream, const Format& format, bool pack) {
-  return dispatchReadTNS(stream, format, pack);
+  return dispatchReadTNS(stream, format, Float64, pack);
+}
+
+TensorBase readTNS(std::istream& stream, const ModeFormat& modetype,
+                   Datatype ctype, bool pack) {
+  return dispatchReadTNS(stream, modetype, ctype, pack);
+}
+
+TensorBase readTNS(std::istream& stream, const Format& format, Datatype ctype,
+                   bool pack) {
+  return dispatchReadTNS(stream, format, ctype, pack);
 }
 
 void writeTNS(std::string filename, const TensorBase& tensor) {
@@ -103,34 +109,20 @@ void writeTNS(std::string filename, const TensorBase& tensor) {
 
 template<typename T>
 static void writeTypedTNS(std::ostream& stream, const TensorBase& tensor) {
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
-    }
-    stream << value.second << endl;
-  }
+  writeComponents<T>(stream, tensor, true, [](std::string& buffer, T value) {
+    formatValue(buffer, value);
+  });
 }
 
-template<typename T>
-static void writeCharTNS(std::ostream& stream, const TensorBase& tensor) {
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
-    }
-    stream << static_cast<int>(value.second) << endl;
-  }
-}
-
-
 void writeTNS(std::ostream& stream, const TensorBase& tensor) {
   switch(tensor.getComponentType().getKind()) {
     case Datatype::Bool: writeTypedTNS<bool>(stream, tensor); break;
-    case Datatype::UInt8: writeCharTNS<uint8_t>(stream, tensor); break;
+    case Datatype::UInt8: writeTypedTNS<uint8_t>(stream, tensor); break;
     case Datatype::UInt16: writeTypedTNS<uint16_t>(stream, tensor); break;
     case Datatype::UInt32: writeTypedTNS<uint32_t>(stream, tensor); break;
     case Datatype::UInt64: writeTypedTNS<uint64_t>(stream, tensor); break;
     case Datatype::UInt128: writeTypedTNS<unsigned long long>(stream, tensor); break;
-    case Datatype::Int8: writeCharTNS<int8_t>(stream, tensor); break;
+    case Datatype::Int8: writeTypedTNS<int8_t>(stream, tensor); break;
     case Datatype::Int16: writeTypedTNS<int16_t>(stream, tensor); break;
     case Datatype::Int32: writeTypedTNS<int32_t>(stream, tensor); break;
     case Datatype::Int64: writeTypedTNS<int64_t>(stream, tensor); break;
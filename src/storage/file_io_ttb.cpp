@@ -0,0 +1,575 @@
+#include "taco/storage/file_io_ttb.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/index_notation/index_notation_nodes.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/util/strings.h"
+#include "taco/util/files.h"
+
+using namespace std;
+
+namespace taco {
+
+// A ttb file consists of a header, a record per storage level, a record per
+// array, and the arrays, each aligned to `alignment` bytes.  The index arrays
+// of level l are stored with level l and the values with level `order`.
+static const char ttbMagic[8] = {'T', 'A', 'C', 'O', 'T', 'T', 'B', '\0'};
+static const uint32_t ttbVersion = 1;
+static const uint32_t ttbByteOrder = 0x01020304;
+static const uint64_t alignment = 64;
+static const uint64_t ttbSymmetric = 1;
+
+namespace {
+struct Header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t componentType;
+  uint32_t order;
+  uint64_t numArrays;
+  uint8_t  fill[16];
+  uint64_t flags;
+  uint64_t reserved;
+};
+
+struct LevelRecord {
+  int32_t  dimension;
+  int32_t  mode;
+  int32_t  modeFormat;
+  uint32_t properties;
+  int32_t  packSize;   // modes in the pack that starts at this level, or 0
+  int32_t  reserved;
+};
+
+struct ArrayRecord {
+  uint32_t type;
+  uint32_t level;
+  uint64_t size;
+  uint64_t offset;
+};
+
+struct Layout {
+  Header header;
+  vector<LevelRecord> levels;
+  vector<ArrayRecord> arrays;
+};
+}
+
+static_assert(sizeof(Header) == 64, "ttb header must be 64 bytes");
+static_assert(sizeof(LevelRecord) == 24, "ttb level record must be 24 bytes");
+static_assert(sizeof(ArrayRecord) == 24, "ttb array record must be 24 bytes");
+
+enum TTBModeFormat {TTB_DENSE, TTB_COMPRESSED, TTB_SINGLETON};
+enum TTBProperty {TTB_ORDERED = 1, TTB_UNIQUE = 2, TTB_ZEROLESS = 4};
+
+static inline uint64_t alignOffset(uint64_t offset) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+static LevelRecord encodeLevel(const ModeFormat& modeFormat) {
+  LevelRecord level;
+  memset(&level, 0, sizeof(level));
+  if (modeFormat.getName() == ModeFormat::Dense.getName()) {
+    level.modeFormat = TTB_DENSE;
+  }
+  else if (modeFormat.getName() == ModeFormat::Compressed.getName()) {
+    level.modeFormat = TTB_COMPRESSED;
+  }
+  else if (modeFormat.getName() == ModeFormat::Singleton.getName()) {
+    level.modeFormat = TTB_SINGLETON;
+  }
+  else {
+    taco_uerror << "The ttb format does not support " << modeFormat.getName()
+                << " modes";
+  }
+  level.properties = (modeFormat.isOrdered()  ? TTB_ORDERED  : 0) |
+                     (modeFormat.isUnique()   ? TTB_UNIQUE   : 0) |
+                     (modeFormat.isZeroless() ? TTB_ZEROLESS : 0);
+  return level;
+}
+
+static ModeFormat decodeModeFormat(const LevelRecord& level) {
+  ModeFormat modeFormat;
+  switch (level.modeFormat) {
+    case TTB_DENSE:
+      modeFormat = ModeFormat::Dense;
+      break;
+    case TTB_COMPRESSED:
+      modeFormat = ModeFormat::Compressed;
+      break;
+    case TTB_SINGLETON:
+      modeFormat = ModeFormat::Singleton;
+      break;
+    default:
+      taco_uerror << "Unknown mode format in ttb file";
+  }
+  return modeFormat({
+    (level.properties & TTB_ORDERED)  ? ModeFormat::ORDERED  : ModeFormat::NOT_ORDERED,
+    (level.properties & TTB_UNIQUE)   ? ModeFormat::UNIQUE   : ModeFormat::NOT_UNIQUE,
+    (level.properties & TTB_ZEROLESS) ? ModeFormat::ZEROLESS : ModeFormat::NOT_ZEROLESS
+  });
+}
+
+static Literal decodeFill(Datatype type, const uint8_t* bytes) {
+  switch (type.getKind()) {
+    case Datatype::Bool: return Literal(*(const bool*)bytes);
+    case Datatype::UInt8: return Literal(*(const uint8_t*)bytes);
+    case Datatype::UInt16: return Literal(*(const uint16_t*)bytes);
+    case Datatype::UInt32: return Literal(*(const uint32_t*)bytes);
+    case Datatype::UInt64: return Literal(*(const uint64_t*)bytes);
+    case Datatype::Int8: return Literal(*(const int8_t*)bytes);
+    case Datatype::Int16: return Literal(*(const int16_t*)bytes);
+    case Datatype::Int32: return Literal(*(const int32_t*)bytes);
+    case Datatype::Int64: return Literal(*(const int64_t*)bytes);
+    case Datatype::Float32: return Literal(*(const float*)bytes);
+    case Datatype::Float64: return Literal(*(const double*)bytes);
+    case Datatype::Complex64:
+      return Literal(*(const std::complex<float>*)bytes);
+    case Datatype::Complex128:
+      return Literal(*(const std::complex<double>*)bytes);
+    default:
+      taco_uerror << "The ttb format does not support " << type << " tensors";
+  }
+  return Literal();
+}
+
+static Format decodeFormat(const Layout& layout) {
+  vector<ModeFormatPack> modeFormatPacks;
+  vector<int> modeOrdering;
+  vector<ModeFormat> pack;
+  int packRemaining = 0;
+  for (auto& level : layout.levels) {
+    if (packRemaining == 0) {
+      taco_uassert(level.packSize > 0) << "Corrupt ttb file";
+      packRemaining = level.packSize;
+    }
+    pack.push_back(decodeModeFormat(level));
+    modeOrdering.push_back(level.mode);
+    if (--packRemaining == 0) {
+      modeFormatPacks.push_back(ModeFormatPack(pack));
+      pack.clear();
+    }
+  }
+  taco_uassert(packRemaining == 0) << "Corrupt ttb file";
+  Format format(modeFormatPacks, modeOrdering);
+  format.setSymmetric((layout.header.flags & ttbSymmetric) != 0);
+  return format;
+}
+
+/// Reads the layout of a ttb file from `read`, which copies the next bytes of
+/// the file to a buffer.
+template <typename Read>
+static Layout readLayout(Read read) {
+  Layout layout;
+  read(&layout.header, sizeof(Header));
+  const Header& header = layout.header;
+  taco_uassert(memcmp(header.magic, ttbMagic, sizeof(ttbMagic)) == 0)
+      << "Not a ttb file";
+  taco_uassert(header.byteOrder == ttbByteOrder)
+      << "The ttb file was written on a machine with a different byte order";
+  taco_uassert(header.version == ttbVersion)
+      << "Unsupported ttb version " << header.version;
+  taco_uassert(header.order < 1024 && header.numArrays < (1 << 20))
+      << "Corrupt ttb file";
+
+  layout.levels.resize(header.order);
+  read(layout.levels.data(), header.order * sizeof(LevelRecord));
+  layout.arrays.resize(header.numArrays);
+  read(layout.arrays.data(), header.numArrays * sizeof(ArrayRecord));
+  for (auto& level : layout.levels) {
+    taco_uassert(level.mode >= 0 && level.mode < (int)header.order)
+        << "Corrupt ttb file";
+  }
+  for (auto& array : layout.arrays) {
+    taco_uassert(array.level <= header.order) << "Corrupt ttb file";
+  }
+  return layout;
+}
+
+static TensorBase makeTensor(const Layout& layout, const vector<Array>& arrays) {
+  const int order = layout.header.order;
+  const Format format = decodeFormat(layout);
+  const Datatype ctype((Datatype::Kind)layout.header.componentType);
+
+  vector<int> dimensions(order);
+  for (auto& level : layout.levels) {
+    dimensions[level.mode] = level.dimension;
+  }
+
+  vector<vector<Array>> levelArrays(order);
+  Array values;
+  for (size_t i = 0; i < arrays.size(); i++) {
+    if ((int)layout.arrays[i].level == order) {
+      values = arrays[i];
+    }
+    else {
+      levelArrays[layout.arrays[i].level].push_back(arrays[i]);
+    }
+  }
+  vector<ModeIndex> modeIndices;
+  for (auto& indexArrays : levelArrays) {
+    modeIndices.push_back(ModeIndex(indexArrays));
+  }
+
+  TensorBase tensor(ctype, dimensions, format);
+  TensorStorage storage = tensor.getStorage();
+  storage.setIndex(Index(format, modeIndices));
+  storage.setValues(values);
+  tensor.setStorage(storage);
+  tensor.setFillValue(decodeFill(ctype, layout.header.fill));
+  return tensor;
+}
+
+template<typename T>
+static void insertTyped(TensorBase& result, const TensorBase& tensor) {
+  // Symmetric matrices are expanded to both triangles for other formats
+  const bool expand = tensor.getFormat().isSymmetric() &&
+                      !result.getFormat().isSymmetric();
+  for (auto& value : iterate<T>(tensor)) {
+    result.insert(value.first.toVector(), value.second);
+    if (expand && value.first[0] != value.first[1]) {
+      result.insert({value.first[1], value.first[0]}, value.second);
+    }
+  }
+}
+
+static TensorBase convert(const TensorBase& tensor, const Format& format,
+                          bool pack) {
+  if (tensor.getFormat() == format) {
+    return tensor;
+  }
+  TensorBase result(tensor.getComponentType(), tensor.getDimensions(), format);
+  result.setFillValue(tensor.getFillValue());
+  switch(tensor.getComponentType().getKind()) {
+    case Datatype::Bool: insertTyped<bool>(result, tensor); break;
+    case Datatype::UInt8: insertTyped<uint8_t>(result, tensor); break;
+    case Datatype::UInt16: insertTyped<uint16_t>(result, tensor); break;
+    case Datatype::UInt32: insertTyped<uint32_t>(result, tensor); break;
+    case Datatype::UInt64: insertTyped<uint64_t>(result, tensor); break;
+    case Datatype::Int8: insertTyped<int8_t>(result, tensor); break;
+    case Datatype::Int16: insertTyped<int16_t>(result, tensor); break;
+    case Datatype::Int32: insertTyped<int32_t>(result, tensor); break;
+    case Datatype::Int64: insertTyped<int64_t>(result, tensor); break;
+    case Datatype::Float32: insertTyped<float>(result, tensor); break;
+    case Datatype::Float64: insertTyped<double>(result, tensor); break;
+    case Datatype::Complex64: insertTyped<std::complex<float>>(result, tensor); break;
+    case Datatype::Complex128: insertTyped<std::complex<double>>(result, tensor); break;
+    default:
+      taco_uerror << "The ttb format does not support "
+                  << tensor.getComponentType() << " tensors";
+  }
+  if (pack) {
+    result.pack();
+  }
+  return result;
+}
+
+static Format makeFormat(const ModeFormat& modetype, int order) {
+  return Format(vector<ModeFormatPack>(order, ModeFormatPack(modetype)));
+}
+
+/// Make a tensor whose arrays are views of a mapped ttb image of `size` bytes.
+/// `mapping` owns the mapped memory.
+static TensorBase makeMappedTensor(shared_ptr<void> mapping, size_t size,
+                                   const string& name) {
+  const char* bytes = static_cast<const char*>(mapping.get());
+  size_t position = 0;
+  Layout layout = readLayout([&](void* buffer, size_t bufferSize) {
+    taco_uassert(position + bufferSize <= size) << "Truncated ttb " << name;
+    memcpy(buffer, bytes + position, bufferSize);
+    position += bufferSize;
+  });
+
+  vector<Array> arrays;
+  for (auto& record : layout.arrays) {
+    const Datatype type((Datatype::Kind)record.type);
+    const uint64_t arraySize = record.size * type.getNumBytes();
+    taco_uassert(record.offset % alignment == 0 &&
+                 record.offset + arraySize <= size) << "Truncated ttb " << name;
+    arrays.push_back(Array(type, static_cast<char*>(mapping.get()) +
+                                 record.offset, record.size, mapping));
+  }
+  return makeTensor(layout, arrays);
+}
+
+/// Map the ttb image in an open file or shared memory object privately, so
+/// that the arrays can be written to without modifying it.  Closes `fd`.
+static TensorBase mapTTB(int fd, const string& name) {
+  struct stat fileStat;
+  int err = fstat(fd, &fileStat);
+  const size_t size = (err == 0) ? (size_t)fileStat.st_size : 0;
+  if (size < sizeof(Header)) {
+    close(fd);
+    taco_uerror << name << " is not a ttb tensor";
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  taco_uassert(data != MAP_FAILED) << "Error mapping " << name;
+  shared_ptr<void> mapping(data, [size](void* ptr) {
+    munmap(ptr, size);
+  });
+  return makeMappedTensor(mapping, size, name);
+}
+
+TensorBase readTTB(std::string filename) {
+  int fd = open(util::sanitizePath(filename).c_str(), O_RDONLY);
+  taco_uassert(fd >= 0) << "Error opening file: " << filename;
+  return mapTTB(fd, filename);
+}
+
+TensorBase readTTB(std::string filename, const ModeFormat& modetype,
+                   bool pack) {
+  TensorBase tensor = readTTB(filename);
+  return convert(tensor, makeFormat(modetype, tensor.getOrder()), pack);
+}
+
+TensorBase readTTB(std::string filename, const Format& format, bool pack) {
+  return convert(readTTB(filename), format, pack);
+}
+
+static TensorBase readTTB(std::istream& stream) {
+  uint64_t position = 0;
+  auto read = [&](void* buffer, size_t size) {
+    stream.read(static_cast<char*>(buffer), size);
+    taco_uassert((size_t)stream.gcount() == size) << "Truncated ttb file";
+    position += size;
+  };
+  Layout layout = readLayout(read);
+
+  // Arrays are stored in the order of their records
+  vector<Array> arrays;
+  for (auto& record : layout.arrays) {
+    taco_uassert(record.offset >= position) << "Corrupt ttb file";
+    stream.ignore(record.offset - position);
+    position = record.offset;
+    const Datatype type((Datatype::Kind)record.type);
+    Array array = makeArray(type, record.size);
+    read(array.getData(), record.size * type.getNumBytes());
+    arrays.push_back(array);
+  }
+  return makeTensor(layout, arrays);
+}
+
+TensorBase readTTB(std::istream& stream, const ModeFormat& modetype,
+                   bool pack) {
+  TensorBase tensor = readTTB(stream);
+  return convert(tensor, makeFormat(modetype, tensor.getOrder()), pack);
+}
+
+TensorBase readTTB(std::istream& stream, const Format& format, bool pack) {
+  return convert(readTTB(stream), format, pack);
+}
+
+void writeTTB(std::string filename, const TensorBase& tensor) {
+  std::fstream file;
+  util::openStream(file, filename, fstream::out | fstream::binary);
+  writeTTB(file, tensor);
+  file.close();
+}
+
+/// Lay out a packed tensor as a ttb image, and collect the data of its arrays
+/// in the order of their records.
+static Layout makeLayout(const TensorBase& tensor, vector<const void*>* data) {
+  TensorStorage storage = tensor.getStorage();
+  const Format& format = tensor.getFormat();
+  Index index = storage.getIndex();
+  const int order = tensor.getOrder();
+
+  Layout layout;
+  Header& header = layout.header;
+  memset(&header, 0, sizeof(Header));
+  memcpy(header.magic, ttbMagic, sizeof(ttbMagic));
+  header.version = ttbVersion;
+  header.byteOrder = ttbByteOrder;
+  header.componentType = tensor.getComponentType().getKind();
+  header.order = order;
+  header.flags = format.isSymmetric() ? ttbSymmetric : 0;
+  TypedComponentVal fill = storage.getFillValue();
+  memcpy(header.fill, &fill.get(), tensor.getComponentType().getNumBytes());
+
+  const vector<ModeFormat> modeFormats = format.getModeFormats();
+  for (int level = 0; level < order; level++) {
+    LevelRecord record = encodeLevel(modeFormats[level]);
+    record.mode = format.getModeOrdering()[level];
+    record.dimension = tensor.getDimension(record.mode);
+    layout.levels.push_back(record);
+  }
+  int level = 0;
+  for (auto& pack : format.getModeFormatPacks()) {
+    layout.levels[level].packSize = pack.getModeFormats().size();
+    level += pack.getModeFormats().size();
+  }
+
+  for (int level = 0; level < order; level++) {
+    ModeIndex modeIndex = index.getModeIndex(level);
+    for (int i = 0; i < modeIndex.numIndexArrays(); i++) {
+      const Array& array = modeIndex.getIndexArray(i);
+      layout.arrays.push_back({(uint32_t)array.getType().getKind(),
+                               (uint32_t)level, array.getSize(), 0});
+      data->push_back(array.getData());
+    }
+  }
+  const Array& values = storage.getValues();
+  layout.arrays.push_back({(uint32_t)values.getType().getKind(),
+                           (uint32_t)order, index.getSize(), 0});
+  data->push_back(values.getData());
+  header.numArrays = layout.arrays.size();
+
+  uint64_t offset = sizeof(Header) + order * sizeof(LevelRecord) +
+                    layout.arrays.size() * sizeof(ArrayRecord);
+  for (auto& array : layout.arrays) {
+    array.offset = alignOffset(offset);
+    offset = array.offset +
+             array.size * Datatype((Datatype::Kind)array.type).getNumBytes();
+  }
+  return layout;
+}
+
+/// Returns the size in bytes of a ttb image.
+static uint64_t getImageSize(const Layout& layout) {
+  uint64_t size = sizeof(Header) + layout.levels.size() * sizeof(LevelRecord) +
+                  layout.arrays.size() * sizeof(ArrayRecord);
+  for (auto& array : layout.arrays) {
+    size = array.offset +
+           array.size * Datatype((Datatype::Kind)array.type).getNumBytes();
+  }
+  return size;
+}
+
+void writeTTB(std::ostream& stream, const TensorBase& tensor) {
+  vector<const void*> data;
+  Layout layout = makeLayout(tensor, &data);
+  const Header& header = layout.header;
+  const int order = tensor.getOrder();
+
+  stream.write((const char*)&header, sizeof(Header));
+  stream.write((const char*)layout.levels.data(),
+               layout.levels.size() * sizeof(LevelRecord));
+  stream.write((const char*)layout.arrays.data(),
+               layout.arrays.size() * sizeof(ArrayRecord));
+  uint64_t offset = sizeof(Header) + order * sizeof(LevelRecord) +
+                    layout.arrays.size() * sizeof(ArrayRecord);
+  const char padding[alignment] = {0};
+  for (size_t i = 0; i < layout.arrays.size(); i++) {
+    const ArrayRecord& array = layout.arrays[i];
+    stream.write(padding, array.offset - offset);
+    const uint64_t size =
+        array.size * Datatype((Datatype::Kind)array.type).getNumBytes();
+    stream.write((const char*)data[i], size);
+    offset = array.offset + size;
+  }
+  taco_uassert(stream.good()) << "Error writing ttb file";
+}
+
+/// Returns the name of the POSIX shared memory object of a shared tensor,
+/// which must start with a slash.
+static string getSharedMemoryName(const string& name) {
+  taco_uassert(!name.empty() && name.find('/', 1) == string::npos)
+      << "Invalid shared tensor name " << name
+      << ": names may only contain a slash as their first character";
+  return (name[0] == '/') ? name : "/" + name;
+}
+
+/// Returns the magic number at the start of a mapped shared tensor, which is
+/// zero until the tensor is complete.
+static std::atomic<uint64_t>* getMagic(void* mapped) {
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(Header::magic),
+                "The magic number must be stored as one atomic word");
+  return static_cast<std::atomic<uint64_t>*>(mapped);
+}
+
+void createSharedTensor(std::string name, const TensorBase& tensor) {
+  vector<const void*> data;
+  Layout layout = makeLayout(tensor, &data);
+  const uint64_t size = getImageSize(layout);
+
+  const string sharedName = getSharedMemoryName(name);
+  int fd = shm_open(sharedName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  taco_uassert(fd >= 0) << "Error creating shared tensor " << name << ": "
+                        << strerror(errno);
+  void* mapped = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int err = errno;
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    shm_unlink(sharedName.c_str());
+    taco_uerror << "Error creating shared tensor " << name << ": "
+                << strerror(err);
+  }
+
+  // The magic number is written last, so that processes that attach while the
+  // tensor is copied see that it is incomplete.  The memory of a new object is
+  // zeroed, which pads the arrays.
+  char* bytes = static_cast<char*>(mapped);
+  size_t position = sizeof(Header::magic);
+  memcpy(bytes + position, (const char*)&layout.header + position,
+         sizeof(Header) - position);
+  position = sizeof(Header);
+  memcpy(bytes + position, layout.levels.data(),
+         layout.levels.size() * sizeof(LevelRecord));
+  position += layout.levels.size() * sizeof(LevelRecord);
+  memcpy(bytes + position, layout.arrays.data(),
+         layout.arrays.size() * sizeof(ArrayRecord));
+  for (size_t i = 0; i < layout.arrays.size(); i++) {
+    const ArrayRecord& array = layout.arrays[i];
+    memcpy(bytes + array.offset, data[i],
+           array.size * Datatype((Datatype::Kind)array.type).getNumBytes());
+  }
+  // Publish the tensor with a single atomic store, which orders the writes
+  // above before it for processes that load the magic number with acquire
+  uint64_t magicWord;
+  memcpy(&magicWord, layout.header.magic, sizeof(magicWord));
+  getMagic(mapped)->store(magicWord, std::memory_order_release);
+  munmap(mapped, size);
+}
+
+TensorBase attachSharedTensor(std::string name) {
+  const string sharedName = getSharedMemoryName(name);
+  int fd = shm_open(sharedName.c_str(), O_RDONLY, 0);
+  taco_uassert(fd >= 0) << "Error attaching shared tensor " << name << ": "
+                        << strerror(errno);
+  // New objects are empty until they are resized, and zeroed after that until
+  // their magic number is stored
+  struct stat fileStat;
+  uint64_t magic = 0;
+  if (fstat(fd, &fileStat) == 0 && (size_t)fileStat.st_size >= sizeof(Header)) {
+    void* header = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+    if (header != MAP_FAILED) {
+      magic = getMagic(header)->load(std::memory_order_acquire);
+      munmap(header, sizeof(Header));
+    }
+  }
+  if (magic == 0) {
+    close(fd);
+    taco_uerror << "Shared tensor " << name << " is still being created";
+  }
+  return mapTTB(fd, "shared tensor " + name);
+}
+
+void removeSharedTensor(std::string name) {
+  const string sharedName = getSharedMemoryName(name);
+  taco_uassert(shm_unlink(sharedName.c_str()) == 0)
+      << "Error removing shared tensor " << name << ": " << strerror(errno);
+}
+
+}
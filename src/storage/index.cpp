@@ -59,6 +59,8 @@ size_t Index::getSize() const {
       size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
     } else if (modeType.getName() == Sparse.getName()) {
       size = modeIndex.getIndexArray(0).get(size).getAsIndex();
+    } else if (modeType.getName() == ModeFormat::Singleton.getName()) {
+      // Singleton levels store one coordinate per parent position
     } else {
       taco_not_supported_yet;
     }
@@ -0,0 +1,309 @@
+#include "taco/storage/numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#if TACO_LINUX
+#include <sys/syscall.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "taco/error.h"
+#include "taco/tensor.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+
+using namespace std;
+
+namespace taco {
+
+// Memory policies of the mbind system call (linux/mempolicy.h)
+static const int MPOL_PREFERRED_MODE  = 1;
+static const int MPOL_INTERLEAVE_MODE = 3;
+
+std::ostream& operator<<(std::ostream& os, MemoryPlacement placement) {
+  switch (placement) {
+    case MemoryPlacement::Default:
+      return os << "default";
+    case MemoryPlacement::FirstTouch:
+      return os << "first-touch";
+    case MemoryPlacement::Interleave:
+      return os << "interleave";
+    case MemoryPlacement::Replicate:
+      return os << "replicate";
+  }
+  return os;
+}
+
+/// Returns the largest node id in a node list such as "0-1,3", or -1 if the
+/// list cannot be parsed.
+static int parseMaxNode(const string& list) {
+  int maxNode = -1;
+  size_t begin = 0;
+  while (begin < list.size()) {
+    size_t end = list.find_first_of(",-", begin);
+    const string number = list.substr(begin, end - begin);
+    if (number.empty() || number.find_first_not_of("0123456789\n") !=
+                          string::npos) {
+      return -1;
+    }
+    maxNode = std::max(maxNode, atoi(number.c_str()));
+    begin = (end == string::npos) ? list.size() : end + 1;
+  }
+  return maxNode;
+}
+
+int getNumNumaNodes() {
+  static const int numNodes = []() {
+    ifstream file("/sys/devices/system/node/online");
+    string list;
+    if (!file || !getline(file, list)) {
+      return 1;
+    }
+    return std::max(parseMaxNode(list) + 1, 1);
+  }();
+  return numNodes;
+}
+
+int getCurrentNumaNode() {
+#if TACO_LINUX && defined(SYS_getcpu)
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return (int)node;
+  }
+#endif
+  return 0;
+}
+
+static size_t getPageSize() {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+}
+
+/// Set the memory policy of the pages of [data, data + bytes), which must not
+/// have been touched yet.  Failures are ignored, since placement is a hint.
+static void bindPages(void* data, size_t bytes, MemoryPlacement placement,
+                      int node) {
+#if TACO_LINUX && defined(SYS_mbind)
+  const int numNodes = getNumNumaNodes();
+  if (numNodes < 2 || bytes == 0) {
+    return;
+  }
+  int mode;
+  const size_t bitsPerWord = 8 * sizeof(unsigned long);
+  vector<unsigned long> nodes((numNodes + bitsPerWord - 1) / bitsPerWord, 0);
+  if (node >= 0) {
+    if (node >= numNodes) {
+      return;
+    }
+    mode = MPOL_PREFERRED_MODE;
+    nodes[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+  }
+  else if (placement == MemoryPlacement::Interleave) {
+    mode = MPOL_INTERLEAVE_MODE;
+    for (int n = 0; n < numNodes; n++) {
+      nodes[n / bitsPerWord] |= 1ul << (n % bitsPerWord);
+    }
+  }
+  else {
+    return;
+  }
+  syscall(SYS_mbind, data, bytes, mode, nodes.data(),
+          nodes.size() * bitsPerWord + 1, 0);
+#endif
+}
+
+/// Copy `bytes` bytes from `src` to `dst`, or zero them if `src` is null.
+/// With first-touch placement every thread that runs parallel kernels touches
+/// the contiguous range of pages that a static schedule gives it.
+static void touchPages(char* dst, const char* src, size_t bytes,
+                       MemoryPlacement placement, int node) {
+#if USE_OPENMP
+  const size_t pageSize = getPageSize();
+  const long numPages = (long)((bytes + pageSize - 1) / pageSize);
+  if (placement == MemoryPlacement::FirstTouch && node < 0 && numPages > 1) {
+    #pragma omp parallel for schedule(static) num_threads(taco_get_num_threads())
+    for (long page = 0; page < numPages; page++) {
+      const size_t offset = page * pageSize;
+      const size_t size = std::min(pageSize, bytes - offset);
+      if (src != nullptr) {
+        memcpy(dst + offset, src + offset, size);
+      }
+      else {
+        memset(dst + offset, 0, size);
+      }
+    }
+    return;
+  }
+#endif
+  if (src != nullptr) {
+    memcpy(dst, src, bytes);
+  }
+  else {
+    memset(dst, 0, bytes);
+  }
+}
+
+/// Allocate page aligned memory by an allocation policy whose pages have the
+/// memory policy of `placement`, without touching it.  Arrays smaller than a
+/// page share pages with other allocations, so they are not placed.
+static void* allocatePages(size_t bytes, MemoryPlacement placement, int node,
+                           const AllocationPolicy& policy) {
+  const size_t pageSize = getPageSize();
+  if (bytes < pageSize) {
+    return allocateAligned(bytes, policy);
+  }
+  AllocationPolicy pagePolicy = policy;
+  pagePolicy.alignment = std::max(policy.alignment, pageSize);
+  const size_t paddedBytes = (bytes + pageSize - 1) / pageSize * pageSize;
+  void* data = allocateAligned(paddedBytes, pagePolicy);
+  if (data != nullptr) {
+    bindPages(data, paddedBytes, placement, node);
+  }
+  return data;
+}
+
+void* allocatePlaced(size_t bytes, MemoryPlacement placement, int node,
+                     const AllocationPolicy& policy) {
+  void* data = allocatePages(bytes, placement, node, policy);
+  if (data != nullptr) {
+    touchPages(static_cast<char*>(data), nullptr, bytes, placement, node);
+  }
+  return data;
+}
+
+Array makeArray(Datatype type, size_t size, MemoryPlacement placement,
+                int node, const AllocationPolicy& policy) {
+  void* data = allocatePlaced(size * type.getNumBytes(), placement, node,
+                              policy);
+  taco_uassert(data != nullptr) << "Could not allocate an array of "
+                                << size << " " << type << " components";
+  return Array(type, data, size, Array::Free);
+}
+
+Array placeArray(const Array& array, MemoryPlacement placement, int node,
+                 const AllocationPolicy& policy) {
+  // Arrays that have not been allocated yet are left as they are
+  if (array.getType().getKind() == Datatype::Undefined ||
+      array.getData() == nullptr) {
+    return array;
+  }
+  const size_t bytes = array.getSize() * array.getType().getNumBytes();
+  void* data = allocatePages(bytes, placement, node, policy);
+  taco_uassert(data != nullptr) << "Could not allocate an array of "
+                                << array.getSize() << " " << array.getType()
+                                << " components";
+  touchPages(static_cast<char*>(data),
+             static_cast<const char*>(array.getData()), bytes, placement, node);
+  return Array(array.getType(), data, array.getSize(), Array::Free);
+}
+
+TensorStorage placeStorage(const TensorStorage& storage,
+                           MemoryPlacement placement, int node,
+                           const AllocationPolicy& policy) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  vector<ModeIndex> modeIndices;
+  for (int l = 0; l < index.numModeIndices(); l++) {
+    const ModeIndex& modeIndex = index.getModeIndex(l);
+    vector<Array> indexArrays;
+    for (int a = 0; a < modeIndex.numIndexArrays(); a++) {
+      indexArrays.push_back(placeArray(modeIndex.getIndexArray(a), placement,
+                                       node, policy));
+    }
+    modeIndices.push_back(ModeIndex(indexArrays));
+  }
+
+  TensorStorage placed(storage.getComponentType(), storage.getDimensions(),
+                       format);
+  placed.setFillValue(storage.getFillValue());
+  if (index.numModeIndices() == index.getFormat().getOrder()) {
+    placed.setIndex(Index(format, modeIndices));
+  }
+  placed.setValues(placeArray(storage.getValues(), placement, node, policy));
+  return placed;
+}
+
+
+// class PlacementAllocator
+PlacementAllocator::PlacementAllocator(MemoryPlacement placement,
+                                       shared_ptr<KernelAllocator> base,
+                                       const AllocationPolicy& policy)
+    : placement(placement), base(base), policy(policy) {
+}
+
+void* PlacementAllocator::allocate(size_t size, bool temporary) {
+  if (temporary) {
+    return (base != nullptr) ? base->allocate(size, temporary)
+                             : KernelAllocator::allocate(size, temporary);
+  }
+  // Only placed arrays need their pages touched before kernels write them
+  if (placement == MemoryPlacement::Default ||
+      placement == MemoryPlacement::Replicate) {
+    return allocateAligned(size, policy);
+  }
+  return allocatePlaced(size, placement, -1, policy);
+}
+
+void* PlacementAllocator::reallocate(void* ptr, size_t size, bool temporary) {
+  if (temporary) {
+    return (base != nullptr) ? base->reallocate(ptr, size, temporary)
+                             : KernelAllocator::reallocate(ptr, size, temporary);
+  }
+  // Interleave the whole pages of a moved array, which affects the pages that
+  // the copy has not touched.  Pages that grow in place are placed by the
+  // thread that first writes them.
+  char* resized = static_cast<char*>(reallocateAligned(ptr, size, policy));
+  if (resized != ptr && resized != nullptr) {
+    const size_t pageSize = getPageSize();
+    const uintptr_t first = ((uintptr_t)resized + pageSize - 1) / pageSize *
+                            pageSize;
+    const uintptr_t last = ((uintptr_t)resized + size) / pageSize * pageSize;
+    if (last > first) {
+      bindPages((void*)first, last - first, placement, -1);
+    }
+  }
+  return resized;
+}
+
+void PlacementAllocator::deallocate(void* ptr, bool temporary) {
+  if (temporary && base != nullptr) {
+    base->deallocate(ptr, temporary);
+  }
+  else {
+    KernelAllocator::deallocate(ptr, temporary);
+  }
+}
+
+void PlacementAllocator::beginKernel() {
+  if (base != nullptr) {
+    base->beginKernel();
+  }
+}
+
+void PlacementAllocator::endKernel() {
+  if (base != nullptr) {
+    base->endKernel();
+  }
+}
+
+MemoryPlacement PlacementAllocator::getPlacement() const {
+  return placement;
+}
+
+shared_ptr<KernelAllocator> PlacementAllocator::getBase() const {
+  return base;
+}
+
+const AllocationPolicy& PlacementAllocator::getPolicy() const {
+  return policy;
+}
+
+}
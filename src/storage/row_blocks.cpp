@@ -0,0 +1,274 @@
+#include "taco/storage/row_blocks.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/storage/file_io_ttb.h"
+
+using namespace std;
+
+namespace taco {
+
+struct RowBlockStream::Content {
+  TensorBase tensor;
+  TensorBase block;
+  int rowsPerBlock;
+
+  /// True if the tensor is a file mapped by the stream, whose pages can be
+  /// released once a block has been copied.
+  bool releasePages;
+};
+
+namespace {
+/// The positions [begin, end) of a level that a block holds, followed by
+/// `padding` positions with no components for the coordinates of the last
+/// block that are past the end of the tensor.
+struct PositionRange {
+  size_t begin;
+  size_t end;
+  size_t padding;
+};
+}
+
+static bool isModeFormat(const ModeFormat& modeFormat, const ModeFormat& kind) {
+  return modeFormat.getName() == kind.getName();
+}
+
+/// Copy [begin, end) of an array into a new array followed by `padding` zeros.
+static Array copyRange(const Array& array, size_t begin, size_t end,
+                       size_t padding) {
+  const size_t bytes = array.getType().getNumBytes();
+  Array copy = makeArray(array.getType(), end - begin + padding);
+  const char* data = static_cast<const char*>(array.getData());
+  memcpy(copy.getData(), data + begin * bytes, (end - begin) * bytes);
+  memset(static_cast<char*>(copy.getData()) + (end - begin) * bytes, 0,
+         padding * bytes);
+  return copy;
+}
+
+/// Let the kernel drop the mapped pages of [begin, end) of an array.  They are
+/// read from the file again if they are touched later.  The page that holds
+/// `end` also holds the start of the next block, so it is kept.
+static void releaseRange(const Array& array, size_t begin, size_t end) {
+  static const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+  const size_t bytes = array.getType().getNumBytes();
+  const uintptr_t data = (uintptr_t)array.getData();
+  const uintptr_t first = (data + begin * bytes) / pageSize * pageSize;
+  const uintptr_t last = (data + end * bytes) / pageSize * pageSize;
+  if (last > first) {
+    madvise((void*)first, last - first, MADV_DONTNEED);
+  }
+}
+
+/// Copy the components of the rows [firstRow, firstRow + rowsPerBlock) of a
+/// tensor into the storage of a block tensor.
+static TensorStorage loadBlock(const TensorBase& tensor, int rowsPerBlock,
+                               int firstRow, bool releasePages) {
+  const Format& format = tensor.getFormat();
+  const vector<ModeFormat> modeFormats = format.getModeFormats();
+  const Index& index = tensor.getStorage().getIndex();
+  const int order = tensor.getOrder();
+  const int numRows = tensor.getDimension(format.getModeOrdering()[0]);
+
+  vector<ModeIndex> modeIndices;
+  PositionRange range;
+  const ModeIndex& top = index.getModeIndex(0);
+  if (isModeFormat(modeFormats[0], ModeFormat::Dense)) {
+    range.begin = firstRow;
+    range.end = std::min(firstRow + rowsPerBlock, numRows);
+    range.padding = firstRow + rowsPerBlock - range.end;
+    modeIndices.push_back(ModeIndex({makeArray({rowsPerBlock})}));
+  }
+  else {
+    // The coordinates of the top level are sorted, so the block is found by
+    // binary search
+    const int32_t* pos = (const int32_t*)top.getIndexArray(0).getData();
+    const int32_t* crd = (const int32_t*)top.getIndexArray(1).getData();
+    range.begin = std::lower_bound(crd + pos[0], crd + pos[1], firstRow) - crd;
+    range.end = std::lower_bound(crd + range.begin, crd + pos[1],
+                                 firstRow + rowsPerBlock) - crd;
+    range.padding = 0;
+    Array blockCrd = copyRange(top.getIndexArray(1), range.begin, range.end, 0);
+    int32_t* blockCrdData = (int32_t*)blockCrd.getData();
+    for (size_t p = 0; p < range.end - range.begin; p++) {
+      blockCrdData[p] -= firstRow;
+    }
+    modeIndices.push_back(ModeIndex({
+      makeArray({0, (int32_t)(range.end - range.begin)}), blockCrd
+    }));
+    if (releasePages) {
+      releaseRange(top.getIndexArray(1), range.begin, range.end);
+    }
+  }
+
+  for (int l = 1; l < order; l++) {
+    const ModeIndex& modeIndex = index.getModeIndex(l);
+    if (isModeFormat(modeFormats[l], ModeFormat::Dense)) {
+      const size_t dimension = tensor.getDimension(format.getModeOrdering()[l]);
+      modeIndices.push_back(ModeIndex({makeArray({(int)dimension})}));
+      range = {range.begin * dimension, range.end * dimension,
+               range.padding * dimension};
+    }
+    else if (isModeFormat(modeFormats[l], ModeFormat::Compressed)) {
+      const Array& pos = modeIndex.getIndexArray(0);
+      const int32_t* posData = (const int32_t*)pos.getData();
+      const size_t numPositions = range.end - range.begin;
+      Array blockPos = makeArray(Int32, numPositions + range.padding + 1);
+      int32_t* blockPosData = (int32_t*)blockPos.getData();
+      for (size_t p = 0; p <= numPositions; p++) {
+        blockPosData[p] = posData[range.begin + p] - posData[range.begin];
+      }
+      std::fill(blockPosData + numPositions + 1,
+                blockPosData + numPositions + range.padding + 1,
+                blockPosData[numPositions]);
+      const size_t begin = posData[range.begin];
+      const size_t end = posData[range.end];
+      modeIndices.push_back(ModeIndex({
+        blockPos, copyRange(modeIndex.getIndexArray(1), begin, end, 0)
+      }));
+      if (releasePages) {
+        releaseRange(pos, range.begin, range.end + 1);
+        releaseRange(modeIndex.getIndexArray(1), begin, end);
+      }
+      range = {begin, end, 0};
+    }
+    else {
+      modeIndices.push_back(ModeIndex({
+        modeIndex.getIndexArray(0),
+        copyRange(modeIndex.getIndexArray(1), range.begin, range.end,
+                  range.padding)
+      }));
+      if (releasePages) {
+        releaseRange(modeIndex.getIndexArray(1), range.begin, range.end);
+      }
+    }
+  }
+
+  vector<int> dimensions = tensor.getDimensions();
+  dimensions[format.getModeOrdering()[0]] = rowsPerBlock;
+  const Array& values = tensor.getStorage().getValues();
+  TensorStorage storage(tensor.getComponentType(), dimensions, format);
+  storage.setFillValue(tensor.getStorage().getFillValue());
+  storage.setIndex(Index(format, modeIndices));
+  storage.setValues(copyRange(values, range.begin, range.end, range.padding));
+  if (releasePages) {
+    releaseRange(values, range.begin, range.end);
+  }
+  return storage;
+}
+
+static void checkSupported(const TensorBase& tensor) {
+  const Format& format = tensor.getFormat();
+  taco_uassert(tensor.getOrder() > 0)
+      << "Only tensors with at least one mode can be read in blocks";
+  taco_uassert(!format.isSymmetric())
+      << "Symmetric tensors cannot be read in blocks, since a block of rows "
+      << "does not hold the mirrored components of other rows";
+  const vector<ModeFormat> modeFormats = format.getModeFormats();
+  const Index& index = tensor.getStorage().getIndex();
+  taco_uassert(index.numModeIndices() == tensor.getOrder() &&
+               tensor.getStorage().getValues().getData() != nullptr)
+      << "Only packed tensors can be read in blocks";
+  for (int l = 0; l < tensor.getOrder(); l++) {
+    const ModeFormat& modeFormat = modeFormats[l];
+    if (isModeFormat(modeFormat, ModeFormat::Dense)) {
+      continue;
+    }
+    taco_uassert(isModeFormat(modeFormat, ModeFormat::Compressed) ||
+                 (l > 0 && isModeFormat(modeFormat, ModeFormat::Singleton)))
+        << "Tensors with " << modeFormat.getName() << " level " << l
+        << " cannot be read in blocks";
+    taco_uassert(l > 0 || modeFormat.isOrdered())
+        << "The outermost level must be ordered to be read in blocks";
+    const ModeIndex& modeIndex = index.getModeIndex(l);
+    taco_uassert(modeIndex.numIndexArrays() >= 2 &&
+                 modeIndex.getIndexArray(0).getType() == Int32 &&
+                 modeIndex.getIndexArray(1).getType() == Int32)
+        << "Only tensors with 32-bit index arrays can be read in blocks";
+  }
+}
+
+RowBlockStream::RowBlockStream(std::string filename, int rowsPerBlock)
+    : RowBlockStream(readTTB(filename), rowsPerBlock) {
+  content->releasePages = true;
+}
+
+RowBlockStream::RowBlockStream(TensorBase tensor, int rowsPerBlock)
+    : content(new Content) {
+  checkSupported(tensor);
+  taco_uassert(rowsPerBlock > 0) << "Blocks must hold at least one row";
+  content->tensor = tensor;
+  content->rowsPerBlock = rowsPerBlock;
+  content->releasePages = false;
+
+  vector<int> dimensions = tensor.getDimensions();
+  dimensions[tensor.getFormat().getModeOrdering()[0]] = rowsPerBlock;
+  content->block = TensorBase(tensor.getName() + "_block",
+                              tensor.getComponentType(), dimensions,
+                              tensor.getFormat());
+  content->block.setFillValue(tensor.getFillValue());
+}
+
+RowBlockStream::~RowBlockStream() {
+}
+
+TensorBase RowBlockStream::getBlockTensor() const {
+  return content->block;
+}
+
+int RowBlockStream::getNumRows() const {
+  const TensorBase& tensor = content->tensor;
+  return tensor.getDimension(tensor.getFormat().getModeOrdering()[0]);
+}
+
+int RowBlockStream::getRowsPerBlock() const {
+  return content->rowsPerBlock;
+}
+
+int RowBlockStream::getNumBlocks() const {
+  return (getNumRows() + content->rowsPerBlock - 1) / content->rowsPerBlock;
+}
+
+void RowBlockStream::evaluate(TensorBase result,
+                              function<void(int,int,const TensorBase&)> consume) {
+  result.compile();
+
+  const int rowsPerBlock = content->rowsPerBlock;
+  const int numBlocks = getNumBlocks();
+  auto prefetch = [&](int block) {
+    return std::async(std::launch::async, loadBlock,
+                      std::cref(content->tensor), rowsPerBlock,
+                      block * rowsPerBlock, content->releasePages);
+  };
+
+  future<TensorStorage> next;
+  if (numBlocks > 0) {
+    next = prefetch(0);
+  }
+  for (int block = 0; block < numBlocks; block++) {
+    TensorStorage storage = next.get();
+    if (block + 1 < numBlocks) {
+      next = prefetch(block + 1);
+    }
+
+    content->block.setStorage(storage);
+    result.setNeedsAssemble(true);
+    result.setNeedsCompute(true);
+    result.assemble();
+    result.compute();
+
+    const int firstRow = block * rowsPerBlock;
+    consume(firstRow, std::min(rowsPerBlock, getNumRows() - firstRow), result);
+  }
+}
+
+}
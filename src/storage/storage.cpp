@@ -25,10 +25,11 @@ struct TensorStorage::Content {
 
   Index         index;
   Array         values;
+  TypedComponentVal fill;
 
   Content(Datatype componentType, vector<int> dimensions, Format format)
       : componentType(componentType), dimensions(dimensions), format(format),
-        index(format) {
+        index(format), fill(componentType, 0) {
     int order = (int)dimensions.size();
 
     taco_iassert(order <= INT_MAX && componentType.getNumBits() <= INT_MAX);
@@ -174,6 +175,15 @@ void TensorStorage::setValues(const Array& values) {
   content->values = values;
 }
 
+TypedComponentVal TensorStorage::getFillValue() const {
+  return content->fill;
+}
+
+void TensorStorage::setFillValue(TypedComponentVal fill) {
+  taco_iassert(fill.getType() == getComponentType());
+  content->fill = fill;
+}
+
 bool equals(TensorStorage a, TensorStorage b) {
   return false;
 }
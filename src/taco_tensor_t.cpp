@@ -36,6 +36,7 @@ taco_tensor_t* init_taco_tensor_t(int32_t order, int32_t csize,
   t->mode_types = (taco_mode_t *) alloc_mem(order * sizeof(taco_mode_t));
   t->indices = (uint8_t ***) alloc_mem(order * sizeof(uint8_t***));
   t->csize         = csize;
+  t->vals_size     = 0;
 
   for (int32_t i = 0; i < order; i++) {
     t->dimensions[i]    = dimensions[i];
@@ -1,14 +1,18 @@
 #include "taco/tensor.h"
 
 #include <set>
+#include <unordered_set>
 #include <cstring>
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
 #include <climits>
+#include <cstdint>
 #include <vector>
 #include <utility>
 #include <mutex>
+#include <algorithm>
+#include <functional>
 
 #include "taco/cuda.h"
 #include "taco/format.h"
@@ -17,6 +21,7 @@
 #include "taco/error/error_messages.h"
 #include "taco/index_notation/index_notation.h"
 #include "taco/index_notation/index_notation_nodes.h"
+#include "taco/index_notation/intrinsic.h"
 //#include "codegen/codegen_c.h"
 //#include "codegen/codegen_cuda.h"
 //#include "taco/taco_tensor_t.h"
@@ -32,6 +37,8 @@
 #include "taco/storage/file_io_tns.h"
 #include "taco/storage/file_io_mtx.h"
 #include "taco/storage/file_io_rb.h"
+#include "taco/storage/file_io_ttb.h"
+#include "taco/storage/numa.h"
 #include "taco/storage/typed_vector.h"
 #include "taco/util/collections.h"
 #include "taco/util/strings.h"
@@ -43,6 +50,7 @@
 #include "error/error_checks.h"
 #include "taco/cuda.h"
 #include "lower/iteration_graph.h"
+#include "storage/decompressing_stream.h"
 
 using namespace std;
 using namespace taco::ir;
@@ -109,6 +117,7 @@ TensorBase::TensorBase(string name, Datatype ctype, vector<int> dimensions,
       "must match the tensor order (" << dimensions.size() << ").";
 
   content->allocSize = 1 << 20;
+  content->estimateAllocSize = true;
 
   vector<ModeIndex> modeIndices(format.getOrder());
   // Initialize dense storage modes
@@ -123,6 +132,14 @@ TensorBase::TensorBase(string name, Datatype ctype, vector<int> dimensions,
 
   content->assembleWhileCompute = false;
   content->module = make_shared<Module>();
+  content->workspaces = make_shared<WorkspaceCache>();
+
+  content->reuseSparsityPattern = false;
+  content->verifySparsityPattern = true;
+  content->hasSparsityPattern = false;
+
+  content->placement = MemoryPlacement::Default;
+  content->hasAllocationPolicy = false;
 
   content->neverPacked = true;
   content->needsPack = true;
@@ -151,6 +168,17 @@ const Format& TensorBase::getFormat() const {
   return content->storage.getFormat();
 }
 
+Literal TensorBase::getFillValue() const {
+  return getTensorVar().getFill();
+}
+
+void TensorBase::setFillValue(Literal fill) {
+  content->tensorVar.setFill(fill);
+  ComponentTypeUnion value;
+  memcpy(&value, to<LiteralNode>(fill.ptr)->val, fill.getDataType().getNumBytes());
+  content->storage.setFillValue(TypedComponentVal(fill.getDataType(), &value));
+}
+
 void TensorBase::reserve(size_t numCoordinates) {
   size_t newSize = content->coordinateBuffer->size() +
                    numCoordinates * content->coordinateSize;
@@ -190,6 +218,10 @@ size_t TensorBase::getAllocSize() const {
   return content->allocSize;
 }
 
+void TensorBase::setEstimateAllocSize(bool estimate) {
+  content->estimateAllocSize = estimate;
+}
+
 void TensorBase::unsetNeverPacked() {
   content->neverPacked = false;
 }
@@ -234,6 +266,69 @@ void TensorBase::setAssembleWhileCompute(bool assembleWhileCompute) {
   content->assembleWhileCompute = assembleWhileCompute;
 }
 
+void TensorBase::setReuseSparsityPattern(bool reuse, bool verify) {
+  content->reuseSparsityPattern = reuse;
+  content->verifySparsityPattern = verify;
+  content->hasSparsityPattern = false;
+}
+
+void TensorBase::setMemoryPlacement(MemoryPlacement placement) {
+  content->placement = placement;
+  applyMemoryPlacement();
+}
+
+MemoryPlacement TensorBase::getMemoryPlacement() const {
+  return content->placement;
+}
+
+const TensorStorage& TensorBase::getLocalStorage() const {
+  if (!content->replicas.empty()) {
+    const size_t node = getCurrentNumaNode();
+    if (node < content->replicas.size()) {
+      return content->replicas[node];
+    }
+  }
+  return content->storage;
+}
+
+void TensorBase::setAllocationPolicy(AllocationPolicy policy) {
+  content->hasAllocationPolicy = true;
+  content->allocationPolicy = policy;
+  const MemoryPlacement placement =
+      (content->placement == MemoryPlacement::Replicate)
+      ? MemoryPlacement::Default : content->placement;
+  content->storage = placeStorage(content->storage, placement, -1, policy);
+  applyMemoryPlacement();
+}
+
+AllocationPolicy TensorBase::getAllocationPolicy() const {
+  return content->hasAllocationPolicy ? content->allocationPolicy
+                                      : taco::getAllocationPolicy();
+}
+
+void TensorBase::applyMemoryPlacement() {
+  content->replicas.clear();
+  switch (content->placement) {
+    case MemoryPlacement::Default:
+      break;
+    case MemoryPlacement::FirstTouch:
+    case MemoryPlacement::Interleave:
+      content->storage = placeStorage(content->storage, content->placement, -1,
+                                      getAllocationPolicy());
+      break;
+    case MemoryPlacement::Replicate:
+      // Kernels on a machine with one node read the storage itself
+      if (getNumNumaNodes() > 1) {
+        for (int node = 0; node < getNumNumaNodes(); node++) {
+          content->replicas.push_back(placeStorage(content->storage,
+                                                   content->placement, node,
+                                                   getAllocationPolicy()));
+        }
+      }
+      break;
+  }
+}
+
 static size_t numIntegersToCompare = 0;
 static int lexicographicalCmp(const void* a, const void* b) {
   for (size_t i = 0; i < numIntegersToCompare; i++) {
@@ -276,12 +371,32 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
   return numVals;
 }
 
+shared_ptr<KernelAllocator>
+TensorBase::getResultAllocator(MemoryPlacement placement) {
+  shared_ptr<KernelAllocator> allocator = getKernelAllocator();
+  const AllocationPolicy policy = getAllocationPolicy();
+  if (placement != MemoryPlacement::FirstTouch &&
+      placement != MemoryPlacement::Interleave &&
+      policy == AllocationPolicy()) {
+    return allocator;
+  }
+  // The placing allocator is kept until the settings that it was made for
+  // change, so that kernel calls do not allocate one
+  shared_ptr<PlacementAllocator>& cached = content->resultAllocator;
+  if (cached == nullptr || cached->getPlacement() != placement ||
+      cached->getBase() != allocator || cached->getPolicy() != policy) {
+    cached = make_shared<PlacementAllocator>(placement, allocator, policy);
+  }
+  return cached;
+}
+
 /// Pack coordinates into a data structure given by the tensor format.
 void TensorBase::pack() {
   if (!needsPack()) {
     return;
   }
   setNeedsPack(false);
+  content->hasSparsityPattern = false;
 
   if (neverPacked()) {
     unsetNeverPacked();
@@ -344,7 +459,39 @@ void TensorBase::pack() {
   const std::vector<int>& dimensions = getDimensions();
 
   taco_iassert((content->coordinateBufferUsed % content->coordinateSize) == 0);
-  const size_t numCoordinates = content->coordinateBufferUsed / content->coordinateSize;
+  size_t numCoordinates = content->coordinateBufferUsed / content->coordinateSize;
+
+  // Symmetric matrices store only their lower triangle, so components of the
+  // upper triangle are stored as their mirror, or dropped if their mirror was
+  // inserted too.
+  if (getFormat().isSymmetric()) {
+    const size_t coordSize = content->coordinateSize;
+    char* coordinatesPtr = content->coordinateBuffer->data();
+    std::unordered_set<uint64_t> lower;
+    for (size_t i = 0; i < numCoordinates; ++i) {
+      int* coordinate = (int*)&coordinatesPtr[i * coordSize];
+      if (coordinate[0] > coordinate[1]) {
+        lower.insert((uint64_t)coordinate[0] << 32 | (uint32_t)coordinate[1]);
+      }
+    }
+    size_t numStored = 0;
+    for (size_t i = 0; i < numCoordinates; ++i) {
+      int* coordinate = (int*)&coordinatesPtr[i * coordSize];
+      if (coordinate[0] < coordinate[1]) {
+        if (lower.count((uint64_t)coordinate[1] << 32 |
+                        (uint32_t)coordinate[0])) {
+          continue;
+        }
+        std::swap(coordinate[0], coordinate[1]);
+      }
+      if (numStored != i) {
+        memcpy(&coordinatesPtr[numStored * coordSize], coordinate, coordSize);
+      }
+      numStored++;
+    }
+    numCoordinates = numStored;
+    content->coordinateBufferUsed = numCoordinates * coordSize;
+  }
 
   const auto helperFuncs = getHelperFunctions(getFormat(), getComponentType(),
                                               dimensions);
@@ -366,7 +513,8 @@ void TensorBase::pack() {
     bufferStorage->vals = (uint8_t*)content->coordinateBuffer->data();
 
     std::vector<void*> arguments = {content->storage, bufferStorage};
-    helperFuncs->callFuncPacked("pack", arguments.data());
+    helperFuncs->callFuncPacked("pack", arguments.data(),
+        getResultAllocator(MemoryPlacement::Default).get());
     content->valuesSize = unpackTensorData(*((taco_tensor_t*)arguments[0]), *this);
 
     deinit_taco_tensor_t(bufferStorage);
@@ -437,11 +585,17 @@ void TensorBase::pack() {
 
   // Pack nonzero components into required format
   std::vector<void*> arguments = {content->storage, bufferStorage};
-  helperFuncs->callFuncPacked("pack", arguments.data());
+  // Arrays are placed on NUMA nodes once they have been packed
+  helperFuncs->callFuncPacked("pack", arguments.data(),
+      getResultAllocator(MemoryPlacement::Default).get());
   content->valuesSize = unpackTensorData(*((taco_tensor_t*)arguments[0]), *this);
 
   free(values);
   deinit_taco_tensor_t(bufferStorage);
+
+  if (content->placement != MemoryPlacement::Default) {
+    applyMemoryPlacement();
+  }
 }
 
 void TensorBase::setStorage(TensorStorage storage) {
@@ -449,6 +603,9 @@ void TensorBase::setStorage(TensorStorage storage) {
   // setStorage and automatic compilation machinery.
   content->needsPack = false;
   content->storage = storage;
+  if (content->placement != MemoryPlacement::Default) {
+    applyMemoryPlacement();
+  }
 }
 
 static inline map<TensorVar, TensorBase> getTensors(const IndexExpr& expr);
@@ -507,6 +664,21 @@ struct AccessTensorNode : public AccessNode {
       operand.second.addDependentTensor(tensor);
     }
 
+    // Results of expressions over tensors with non-zero fill values take the
+    // fill value of the expression, so that they can stay sparse.
+    bool nonZeroFill = false;
+    for (auto& operand : operands) {
+      nonZeroFill |= !isZero(operand.second.getFillValue());
+    }
+    if (nonZeroFill && isZero(tensor.getFillValue()) &&
+        !assignment.getOperator().defined()) {
+      Literal fill = getFillValue(assign.getRhs());
+      if (fill.defined() &&
+          fill.getDataType() == tensor.getComponentType()) {
+        tensor.setFillValue(fill);
+      }
+    }
+
     tensor.setAssignment(assign);
   }
 };
@@ -546,13 +718,17 @@ const Access TensorBase::operator()() const {
 TensorBase::KernelsCache TensorBase::computeKernels;
 std::mutex TensorBase::computeKernelsMutex;
 
-std::shared_ptr<Module> TensorBase::getComputeKernel(const IndexStmt stmt) {
+std::shared_ptr<Module> TensorBase::getComputeKernel(const IndexStmt stmt,
+                                                     bool assembleWhileCompute) {
+  const LoweringOptions options = getLoweringOptions();
   computeKernelsMutex.lock();
   const auto computeKernelsReverse =
       util::ReverseConstIterable<TensorBase::KernelsCache>(computeKernels);
   for (const auto& computeKernel : computeKernelsReverse) {
-    if (isomorphic(stmt, computeKernel.first)) {
-      const auto kernelModule = computeKernel.second;
+    if (std::get<1>(computeKernel) == assembleWhileCompute &&
+        std::get<2>(computeKernel) == options &&
+        isomorphic(stmt, std::get<0>(computeKernel))) {
+      const auto kernelModule = std::get<3>(computeKernel);
       computeKernelsMutex.unlock();
       return kernelModule;
     }
@@ -562,9 +738,11 @@ std::shared_ptr<Module> TensorBase::getComputeKernel(const IndexStmt stmt) {
 }
 
 void TensorBase::cacheComputeKernel(const IndexStmt stmt,
+                                    bool assembleWhileCompute,
                                     const std::shared_ptr<Module> kernel) {
   computeKernelsMutex.lock();
-  computeKernels.emplace_back(stmt, kernel);
+  computeKernels.emplace_back(stmt, assembleWhileCompute, getLoweringOptions(),
+                              kernel);
   computeKernelsMutex.unlock();
 }
 
@@ -606,20 +784,28 @@ void TensorBase::compile() {
   stmt = parallelizeOuterLoop(stmt);
   compile(stmt, content->assembleWhileCompute);
 }
+static std::function<size_t()> getCapacityBound(const TensorBase& result);
+
 void TensorBase::compile(taco::IndexStmt stmt, bool assembleWhileCompute) {
   if (!needsCompile()) {
     return;
   }
   setNeedsCompile(false);
+  content->hasSparsityPattern = false;
+  content->capacityBound = getCapacityBound(*this);
+  // The workspaces of the previous kernel are not used by the new one
+  content->workspaces->release();
 
   IndexStmt concretizedAssign = stmt;
   IndexStmt stmtToCompile = stmt.concretize();
+  stmtToCompile = exploitSymmetry(stmtToCompile);
   stmtToCompile = scalarPromote(stmtToCompile);
 
   if (!std::getenv("CACHE_KERNELS") ||
       std::string(std::getenv("CACHE_KERNELS")) != "0") {
     concretizedAssign = stmtToCompile;
-    const auto cachedKernel = getComputeKernel(concretizedAssign);
+    const auto cachedKernel = getComputeKernel(concretizedAssign,
+                                                assembleWhileCompute);
     if (cachedKernel) {
       content->module = cachedKernel;
       return;
@@ -635,7 +821,7 @@ void TensorBase::compile(taco::IndexStmt stmt, bool assembleWhileCompute) {
   content->module->addFunction(content->assembleFunc);
   content->module->addFunction(content->computeFunc);
   content->module->compile();
-  cacheComputeKernel(concretizedAssign, content->module);
+  cacheComputeKernel(concretizedAssign, assembleWhileCompute, content->module);
 }
 
 taco_tensor_t* TensorBase::getTacoTensorT() {
@@ -739,12 +925,358 @@ vector<void*> packArguments(const TensorBase& tensor) {
   auto tensors = getTensors(tensor.getAssignment().getRhs());
   for (auto& operand : operands) {
     taco_iassert(util::contains(tensors, operand));
-    arguments.push_back(tensors.at(operand).getStorage());
+    arguments.push_back(tensors.at(operand).getLocalStorage());
   }
 
   return arguments;
 }
 
+/// Returns true if the result of a masked assignment can share the index of
+/// its structural mask, and stores the mask in `mask`.  This is the case when
+/// the result is computed at exactly the coordinates of the mask (e.g. SDDMM
+/// where all other operands are dense).
+static bool getSharedMaskIndex(const TensorBase& result, TensorBase* mask) {
+  Assignment assignment = result.getAssignment();
+  IndexExpr rhs = assignment.getRhs();
+  while (isa<Reduction>(rhs)) {
+    rhs = to<Reduction>(rhs).getExpr();
+  }
+  if (assignment.getOperator().defined() || !isa<CallIntrinsic>(rhs)) {
+    return false;
+  }
+  CallIntrinsic call = to<CallIntrinsic>(rhs);
+  if (dynamic_cast<const MaskIntrinsic*>(&call.getFunc()) == nullptr ||
+      !isa<AccessTensorNode>(call.getArgs()[0].ptr)) {
+    return false;
+  }
+  auto maskAccess = to<AccessTensorNode>(call.getArgs()[0].ptr);
+  if (maskAccess->indexVars != assignment.getLhs().getIndexVars() ||
+      maskAccess->tensor.getFormat() != result.getFormat() ||
+      maskAccess->tensor.getDimensions() != result.getDimensions()) {
+    return false;
+  }
+  for (auto& operand : getTensors(call.getArgs()[1])) {
+    for (auto& modeFormat : operand.second.getFormat().getModeFormats()) {
+      if (modeFormat != Dense) {
+        return false;
+      }
+    }
+  }
+  *mask = maskAccess->tensor;
+  return true;
+}
+
+static inline void appendBytes(vector<char>* pattern, const void* data,
+                               size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  pattern->insert(pattern->end(), bytes, bytes + size);
+}
+
+/// Returns a copy of the dimensions, fill values and index arrays of the
+/// operands of the assignment, which determine the sparsity pattern of its
+/// result.  Patterns are compared exactly, since a pattern that is wrongly
+/// taken to be unchanged would give the result a stale index.
+static vector<char> getSparsityPattern(const map<TensorVar,TensorBase>& operands){
+  vector<char> pattern;
+  for (auto& operand : operands) {
+    const TensorStorage& storage = operand.second.getStorage();
+    const vector<int>& dimensions = operand.second.getDimensions();
+    appendBytes(&pattern, dimensions.data(), dimensions.size() * sizeof(int));
+    TypedComponentVal fill = storage.getFillValue();
+    ComponentTypeUnion fillValue = fill.get();
+    appendBytes(&pattern, &fillValue, fill.getType().getNumBytes());
+
+    const Index& index = storage.getIndex();
+    for (int i = 0; i < index.numModeIndices(); i++) {
+      const ModeIndex& modeIndex = index.getModeIndex(i);
+      for (int j = 0; j < modeIndex.numIndexArrays(); j++) {
+        const Array& array = modeIndex.getIndexArray(j);
+        const size_t size = array.getSize() * array.getType().getNumBytes();
+        appendBytes(&pattern, &size, sizeof(size));
+        appendBytes(&pattern, array.getData(), size);
+      }
+    }
+  }
+  return pattern;
+}
+
+static inline size_t saturatingAdd(size_t a, size_t b) {
+  return (a > SIZE_MAX - b) ? SIZE_MAX : a + b;
+}
+
+static inline size_t saturatingMul(size_t a, size_t b) {
+  return (b != 0 && a > SIZE_MAX / b) ? SIZE_MAX : a * b;
+}
+
+/// Adds the stored components below position `pos` of level `level` of a
+/// tensor index to the count of their coordinate of dimension `dim`.
+static void countComponents(const vector<vector<const int*>>& arrays,
+                            const vector<ModeFormat>& modeFormats,
+                            const vector<int>& modeOrdering, int dim,
+                            int level, size_t pos, int coord,
+                            vector<size_t>* counts) {
+  if (level == (int)arrays.size()) {
+    (*counts)[coord]++;
+    return;
+  }
+  const bool isDim = modeOrdering[level] == dim;
+  const ModeFormat& modeFormat = modeFormats[level];
+  if (modeFormat == Dense) {
+    const int size = arrays[level][0][0];
+    for (int c = 0; c < size; c++) {
+      countComponents(arrays, modeFormats, modeOrdering, dim, level + 1,
+                      pos * size + c, isDim ? c : coord, counts);
+    }
+  } else if (modeFormat == Sparse) {
+    const int* posArray = arrays[level][0];
+    const int* crdArray = arrays[level][1];
+    for (int p = posArray[pos]; p < posArray[pos + 1]; p++) {
+      countComponents(arrays, modeFormats, modeOrdering, dim, level + 1, p,
+                      isDim ? crdArray[p] : coord, counts);
+    }
+  } else {
+    const int* crdArray = arrays[level][1];
+    countComponents(arrays, modeFormats, modeOrdering, dim, level + 1, pos,
+                    isDim ? crdArray[pos] : coord, counts);
+  }
+}
+
+/// Counts the stored components of a tensor per coordinate of dimension `dim`
+/// by walking its index.  Returns false if the index cannot be walked.
+static bool countComponents(const TensorBase& tensor, int dim,
+                            vector<size_t>* counts) {
+  const Format& format = tensor.getFormat();
+  const vector<ModeFormat> modeFormats = format.getModeFormats();
+  const Index& index = tensor.getStorage().getIndex();
+  const int order = tensor.getOrder();
+  vector<vector<const int*>> arrays(order);
+  for (int level = 0; level < order; level++) {
+    const ModeFormat& modeFormat = modeFormats[level];
+    const ModeIndex& modeIndex = index.getModeIndex(level);
+    if ((modeFormat != Dense && modeFormat != Sparse &&
+         modeFormat != Singleton) ||
+        modeIndex.numIndexArrays() < (modeFormat == Dense ? 1 : 2)) {
+      return false;
+    }
+    for (int i = 0; i < modeIndex.numIndexArrays(); i++) {
+      const Array& array = modeIndex.getIndexArray(i);
+      if (array.getType() != type<int>()) {
+        return false;
+      }
+      arrays[level].push_back(static_cast<const int*>(array.getData()));
+    }
+  }
+  countComponents(arrays, modeFormats, format.getModeOrdering(), dim, 0, 0, 0,
+                  counts);
+  return true;
+}
+
+/// An upper bound on the number of components of an index expression.  It is
+/// built from the expression when the result is compiled and evaluated on the
+/// indices of the operands when the result is assembled or computed, which
+/// gives SIZE_MAX if the current operands have no known bound.
+typedef std::function<size_t()> NnzBound;
+
+/// Builds an upper bound on the number of components of `expr` over the index
+/// variables `vars`, which is the number of components that a result indexed
+/// by `vars` may have to store.  Returns false if no bound is known.
+static bool getNnzBound(IndexExpr expr, const set<IndexVar>& vars,
+                        const map<IndexVar,int>& dims, NnzBound* bound) {
+  if (isa<AccessTensorNode>(expr.ptr)) {
+    auto access = to<AccessTensorNode>(expr.ptr);
+    set<IndexVar> accessVars(access->indexVars.begin(),
+                             access->indexVars.end());
+    if (accessVars.size() != access->indexVars.size() ||
+        !isZero(access->tensor.getFillValue())) {
+      return false;
+    }
+    size_t scale = 1;
+    for (auto& var : vars) {
+      if (!util::contains(accessVars, var)) {
+        scale = saturatingMul(scale, dims.at(var));
+      }
+    }
+    for (auto& var : accessVars) {
+      if (!util::contains(vars, var)) {
+        return false;
+      }
+    }
+    TensorBase tensor = access->tensor;
+    *bound = [tensor, scale]() {
+      return saturatingMul(tensor.getStorage().getIndex().getSize(), scale);
+    };
+    return true;
+  }
+  if (isa<Neg>(expr) || isa<Sqrt>(expr) || isa<Cast>(expr)) {
+    return getNnzBound(to<UnaryExprNode>(expr.ptr)->a, vars, dims, bound);
+  }
+  if (isa<Div>(expr)) {
+    return getNnzBound(to<Div>(expr).getA(), vars, dims, bound);
+  }
+  if (isa<Add>(expr) || isa<Sub>(expr)) {
+    auto node = to<BinaryExprNode>(expr.ptr);
+    NnzBound a, b;
+    if (!getNnzBound(node->a, vars, dims, &a) ||
+        !getNnzBound(node->b, vars, dims, &b)) {
+      return false;
+    }
+    *bound = [a, b]() { return saturatingAdd(a(), b()); };
+    return true;
+  }
+  if (isa<Mul>(expr)) {
+    NnzBound a, b;
+    bool hasA = getNnzBound(to<Mul>(expr).getA(), vars, dims, &a);
+    bool hasB = getNnzBound(to<Mul>(expr).getB(), vars, dims, &b);
+    if (!hasA && !hasB) {
+      return false;
+    }
+    if (hasA && hasB) {
+      *bound = [a, b]() { return std::min(a(), b()); };
+    } else {
+      *bound = hasA ? a : b;
+    }
+    return true;
+  }
+  if (isa<Reduction>(expr) && isa<Add>(to<Reduction>(expr).getOp())) {
+    Reduction reduction = to<Reduction>(expr);
+    IndexVar k = reduction.getVar();
+
+    // Summing over k projects out a variable, which does not increase the
+    // number of components.
+    set<IndexVar> bodyVars = vars;
+    bodyVars.insert(k);
+    bool hasBound = getNnzBound(reduction.getExpr(), bodyVars, dims, bound);
+
+    // A product of operands has at most one component per combination of
+    // operand components with the same coordinate k, so counting components
+    // per k gives the number of multiplications of e.g. Gustavson's SpGEMM.
+    vector<IndexExpr> factors = {reduction.getExpr()};
+    vector<const AccessTensorNode*> operands;
+    while (!factors.empty()) {
+      IndexExpr factor = factors.back();
+      factors.pop_back();
+      if (isa<Mul>(factor)) {
+        factors.push_back(to<Mul>(factor).getA());
+        factors.push_back(to<Mul>(factor).getB());
+      } else if (isa<AccessTensorNode>(factor.ptr)) {
+        operands.push_back(to<AccessTensorNode>(factor.ptr));
+      } else {
+        return hasBound;
+      }
+    }
+    set<IndexVar> coveredVars;
+    vector<pair<TensorBase,int>> countedOperands;
+    vector<TensorBase> constantOperands;
+    for (auto& operand : operands) {
+      const vector<IndexVar>& indexVars = operand->indexVars;
+      if (Access(operand).hasWindowedModes() ||
+          !isZero(operand->tensor.getFillValue())) {
+        return hasBound;
+      }
+      coveredVars.insert(indexVars.begin(), indexVars.end());
+      auto it = std::find(indexVars.begin(), indexVars.end(), k);
+      if (it == indexVars.end()) {
+        constantOperands.push_back(operand->tensor);
+      } else {
+        countedOperands.push_back({operand->tensor,
+                                   (int)(it - indexVars.begin())});
+      }
+    }
+    size_t scale = 1;
+    for (auto& var : coveredVars) {
+      if (var != k && !util::contains(vars, var)) {
+        return hasBound;
+      }
+    }
+    for (auto& var : vars) {
+      if (!util::contains(coveredVars, var)) {
+        scale = saturatingMul(scale, dims.at(var));
+      }
+    }
+    NnzBound body = hasBound ? *bound : NnzBound();
+    const size_t size = dims.at(k);
+    *bound = [body, countedOperands, constantOperands, size, scale]() {
+      const size_t bodyBound = body ? body() : SIZE_MAX;
+      vector<size_t> products(size, 1);
+      for (auto& operand : countedOperands) {
+        vector<size_t> counts(size, 0);
+        if (!countComponents(operand.first, operand.second, &counts)) {
+          return bodyBound;
+        }
+        for (size_t c = 0; c < size; c++) {
+          products[c] = saturatingMul(products[c], counts[c]);
+        }
+      }
+      size_t combinations = 0;
+      for (size_t product : products) {
+        combinations = saturatingAdd(combinations, product);
+      }
+      for (auto& operand : constantOperands) {
+        combinations = saturatingMul(combinations,
+            operand.getStorage().getIndex().getSize());
+      }
+      return std::min(bodyBound, saturatingMul(combinations, scale));
+    };
+    return true;
+  }
+  return false;
+}
+
+/// Builds the bound on the number of components of the result of its
+/// assignment, or returns an empty bound if none is known.  Results whose
+/// assignment compounds into them or that have a non-zero fill value have no
+/// bound, since they keep the components that they already store.
+static NnzBound getCapacityBound(const TensorBase& result) {
+  Assignment assignment = result.getAssignment();
+  if (!assignment.defined() || assignment.getOperator().defined() ||
+      !isZero(result.getFillValue())) {
+    return NnzBound();
+  }
+
+  map<IndexVar,int> dims;
+  const vector<IndexVar>& resultVars = assignment.getLhs().getIndexVars();
+  for (size_t i = 0; i < resultVars.size(); i++) {
+    dims.insert({resultVars[i], result.getDimension(i)});
+  }
+  bool windowed = false;
+  match(assignment.getRhs(),
+    std::function<void(const AccessNode*)>([&](const AccessNode* op) {
+      windowed |= Access(op).hasWindowedModes();
+      if (isa<AccessTensorNode>(op)) {
+        auto access = to<AccessTensorNode>(op);
+        for (size_t i = 0; i < access->indexVars.size(); i++) {
+          dims.insert({access->indexVars[i], access->tensor.getDimension(i)});
+        }
+      }
+    })
+  );
+
+  NnzBound bound;
+  set<IndexVar> vars(resultVars.begin(), resultVars.end());
+  if (windowed || vars.size() != resultVars.size() ||
+      !getNnzBound(assignment.getRhs(), vars, dims, &bound)) {
+    return NnzBound();
+  }
+  return bound;
+}
+
+/// Returns the initial capacity of the appended index and value arrays of the
+/// result of an assignment, which generated kernels read from `vals_size`.
+static int32_t getInitialCapacity(const TensorBase& result, size_t allocSize,
+                                  bool estimate, const NnzBound& bound) {
+  const size_t maxCapacity = INT_MAX / 2;
+  const size_t nnz = (estimate && bound) ? bound() : SIZE_MAX;
+  if (nnz == SIZE_MAX) {
+    return (int32_t)std::min(std::max(allocSize, (size_t)1), maxCapacity);
+  }
+  size_t denseSize = 1;
+  for (int dimension : result.getDimensions()) {
+    denseSize = saturatingMul(denseSize, dimension);
+  }
+  return (int32_t)std::min(std::max(std::min(nnz, denseSize), (size_t)1),
+                           maxCapacity);
+}
+
 void TensorBase::assemble() {
   taco_uassert(!needsCompile()) << error::assemble_without_compile;
   if (!needsAssemble()) {
@@ -756,8 +1288,44 @@ void TensorBase::assemble() {
     operand.second.syncValues();
   }
 
+  // Keep the index of the previous evaluation if the operands still have the
+  // same sparsity structure, so that compute overwrites the values in place.
+  const bool reusePattern = content->reuseSparsityPattern &&
+                            !content->assembleWhileCompute;
+  vector<char> pattern;
+  if (reusePattern && content->verifySparsityPattern) {
+    pattern = getSparsityPattern(operands);
+  }
+  if (reusePattern && content->hasSparsityPattern &&
+      pattern == content->sparsityPattern) {
+    setNeedsAssemble(false);
+    return;
+  }
+  content->hasSparsityPattern = reusePattern;
+  content->sparsityPattern = std::move(pattern);
+
+  // A structurally masked result with dense operands has the mask's sparsity
+  // pattern, so share its index instead of assembling a new one.
+  TensorBase mask;
+  if (!content->assembleWhileCompute && getSharedMaskIndex(*this, &mask)) {
+    const Index& index = mask.getStorage().getIndex();
+    const size_t nnz = index.getSize();
+    Array values = makeArray(getComponentType(), nnz, getAllocationPolicy());
+    values.zero();
+    content->storage.setIndex(index);
+    content->storage.setValues(values);
+    content->valuesSize = nnz;
+    setNeedsAssemble(false);
+    return;
+  }
+
   auto arguments = packArguments(*this);
-  content->module->callFuncPacked("assemble", arguments.data());
+  ((taco_tensor_t*)arguments[0])->vals_size =
+      getInitialCapacity(*this, content->allocSize, content->estimateAllocSize,
+                         content->capacityBound);
+  content->module->callFuncPacked("assemble", arguments.data(),
+      getResultAllocator(getMemoryPlacement()).get(),
+      content->workspaces.get());
 
   if (!content->assembleWhileCompute) {
     setNeedsAssemble(false);
@@ -780,13 +1348,23 @@ void TensorBase::compute() {
   }
 
   auto arguments = packArguments(*this);
-  this->content->module->callFuncPacked("compute", arguments.data());
+  if (content->assembleWhileCompute) {
+    ((taco_tensor_t*)arguments[0])->vals_size =
+        getInitialCapacity(*this, content->allocSize,
+                           content->estimateAllocSize, content->capacityBound);
+  }
+  content->module->callFuncPacked("compute", arguments.data(),
+      getResultAllocator(getMemoryPlacement()).get(),
+      content->workspaces.get());
 
   if (content->assembleWhileCompute) {
     setNeedsAssemble(false);
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
     content->valuesSize = unpackTensorData(*tensorData, *this);
   }
+  if (content->placement == MemoryPlacement::Replicate) {
+    applyMemoryPlacement();
+  }
 }
 
 void TensorBase::evaluate() {
@@ -838,10 +1416,22 @@ void TensorBase::printAssembleIR(ostream& os, bool color, bool simplify) const {
   printer.print(content->assembleFunc.as<Function>()->body);
 }
 
+void TensorBase::releaseWorkspaces() {
+  content->workspaces->release();
+}
+
+size_t TensorBase::getWorkspaceSize() const {
+  return content->workspaces->getSize();
+}
+
 string TensorBase::getSource() const {
   return content->module->getSource();
 }
 
+string TensorBase::getVectorizationReport() const {
+  return content->module->getVectorizationReport();
+}
+
 void TensorBase::compileSource(std::string source) {
   taco_iassert(getAssignment().getRhs().defined())
       << error::compile_without_expr;
@@ -850,6 +1440,7 @@ void TensorBase::compileSource(std::string source) {
   stmt = reorderLoopsTopologically(stmt);
   stmt = insertTemporaries(stmt);
   stmt = parallelizeOuterLoop(stmt);
+  stmt = exploitSymmetry(stmt);
   content->assembleFunc = lower(stmt, "assemble", true, false);
   content->computeFunc = lower(stmt, "compute",  false, true);
 
@@ -866,6 +1457,8 @@ void TensorBase::compileSource(std::string source) {
   }
   content->module->setSource(source + "\n" + ss.str());
   content->module->compile();
+  content->capacityBound = getCapacityBound(*this);
+  content->workspaces->release();
   setNeedsCompile(false);
 }
 
@@ -1044,6 +1637,11 @@ bool equals(const TensorBase& a, const TensorBase& b) {
     }
   }
 
+  // Fill values must be the same
+  if (!equals(a.getFillValue(), b.getFillValue())) {
+    return false;
+  }
+
   // Values must be the same
   switch(a.getComponentType().getKind()) {
     case Datatype::Bool: taco_ierror; return false;
@@ -1175,39 +1773,69 @@ static string getExtension(string filename) {
 }
 
 template <typename T, typename U>
-TensorBase dispatchRead(T& file, FileType filetype, U format, bool pack) {
+TensorBase dispatchRead(T& file, FileType filetype, U format, Datatype ctype,
+                        bool pack) {
   TensorBase tensor;
   switch (filetype) {
     case FileType::ttx:
     case FileType::mtx:
-      tensor = readMTX(file, format, pack);
+      tensor = readMTX(file, format, ctype, pack);
       break;
     case FileType::tns:
-      tensor = readTNS(file, format, pack);
+      tensor = readTNS(file, format, (ctype == Datatype()) ? Float64 : ctype,
+                       pack);
       break;
     case FileType::rb:
+      taco_uassert(ctype == Datatype() || ctype == Float64)
+          << "Rutherford-Boeing files can only be read as " << Float64;
       tensor = readRB(file, format, pack);
       break;
+    case FileType::ttb:
+      tensor = readTTB(file, format, pack);
+      taco_uassert(ctype == Datatype() || ctype == tensor.getComponentType())
+          << "Cannot read a " << tensor.getComponentType() << " ttb tensor as "
+          << ctype;
+      break;
   }
   return tensor;
 }
 
+/// Read a file of the given file format, decompressing it on the fly if its
+/// name ends in a compression extension.
 template <typename U>
-TensorBase dispatchRead(std::string filename, U format, bool pack) {
-  string extension = getExtension(filename);
+TensorBase dispatchReadFile(std::string filename, FileType filetype, U format,
+                            Datatype ctype, bool pack) {
+  string uncompressed = filename;
+  const Compression compression = stripCompressionExtension(&uncompressed);
+  if (compression == Compression::None) {
+    return dispatchRead(filename, filetype, format, ctype, pack);
+  }
+  DecompressingStream stream(filename, compression);
+  return dispatchRead<std::istream>(stream, filetype, format, ctype, pack);
+}
+
+template <typename U>
+TensorBase dispatchRead(std::string filename, U format, Datatype ctype,
+                        bool pack) {
+  string uncompressed = filename;
+  stripCompressionExtension(&uncompressed);
+  string extension = getExtension(uncompressed);
 
   TensorBase tensor;
   if (extension == "ttx") {
-    tensor = dispatchRead(filename, FileType::ttx, format, pack);
+    tensor = dispatchReadFile(filename, FileType::ttx, format, ctype, pack);
   }
   else if (extension == "tns") {
-    tensor = dispatchRead(filename, FileType::tns, format, pack);
+    tensor = dispatchReadFile(filename, FileType::tns, format, ctype, pack);
   }
   else if (extension == "mtx") {
-    tensor = dispatchRead(filename, FileType::mtx, format, pack);
+    tensor = dispatchReadFile(filename, FileType::mtx, format, ctype, pack);
   }
   else if (extension == "rb") {
-    tensor = dispatchRead(filename, FileType::rb, format, pack);
+    tensor = dispatchReadFile(filename, FileType::rb, format, ctype, pack);
+  }
+  else if (extension == "ttb") {
+    tensor = dispatchReadFile(filename, FileType::ttb, format, ctype, pack);
   }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
@@ -1222,29 +1850,49 @@ TensorBase dispatchRead(std::string filename, U format, bool pack) {
 }
 
 TensorBase read(std::string filename, ModeFormat modetype, bool pack) {
-  return dispatchRead(filename, modetype, pack);
+  return dispatchRead(filename, modetype, Datatype(), pack);
 }
 
 TensorBase read(std::string filename, Format format, bool pack) {
-  return dispatchRead(filename, format, pack);
+  return dispatchRead(filename, format, Datatype(), pack);
 }
 
 TensorBase read(string filename, FileType filetype, ModeFormat modetype,
                 bool pack) {
-  return dispatchRead(filename, filetype, modetype, pack);
+  return dispatchReadFile(filename, filetype, modetype, Datatype(), pack);
 }
 
 TensorBase read(string filename, FileType filetype, Format format, bool pack) {
-  return dispatchRead(filename, filetype, format, pack);
+  return dispatchReadFile(filename, filetype, format, Datatype(), pack);
 }
 
 TensorBase read(istream& stream, FileType filetype, ModeFormat modetype,
                 bool pack) {
-  return dispatchRead(stream, filetype, modetype, pack);
+  return dispatchRead(stream, filetype, modetype, Datatype(), pack);
 }
 
 TensorBase read(istream& stream, FileType filetype, Format format, bool pack) {
-  return dispatchRead(stream, filetype, format, pack);
+  return dispatchRead(stream, filetype, format, Datatype(), pack);
+}
+
+TensorBase read(std::string filename, ModeFormat modetype, Datatype ctype,
+                bool pack) {
+  return dispatchRead(filename, modetype, ctype, pack);
+}
+
+TensorBase read(std::string filename, Format format, Datatype ctype,
+                bool pack) {
+  return dispatchRead(filename, format, ctype, pack);
+}
+
+TensorBase read(istream& stream, FileType filetype, ModeFormat modetype,
+                Datatype ctype, bool pack) {
+  return dispatchRead(stream, filetype, modetype, ctype, pack);
+}
+
+TensorBase read(istream& stream, FileType filetype, Format format,
+                Datatype ctype, bool pack) {
+  return dispatchRead(stream, filetype, format, ctype, pack);
 }
 
 template <typename T>
@@ -1260,6 +1908,9 @@ void dispatchWrite(T& file, const TensorBase& tensor, FileType filetype) {
     case FileType::rb:
       writeRB(file, tensor);
       break;
+    case FileType::ttb:
+      writeTTB(file, tensor);
+      break;
   }
 }
 
@@ -1280,6 +1931,9 @@ void write(string filename, const TensorBase& tensor) {
   else if (extension == "rb") {
     dispatchWrite(filename, tensor, FileType::rb);
   }
+  else if (extension == "ttb") {
+    dispatchWrite(filename, tensor, FileType::ttb);
+  }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstdlib>
 
 #include "test_tensors.h"
 
@@ -531,4 +532,45 @@ TensorBase readTestTensor(std::string filename, Format format) {
   return read(testDirectory()+"/data/"+filename, format, false);
 }
 
+void fillRandom(TensorBase& tensor, int density, double scale) {
+  taco_iassert(tensor.getOrder() > 0);
+  std::vector<int> coordinate(tensor.getOrder(), 0);
+  while (coordinate[0] < tensor.getDimension(0)) {
+    if (rand() % density == 0) {
+      tensor.insert(coordinate, scale * (double) (rand() % 9 + 1));
+    }
+    int mode = tensor.getOrder() - 1;
+    while (++coordinate[mode] == tensor.getDimension(mode) && mode > 0) {
+      coordinate[mode--] = 0;
+    }
+  }
+  tensor.pack();
+}
+
+Tensor<double> denseProduct(Tensor<double>& A, Tensor<double>& B) {
+  const int N = A.getDimension(0);
+  std::vector<std::vector<double>> a(N, std::vector<double>(N, 0.0));
+  std::vector<std::vector<double>> b(N, std::vector<double>(N, 0.0));
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      a[r][c] = A.at({r, c});
+      b[r][c] = B.at({r, c});
+    }
+  }
+  Tensor<double> product("product", {N, N}, CSR);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      double value = 0.0;
+      for (int l = 0; l < N; l++) {
+        value += a[r][l] * b[l][c];
+      }
+      if (value != 0.0) {
+        product.insert({r, c}, value);
+      }
+    }
+  }
+  product.pack();
+  return product;
+}
+
 }}
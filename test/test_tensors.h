@@ -2,6 +2,7 @@
 #define TACO_TEST_TENSORS_H
 
 #include <set>
+#include <atomic>
 #include <vector>
 #include <utility>
 #include <algorithm>
@@ -10,6 +11,7 @@
 
 #include "taco/tensor.h"
 #include "taco/format.h"
+#include "taco/allocator.h"
 #include "taco/util/collections.h"
 
 namespace taco {
@@ -187,5 +189,39 @@ Tensor<double> d33a(std::string name, ModeFormat modeType);
 
 TensorBase readTestTensor(std::string filename, Format format=Sparse);
 
+/// Insert a random value between `scale` and `9*scale` at about one in
+/// `density` of the coordinates of a tensor, and pack it.
+void fillRandom(TensorBase& tensor, int density, double scale=1.0);
+
+/// Returns the product of two square matrices, computed densely, in CSR.
+Tensor<double> denseProduct(Tensor<double>& A, Tensor<double>& B);
+
+/// A kernel allocator that counts the allocations of temporaries and results,
+/// the reallocations of results, and the kernels that it serves.
+class CountingAllocator : public KernelAllocator {
+public:
+  std::atomic<int> temporaries{0};
+  std::atomic<int> results{0};
+  std::atomic<int> reallocations{0};
+  std::atomic<int> kernels{0};
+
+  void* allocate(size_t size, bool temporary) {
+    (temporary ? temporaries : results)++;
+    return KernelAllocator::allocate(size, temporary);
+  }
+
+  void* reallocate(void* ptr, size_t size, bool temporary) {
+    (temporary ? temporaries : results)++;
+    if (!temporary) {
+      reallocations++;
+    }
+    return KernelAllocator::reallocate(ptr, size, temporary);
+  }
+
+  void beginKernel() {
+    kernels++;
+  }
+};
+
 }}
 #endif
@@ -0,0 +1,282 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "taco/tensor.h"
+#include "taco/allocator.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/kernel.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j"), k("k");
+
+TEST(allocator, routesAllocations) {
+  const int N = 29;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, CSR);
+  srand(58391);
+  fillRandom(A, 5);
+  fillRandom(B, 5);
+
+  auto allocator = std::make_shared<CountingAllocator>();
+  setKernelAllocator(allocator);
+  Tensor<double> C("C", {N, N}, CSR);
+  C(i,j) = sum(k, A(i,k) * B(k,j));
+  C.evaluate();
+  setKernelAllocator(nullptr);
+
+  ASSERT_TENSOR_EQ(denseProduct(A, B), C);
+  ASSERT_LT(0, allocator->temporaries.load());
+  ASSERT_LT(0, allocator->results.load());
+  ASSERT_LT(0, allocator->kernels.load());
+}
+
+TEST(allocator, arena) {
+  const int N = 41;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, CSR);
+  srand(12653);
+  fillRandom(A, 4);
+  fillRandom(B, 6);
+  Tensor<double> expected = denseProduct(A, B);
+
+  auto arena = std::make_shared<ArenaAllocator>(256);
+  setKernelAllocator(arena);
+  Tensor<double> C("C", {N, N}, CSR);
+  C(i,j) = sum(k, A(i,k) * B(k,j));
+  C.compile();
+  size_t reserved = 0;
+  for (int run = 0; run < 3; run++) {
+    C.assemble();
+    C.compute();
+    ASSERT_TENSOR_EQ(expected, C);
+    if (run == 0) {
+      reserved = arena->getReservedBytes();
+      ASSERT_LT(0u, reserved);
+    }
+    else {
+      ASSERT_EQ(reserved, arena->getReservedBytes());
+    }
+  }
+  setKernelAllocator(nullptr);
+
+  // The last temporary of a chunk grows in place, while others are copied
+  ArenaAllocator growing(1024);
+  growing.beginKernel();
+  char* first = (char*)growing.allocate(16, true);
+  char* last = (char*)growing.allocate(16, true);
+  first[0] = 5;
+  last[15] = 7;
+  ASSERT_EQ(last, growing.reallocate(last, 200, true));
+  ASSERT_EQ(7, last[15]);
+  char* moved = (char*)growing.reallocate(first, 64, true);
+  ASSERT_NE(first, moved);
+  ASSERT_EQ(5, moved[0]);
+  growing.endKernel();
+}
+
+TEST(allocator, workspacePool) {
+  const int N = 37;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, CSR);
+  srand(90641);
+  fillRandom(A, 5);
+  fillRandom(B, 4);
+  Tensor<double> expected = denseProduct(A, B);
+
+  auto pool = std::make_shared<WorkspacePool>();
+  setKernelAllocator(pool);
+  Tensor<double> C("C", {N, N}, CSR);
+  C(i,j) = sum(k, A(i,k) * B(k,j));
+  C.compile();
+  size_t pooled = 0;
+  for (int run = 0; run < 3; run++) {
+    C.assemble();
+    C.compute();
+    ASSERT_TENSOR_EQ(expected, C);
+    if (run == 0) {
+      pooled = pool->getPooledBytes();
+      ASSERT_LT(0u, pooled);
+    }
+    else {
+      ASSERT_EQ(pooled, pool->getPooledBytes());
+    }
+  }
+  setKernelAllocator(nullptr);
+}
+
+TEST(allocator, perThreadAllocators) {
+  const int N = 31, numThreads = 4, numCalls = 10;
+  Tensor<double> B("B", {N}, Format({Sparse}));
+  Tensor<double> C("C", {N}, Format({Sparse}));
+  srand(70439);
+  fillRandom(B, 3);
+  fillRandom(C, 3);
+  Tensor<double> a("a", {N}, Format({Sparse}));
+  a(i) = B(i) + C(i);
+  Kernel kernel = compile(makeConcreteNotation(a.getAssignment()));
+
+  std::vector<TensorStorage> results;
+  std::vector<std::vector<taco_tensor_t*>> args;
+  std::vector<std::shared_ptr<CountingAllocator>> allocators;
+  for (int t = 0; t < numThreads; t++) {
+    results.push_back(TensorStorage(type<double>(), {N}, Format({Sparse})));
+    args.push_back({results.back(), B.getTacoTensorT(), C.getTacoTensorT()});
+    allocators.push_back(std::make_shared<CountingAllocator>());
+  }
+
+  // Threads that call the same kernel concurrently each allocate the result
+  // arrays with their own allocator
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; t++) {
+    threads.emplace_back([&, t]() {
+      ScopedKernelAllocator allocator(allocators[t]);
+      for (int call = 0; call < numCalls; call++) {
+        kernel.evaluate(args[t].data());
+        taco_tensor_t* result = args[t][0];
+        free(result->indices[0][0]);
+        free(result->indices[0][1]);
+        free(result->vals);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < numThreads; t++) {
+    ASSERT_LT(0, allocators[t]->results.load());
+    ASSERT_EQ(allocators[0]->results.load(), allocators[t]->results.load());
+    ASSERT_EQ(numCalls, allocators[t]->kernels.load());
+  }
+}
+
+static bool isAligned(const void* ptr, size_t alignment) {
+  return (uintptr_t)ptr % alignment == 0;
+}
+
+/// Returns the number in a line of /proc/meminfo, or 0 if it has no such line.
+static size_t readMeminfo(const std::string& key) {
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line)) {
+    if (line.compare(0, key.size(), key) == 0) {
+      return strtoull(line.c_str() + key.size(), nullptr, 10);
+    }
+  }
+  return 0;
+}
+
+TEST(allocator, allocationPolicy) {
+  AllocationPolicy pagePolicy;
+  pagePolicy.alignment = 4096;
+  Array array = makeArray(Float64, 1000, pagePolicy);
+  ASSERT_TRUE(isAligned(array.getData(), 4096));
+  ASSERT_TRUE(isAligned(makeArray(Int32, 3).getData(), 64));
+
+  // Huge pages are a hint, so large arrays are allocated whether or not the
+  // system has them
+  AllocationPolicy hugePolicy;
+  hugePolicy.hugePageThreshold = 1 << 20;
+  for (auto hugePages : {AllocationPolicy::Transparent,
+                         AllocationPolicy::Explicit}) {
+    hugePolicy.hugePages = hugePages;
+    Array large = makeArray(Float64, 1 << 18, hugePolicy);
+    ASSERT_TRUE(isAligned(large.getData(), 64));
+    ((double*)large.getData())[(1 << 18) - 1] = 1.0;
+    Array small = makeArray(Float64, 16, hugePolicy);
+    ASSERT_TRUE(isAligned(small.getData(), 64));
+  }
+
+  char* data = (char*)allocateAligned(100, pagePolicy);
+  ASSERT_TRUE(isAligned(data, 4096));
+  memset(data, 7, 100);
+  data = (char*)reallocateAligned(data, 1 << 16, pagePolicy);
+  ASSERT_TRUE(isAligned(data, 4096));
+  ASSERT_EQ(7, data[99]);
+  free(data);
+
+  AllocationPolicy unaligned;
+  unaligned.alignment = 48;
+  ASSERT_THROW(setAllocationPolicy(unaligned), TacoException);
+  ASSERT_THROW(makeArray(Float64, 8, unaligned), TacoException);
+}
+
+TEST(allocator, tensorAllocationPolicy) {
+  const int N = 47;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, CSR);
+  srand(33017);
+  fillRandom(A, 4);
+  fillRandom(B, 5);
+  Tensor<double> expected = denseProduct(A, B);
+
+  AllocationPolicy pagePolicy;
+  pagePolicy.alignment = 4096;
+  auto assertAligned = [](const TensorBase& tensor) {
+    const TensorStorage& storage = tensor.getStorage();
+    ASSERT_TRUE(isAligned(storage.getValues().getData(), 4096));
+    const ModeIndex& modeIndex = storage.getIndex().getModeIndex(1);
+    for (int a = 0; a < modeIndex.numIndexArrays(); a++) {
+      ASSERT_TRUE(isAligned(modeIndex.getIndexArray(a).getData(), 4096));
+    }
+  };
+
+  // Arrays that kernels allocate for results, and grow while they assemble
+  // them, follow the policy of the result
+  Tensor<double> C("C", {N, N}, CSR);
+  C.setAllocationPolicy(pagePolicy);
+  C.setAllocSize(4);
+  C(i,j) = sum(k, A(i,k) * B(k,j));
+  C.evaluate();
+  ASSERT_TENSOR_EQ(expected, C);
+  assertAligned(C);
+
+  // Arrays the tensor already has are moved
+  A.setAllocationPolicy(pagePolicy);
+  assertAligned(A);
+  ASSERT_TRUE(A.getAllocationPolicy() == pagePolicy);
+  ASSERT_TRUE(B.getAllocationPolicy() == AllocationPolicy());
+
+  // Tensors that do not override the policy follow the default
+  setAllocationPolicy(pagePolicy);
+  Tensor<double> D("D", {N, N}, CSR);
+  D(i,j) = sum(k, A(i,k) * B(k,j));
+  D.evaluate();
+  Tensor<double> E("E", {N, N}, CSR);
+  fillRandom(E, 3);
+  setAllocationPolicy(AllocationPolicy());
+  ASSERT_TENSOR_EQ(expected, D);
+  assertAligned(D);
+  assertAligned(E);
+
+  // Large arrays are mapped from the huge page pool when it has free pages,
+  // and are aligned to huge pages for transparent huge pages otherwise
+  const size_t hugePageKilobytes = readMeminfo("Hugepagesize:");
+  const size_t hugePageSize = (hugePageKilobytes > 0) ? hugePageKilobytes << 10
+                                                       : (size_t)2 << 20;
+  const bool hasFreeHugePages = readMeminfo("HugePages_Free:") > 0;
+  AllocationPolicy hugePolicy;
+  hugePolicy.hugePageThreshold = 4096;
+  for (auto hugePages : {AllocationPolicy::Transparent,
+                         AllocationPolicy::Explicit}) {
+    hugePolicy.hugePages = hugePages;
+    setAllocationPolicy(hugePolicy);
+    Tensor<double> F("F", {64, 64}, Format({Dense,Dense}));
+    fillRandom(F, 64);
+    setAllocationPolicy(AllocationPolicy());
+    const Array& values = F.getStorage().getValues();
+    ASSERT_TRUE(isAligned(values.getData(), hugePageSize));
+    if (hugePages == AllocationPolicy::Explicit && hasFreeHugePages) {
+      ASSERT_EQ(Array::Shared, values.getPolicy());
+    }
+    else {
+      ASSERT_EQ(Array::Free, values.getPolicy());
+    }
+  }
+}
@@ -0,0 +1,166 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <cmath>
+#include <limits>
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j");
+
+TEST(fill, getFillValue) {
+  Tensor<double> a("a", {8}, Format({Sparse}));
+  Tensor<double> b("b", {8}, Format({Sparse}));
+  b.setFillValue(2.0);
+
+  ASSERT_TRUE(isZero(getFillValue(a(i) * b(i))));
+  ASSERT_EQ(5.0, getFillValue(b(i) + 3.0).getVal<double>());
+  ASSERT_EQ(1.0, getFillValue(exp(a(i))).getVal<double>());
+  ASSERT_EQ(4.0, getFillValue(b(i) * b(i)).getVal<double>());
+}
+
+TEST(fill, expStaysSparse) {
+  const int N = 27;
+  Tensor<double> A("A", {N, N}, CSR);
+
+  srand(51803);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (rand() % 7 == 0) {
+        A.insert({r, c}, (double) (rand() % 5) / 4.0);
+      }
+    }
+  }
+  A.pack();
+
+  Tensor<double> B("B", {N, N}, CSR);
+  B.setFillValue(1.0);
+  B(i,j) = exp(A(i,j));
+  B.evaluate();
+
+  ASSERT_EQ(A.getStorage().getIndex().getSize(),
+            B.getStorage().getIndex().getSize());
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      ASSERT_DOUBLE_EQ(std::exp(A.at({r, c})), B.at({r, c}));
+    }
+  }
+}
+
+TEST(fill, maxWithNegativeInfinity) {
+  const double ninf = -std::numeric_limits<double>::infinity();
+  Tensor<double> b("b", {10}, Format({Sparse}));
+  Tensor<double> c("c", {10}, Format({Sparse}));
+  b.setFillValue(ninf);
+  c.setFillValue(ninf);
+  b.insert({1}, 4.0);
+  b.insert({5}, -2.0);
+  c.insert({5}, 3.0);
+  c.insert({8}, -1.0);
+  b.pack();
+  c.pack();
+
+  Tensor<double> a("a", {10}, Format({Sparse}));
+  a(i) = taco::max(b(i), c(i));
+  a.evaluate();
+
+  Tensor<double> expected("expected", {10}, Format({Sparse}));
+  expected.setFillValue(ninf);
+  expected.insert({1}, 4.0);
+  expected.insert({5}, 3.0);
+  expected.insert({8}, -1.0);
+  expected.pack();
+  ASSERT_TENSOR_EQ(expected, a);
+  ASSERT_EQ(ninf, a.at({0}));
+}
+
+TEST(fill, productWithNonZeroFill) {
+  const int N = 41;
+  Tensor<double> b("b", {N}, Format({Sparse}));
+  Tensor<double> c("c", {N}, Format({Sparse}));
+  b.setFillValue(2.0);
+
+  srand(83117);
+  for (int k = 0; k < N; k++) {
+    if (rand() % 3 == 0) {
+      b.insert({k}, (double) (rand() % 9 + 3));
+    }
+    if (rand() % 3 == 0) {
+      c.insert({k}, (double) (rand() % 9 + 1));
+    }
+  }
+  b.pack();
+  c.pack();
+
+  Tensor<double> a("a", {N}, Format({Sparse}));
+  a(i) = b(i) * c(i);
+  a.evaluate();
+
+  ASSERT_TRUE(isZero(a.getFillValue()));
+  ASSERT_EQ(c.getStorage().getIndex().getSize(),
+            a.getStorage().getIndex().getSize());
+  for (int k = 0; k < N; k++) {
+    ASSERT_DOUBLE_EQ(b.at({k}) * c.at({k}), a.at({k})) << k;
+  }
+}
+
+TEST(fill, reductionOverNonZeroFill) {
+  const int N = 19;
+  Tensor<double> A("A", {N, N}, CSR);
+  A.setFillValue(1.0);
+
+  srand(29363);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (rand() % 4 == 0) {
+        A.insert({r, c}, (double) (rand() % 6));
+      }
+    }
+  }
+  A.pack();
+
+  Tensor<double> y("y", {N}, Format({Dense}));
+  y(i) = sum(j, A(i,j));
+  y.evaluate();
+
+  for (int r = 0; r < N; r++) {
+    double expected = 0.0;
+    for (int c = 0; c < N; c++) {
+      expected += A.at({r, c});
+    }
+    ASSERT_DOUBLE_EQ(expected, y.at({r})) << r;
+  }
+}
+
+TEST(fill, sparseDivisionStaysSparse) {
+  Tensor<double> b("b", {10}, Format({Sparse}));
+  Tensor<double> c("c", {10}, Format({Sparse}));
+  b.insert({1}, 4.0);
+  b.insert({5}, 8.0);
+  c.insert({5}, 2.0);
+  c.insert({8}, 16.0);
+  b.pack();
+  c.pack();
+
+  Tensor<double> a("a", {10}, Format({Sparse}));
+  a(i) = b(i) / c(i);
+  a.evaluate();
+  ASSERT_EQ(std::string::npos, a.getSource().find("while (i < "));
+  Tensor<double> expected("expected", {10}, Format({Sparse}));
+  expected.insert({5}, 4.0);
+  expected.pack();
+  ASSERT_TENSOR_EQ(expected, a);
+
+  // The quotient is NaN where neither operand is stored, which is ignored as
+  // long as no tensor declares a non-zero fill, so only the union of the
+  // operands is iterated over
+  Tensor<double> d("d", {10}, Format({Sparse}));
+  d(i) = log(b(i)) / log(c(i));
+  d.evaluate();
+  ASSERT_EQ(std::string::npos, d.getSource().find("while (i < "));
+  ASSERT_DOUBLE_EQ(std::log(8.0) / std::log(2.0), d.at({5}));
+  ASSERT_EQ(0.0, d.at({0}));
+}
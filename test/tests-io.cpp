@@ -1,6 +1,29 @@
 #include "test.h"
 
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#ifdef TACO_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TACO_ZSTD
+#include <zstd.h>
+#endif
+
 #include "taco/tensor.h"
+#include "taco/util/env.h"
+#include "taco/storage/file_io_tns.h"
+#include "taco/storage/file_io_ttb.h"
+#include "storage/coordinate_parser.h"
+#include "storage/coordinate_writer.h"
+#include "storage/decompressing_stream.h"
 
 using namespace taco;
 
@@ -127,3 +150,391 @@ TEST(io, mtxsymmetric) {
 
   ASSERT_TRUE(equals(expected, tensor));
 }
+
+TEST(io, ttb) {
+  TensorBase tensor = read(testDataDirectory()+"d567.ttx", Sparse);
+  tensor.setFillValue(Literal(0.0));
+  std::string filename = util::getTmpdir() + "/d567.ttb";
+  write(filename, tensor);
+
+  // Reading in the stored format maps the file
+  TensorBase mapped = read(filename, Sparse);
+  ASSERT_EQ(Format({Sparse,Sparse,Sparse}), mapped.getFormat());
+  ASSERT_EQ(Array::Shared, mapped.getStorage().getValues().getPolicy());
+  ASSERT_TRUE(equals(tensor, mapped));
+
+  // Reading in another format converts the tensor
+  TensorBase converted = read(filename, Format({Dense,Sparse,Dense}));
+  ASSERT_EQ(Format({Dense,Sparse,Dense}), converted.getFormat());
+  ASSERT_TRUE(equals(tensor, converted));
+
+  std::ifstream stream(filename, std::ios::binary);
+  TensorBase streamed = read(stream, FileType::ttb, Sparse);
+  ASSERT_TRUE(equals(tensor, streamed));
+}
+
+TEST(io, sharedTensor) {
+  TensorBase tensor = read(testDataDirectory()+"d567.ttx", Sparse);
+  tensor.setFillValue(Literal(0.0));
+  const std::string name = "taco-test-" + std::to_string(getpid());
+  createSharedTensor(name, tensor);
+  ASSERT_THROW(createSharedTensor(name, tensor), TacoException);
+
+  TensorBase attached = attachSharedTensor(name);
+  TensorBase other = attachSharedTensor("/" + name);
+  ASSERT_EQ(Array::Shared, attached.getStorage().getValues().getPolicy());
+  ASSERT_TRUE(equals(tensor, attached));
+
+  // Attachments are private, so writing to one does not change the others
+  ((double*)attached.getStorage().getValues().getData())[0] += 1.0;
+  ASSERT_FALSE(equals(tensor, attached));
+  ASSERT_TRUE(equals(tensor, other));
+
+  // Removing the name keeps existing attachments valid
+  removeSharedTensor(name);
+  ASSERT_TRUE(equals(tensor, other));
+  ASSERT_THROW(attachSharedTensor(name), TacoException);
+  ASSERT_THROW(createSharedTensor("a/b", tensor), TacoException);
+
+  // Tensors whose magic number has not been stored yet are incomplete
+  const std::string sharedName = "/" + name;
+  int fd = shm_open(sharedName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  ASSERT_LE(0, fd);
+  ASSERT_EQ(0, ftruncate(fd, 4096));
+  close(fd);
+  try {
+    attachSharedTensor(name);
+    FAIL() << "Attached an incomplete shared tensor";
+  }
+  catch (const TacoException& e) {
+    ASSERT_NE(std::string::npos,
+              std::string(e.what()).find("still being created"));
+  }
+  removeSharedTensor(name);
+}
+
+TEST(io, parseDouble) {
+  const std::vector<std::string> numbers = {
+    "0", "-0", "1", "+2.5", "3.14159265358979", "0.1", "0.30000000000000004",
+    "1e22", "1e23", "2.2250738585072014e-308", "4.9e-324", "1.7976931348623157e308",
+    "123456789012345678901234567890", ".5", "5.", "-1.25E-3", "0x1p3", "inf",
+    "nan", "9007199254740993", "0.000000000000000000001"
+  };
+  for (auto& number : numbers) {
+    std::string token = number + "\n";
+    const char* ptr = token.data();
+    double value;
+    ASSERT_TRUE(parseDouble(ptr, &value)) << number;
+    double expected = strtod(token.data(), nullptr);
+    if (std::isnan(expected)) {
+      ASSERT_TRUE(std::isnan(value)) << number;
+    }
+    else {
+      ASSERT_EQ(0, memcmp(&expected, &value, sizeof(double))) << number;
+    }
+    ASSERT_EQ('\n', *ptr) << number;
+  }
+  const char* ptr = "x";
+  double value;
+  ASSERT_FALSE(parseDouble(ptr, &value));
+}
+
+TEST(io, parseCoordinates) {
+  srand(51407);
+  std::vector<std::vector<int>> coordinates(3);
+  std::vector<double> values;
+  std::stringstream stream;
+  stream << "# comment" << std::endl;
+  for (int i = 0; i < 1000; i++) {
+    for (auto& modeCoordinates : coordinates) {
+      modeCoordinates.push_back(rand() % 100);
+      stream << modeCoordinates.back() + 1 << ((i % 2) ? "\t" : " ");
+    }
+    values.push_back((double)rand() / RAND_MAX);
+    stream << std::setprecision(17) << values.back() << std::endl;
+    if (i % 100 == 0) {
+      stream << std::endl;
+    }
+  }
+
+  // Small blocks split lines across reads and threads
+  std::vector<CoordinateBlock> blocks = parseCoordinates(stream, -1, 1, false, 4, 1000);
+  std::vector<std::vector<int>> parsedCoordinates(3);
+  std::vector<double> parsedValues;
+  for (auto& block : blocks) {
+    ASSERT_EQ(3u, block.coordinates.size());
+    for (size_t mode = 0; mode < 3; mode++) {
+      parsedCoordinates[mode].insert(parsedCoordinates[mode].end(),
+                                     block.coordinates[mode].begin(),
+                                     block.coordinates[mode].end());
+    }
+    parsedValues.insert(parsedValues.end(), block.values.begin(),
+                        block.values.end());
+  }
+  ASSERT_EQ(coordinates, parsedCoordinates);
+  ASSERT_EQ(values, parsedValues);
+
+  std::stringstream malformed("1 2 3.0\n1 x 2.0\n");
+  ASSERT_THROW(parseCoordinates(malformed, 2), TacoException);
+  for (std::string value : {"1.5abc", "2.0x", "3e5,"}) {
+    std::stringstream trailing("1 2 " + value + "\n");
+    ASSERT_THROW(parseCoordinates(trailing, 2), TacoException) << value;
+  }
+}
+
+TEST(io, mtxpattern) {
+  std::string pattern = "%%MatrixMarket matrix coordinate pattern symmetric\n"
+                        "% comment\n"
+                        "3 3 3\n"
+                        "1 1\n"
+                        "2 1\n"
+                        "3 2\n";
+  std::stringstream stream(pattern);
+  TensorBase tensor = read(stream, FileType::mtx, Sparse);
+  ASSERT_EQ(taco::Bool, tensor.getComponentType());
+  std::set<std::vector<int>> coordinates;
+  for (auto& value : iterate<bool>(tensor)) {
+    ASSERT_TRUE(value.second);
+    coordinates.insert(value.first.toVector());
+  }
+  std::set<std::vector<int>> expected = {{0,0}, {1,0}, {0,1}, {2,1}, {1,2}};
+  ASSERT_EQ(expected, coordinates);
+
+  std::stringstream floatStream(pattern);
+  TensorBase floats = read(floatStream, FileType::mtx, Sparse, Float32);
+  ASSERT_EQ(Float32, floats.getComponentType());
+  for (auto& value : iterate<float>(floats)) {
+    ASSERT_EQ(1.0f, value.second);
+  }
+}
+
+TEST(io, mtxfields) {
+  std::stringstream integers("%%MatrixMarket matrix coordinate integer general\n"
+                             "2 2 2\n"
+                             "1 2 -3\n"
+                             "2 1 9007199254740993\n");
+  TensorBase tensor = read(integers, FileType::mtx, Sparse);
+  ASSERT_EQ(Int64, tensor.getComponentType());
+  TensorBase expected(Int64, {2,2}, Sparse);
+  expected.insert({0, 1}, (int64_t)-3);
+  expected.insert({1, 0}, (int64_t)9007199254740993);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, tensor));
+
+  // Integers are read exactly, also beyond the 53 bits of a double
+  std::stringstream integerArray("%%MatrixMarket matrix array integer general\n"
+                                 "2 1\n"
+                                 "-9007199254740993\n"
+                                 "4611686018427387905\n");
+  tensor = read(integerArray, FileType::mtx, Dense);
+  expected = TensorBase(Int64, {2,1}, Dense);
+  expected.insert({0, 0}, (int64_t)-9007199254740993);
+  expected.insert({1, 0}, (int64_t)4611686018427387905);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, tensor));
+
+  std::stringstream fraction("%%MatrixMarket matrix coordinate integer general\n"
+                             "1 1 1\n"
+                             "1 1 2.5\n");
+  ASSERT_THROW(read(fraction, FileType::mtx, Sparse), TacoException);
+
+  std::stringstream complex("%%MatrixMarket matrix coordinate complex hermitian\n"
+                            "2 2 2\n"
+                            "1 1 1.0 0.0\n"
+                            "2 1 2.0 3.0\n");
+  tensor = read(complex, FileType::mtx, Sparse);
+  ASSERT_EQ(Complex128, tensor.getComponentType());
+  expected = TensorBase(Complex128, {2,2}, Sparse);
+  expected.insert({0, 0}, std::complex<double>(1.0, 0.0));
+  expected.insert({1, 0}, std::complex<double>(2.0, 3.0));
+  expected.insert({0, 1}, std::complex<double>(2.0, -3.0));
+  expected.pack();
+  ASSERT_TRUE(equals(expected, tensor));
+
+  std::stringstream skew("%%MatrixMarket matrix array real skew-symmetric\n"
+                         "2 2\n"
+                         "0\n"
+                         "4.5\n"
+                         "0\n"
+                         "0\n");
+  tensor = read(skew, FileType::mtx, Dense, Float32);
+  expected = TensorBase(Float32, {2,2}, Dense);
+  expected.insert({1, 0}, 4.5f);
+  expected.insert({0, 1}, -4.5f);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, tensor));
+
+  std::stringstream mismatch("%%MatrixMarket matrix coordinate complex general\n"
+                             "1 1 1\n"
+                             "1 1 1.0 2.0\n");
+  ASSERT_THROW(read(mismatch, FileType::mtx, Sparse, Float64), TacoException);
+}
+
+TEST(io, tnstype) {
+  TensorBase tensor = read(testDataDirectory()+"3tensor.tns", Sparse, Float32);
+  ASSERT_EQ(Float32, tensor.getComponentType());
+  TensorBase expected(Float32, {1073,1,7});
+  expected.insert({735,  0, 0}, 1.0f);
+  expected.insert({1072, 0, 5}, 1.1f);
+  expected.insert({880,  0, 6}, 1.0f);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, tensor));
+}
+
+TEST(io, formatDouble) {
+  const std::vector<double> numbers = {
+    0.0, -0.0, 1.0, -7.0, 999999.0, 1000000.0, -1000000.0, 0.5, 1.0/3.0,
+    123456.5, 1e-5, 2.5e17, -3.75e-300, INFINITY, -INFINITY, NAN
+  };
+  for (double number : numbers) {
+    std::stringstream expected;
+    expected << number;
+    std::string buffer;
+    formatDouble(buffer, number);
+    ASSERT_EQ(expected.str(), buffer);
+  }
+}
+
+TEST(io, writeBuffered) {
+  // Writing traverses the packed arrays in parallel, which must produce the
+  // lines the iterator produces
+  const std::vector<Format> formats = {
+    CSR, CSC, DCSR, Format({Dense,Dense}), COO(2), COO(2, false, true, false,
+    {1,0})
+  };
+  srand(27011);
+  for (auto& format : formats) {
+    TensorBase tensor(Float64, {307, 211}, format);
+    for (int n = 0; n < 2000; n++) {
+      tensor.insert({rand() % 307, rand() % 211},
+                    (double)(rand() % 2000) / 8.0 - 100.0);
+    }
+    tensor.pack();
+
+    std::stringstream expected;
+    for (auto& value : iterate<double>(tensor)) {
+      expected << value.first[0]+1 << " " << value.first[1]+1 << " "
+               << value.second << "\n";
+    }
+    std::stringstream written;
+    writeTNS(written, tensor);
+    ASSERT_EQ(expected.str(), written.str()) << format;
+  }
+
+  std::stringstream lines;
+  writeFormatted(lines, 1000, [](size_t begin, size_t end,
+                                 std::string& buffer) {
+    for (size_t i = begin; i < end; i++) {
+      formatUnsigned(buffer, i);
+      buffer += '\n';
+    }
+  }, 7, 4);
+  for (size_t i = 0; i < 1000; i++) {
+    std::string line;
+    std::getline(lines, line);
+    ASSERT_EQ(std::to_string(i), line);
+  }
+}
+
+#ifdef TACO_ZLIB
+TEST(io, gzip) {
+  TensorBase tensor = read(testDataDirectory()+"d567.ttx", Sparse);
+  tensor.setFillValue(Literal(0.0));
+  std::stringstream text;
+  writeTNS(text, tensor);
+  const std::string contents = text.str();
+
+  // Write the file as two gzip members, which readers must concatenate
+  std::string filename = util::getTmpdir() + "/d567.tns.gz";
+  const size_t half = contents.size() / 2;
+  const std::vector<std::string> members = {contents.substr(0, half),
+                                            contents.substr(half)};
+  for (size_t i = 0; i < members.size(); i++) {
+    const std::string& member = members[i];
+    gzFile file = gzopen(filename.c_str(), (i == 0) ? "wb" : "ab");
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ((int)member.size(), gzwrite(file, member.data(), member.size()));
+    gzclose(file);
+  }
+
+  // Small buffers exercise the queue between the decompressing thread and the
+  // reader
+  DecompressingStream stream(filename, Compression::Gzip, 61, 2);
+  std::string decompressed((std::istreambuf_iterator<char>(stream)),
+                           std::istreambuf_iterator<char>());
+  ASSERT_EQ(contents, decompressed);
+
+  TensorBase readTensor = read(filename, Sparse);
+  ASSERT_EQ("d567", readTensor.getName());
+  ASSERT_TRUE(equals(tensor, readTensor));
+
+  // Highly compressed contents that end exactly on a buffer boundary leave
+  // output in the decompressor after the last input is read
+  std::string boundary;
+  for (int i = 0; boundary.size() < 64 * 1000; i++) {
+    boundary += std::to_string(i % 10);
+  }
+  std::string boundaryFilename = util::getTmpdir() + "/boundary.gz";
+  gzFile boundaryFile = gzopen(boundaryFilename.c_str(), "wb");
+  ASSERT_NE(nullptr, boundaryFile);
+  ASSERT_EQ((int)boundary.size(),
+            gzwrite(boundaryFile, boundary.data(), boundary.size()));
+  gzclose(boundaryFile);
+  DecompressingStream boundaryStream(boundaryFilename, Compression::Gzip, 64, 2);
+  ASSERT_EQ(boundary,
+            std::string((std::istreambuf_iterator<char>(boundaryStream)),
+                        std::istreambuf_iterator<char>()));
+  remove(boundaryFilename.c_str());
+
+  std::string truncated = util::getTmpdir() + "/truncated.tns.gz";
+  {
+    std::ifstream in(filename, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    std::ofstream out(truncated, std::ios::binary);
+    out << bytes.substr(0, bytes.size() - 10);
+  }
+  ASSERT_THROW(read(truncated, Sparse), TacoException);
+}
+#endif
+
+#ifdef TACO_ZSTD
+TEST(io, zstd) {
+  TensorBase tensor = read(testDataDirectory()+"d567.ttx", Sparse);
+  tensor.setFillValue(Literal(0.0));
+  std::stringstream text;
+  writeTNS(text, tensor);
+  // Pad the contents to a multiple of the buffer size, so that they end
+  // exactly on a buffer boundary
+  std::string contents = text.str();
+  contents.append(64 - contents.size() % 64, '\n');
+
+  std::string compressed(ZSTD_compressBound(contents.size()), '\0');
+  const size_t size = ZSTD_compress(&compressed[0], compressed.size(),
+                                    contents.data(), contents.size(), 19);
+  ASSERT_FALSE(ZSTD_isError(size));
+  compressed.resize(size);
+  std::string filename = util::getTmpdir() + "/d567.tns.zst";
+  {
+    std::ofstream out(filename, std::ios::binary);
+    out << compressed;
+  }
+
+  DecompressingStream stream(filename, Compression::Zstd, 64, 2);
+  std::string decompressed((std::istreambuf_iterator<char>(stream)),
+                           std::istreambuf_iterator<char>());
+  ASSERT_EQ(contents, decompressed);
+
+  TensorBase readTensor = read(filename, Sparse);
+  ASSERT_TRUE(equals(tensor, readTensor));
+
+  std::string truncated = util::getTmpdir() + "/truncated.tns.zst";
+  {
+    std::ofstream out(truncated, std::ios::binary);
+    out << compressed.substr(0, compressed.size() - 10);
+  }
+  ASSERT_THROW(read(truncated, Sparse), TacoException);
+  remove(filename.c_str());
+  remove(truncated.c_str());
+}
+#endif
@@ -0,0 +1,103 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <thread>
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/kernel.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j");
+
+TEST(kernel, concurrentRawCompute) {
+  const int N = 57, numThreads = 4, numCalls = 20;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> x("x", {N}, Format({Dense}));
+  srand(24097);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (rand() % 5 == 0) {
+        A.insert({r, c}, (double) (rand() % 9 + 1));
+      }
+    }
+    x.insert({r}, (double) (rand() % 7));
+  }
+  A.pack();
+  x.pack();
+
+  Tensor<double> expected("expected", {N}, Format({Dense}));
+  expected(i) = A(i,j) * x(j);
+  expected.evaluate();
+
+  // Every thread computes into its own result with the same kernel
+  std::vector<Tensor<double>> ys;
+  for (int t = 0; t < numThreads; t++) {
+    ys.push_back(Tensor<double>("y", {N}, Format({Dense})));
+    ys.back().pack();
+  }
+  Tensor<double>& y = ys[0];
+  y(i) = A(i,j) * x(j);
+  Kernel kernel = compile(makeConcreteNotation(y.getAssignment()));
+
+  // Converting a tensor to a taco_tensor_t updates its storage, so the
+  // arguments are converted before the threads start
+  std::vector<std::vector<taco_tensor_t*>> args;
+  for (int t = 0; t < numThreads; t++) {
+    args.push_back({ys[t].getTacoTensorT(), A.getTacoTensorT(),
+                    x.getTacoTensorT()});
+  }
+  std::vector<char> succeeded(numThreads, true);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int call = 0; call < numCalls; call++) {
+        succeeded[t] = succeeded[t] && kernel.compute(args[t].data());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int t = 0; t < numThreads; t++) {
+    ASSERT_TRUE(succeeded[t]);
+    const double* vals = (const double*)args[t][0]->vals;
+    for (int r = 0; r < N; r++) {
+      ASSERT_DOUBLE_EQ(expected.at({r}), vals[r]) << t << ": " << r;
+    }
+  }
+}
+
+TEST(kernel, evaluateStorage) {
+  const int N = 23;
+  Tensor<double> B("B", {N}, Format({Sparse}));
+  Tensor<double> C("C", {N}, Format({Sparse}));
+  srand(63419);
+  for (int k = 0; k < N; k++) {
+    if (rand() % 3 == 0) {
+      B.insert({k}, (double) (rand() % 9 + 1));
+    }
+    if (rand() % 3 == 0) {
+      C.insert({k}, (double) (rand() % 9 + 1));
+    }
+  }
+  B.pack();
+  C.pack();
+
+  Tensor<double> expected("expected", {N}, Format({Sparse}));
+  expected(i) = B(i) + C(i);
+  expected.evaluate();
+
+  Tensor<double> a("a", {N}, Format({Sparse}));
+  a(i) = B(i) + C(i);
+  Kernel kernel = compile(makeConcreteNotation(a.getAssignment()));
+  for (int call = 0; call < 3; call++) {
+    TensorStorage storage(type<double>(), {N}, Format({Sparse}));
+    ASSERT_TRUE(kernel(storage, B.getStorage(), C.getStorage()));
+    Tensor<double> result({N}, Format({Sparse}));
+    result.setStorage(storage);
+    ASSERT_TENSOR_EQ(expected, result);
+  }
+}
@@ -15,6 +15,7 @@
 #include "taco/lower/lower.h"
 #include "taco/format.h"
 #include "taco/util/strings.h"
+#include "codegen/codegen_c.h"
 
 namespace taco {
 namespace test {
@@ -1556,4 +1557,87 @@ TEST_STMT(vector_not,
   }
 )
 
+TEST(lower, vectorizePragmas) {
+  ir::Expr n = ir::Var::make("n", Int32);
+  ir::Expr i = ir::Var::make("i", Int32);
+  ir::Expr t = ir::Var::make("t", Float64);
+  ir::Expr x = ir::Var::make("x", Float64, true);
+  ir::Expr y = ir::Var::make("y", Float64, true);
+  ir::Expr idx = ir::Var::make("idx", Int32, true);
+  ir::Expr j = ir::Var::make("j", Int32);
+  ir::Expr w = ir::Var::make("w", Float64, true);
+  auto vectorized = [&](ir::Stmt body) {
+    return ir::For::make(i, 0, n, 1, body, ir::LoopKind::Vectorized);
+  };
+  ir::Expr xi = ir::Load::make(x, i);
+  ir::Stmt body = ir::Block::make({
+    // Stores to affine locations are independent
+    vectorized(ir::Store::make(y, ir::Add::make(ir::Mul::make(2, i), 1), xi)),
+    // So are they when a scalar recurrence prevents simd
+    vectorized(ir::Block::make(ir::Store::make(y, i, xi),
+                               ir::Assign::make(t, ir::Sub::make(xi, t)))),
+    // Stores through an index array may collide
+    vectorized(ir::Store::make(y, ir::Load::make(idx, i), xi)),
+    // Updates that load the stored location are independent
+    vectorized(ir::Store::make(y, i, ir::Add::make(ir::Load::make(y, i), xi))),
+    // Every iteration writes the workspace of a nested loop
+    vectorized(ir::For::make(j, 0, n, 1, ir::Store::make(w, j, xi))),
+    // Iterations read what the next iteration writes
+    vectorized(ir::Store::make(y, i, ir::Load::make(y, ir::Add::make(i, 1))))
+  });
+  ir::Stmt func = ir::Function::make("vectorize", {}, {n, t, x, y, idx, w},
+                                     body);
+
+  std::stringstream source;
+  ir::CodeGen_C codegen(source, ir::CodeGen::ImplementationGen);
+  codegen.setCompilerFamily(Target::GCC);
+  codegen.compile(func, false);
+  std::vector<std::string> pragmas;
+  std::string line;
+  while (std::getline(source, line)) {
+    if (line.find("#pragma") != std::string::npos) {
+      pragmas.push_back(line.substr(line.find("#pragma")));
+    }
+  }
+  ASSERT_EQ(std::vector<std::string>({"#pragma omp simd", "#pragma GCC ivdep",
+                                      "#pragma omp simd"}),
+            pragmas) << source.str();
+}
+
+TEST(lower, restrictPointers) {
+  ir::Expr n = ir::Var::make("n", Int32);
+  ir::Expr x = ir::Var::make("x", Float64, true);
+  ir::Expr y = ir::Var::make("y", Float64, true);
+  ir::Expr z = ir::Var::make("z", Float64, true);
+  ir::Stmt body = ir::Block::make({
+    ir::VarDecl::make(n, 8),
+    ir::VarDecl::make(x, 0),
+    ir::Allocate::make(x, n),
+    ir::VarDecl::make(y, x),
+    ir::Store::make(y, 0, ir::Literal::make(1.0)),
+    ir::VarDecl::make(z, 0),
+    ir::Allocate::make(z, n),
+    ir::Store::make(z, 0, ir::Load::make(x, 0)),
+    ir::Free::make(x),
+    ir::Free::make(z)
+  });
+  ir::Stmt func = ir::Function::make("copyPointer", {}, {}, body);
+
+  std::stringstream source;
+  ir::CodeGen_C codegen(source, ir::CodeGen::ImplementationGen);
+  codegen.compile(func, false);
+
+  // y copies x, so neither may be declared restrict
+  ASSERT_NE(std::string::npos, source.str().find("double* x = 0;"))
+      << source.str();
+  ASSERT_NE(std::string::npos, source.str().find("double* y = x;"))
+      << source.str();
+  ASSERT_NE(std::string::npos, source.str().find("double* restrict z = 0;"))
+      << source.str();
+  ASSERT_NE(std::string::npos, source.str().find(
+      "z = (double*)TACO_ASSUME_ALIGNED(taco_allocate(taco_kernelAllocator, "
+      "sizeof(double) * n, 1));"))
+      << source.str();
+}
+
 }}
@@ -0,0 +1,163 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j"), k("k");
+
+TEST(mask, sddmm) {
+  const int N = 31, K = 7;
+  Tensor<double> M("M", {N, N}, CSR);
+  Tensor<double> A("A", {N, K}, Format({Dense, Dense}));
+  Tensor<double> B("B", {N, K}, Format({Dense, Dense}));
+  std::vector<std::vector<bool>> m(N, std::vector<bool>(N, false));
+
+  srand(48271);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (rand() % 6 == 0) {
+        m[r][c] = true;
+        M.insert({r, c}, 1.0);
+      }
+    }
+    for (int l = 0; l < K; l++) {
+      A.insert({r, l}, (double) (rand() % 10));
+      B.insert({r, l}, (double) (rand() % 10));
+    }
+  }
+  M.pack();
+  A.pack();
+  B.pack();
+
+  Tensor<double> C("C", {N, N}, CSR);
+  C(i,j) = mask(M(i,j), A(i,k) * B(j,k));
+  C.evaluate();
+
+  Tensor<double> expected("expected", {N, N}, CSR);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (m[r][c]) {
+        double dot = 0.0;
+        for (int l = 0; l < K; l++) {
+          dot += A.at({r, l}) * B.at({c, l});
+        }
+        expected.insert({r, c}, dot);
+      }
+    }
+  }
+  expected.pack();
+  ASSERT_TENSOR_EQ(expected, C);
+
+  // The result shares the sparsity pattern of the mask.
+  const Index& maskIndex = M.getStorage().getIndex();
+  const Index& resultIndex = C.getStorage().getIndex();
+  ASSERT_EQ(maskIndex.getSize(), resultIndex.getSize());
+  ASSERT_EQ(maskIndex.getModeIndex(1).getIndexArray(1).getData(),
+            resultIndex.getModeIndex(1).getIndexArray(1).getData());
+}
+
+TEST(mask, maskedSpGEMM) {
+  const int N = 23;
+  Tensor<double> M("M", {N, N}, CSR);
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, CSR);
+  std::vector<std::vector<double>> a(N, std::vector<double>(N, 0.0));
+  std::vector<std::vector<double>> b(N, std::vector<double>(N, 0.0));
+  std::vector<std::vector<bool>> m(N, std::vector<bool>(N, false));
+
+  srand(71993);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (rand() % 3 == 0) {
+        m[r][c] = true;
+        M.insert({r, c}, 1.0);
+      }
+      if (rand() % 4 == 0) {
+        a[r][c] = (double) (rand() % 9 + 1);
+        A.insert({r, c}, a[r][c]);
+      }
+      if (rand() % 4 == 0) {
+        b[r][c] = (double) (rand() % 9 + 1);
+        B.insert({r, c}, b[r][c]);
+      }
+    }
+  }
+  M.pack();
+  A.pack();
+  B.pack();
+
+  Tensor<double> C("C", {N, N}, Format({Dense, Dense}));
+  C(i,j) = mask(M(i,j), A(i,k) * B(k,j));
+  C.evaluate();
+
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      double expected = 0.0;
+      if (m[r][c]) {
+        for (int l = 0; l < N; l++) {
+          expected += a[r][l] * b[l][c];
+        }
+      }
+      ASSERT_DOUBLE_EQ(expected, C.at({r, c})) << "(" << r << "," << c << ")";
+    }
+  }
+}
+
+TEST(mask, complementSparseVector) {
+  Tensor<double> m("m", {10}, Format({Sparse}));
+  Tensor<double> b("b", {10}, Format({Sparse}));
+  m.insert({1}, 1.0);
+  m.insert({4}, 1.0);
+  m.insert({7}, 1.0);
+  b.insert({0}, 2.0);
+  b.insert({4}, 3.0);
+  b.insert({7}, 5.0);
+  b.insert({9}, 6.0);
+  m.pack();
+  b.pack();
+
+  Tensor<double> a("a", {10}, Format({Sparse}));
+  a(i) = maskComplement(m(i), b(i));
+  a.evaluate();
+
+  Tensor<double> expected("expected", {10}, Format({Sparse}));
+  expected.insert({0}, 2.0);
+  expected.insert({9}, 6.0);
+  expected.pack();
+  ASSERT_TENSOR_EQ(expected, a);
+}
+
+TEST(mask, complementCSR) {
+  const int N = 19;
+  Tensor<double> M("M", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, CSR);
+  Tensor<double> expected("expected", {N, N}, CSR);
+
+  srand(20411);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      const bool masked = rand() % 3 == 0;
+      if (masked) {
+        M.insert({r, c}, 1.0);
+      }
+      if (rand() % 3 == 0) {
+        const double value = (double) (rand() % 9 + 1);
+        B.insert({r, c}, value);
+        if (!masked) {
+          expected.insert({r, c}, value);
+        }
+      }
+    }
+  }
+  M.pack();
+  B.pack();
+  expected.pack();
+
+  Tensor<double> C("C", {N, N}, CSR);
+  C(i,j) = maskComplement(M(i,j), B(i,j));
+  C.evaluate();
+  ASSERT_TENSOR_EQ(expected, C);
+}
@@ -0,0 +1,126 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "taco/tensor.h"
+#include "taco/allocator.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/storage/numa.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j"), k("k");
+
+TEST(numa, arrays) {
+  ASSERT_LE(1, getNumNumaNodes());
+  ASSERT_LE(0, getCurrentNumaNode());
+  ASSERT_GT(getNumNumaNodes(), getCurrentNumaNode());
+
+  const std::vector<MemoryPlacement> placements = {
+    MemoryPlacement::Default, MemoryPlacement::FirstTouch,
+    MemoryPlacement::Interleave, MemoryPlacement::Replicate
+  };
+  const size_t size = 100003;
+  Array source = makeArray(Int32, size);
+  for (size_t n = 0; n < size; n++) {
+    ((int32_t*)source.getData())[n] = (int32_t)(n * 7);
+  }
+  for (auto placement : placements) {
+    for (int node : {-1, 0}) {
+      Array zeros = makeArray(Int32, size, placement, node);
+      ASSERT_EQ(0u, (uintptr_t)zeros.getData() % 64);
+      for (size_t n = 0; n < size; n++) {
+        ASSERT_EQ(0, ((int32_t*)zeros.getData())[n]);
+      }
+
+      Array copy = placeArray(source, placement, node);
+      ASSERT_NE(source.getData(), copy.getData());
+      ASSERT_EQ(size, copy.getSize());
+      ASSERT_EQ(0, memcmp(source.getData(), copy.getData(), size * 4));
+    }
+  }
+}
+
+TEST(numa, spmv) {
+  const int M = 311, N = 127;
+  srand(40813);
+  TensorBase A("A", Float64, {M, N}, CSR);
+  fillRandom(A, 7);
+  TensorBase x("x", Float64, {N}, Format({Dense}));
+  for (int c = 0; c < N; c++) {
+    x.insert({c}, (double)(c % 5));
+  }
+  x.pack();
+
+  TensorBase expected("expected", Float64, {M}, Format({Dense}));
+  expected(i) = A(i,j) * x(j);
+  expected.evaluate();
+
+  const std::vector<MemoryPlacement> placements = {
+    MemoryPlacement::FirstTouch, MemoryPlacement::Interleave,
+    MemoryPlacement::Replicate, MemoryPlacement::Default
+  };
+  for (auto placement : placements) {
+    A.setMemoryPlacement(placement);
+    x.setMemoryPlacement(placement);
+    ASSERT_EQ(placement, A.getMemoryPlacement());
+
+    TensorBase y("y", Float64, {M}, Format({Dense}));
+    y.setMemoryPlacement(placement);
+    y(i) = A(i,j) * x(j);
+    IndexVar i0("i0"), i1("i1");
+    IndexStmt stmt = y.getAssignment().concretize();
+    stmt = stmt.split(i, i0, i1, 16)
+               .parallelize(i0, ParallelUnit::CPUThread,
+                            OutputRaceStrategy::NoRaces);
+    y.compile(stmt);
+    y.assemble();
+    y.compute();
+    ASSERT_TENSOR_EQ(expected, y);
+    // Replicas hold the values of the tensor
+    ASSERT_EQ(0, memcmp(A.getStorage().getValues().getData(),
+                        A.getLocalStorage().getValues().getData(),
+                        A.getStorage().getValues().getSize() * sizeof(double)));
+  }
+}
+
+TEST(numa, packedResults) {
+  const int N = 43;
+  srand(27709);
+  TensorBase A("A", Float64, {N, N}, CSR);
+  fillRandom(A, 5);
+  TensorBase B("B", Float64, {N, N}, CSR);
+  fillRandom(B, 4);
+  TensorBase expected("expected", Float64, {N, N}, CSR);
+  expected(i,j) = sum(k, A(i,k) * B(k,j));
+  expected.evaluate();
+
+  // Temporaries of kernels that compute placed results are served by the
+  // allocator that is installed
+  auto allocator = std::make_shared<CountingAllocator>();
+  setKernelAllocator(std::make_shared<PlacementAllocator>(
+      MemoryPlacement::Interleave, allocator));
+  TensorBase C("C", Float64, {N, N}, CSR);
+  C(i,j) = sum(k, A(i,k) * B(k,j));
+  C.evaluate();
+  setKernelAllocator(nullptr);
+  ASSERT_TENSOR_EQ(expected, C);
+  ASSERT_LT(0, allocator->temporaries.load());
+  ASSERT_EQ(0, allocator->results.load());
+  ASSERT_LT(0, allocator->kernels.load());
+
+  TensorBase D("D", Float64, {N, N}, CSR);
+  D.setMemoryPlacement(MemoryPlacement::FirstTouch);
+  D(i,j) = sum(k, A(i,k) * B(k,j));
+  D.evaluate();
+  ASSERT_TENSOR_EQ(expected, D);
+
+  // Packed tensors are placed when their placement is set
+  TensorBase E("E", Float64, {N, N}, DCSR);
+  fillRandom(E, 3);
+  const void* values = E.getStorage().getValues().getData();
+  E.setMemoryPlacement(MemoryPlacement::Interleave);
+  ASSERT_NE(values, E.getStorage().getValues().getData());
+}
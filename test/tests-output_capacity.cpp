@@ -0,0 +1,74 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/allocator.h"
+#include "taco/index_notation/index_notation.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j"), k("k");
+
+struct outputCapacity : public TestWithParam<std::tuple<bool, bool>> {
+  /// Evaluates a result whose initial capacity is `allocSize` with a counting
+  /// allocator installed, and checks that estimated capacities never grow.
+  void evaluate(TensorBase& result, size_t allocSize) {
+    const bool estimate = std::get<0>(GetParam());
+    result.setEstimateAllocSize(estimate);
+    result.setAssembleWhileCompute(std::get<1>(GetParam()));
+    result.setAllocSize(allocSize);
+    auto allocator = std::make_shared<CountingAllocator>();
+    setKernelAllocator(allocator);
+    result.evaluate();
+    setKernelAllocator(nullptr);
+    if (estimate) {
+      ASSERT_EQ(0, allocator->reallocations.load());
+    }
+    else {
+      ASSERT_LT(0, allocator->reallocations.load());
+    }
+  }
+};
+
+TEST_P(outputCapacity, spgemm) {
+  const int N = 43;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, CSR);
+  srand(77743);
+  fillRandom(A, 6);
+  fillRandom(B, 6);
+
+  Tensor<double> C("C", {N, N}, CSR);
+  C(i,j) = sum(k, A(i,k) * B(k,j));
+  evaluate(C, 2);
+
+  Tensor<double> expected = denseProduct(A, B);
+  ASSERT_TENSOR_EQ(expected, C);
+}
+
+TEST_P(outputCapacity, addition) {
+  const int N = 37;
+  const Format dcsr({Sparse, Sparse});
+  Tensor<double> A("A", {N, N}, dcsr);
+  Tensor<double> B("B", {N, N}, CSR);
+  srand(40939);
+  fillRandom(A, 3);
+  fillRandom(B, 5);
+
+  Tensor<double> C("C", {N, N}, dcsr);
+  C(i,j) = A(i,j) + B(i,j) * A(i,j);
+  evaluate(C, 1);
+
+  // The hint bounds the number of coordinates, not the number of positions
+  ASSERT_EQ(std::string::npos, C.getSource().find("pos_size = C_capacity_hint"));
+
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      ASSERT_DOUBLE_EQ(A.at({r, c}) + B.at({r, c}) * A.at({r, c}),
+                       C.at({r, c})) << "(" << r << "," << c << ")";
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(outputCapacity, outputCapacity,
+                        Combine(::testing::Bool(), ::testing::Bool()));
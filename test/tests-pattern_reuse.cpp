@@ -0,0 +1,99 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j");
+
+static void scaleValues(Tensor<double>& tensor, double scale) {
+  double* values = (double*) tensor.getStorage().getValues().getData();
+  for (size_t k = 0; k < tensor.getStorage().getIndex().getSize(); k++) {
+    values[k] *= scale;
+  }
+}
+
+static void assertSum(Tensor<double>& B, Tensor<double>& C,
+                      Tensor<double>& A) {
+  const int N = A.getDimension(0);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      ASSERT_DOUBLE_EQ(B.at({r, c}) + C.at({r, c}), A.at({r, c}))
+          << "(" << r << "," << c << ")";
+    }
+  }
+}
+
+TEST(patternReuse, valuesOnlyRecompute) {
+  const int N = 27;
+  Tensor<double> B("B", {N, N}, CSR);
+  Tensor<double> C("C", {N, N}, CSR);
+  srand(61129);
+  fillRandom(B, 5);
+  fillRandom(C, 4);
+
+  Tensor<double> A("A", {N, N}, CSR);
+  A.setReuseSparsityPattern(true);
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  assertSum(B, C, A);
+  const void* crd = A.getStorage().getIndex().getModeIndex(1)
+                     .getIndexArray(1).getData();
+  const void* vals = A.getStorage().getValues().getData();
+
+  // Only the values of the operands change, so the index is kept and the
+  // values are overwritten in place.
+  scaleValues(B, 2.0);
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  assertSum(B, C, A);
+  ASSERT_EQ(crd, A.getStorage().getIndex().getModeIndex(1)
+                  .getIndexArray(1).getData());
+  ASSERT_EQ(vals, A.getStorage().getValues().getData());
+
+  // Changing the structure of an operand reassembles the result.
+  int row = 0, col = 0;
+  while (B.at({row, col}) != 0.0 || C.at({row, col}) != 0.0) {
+    col = (col + 1) % N;
+    row += (col == 0);
+  }
+  B.insert({row, col}, 7.0);
+  B.pack();
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  assertSum(B, C, A);
+  ASSERT_EQ(7.0, A.at({row, col}));
+  ASSERT_NE(crd, A.getStorage().getIndex().getModeIndex(1)
+                  .getIndexArray(1).getData());
+}
+
+TEST(patternReuse, inPlaceIndexChange) {
+  const int N = 8;
+  Tensor<double> B("B", {N, N}, CSR);
+  Tensor<double> C("C", {N, N}, CSR);
+  B.insert({2, 3}, 1.0);
+  B.insert({5, 1}, 2.0);
+  C.insert({2, 3}, 4.0);
+  B.pack();
+  C.pack();
+
+  Tensor<double> A("A", {N, N}, CSR);
+  A.setReuseSparsityPattern(true);
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  assertSum(B, C, A);
+
+  // Moving a coordinate of an operand in place keeps the sizes of all index
+  // arrays, but still reassembles the result
+  int* crd = (int*) B.getStorage().getIndex().getModeIndex(1)
+                     .getIndexArray(1).getData();
+  ASSERT_EQ(1, crd[1]);
+  crd[1] = 6;
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  ASSERT_EQ(2.0, A.at({5, 6}));
+  ASSERT_EQ(0.0, A.at({5, 1}));
+  assertSum(B, C, A);
+}
@@ -0,0 +1,136 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/storage/file_io_ttb.h"
+#include "taco/storage/row_blocks.h"
+#include "taco/util/env.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j"), k("k");
+
+TEST(row_blocks, spmv) {
+  const int M = 103, N = 37, R = 16;
+  srand(64591);
+  const std::vector<Format> formats = {CSR, DCSR, CSC, COO(2)};
+  for (auto& format : formats) {
+    TensorBase A("A", Float64, {M, N}, format);
+    fillRandom(A, 6);
+    // The outermost stored mode of CSC matrices is their columns
+    const bool rows = format.getModeOrdering()[0] == 0;
+    TensorBase x("x", Float64, {rows ? N : M}, Format({Dense}));
+    fillRandom(x, 1);
+    std::string filename = util::getTmpdir() + "/row_blocks.ttb";
+    write(filename, A);
+
+    TensorBase expected("expected", Float64, {rows ? M : N}, Format({Dense}));
+    TensorBase y("y", Float64, {rows ? M : N}, Format({Dense}));
+    if (rows) {
+      expected(i) = A(i,j) * x(j);
+    }
+    else {
+      expected(j) = A(i,j) * x(i);
+    }
+    expected.evaluate();
+
+    RowBlockStream blocks(filename, R);
+    ASSERT_EQ(rows ? M : N, blocks.getNumRows());
+    ASSERT_EQ((blocks.getNumRows() + R - 1) / R, blocks.getNumBlocks());
+    TensorBase block = blocks.getBlockTensor();
+    TensorBase z("z", Float64, {R}, Format({Dense}));
+    if (rows) {
+      z(i) = block(i,j) * x(j);
+    }
+    else {
+      z(j) = block(i,j) * x(i);
+    }
+
+    int numBlocks = 0;
+    blocks.evaluate(z, [&](int firstRow, int numRows, const TensorBase& z) {
+      ASSERT_EQ(numBlocks * R, firstRow);
+      ASSERT_EQ(std::min(R, blocks.getNumRows() - firstRow), numRows);
+      const double* values = (const double*)z.getStorage().getValues().getData();
+      for (int r = 0; r < numRows; r++) {
+        y.insert({firstRow + r}, values[r]);
+      }
+      numBlocks++;
+    });
+    ASSERT_EQ(blocks.getNumBlocks(), numBlocks);
+    y.pack();
+    ASSERT_TENSOR_EQ(expected, y);
+    remove(filename.c_str());
+  }
+}
+
+TEST(row_blocks, compoundAssignment) {
+  const int M = 61, N = 23, R = 8;
+  srand(30817);
+  TensorBase A("A", Float64, {M, N}, CSR);
+  fillRandom(A, 5);
+  TensorBase expected("expected", Float64, {N}, Format({Dense}));
+  expected(j) = sum(i, A(i,j));
+  expected.evaluate();
+
+  // Results of compound assignments hold the sums of one block at a time
+  RowBlockStream blocks(A, R);
+  TensorBase block = blocks.getBlockTensor();
+  TensorBase z("z", Float64, {N}, Format({Dense}));
+  z(j) += block(i,j);
+  std::vector<double> sums(N, 0.0);
+  int numBlocks = 0;
+  blocks.evaluate(z, [&](int, int, const TensorBase& z) {
+    const double* values = (const double*)z.getStorage().getValues().getData();
+    for (int c = 0; c < N; c++) {
+      sums[c] += values[c];
+    }
+    numBlocks++;
+  });
+  ASSERT_EQ(blocks.getNumBlocks(), numBlocks);
+  TensorBase y("y", Float64, {N}, Format({Dense}));
+  for (int c = 0; c < N; c++) {
+    y.insert({c}, sums[c]);
+  }
+  y.pack();
+  ASSERT_TENSOR_EQ(expected, y);
+}
+
+TEST(row_blocks, sparseResult) {
+  const int M = 45, N = 29, K = 7, R = 8;
+  srand(18253);
+  TensorBase A("A", Float64, {M, N, K}, Format({Dense,Sparse,Sparse}));
+  fillRandom(A, 30);
+  TensorBase B("B", Float64, {N, K}, CSR);
+  fillRandom(B, 3);
+  TensorBase expected("expected", Float64, {M}, Format({Sparse}));
+  expected(i) = A(i,j,k) * B(j,k);
+  expected.evaluate();
+
+  // Blocks of a tensor that is already in memory
+  RowBlockStream blocks(A, R);
+  TensorBase block = blocks.getBlockTensor();
+  TensorBase z("z", Float64, {R}, Format({Sparse}));
+  z(i) = block(i,j,k) * B(j,k);
+
+  TensorBase y("y", Float64, {M}, Format({Sparse}));
+  blocks.evaluate(z, [&](int firstRow, int numRows, const TensorBase& z) {
+    for (auto& value : iterate<double>(z)) {
+      // Rows of the last block past the end of A are empty
+      if (value.first[0] >= numRows) {
+        ASSERT_EQ(0.0, value.second);
+        continue;
+      }
+      y.insert({firstRow + value.first[0]}, value.second);
+    }
+  });
+  y.pack();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  Format symmetricFormat = CSR;
+  symmetricFormat.setSymmetric(true);
+  TensorBase S("S", Float64, {M, M}, symmetricFormat);
+  S.insert({1, 0}, 1.0);
+  S.pack();
+  ASSERT_THROW(RowBlockStream(S, R), TacoException);
+}
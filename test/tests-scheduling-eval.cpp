@@ -467,6 +467,70 @@ TEST(scheduling_eval, example_spmvCPU_splitpos) {
   ASSERT_TENSOR_EQ(expected, y);
 }
 
+TEST(scheduling_eval, example_spmvCPU_dividepos) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+  int NUM_I = 1021/10;
+  int NUM_J = 1039/10;
+  float SPARSITY = .3;
+  int NUM_THREADS = 4;
+  Tensor<double> A("A", {NUM_I, NUM_J}, CSR);
+  Tensor<double> x("x", {NUM_J}, Format({Dense}));
+  Tensor<double> y("y", {NUM_I}, Format({Dense}));
+
+  srand(53535);
+  for (int i = 0; i < NUM_I; i++) {
+    // A few dense rows so that some rows span several threads' nonzeros
+    float rowSparsity = (i % 25 == 0) ? 1.0 : SPARSITY;
+    for (int j = 0; j < NUM_J; j++) {
+      float rand_float = (float)rand()/(float)(RAND_MAX);
+      if (rand_float < rowSparsity) {
+        A.insert({i, j}, (double) ((int) (rand_float*3/SPARSITY)));
+      }
+    }
+  }
+
+  for (int j = 0; j < NUM_J; j++) {
+    float rand_float = (float)rand()/(float)(RAND_MAX);
+    x.insert({j}, (double) ((int) (rand_float*3/SPARSITY)));
+  }
+
+  x.pack();
+  A.pack();
+
+  IndexVar f("f"), fpos("fpos"), thread("thread"), thread_nz("thread_nz");
+  y(i) = A(i, j) * x(j);
+
+  IndexStmt stmt = y.getAssignment().concretize();
+  stmt = stmt.fuse(i, j, f)
+          .pos(f, fpos, A(i, j))
+          .divide(fpos, thread, thread_nz, NUM_THREADS)
+          .parallelize(thread, ParallelUnit::CPUThread, OutputRaceStrategy::Atomics);
+
+  y.compile(stmt);
+  y.assemble();
+  y.compute();
+
+  Tensor<double> expected("expected", {NUM_I}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // Rows are accumulated in a scalar, and only the first row of a partition
+  // and its carry-out row are written atomically
+  std::string source = y.getSource();
+  ASSERT_NE(std::string::npos, source.find("_first_row"));
+  size_t atomics = 0;
+  for (size_t pos = source.find("#pragma omp atomic"); pos != std::string::npos;
+       pos = source.find("#pragma omp atomic", pos + 1)) {
+    atomics++;
+  }
+  ASSERT_EQ(2u, atomics);
+}
+
 TEST(scheduling_eval, spmmCPU) {
   if (should_use_CUDA_codegen()) {
     return;
@@ -578,6 +642,102 @@ TEST(scheduling_eval, sddmmCPU) {
   ASSERT_TENSOR_EQ(expected, A);
 }
 
+TEST(scheduling_eval, vectorizeCPU) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+  int NUM_I = 1021/10;
+  int NUM_J = 1039/10;
+  Tensor<double> y("y", {NUM_I}, {Dense});
+  Tensor<double> A("A", {NUM_I, NUM_J}, {Dense, Dense});
+  Tensor<double> x("x", {NUM_J}, {Dense});
+
+  srand(85723);
+  for (int i = 0; i < NUM_I; i++) {
+    for (int j = 0; j < NUM_J; j++) {
+      A.insert({i, j}, (double) (rand() % 8));
+    }
+  }
+  for (int j = 0; j < NUM_J; j++) {
+    x.insert({j}, (double) (rand() % 8));
+  }
+  A.pack();
+  x.pack();
+
+  y(i) = A(i,j) * x(j);
+
+  IndexVar j0("j0"), j1("j1");
+  IndexStmt stmt = y.getAssignment().concretize();
+  stmt = stmt.split(j, j0, j1, 8)
+             .parallelize(j1, ParallelUnit::CPUVector,
+                          OutputRaceStrategy::ParallelReduction);
+
+  y.compile(stmt);
+  y.assemble();
+  y.compute();
+
+  Tensor<double> expected("expected", {NUM_I}, {Dense});
+  expected(i) = A(i,j) * x(j);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // The reduction into the output is declared to compilers that take OpenMP
+  // simd hints, while clang is only asked to vectorize
+  std::string source = y.getSource();
+  ASSERT_TRUE(source.find("#pragma omp simd reduction(+:") != std::string::npos ||
+              source.find("#pragma clang loop interleave(enable) "
+                          "vectorize(enable)") != std::string::npos) << source;
+  std::string report = y.getVectorizationReport();
+  if (source.find("reduction(+:") != std::string::npos) {
+    ASSERT_NE(std::string::npos, report.find("(requested)")) << report;
+  }
+}
+
+TEST(scheduling_eval, coiterateCPU) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+  int NUM_I = 1021/10;
+  int NUM_J = 1039/10;
+  Tensor<double> B("B", {NUM_I, NUM_J}, CSR);
+  Tensor<double> C("C", {NUM_I, NUM_J}, CSR);
+
+  srand(61237);
+  for (int i = 0; i < NUM_I; i++) {
+    for (int j = 0; j < NUM_J; j++) {
+      if (rand() % 40 == 0) {
+        B.insert({i, j}, (double) (rand() % 8 + 1));
+      }
+      if (rand() % 3 == 0) {
+        C.insert({i, j}, (double) (rand() % 8 + 1));
+      }
+    }
+  }
+  B.pack();
+  C.pack();
+
+  Tensor<double> expected("expected", {NUM_I, NUM_J}, CSR);
+  expected(i,j) = B(i,j) * C(i,j);
+  IndexStmt reference = expected.getAssignment().concretize();
+  expected.compile(reference.coiterate(j, CoIterationStrategy::Merge));
+  expected.assemble();
+  expected.compute();
+
+  for (auto strategy : {CoIterationStrategy::Gallop,
+                        CoIterationStrategy::SIMDMerge,
+                        CoIterationStrategy::Auto}) {
+    Tensor<double> A("A", {NUM_I, NUM_J}, CSR);
+    A(i,j) = B(i,j) * C(i,j);
+    IndexStmt stmt = A.getAssignment().concretize();
+    A.compile(stmt.coiterate(j, strategy));
+    A.assemble();
+    A.compute();
+    ASSERT_TENSOR_EQ(expected, A);
+  }
+}
+
 TEST(scheduling_eval, spmvCPU) {
   if (should_use_CUDA_codegen()) {
     return;
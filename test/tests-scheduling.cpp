@@ -26,6 +26,23 @@ TEST(scheduling, splitEquality) {
   ASSERT_NE(rel1, rel5);
 }
 
+TEST(scheduling, divideEquality) {
+  IndexVar i1, i2;
+  IndexVar j1, j2;
+  IndexVarRel rel1 = IndexVarRel(new DivideRelNode(i, i1, i2, 2));
+  IndexVarRel rel2 = IndexVarRel(new DivideRelNode(i, i1, i2, 2));
+  IndexVarRel rel3 = IndexVarRel(new DivideRelNode(j, i1, i1, 2));
+  IndexVarRel rel4 = IndexVarRel(new DivideRelNode(i, i1, i2, 4));
+  IndexVarRel rel5 = IndexVarRel(new DivideRelNode(i, j1, j2, 2));
+  IndexVarRel rel6 = IndexVarRel(new SplitRelNode(i, i1, i2, 2));
+
+  ASSERT_EQ(rel1, rel2);
+  ASSERT_NE(rel1, rel3);
+  ASSERT_NE(rel1, rel4);
+  ASSERT_NE(rel1, rel5);
+  ASSERT_NE(rel1, rel6);
+}
+
 TEST(scheduling, forallReplace) {
   IndexVar i1, j1, j2;
   Type t(type<double>(), {3});
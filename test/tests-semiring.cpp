@@ -0,0 +1,190 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <cmath>
+#include <limits>
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/semiring.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j"), k("k");
+
+TEST(semiring, minPlusSpMV) {
+  const int N = 37;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> x("x", {N}, Format({Dense}));
+  std::vector<std::vector<double>> weights(N, std::vector<double>(N, -1.0));
+
+  srand(37511);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (r != 0 && rand() % 5 == 0) {
+        weights[r][c] = (double) (rand() % 10);
+        A.insert({r, c}, weights[r][c]);
+      }
+    }
+  }
+  for (int c = 0; c < N; c++) {
+    x.insert({c}, (double) (rand() % 20));
+  }
+  A.pack();
+  x.pack();
+
+  Tensor<double> y("y", {N}, Format({Dense}));
+  y(i) = overSemiring(std::make_shared<MinPlusSemiring>(),
+                      sum(j, A(i,j) * x(j)));
+  y.evaluate();
+
+  ASSERT_NE(std::string::npos, y.getSource().find("INFINITY"));
+  for (int r = 0; r < N; r++) {
+    double expected = std::numeric_limits<double>::infinity();
+    for (int c = 0; c < N; c++) {
+      if (weights[r][c] >= 0.0) {
+        expected = std::min(expected, weights[r][c] + x.at({c}));
+      }
+    }
+    ASSERT_EQ(expected, y.at({r})) << "row " << r;
+  }
+}
+
+TEST(semiring, maxTimesSparseVector) {
+  const int N = 53;
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> x("x", {N}, Format({Sparse}));
+  std::vector<std::vector<double>> a(N, std::vector<double>(N, 0.0));
+  std::vector<double> xv(N, 0.0);
+
+  srand(90127);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (rand() % 4 == 0) {
+        a[r][c] = (double) (rand() % 8 + 1) / 8.0;
+        A.insert({r, c}, a[r][c]);
+      }
+    }
+  }
+  for (int c = 0; c < N; c++) {
+    if (rand() % 3 == 0) {
+      xv[c] = (double) (rand() % 8 + 1) / 8.0;
+      x.insert({c}, xv[c]);
+    }
+  }
+  A.pack();
+  x.pack();
+
+  Tensor<double> y("y", {N}, Format({Dense}));
+  y(i) = reduce(j, std::make_shared<MaxTimesSemiring>(),
+                semiringMul(std::make_shared<MaxTimesSemiring>(),
+                            A(i,j), x(j)));
+  y.evaluate();
+
+  for (int r = 0; r < N; r++) {
+    double expected = 0.0;
+    for (int c = 0; c < N; c++) {
+      expected = std::max(expected, a[r][c] * xv[c]);
+    }
+    ASSERT_DOUBLE_EQ(expected, y.at({r})) << "row " << r;
+  }
+}
+
+TEST(semiring, orAndSpGEMM) {
+  const int N = 29;
+  Tensor<int> A("A", {N, N}, CSR);
+  Tensor<int> B("B", {N, N}, CSR);
+  std::vector<std::vector<int>> a(N, std::vector<int>(N, 0));
+  std::vector<std::vector<int>> b(N, std::vector<int>(N, 0));
+
+  srand(66191);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      if (rand() % 9 == 0) {
+        a[r][c] = 1;
+        A.insert({r, c}, 1);
+      }
+      if (rand() % 9 == 0) {
+        b[r][c] = 1;
+        B.insert({r, c}, 1);
+      }
+    }
+  }
+  A.pack();
+  B.pack();
+
+  Tensor<int> C("C", {N, N}, Format({Dense, Dense}));
+  C(i,j) = overSemiring(std::make_shared<OrAndSemiring>(),
+                        sum(k, A(i,k) * B(k,j)));
+  C.evaluate();
+
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      int expected = 0;
+      for (int m = 0; m < N; m++) {
+        expected |= a[r][m] & b[m][c];
+      }
+      ASSERT_EQ(expected, C.at({r, c})) << "(" << r << "," << c << ")";
+    }
+  }
+}
+
+TEST(semiring, additionIteratesUnion) {
+  Tensor<double> b("b", {8}, Format({Sparse}));
+  Tensor<double> c("c", {8}, Format({Sparse}));
+  b.insert({1}, 4.0);
+  b.insert({5}, 2.0);
+  c.insert({5}, 3.0);
+  c.insert({6}, 1.0);
+  b.pack();
+  c.pack();
+
+  Tensor<double> a("a", {8}, Format({Sparse}));
+  a(i) = semiringAdd(std::make_shared<MinPlusSemiring>(), b(i), c(i));
+  a.evaluate();
+
+  Tensor<double> expected("expected", {8}, Format({Sparse}));
+  expected.insert({1}, 4.0);
+  expected.insert({5}, 2.0);
+  expected.insert({6}, 1.0);
+  expected.pack();
+  ASSERT_TENSOR_EQ(expected, a);
+}
+
+namespace {
+
+// A semiring that shares the name of the min-plus semiring
+class MaxPlusSemiring : public MinPlusSemiring {
+public:
+  ir::Expr add(ir::Expr a, ir::Expr b) const {
+    return ir::Max::make(a, b);
+  }
+
+  IndexExpr addIdentity(Datatype type) const {
+    return Literal(-std::numeric_limits<double>::infinity());
+  }
+};
+
+}
+
+TEST(semiring, kernelsDistinguishSemirings) {
+  Tensor<double> b("b", {8}, Format({Sparse}));
+  Tensor<double> c("c", {8}, Format({Sparse}));
+  b.insert({1}, 4.0);
+  b.insert({5}, 2.0);
+  c.insert({5}, 3.0);
+  b.pack();
+  c.pack();
+
+  // Kernels of semirings with the same name are not reused for each other
+  Tensor<double> a("a", {8}, Format({Sparse}));
+  a(i) = semiringAdd(std::make_shared<MinPlusSemiring>(), b(i), c(i));
+  a.evaluate();
+  ASSERT_EQ(2.0, a.at({5}));
+
+  Tensor<double> d("d", {8}, Format({Sparse}));
+  d(i) = semiringAdd(std::make_shared<MaxPlusSemiring>(), b(i), c(i));
+  d.evaluate();
+  ASSERT_EQ(3.0, d.at({5}));
+  ASSERT_FALSE(equals(a.getAssignment().getRhs(), d.getAssignment().getRhs()));
+}
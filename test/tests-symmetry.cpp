@@ -0,0 +1,215 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <sstream>
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/storage/file_io_mtx.h"
+#include "taco/util/env.h"
+
+using namespace taco;
+
+static const IndexVar i("i"), j("j"), k("k");
+
+static Format symmetricCSR() {
+  Format format = CSR;
+  format.setSymmetric(true);
+  return format;
+}
+
+// Insert the same random symmetric matrix into a symmetric and a general
+// tensor.
+static void fillSymmetric(Tensor<double>& symmetric, Tensor<double>& general,
+                          unsigned int seed) {
+  const int N = general.getDimension(0);
+  srand(seed);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c <= r; c++) {
+      if (r == c || rand() % 4 == 0) {
+        double value = (double)(rand() % 10 + 1);
+        symmetric.insert({r, c}, value);
+        general.insert({r, c}, value);
+        if (r != c) {
+          symmetric.insert({c, r}, value);
+          general.insert({c, r}, value);
+        }
+      }
+    }
+  }
+  symmetric.pack();
+  general.pack();
+}
+
+TEST(symmetry, pack) {
+  const int N = 23;
+  Tensor<double> S("S", {N, N}, symmetricCSR());
+  Tensor<double> A("A", {N, N}, CSR);
+  fillSymmetric(S, A, 70913);
+
+  // Only the lower triangle is stored
+  size_t lower = 0;
+  for (auto& value : iterate<double>(A)) {
+    lower += (value.first[0] >= value.first[1]);
+  }
+  ASSERT_EQ(lower, S.getStorage().getIndex().getSize());
+  for (auto& value : iterate<double>(S)) {
+    ASSERT_GE(value.first[0], value.first[1]);
+  }
+
+  // Components inserted only into the upper triangle are stored as their
+  // mirror
+  Tensor<double> U("U", {N, N}, symmetricCSR());
+  for (auto& value : iterate<double>(A)) {
+    if (value.first[0] <= value.first[1]) {
+      U.insert({value.first[0], value.first[1]}, value.second);
+    }
+  }
+  U.pack();
+  ASSERT_TRUE(equals(S, U));
+}
+
+TEST(symmetry, spmv) {
+  const int N = 37;
+  Tensor<double> S("S", {N, N}, symmetricCSR());
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> x("x", {N}, Format({Dense}));
+  fillSymmetric(S, A, 60337);
+  for (int r = 0; r < N; r++) {
+    x.insert({r}, (double)(rand() % 10));
+  }
+  x.pack();
+
+  Tensor<double> expected("expected", {N}, Format({Dense}));
+  expected(i) = A(i,j) * x(j);
+  expected.evaluate();
+
+  Tensor<double> y("y", {N}, Format({Dense}));
+  y(i) = S(i,j) * x(j);
+  y.evaluate();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // The transposed product reads the same stored triangle
+  Tensor<double> z("z", {N}, Format({Dense}));
+  z(j) = x(i) * S(i,j);
+  z.evaluate();
+  ASSERT_TENSOR_EQ(expected, z);
+
+  Tensor<double> quadratic("quadratic");
+  quadratic = x(i) * S(i,j) * x(j);
+  quadratic.evaluate();
+  Tensor<double> expectedQuadratic("expectedQuadratic");
+  expectedQuadratic = x(i) * A(i,j) * x(j);
+  expectedQuadratic.evaluate();
+  ASSERT_TENSOR_EQ(expectedQuadratic, quadratic);
+}
+
+TEST(symmetry, spmm) {
+  const int N = 19, K = 5;
+  Tensor<double> S("S", {N, N}, symmetricCSR());
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, K}, Format({Dense, Dense}));
+  fillSymmetric(S, A, 33119);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < K; c++) {
+      B.insert({r, c}, (double)(rand() % 10));
+    }
+  }
+  B.pack();
+
+  Tensor<double> expected("expected", {N, K}, Format({Dense, Dense}));
+  expected(i,k) = A(i,j) * B(j,k);
+  expected.evaluate();
+
+  Tensor<double> C("C", {N, K}, Format({Dense, Dense}));
+  C(i,k) = S(i,j) * B(j,k);
+  C.evaluate();
+  ASSERT_TENSOR_EQ(expected, C);
+}
+
+TEST(symmetry, unsupported) {
+  const int N = 7;
+  Tensor<double> S("S", {N, N}, symmetricCSR());
+  Tensor<double> A("A", {N, N}, CSR);
+  fillSymmetric(S, A, 28859);
+
+  // Sums do not scatter a component of the symmetric matrix to its mirror
+  Tensor<double> B("B", {N, N}, Format({Dense, Dense}));
+  B(i,j) = S(i,j) + A(i,j);
+  ASSERT_THROW(B.compile(), taco::TacoException);
+
+  // Sparse results cannot be scattered into
+  Tensor<double> y("y", {N}, Format({Sparse}));
+  Tensor<double> x("x", {N}, Format({Dense}));
+  y(i) = S(i,j) * x(j);
+  ASSERT_THROW(y.compile(), taco::TacoException);
+
+  // The mirrored components would read a sparse matrix transposed
+  Tensor<double> z("z", {N}, Format({Dense}));
+  z(i) = S(i,j) * A(i,j);
+  ASSERT_THROW(z.compile(), taco::TacoException);
+}
+
+TEST(symmetry, elementwise) {
+  const int N = 17;
+  Tensor<double> S("S", {N, N}, symmetricCSR());
+  Tensor<double> A("A", {N, N}, CSR);
+  Tensor<double> B("B", {N, N}, Format({Dense, Dense}));
+  fillSymmetric(S, A, 91823);
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) {
+      B.insert({r, c}, (double)(rand() % 10));
+    }
+  }
+  B.pack();
+
+  // Dense operands indexed by both variables are read at the mirrored
+  // coordinates
+  Tensor<double> expected("expected", {N}, Format({Dense}));
+  expected(i) = A(i,j) * B(i,j);
+  expected.evaluate();
+  Tensor<double> y("y", {N}, Format({Dense}));
+  y(i) = S(i,j) * B(i,j);
+  y.evaluate();
+  ASSERT_TENSOR_EQ(expected, y);
+}
+
+TEST(symmetry, mtx) {
+  const int N = 13;
+  Tensor<double> S("S", {N, N}, symmetricCSR());
+  Tensor<double> A("A", {N, N}, CSR);
+  fillSymmetric(S, A, 52457);
+
+  std::stringstream stream;
+  writeMTX(stream, S);
+  ASSERT_NE(std::string::npos, stream.str().find("symmetric"));
+
+  // Symmetric files keep their lower triangle in symmetric formats and are
+  // expanded otherwise
+  std::stringstream symmetricStream(stream.str());
+  TensorBase symmetric = readMTX(symmetricStream, symmetricCSR());
+  ASSERT_TRUE(symmetric.getFormat().isSymmetric());
+  ASSERT_EQ(S.getStorage().getIndex().getSize(),
+            symmetric.getStorage().getIndex().getSize());
+  ASSERT_TRUE(equals(S, symmetric));
+
+  std::stringstream generalStream(stream.str());
+  TensorBase general = readMTX(generalStream, CSR);
+  ASSERT_TRUE(equals(A, general));
+}
+
+TEST(symmetry, ttb) {
+  const int N = 11;
+  Tensor<double> S("S", {N, N}, symmetricCSR());
+  Tensor<double> A("A", {N, N}, CSR);
+  fillSymmetric(S, A, 41269);
+
+  std::string filename = util::getTmpdir() + "/symmetric.ttb";
+  write(filename, S);
+  TensorBase mapped = read(filename, symmetricCSR());
+  ASSERT_EQ(symmetricCSR(), mapped.getFormat());
+  ASSERT_TRUE(equals(S, mapped));
+
+  TensorBase expanded = read(filename, CSR);
+  ASSERT_TRUE(equals(A, expanded));
+}
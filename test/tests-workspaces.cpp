@@ -7,6 +7,7 @@
 #include "taco/index_notation/index_notation.h"
 #include "codegen/codegen.h"
 #include "taco/lower/lower.h"
+#include <thread>
 
 using namespace taco;
 
@@ -186,3 +187,246 @@ TEST(workspaces, tile_denseMatMul) {
 //  codegen->compile(compute, false);
   
 }
+
+// Returns the source of the kernel that computes the product
+static std::string spgemmWithWorkspace(int numCols, Format resultFormat) {
+  Tensor<double> B("B", {16, 24}, CSR);
+  Tensor<double> C("C", {24, numCols}, CSR);
+
+  for (int i = 0; i < 16; i++) {
+    for (int k = 0; k < 24; k++) {
+      if ((i + k) % 3 == 0) {
+        B.insert({i, k}, (double) (i + k));
+      }
+    }
+  }
+  for (int k = 0; k < 24; k++) {
+    for (int j = k; j < numCols; j += (k + 1) * numCols / 200) {
+      C.insert({k, j}, (double) j);
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i("i"), j("j"), k("k");
+  WorkspaceKind kind = getWorkspaceKind();
+  setWorkspaceKind(WorkspaceKind::Dense);
+  Tensor<double> expected("expected", {16, numCols}, CSR);
+  expected(i, j) = B(i, k) * C(k, j);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  setWorkspaceKind(kind);
+
+  Tensor<double> A("A", {16, numCols}, resultFormat);
+  TensorVar w("w", Type(Float64, {(size_t)numCols}), taco::dense);
+  TensorVar a = A.getTensorVar(), b = B.getTensorVar(), c = C.getTensorVar();
+  IndexStmt stmt = forall(i, where(forall(j, a(i, j) = w(j)),
+                                   forall(k, forall(j, w(j) += b(i, k) * c(k, j)))));
+  A(i, j) = B(i, k) * C(k, j);
+  A.compile(stmt);
+  A.assemble();
+  A.compute();
+
+  if (resultFormat.getModeFormats()[1].isOrdered()) {
+    ASSERT_TENSOR_EQ(expected, A);
+  }
+  else {
+    // Rows of an unordered result may be in any order, so compare them sorted
+    auto rowsOf = [](const Tensor<double>& tensor) {
+      const Index& index = tensor.getStorage().getIndex();
+      const int* pos = (const int*)index.getModeIndex(1).getIndexArray(0).getData();
+      const int* crd = (const int*)index.getModeIndex(1).getIndexArray(1).getData();
+      const double* vals = (const double*)tensor.getStorage().getValues().getData();
+      std::vector<std::vector<std::pair<int,double>>> rows(tensor.getDimension(0));
+      for (int i = 0; i < tensor.getDimension(0); i++) {
+        for (int p = pos[i]; p < pos[i + 1]; p++) {
+          rows[i].push_back({crd[p], vals[p]});
+        }
+        std::sort(rows[i].begin(), rows[i].end());
+      }
+      return rows;
+    };
+    EXPECT_EQ(rowsOf(expected), rowsOf(A));
+  }
+  return A.getSource();
+}
+
+TEST(workspaces, sparseAccelerationGuard) {
+  // Kernels compiled under each guard are cached separately
+  for (auto guard : {WorkspaceGuard::Bool, WorkspaceGuard::BitPacked}) {
+    setWorkspaceGuard(guard);
+    const std::string source = spgemmWithWorkspace(200, CSR);
+    ASSERT_NE(std::string::npos,
+              source.find(guard == WorkspaceGuard::Bool
+                          ? "bool* restrict w_already_set"
+                          : "uint64_t* restrict w_already_set"));
+  }
+  setWorkspaceGuard(WorkspaceGuard::BitPacked);
+}
+
+TEST(workspaces, sparseAccelerationOrdering) {
+  for (auto guard : {WorkspaceGuard::Bool, WorkspaceGuard::BitPacked}) {
+    setWorkspaceGuard(guard);
+    for (auto ordering : {WorkspaceOrdering::Sort, WorkspaceOrdering::Adaptive}) {
+      setWorkspaceOrdering(ordering);
+      // Short, dense and long, sparse coordinate lists
+      const std::string source = spgemmWithWorkspace(200, CSR);
+      ASSERT_EQ(ordering == WorkspaceOrdering::Adaptive,
+                source.find("= taco_orderIndexList(") != std::string::npos);
+      spgemmWithWorkspace(100000, CSR);
+    }
+  }
+  setWorkspaceGuard(WorkspaceGuard::BitPacked);
+  setWorkspaceOrdering(WorkspaceOrdering::Adaptive);
+
+  spgemmWithWorkspace(200, Format({Dense, Compressed(ModeFormat::NOT_ORDERED)}));
+}
+
+TEST(workspaces, sparseAccelerationHash) {
+  setWorkspaceKind(WorkspaceKind::Hash);
+  ASSERT_NE(std::string::npos, spgemmWithWorkspace(200, CSR).find("w_keys"));
+  spgemmWithWorkspace(100000, CSR);
+  spgemmWithWorkspace(200, Format({Dense, Compressed(ModeFormat::NOT_ORDERED)}));
+
+  // Hash maps are not written atomically, so producers that run in parallel
+  // use dense workspaces
+  IndexVar i("i"), j("j"), k("k");
+  TensorVar a("a", Type(Float64, {16, 200}), CSR);
+  TensorVar b("b", Type(Float64, {16, 24}), CSR);
+  TensorVar c("c", Type(Float64, {24, 200}), CSR);
+  TensorVar w("w", Type(Float64, {200}), taco::dense);
+  IndexStmt stmt = forall(i, where(forall(j, a(i, j) = w(j)),
+                                   forall(k, forall(j, w(j) += b(i, k) * c(k, j)))));
+  stmt = stmt.parallelize(k, ParallelUnit::CPUThread, OutputRaceStrategy::Atomics);
+  std::stringstream compute;
+  compute << lower(stmt, "compute", false, true);
+  ASSERT_EQ(std::string::npos, compute.str().find("w_keys"));
+
+  // Workspaces too large to index with 32-bit hash keys use dense arrays
+  TensorVar A("A", Type(Float64, {16, (1 << 29) + 1}), CSR);
+  TensorVar C("C", Type(Float64, {24, (1 << 29) + 1}), CSR);
+  TensorVar W("W", Type(Float64, {(1 << 29) + 1}), taco::dense);
+  IndexStmt large = forall(i, where(forall(j, A(i, j) = W(j)),
+                                    forall(k, forall(j, W(j) += b(i, k) * C(k, j)))));
+  std::stringstream largeCompute;
+  largeCompute << lower(large, "compute", false, true);
+  ASSERT_EQ(std::string::npos, largeCompute.str().find("W_keys"));
+
+  // Large workspaces are automatically stored in hash maps
+  setWorkspaceKind(WorkspaceKind::Auto);
+  ASSERT_NE(std::string::npos,
+            spgemmWithWorkspace(1 << 21, CSR).find("w_keys"));
+}
+
+TEST(workspaces, persistentLifetime) {
+  Tensor<double> B("B", {16, 24}, CSR);
+  Tensor<double> C("C", {24, 300}, CSR);
+  srand(30851);
+  for (int i = 0; i < 16; i++) {
+    for (int k = 0; k < 24; k++) {
+      if (rand() % 3 == 0) {
+        B.insert({i, k}, (double) (rand() % 9 + 1));
+      }
+    }
+  }
+  for (int k = 0; k < 24; k++) {
+    for (int j = 0; j < 300; j++) {
+      if (rand() % 20 == 0) {
+        C.insert({k, j}, (double) (rand() % 9 + 1));
+      }
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i("i"), j("j"), k("k");
+  Tensor<double> expected("expected", {16, 300}, CSR);
+  expected(i, j) = B(i, k) * C(k, j);
+  expected.evaluate();
+
+  // Compile a kernel for every workspace representation
+  setWorkspaceLifetime(WorkspaceLifetime::Persistent);
+  for (auto kind : {WorkspaceKind::Dense, WorkspaceKind::Hash}) {
+    for (auto guard : {WorkspaceGuard::Bool, WorkspaceGuard::BitPacked}) {
+      setWorkspaceKind(kind);
+      setWorkspaceGuard(guard);
+      Tensor<double> A("A", {16, 300}, CSR);
+      A(i, j) = B(i, k) * C(k, j);
+      A.compile();
+      ASSERT_NE(std::string::npos,
+                A.getSource().find("= taco_acquireWorkspace("));
+      ASSERT_EQ(kind == WorkspaceKind::Hash,
+                A.getSource().find("w_keys") != std::string::npos);
+
+      // Workspaces are allocated by the first call and kept by the following
+      // calls, which find them clean since consuming them resets what the
+      // previous call wrote
+      size_t workspaceSize = 0;
+      for (int run = 0; run < 3; run++) {
+        A.assemble();
+        A.compute();
+        ASSERT_TENSOR_EQ(expected, A);
+        if (run == 0) {
+          workspaceSize = A.getWorkspaceSize();
+          ASSERT_LT(0u, workspaceSize);
+        }
+        ASSERT_EQ(workspaceSize, A.getWorkspaceSize());
+      }
+
+      A.releaseWorkspaces();
+      ASSERT_EQ(0u, A.getWorkspaceSize());
+      A.assemble();
+      A.compute();
+      ASSERT_TENSOR_EQ(expected, A);
+    }
+  }
+
+  // Tensors that share a kernel keep their own workspaces
+  Tensor<double> D("D", {16, 300}, CSR);
+  D(i, j) = B(i, k) * C(k, j);
+  D.evaluate();
+  Tensor<double> E("E", {16, 300}, CSR);
+  E(i, j) = B(i, k) * C(k, j);
+  E.evaluate();
+  ASSERT_LT(0u, E.getWorkspaceSize());
+  D.releaseWorkspaces();
+  ASSERT_EQ(0u, D.getWorkspaceSize());
+  ASSERT_LT(0u, E.getWorkspaceSize());
+
+  // The workspaces of a thread are freed when it exits
+  Tensor<double> F("F", {16, 300}, CSR);
+  F(i, j) = B(i, k) * C(k, j);
+  F.compile();
+  std::thread thread([&]() {
+    F.assemble();
+    F.compute();
+  });
+  thread.join();
+  ASSERT_EQ(0u, F.getWorkspaceSize());
+  ASSERT_TENSOR_EQ(expected, F);
+
+  // Dense workspaces that are not consumed by their written coordinates are
+  // kept too, but are still zeroed for every row they are filled for
+  Tensor<double> G("G", {16, 300}, Format({Dense, Dense}));
+  TensorVar w("w", Type(Float64, {300}), taco::dense);
+  TensorVar g = G.getTensorVar(), b = B.getTensorVar(), c = C.getTensorVar();
+  IndexStmt stmt = forall(i, where(forall(j, g(i, j) = w(j)),
+                                   forall(k, forall(j, w(j) += b(i, k) * c(k, j)))));
+  G(i, j) = B(i, k) * C(k, j);
+  G.compile(stmt);
+  ASSERT_NE(std::string::npos, G.getSource().find("w[pw] = 0.0;"));
+  Tensor<double> denseExpected("denseExpected", {16, 300},
+                               Format({Dense, Dense}));
+  denseExpected(i, j) = B(i, k) * C(k, j);
+  denseExpected.evaluate();
+  for (int run = 0; run < 3; run++) {
+    G.assemble();
+    G.compute();
+    ASSERT_TENSOR_EQ(denseExpected, G);
+  }
+  ASSERT_LT(0u, G.getWorkspaceSize());
+  setWorkspaceLifetime(WorkspaceLifetime::Call);
+  setWorkspaceKind(WorkspaceKind::Auto);
+  setWorkspaceGuard(WorkspaceGuard::BitPacked);
+}
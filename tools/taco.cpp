@@ -231,6 +231,13 @@ static void printSchedulingHelp() {
               "size of the inner index variable `i1` is then held constant at "
               "`factor`, which must be a positive integer.");
     cout << endl;
+    printFlag("s=divide(i, i0, i1, factor)", "Divides an index variable `i` "
+              "into two nested index variables `i0` and `i1`. The size of the "
+              "outer index variable `i0` is then held constant at `factor`, "
+              "which must be a positive integer. Dividing a position variable "
+              "`fpos` from fuse and pos and then parallelizing `i0` with "
+              "atomics gives each thread an equal share of the nonzeros.");
+    cout << endl;
     printFlag("s=precompute(expr, i, iw)", "Leverages scratchpad memories and "
               "reorders computations to increase locality.  Given a subexpression "
               "`expr` to precompute, an index variable `i` to precompute over, "
@@ -254,6 +261,11 @@ static void printSchedulingHelp() {
               "index variable `i` by `factor` number of iterations, where "
               "`factor` is a positive integer.");
     cout << endl;
+    printFlag("s=coiterate(i, strat)", "Sets how the loop corresponding to an "
+              "index variable `i` intersects sparse operands. Possible "
+              "strategies are: Auto (chosen at runtime from segment lengths), "
+              "Merge, Gallop, SIMDMerge.");
+    cout << endl;
     printFlag("s=parallelize(i, u, strat)", "tags an index variable `i` for "
               "parallel execution on hardware type `u`. Data races are handled by "
               "an output race strategy `strat`. Since the other transformations "
@@ -338,18 +350,18 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
       IndexVar split2(i2);
       stmt = stmt.split(findVar(i), split1, split2, splitFactor);
 
-    // } else if (command == "divide") {
-    //   string i, i1, i2;
-    //   in >> i;
-    //   in >> i1;
-    //   in >> i2;
-
-    //   size_t divideFactor;
-    //   in >> divideFactor;
+    } else if (command == "divide") {
+      taco_uassert(scheduleCommand.size() == 4) << "'divide' scheduling directive takes 4 parameters: divide(i, i1, i2, divideFactor)";
+      string i, i1, i2;
+      size_t divideFactor;
+      i  = scheduleCommand[0];
+      i1 = scheduleCommand[1];
+      i2 = scheduleCommand[2];
+      taco_uassert(sscanf(scheduleCommand[3].c_str(), "%zu", &divideFactor) == 1) << "failed to parse fourth parameter to `divide` directive as a size_t";
 
-    //   IndexVar divide1(i1);
-    //   IndexVar divide2(i2);
-    //   stmt = stmt.divide(findVar(i), divide1, divide2, divideFactor);
+      IndexVar divide1(i1);
+      IndexVar divide2(i2);
+      stmt = stmt.divide(findVar(i), divide1, divide2, divideFactor);
 
     } else if (command == "precompute") {
       string exprStr, i, iw;
@@ -477,6 +489,28 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
 
       stmt = stmt.unroll(findVar(i), unrollFactor);
 
+    } else if (command == "coiterate") {
+      taco_uassert(scheduleCommand.size() == 2) << "'coiterate' scheduling directive takes 2 parameters: coiterate(i, strategy)";
+      string i, strategy;
+      i        = scheduleCommand[0];
+      strategy = scheduleCommand[1];
+
+      CoIterationStrategy coiteration_strategy;
+      if (strategy == "Auto") {
+        coiteration_strategy = CoIterationStrategy::Auto;
+      } else if (strategy == "Merge") {
+        coiteration_strategy = CoIterationStrategy::Merge;
+      } else if (strategy == "Gallop") {
+        coiteration_strategy = CoIterationStrategy::Gallop;
+      } else if (strategy == "SIMDMerge") {
+        coiteration_strategy = CoIterationStrategy::SIMDMerge;
+      } else {
+        taco_uerror << "Co-iteration strategy not defined.";
+        goto end;
+      }
+
+      stmt = stmt.coiterate(findVar(i), coiteration_strategy);
+
     } else if (command == "parallelize") {
       string i, unit, strategy;
       taco_uassert(scheduleCommand.size() == 3) << "'parallelize' scheduling directive takes 3 parameters: parallelize(i, unit, strategy)";